@@ -0,0 +1,12 @@
+#include "core/Bench.h"
+#include "core/Allocator.h"
+
+
+int main( int argc, char **argv )
+{
+    Core::initAllocators();
+    int result = Core::bench::main( argc, argv );
+    Core::destroyAllocators();
+    
+    return result;
+}
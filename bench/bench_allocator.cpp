@@ -0,0 +1,49 @@
+#include "core/Bench.h"
+#include "core/Allocator.h"
+#include "core/AllocationTracker.h"
+
+
+namespace {
+    using Core::BenchContext;
+    using namespace Core::bench;
+    
+    static const std::size_t LIVE_ALLOCATIONS = 64;
+    
+    // allocates and frees in batches, so the allocator has live blocks to work around
+    void allocateBatches( BenchContext &context, Core::Allocator *allocator )
+    {
+        const std::size_t size = std::size_t( context.parameter );
+        void *ptrs[LIVE_ALLOCATIONS];
+        
+        for( uint64_t i=0; i < context.iterations; ++i ) {
+            for( std::size_t j=0; j < LIVE_ALLOCATIONS; ++j ) {
+                ptrs[j] = allocator->allocate( size, 16 );
+                doNotOptimize( ptrs[j] );
+            }
+            for( std::size_t j=0; j < LIVE_ALLOCATIONS; ++j ) {
+                allocator->free( ptrs[j] );
+            }
+        }
+    }
+    
+    void defaultAllocator( BenchContext &context )
+    {
+        allocateBatches( context, Core::getDefaultAllocator() );
+    }
+    CORE_BENCH( defaultAllocator, 16, 256, 4096 );
+    
+    void scrapAllocator( BenchContext &context )
+    {
+        allocateBatches( context, Core::getScrapAllocator() );
+    }
+    CORE_BENCH( scrapAllocator, 16, 256, 4096 );
+    
+    // the cost of the tracking on top of the default allocator
+    void trackingAllocator( BenchContext &context )
+    {
+        Core::AllocationTracker *tracker = Core::createAllocationTracker( Core::getDefaultAllocator() );
+        allocateBatches( context, Core::allocationTracker::allocator(tracker) );
+        Core::destroyAllocationTracker( tracker );
+    }
+    CORE_BENCH( trackingAllocator, 16, 256, 4096 );
+}
@@ -0,0 +1,70 @@
+#include "core/Bench.h"
+#include "core/Array.h"
+#include "core/Allocator.h"
+
+
+namespace {
+    using Core::BenchContext;
+    using namespace Core::bench;
+    
+    void arrayPushBack( BenchContext &context )
+    {
+        const std::size_t count = std::size_t( context.parameter );
+        for( uint64_t i=0; i < context.iterations; ++i ) {
+            Core::Array<uint32_t> array( Core::getDefaultAllocator() );
+            for( std::size_t j=0; j < count; ++j ) {
+                Core::array::pushBack( array, uint32_t(j) );
+            }
+            doNotOptimize( Core::array::begin(array) );
+        }
+    }
+    CORE_BENCH( arrayPushBack, 16, 1024, 65536 );
+    
+    void arrayPushBackReserved( BenchContext &context )
+    {
+        const std::size_t count = std::size_t( context.parameter );
+        for( uint64_t i=0; i < context.iterations; ++i ) {
+            Core::Array<uint32_t> array( Core::getDefaultAllocator() );
+            Core::array::reserve( array, count );
+            for( std::size_t j=0; j < count; ++j ) {
+                Core::array::pushBack( array, uint32_t(j) );
+            }
+            doNotOptimize( Core::array::begin(array) );
+        }
+    }
+    CORE_BENCH( arrayPushBackReserved, 16, 1024, 65536 );
+    
+    void arrayIterate( BenchContext &context )
+    {
+        const std::size_t count = std::size_t( context.parameter );
+        Core::Array<uint32_t> array( Core::getDefaultAllocator() );
+        Core::array::resize( array, count );
+        for( std::size_t j=0; j < count; ++j ) {
+            array[j] = uint32_t( j );
+        }
+        
+        for( uint64_t i=0; i < context.iterations; ++i ) {
+            uint64_t sum = 0;
+            for( const uint32_t *value = Core::array::begin(array); value != Core::array::end(array); ++value ) {
+                sum += *value;
+            }
+            doNotOptimize( sum );
+            clobber();
+        }
+    }
+    // the largest is past the last level cache of most machines
+    CORE_BENCH( arrayIterate, 1024, 65536, 16*1024*1024 );
+    
+    void arrayCopy( BenchContext &context )
+    {
+        const std::size_t count = std::size_t( context.parameter );
+        Core::Array<uint32_t> array( Core::getDefaultAllocator() );
+        Core::array::resize( array, count );
+        
+        for( uint64_t i=0; i < context.iterations; ++i ) {
+            Core::Array<uint32_t> copy( array );
+            doNotOptimize( Core::array::begin(copy) );
+        }
+    }
+    CORE_BENCH( arrayCopy, 1024, 65536 );
+}
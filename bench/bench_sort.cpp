@@ -0,0 +1,114 @@
+#include "core/Bench.h"
+#include "core/Array.h"
+#include "core/ArrayView.h"
+#include "core/Allocator.h"
+
+#include <cstring>
+
+
+namespace {
+    using Core::BenchContext;
+    using namespace Core::bench;
+    
+    // xorshift, so every run sorts the same input
+    uint32_t nextRandom( uint32_t &state )
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+    
+    enum class Order {
+        Random,
+        Sorted,
+        Reversed
+    };
+    
+    template< typename Type >
+    void fill( Core::Array<Type> &array, Order order )
+    {
+        uint32_t state = 0x9e3779b9;
+        const std::size_t count = Core::array::size( array );
+        for( std::size_t i=0; i < count; ++i ) {
+            switch( order ) {
+            case Order::Random:
+                array[i] = Type( nextRandom(state) );
+                break;
+            case Order::Sorted:
+                array[i] = Type( i );
+                break;
+            case Order::Reversed:
+                array[i] = Type( count - i );
+                break;
+            }
+        }
+    }
+    
+    // copies the input back in before each sort, outside of the measured time
+    template< typename Type >
+    void sortArray( BenchContext &context, Order order )
+    {
+        const std::size_t count = std::size_t( context.parameter );
+        Core::Array<Type> input( Core::getDefaultAllocator() );
+        Core::Array<Type> array( Core::getDefaultAllocator() );
+        Core::array::resize( input, count );
+        Core::array::resize( array, count );
+        fill( input, order );
+        
+        for( uint64_t i=0; i < context.iterations; ++i ) {
+            pause( context );
+            std::memcpy( Core::array::begin(array), Core::array::begin(input), count*sizeof(Type) );
+            resume( context );
+            
+            Core::array::sort( array );
+            clobber();
+        }
+    }
+    
+    void sortRandomInts( BenchContext &context )
+    {
+        sortArray<uint32_t>( context, Order::Random );
+    }
+    CORE_BENCH( sortRandomInts, 1024, 65536, 1024*1024 );
+    
+    void sortSortedInts( BenchContext &context )
+    {
+        sortArray<uint32_t>( context, Order::Sorted );
+    }
+    CORE_BENCH( sortSortedInts, 1024, 65536 );
+    
+    void sortReversedInts( BenchContext &context )
+    {
+        sortArray<uint32_t>( context, Order::Reversed );
+    }
+    CORE_BENCH( sortReversedInts, 1024, 65536 );
+    
+    void sortRandomFloats( BenchContext &context )
+    {
+        sortArray<float>( context, Order::Random );
+    }
+    CORE_BENCH( sortRandomFloats, 1024, 65536 );
+    
+    void sortRandomView( BenchContext &context )
+    {
+        const std::size_t count = std::size_t( context.parameter );
+        Core::Array<uint64_t> input( Core::getDefaultAllocator() );
+        Core::Array<uint64_t> array( Core::getDefaultAllocator() );
+        Core::array::resize( input, count );
+        Core::array::resize( array, count );
+        fill( input, Order::Random );
+        
+        // a view of the middle half
+        Core::MutableArrayView<uint64_t> view( Core::array::begin(array) + count/4, count/2 );
+        for( uint64_t i=0; i < context.iterations; ++i ) {
+            pause( context );
+            std::memcpy( Core::array::begin(array), Core::array::begin(input), count*sizeof(uint64_t) );
+            resume( context );
+            
+            Core::array::sort( view );
+            clobber();
+        }
+    }
+    CORE_BENCH( sortRandomView, 1024, 65536 );
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "Array.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+namespace Core
+{
+    class Allocator;
+    struct AllocationTag;
+
+    struct AllocationTracker;
+
+    // the allocations made on behalf of a tag
+    struct AllocationSiteStats {
+        const AllocationTag *tag;
+        uint64_t liveBytes,
+                 liveCount,
+                 // the most liveBytes has been
+                 peakBytes,
+                 // every allocation since the tracker was created
+                 totalBytes,
+                 totalCount;
+        // since the previous snapshot
+        double bytesPerSecond,
+               allocationsPerSecond;
+    };
+
+    // the sites of a subsystem added together
+    struct AllocationSubsystemStats {
+        const char *subsystem;
+        uint64_t liveBytes,
+                 liveCount,
+                 totalBytes,
+                 totalCount;
+        double bytesPerSecond,
+               allocationsPerSecond;
+    };
+
+    /* Tracks the allocations made through allocationTracker::allocator, which allocates from backer
+     * Allocations are counted for the tag they were made with, CORE_ALLOCATE tags a single allocation,
+     * CORE_ALLOCATION_TAG every allocation in a scope, the rest count as "Untagged"
+     * Each allocation gets a header of at least 16 bytes
+     */
+    AllocationTracker* createAllocationTracker( Allocator *backer );
+    // every allocation must have been freed, or be freed to backer through some other way
+    void destroyAllocationTracker( AllocationTracker *tracker );
+
+    namespace allocationTracker
+    {
+        Allocator* allocator( AllocationTracker *tracker );
+
+        uint64_t liveBytes( const AllocationTracker *tracker );
+
+        /* The stats of every site, sorted by live bytes, and optionaly of each subsystem
+         * The rates are since the previous snapshot, or since the tracker was created
+         */
+        void snapshot( AllocationTracker *tracker, Array<AllocationSiteStats> &sites, Array<AllocationSubsystemStats> *subsystems = nullptr );
+        // takes a snapshot and prints it, subsystems first
+        void printSnapshot( AllocationTracker *tracker, FILE *file );
+    }
+}
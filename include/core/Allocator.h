@@ -1,9 +1,17 @@
 #pragma once
 
 #include <cstdint>
+#include <cstddef>
 
 namespace Core 
 {
+    // who made an allocation, one static for each CORE_ALLOCATE or CORE_ALLOCATION_TAG
+    struct AllocationTag {
+        const char *subsystem;
+        const char *file;
+        int line;
+    };
+    
     class Allocator {
         Allocator( const Allocator& ) = delete;
         Allocator& operator = ( const Allocator& ) = delete;
@@ -13,6 +21,48 @@ namespace Core
         
         virtual void* allocate( std::size_t size, std::size_t alignment ) = 0;
         virtual void free( void *ptr ) = 0;
+        
+        /* Frees a block whose first usedSize bytes are in use, containers free their blocks this way
+         * The default just frees it, a allocator that maps a file truncates the file to usedSize first
+         */
+        virtual void freeUsed( void *ptr, std::size_t usedSize );
+        
+        /* Resizes the block at ptr to newSize bytes, preserving the first usedSize bytes
+         * ptr may be nullptr, the returned pointer replaces ptr
+         * The default allocates a new block, copies usedSize bytes and frees the old one
+         */
+        virtual void* reallocate( void *ptr, std::size_t usedSize, std::size_t newSize, std::size_t alignment );
+        
+        /* Allocates on behalf of tag, use it through CORE_ALLOCATE
+         * The default ignores the tag, only allocators that track allocations use it
+         */
+        virtual void* allocateTagged( std::size_t size, std::size_t alignment, const AllocationTag *tag );
+    };
+    
+    namespace detail
+    {
+        // the innermost AllocationTagScope of the thread
+        extern thread_local const AllocationTag *currentAllocationTag;
+    }
+    
+    // tags every untagged allocation the thread makes in a scope, use it through CORE_ALLOCATION_TAG
+    class AllocationTagScope {
+        AllocationTagScope( const AllocationTagScope& ) = delete;
+        AllocationTagScope& operator = ( const AllocationTagScope& ) = delete;
+    public:
+        explicit AllocationTagScope( const AllocationTag *tag ) :
+            mPrevious(detail::currentAllocationTag)
+        {
+            detail::currentAllocationTag = tag;
+        }
+        
+        ~AllocationTagScope()
+        {
+            detail::currentAllocationTag = mPrevious;
+        }
+        
+    private:
+        const AllocationTag *mPrevious;
     };
     
     void initAllocators();
@@ -24,4 +74,20 @@ namespace Core
     
     Allocator* createHeapAllocator( void *heap, std::size_t size );
     Allocator* createScrapAllocator( void *heap, std::size_t size, Allocator *backer );
-}
\ No newline at end of file
+}
+
+
+#define CORE_ALLOCATION_CONCAT_( a, b ) a##b
+#define CORE_ALLOCATION_CONCAT( a, b ) CORE_ALLOCATION_CONCAT_( a, b )
+
+// allocates from allocator, tagged with subsystem and the call site
+#define CORE_ALLOCATE( allocator, subsystem, size, alignment ) \
+    ([&]() -> void* { \
+        static const ::Core::AllocationTag coreAllocationTag = { subsystem, __FILE__, __LINE__ }; \
+        return (allocator)->allocateTagged( size, alignment, &coreAllocationTag ); \
+    }())
+
+// tags the allocations in the rest of the scope, containers included, with subsystem and the scope
+#define CORE_ALLOCATION_TAG( subsystem ) \
+    static const ::Core::AllocationTag CORE_ALLOCATION_CONCAT( coreAllocationTag, __LINE__ ) = { subsystem, __FILE__, __LINE__ }; \
+    ::Core::AllocationTagScope CORE_ALLOCATION_CONCAT( coreAllocationTagScope, __LINE__ )( &CORE_ALLOCATION_CONCAT(coreAllocationTag, __LINE__) )
@@ -1,3 +1,5 @@
+#pragma once
+
 #include "Containers.h"
 #include "Allocator.h"
 #include "Assume.h"
@@ -38,7 +40,7 @@ namespace Core
     Array<Type>::~Array()
     {
         if( _allocator && _data ) {
-            _allocator->free( _data );
+            _allocator->freeUsed( _data, _size*sizeof(Type) );
         }
     }
 
@@ -47,9 +49,9 @@ namespace Core
     {
         ASSUME_TRUE( copy._allocator != nullptr );
         
-        if( this == &copy ) return;
+        if( this == &copy ) return *this;
         if( _allocator && _data ) {
-            _allocator->free( _data );
+            _allocator->freeUsed( _data, _size*sizeof(Type) );
         }
         
         _allocator = copy._allocator;
@@ -57,7 +59,7 @@ namespace Core
         _capasity = _size;
         
         
-        _data = _allocator->allocate( _size, alignof(Type) );
+        _data = reinterpret_cast<Type*>( _allocator->allocate(_size*sizeof(Type), alignof(Type)) );
         memcpy( _data, copy._data, sizeof(Type)*_size );
         
         return *this;
@@ -67,7 +69,7 @@ namespace Core
     Array<Type>& Array<Type>::operator = ( Array &&move )
     {
         if( _allocator && _data ) {
-            _allocator->free( _data );
+            _allocator->freeUsed( _data, _size*sizeof(Type) );
         }
         
         _allocator = move._allocator;
@@ -150,15 +152,13 @@ namespace Core
         void resize( Array<Type> &array, std::size_t size )
         {
             ASSUME_TRUE( array._allocator != nullptr );
-            Type *newData = reinterpret_cast<Type*>( array._allocator->allocate(size*sizeof(Type), alignof(Type)) );
             
             std::size_t copySize = size < array._size ? size : array._size;
             std::size_t initSize = size < array._size ? 0 : size - array._size;
             
-            std::memcpy( newData, array._data, copySize*sizeof(Type) );
+            Type *newData = reinterpret_cast<Type*>( array._allocator->reallocate(array._data, copySize*sizeof(Type), size*sizeof(Type), alignof(Type)) );
             std::memset( newData+copySize, 0, initSize * sizeof(Type) );
             
-            array._allocator->free( array._data );
             array._data = newData;
             array._size = size;
             array._capasity = size;
@@ -172,17 +172,15 @@ namespace Core
         void resize( Array<Type> &array, std::size_t size, const Type &value )
         {
             ASSUME_TRUE( array._allocator != nullptr );
-            Type *newData = array._allocator->allocate( size * sizeof(Type) );
             
-            std::size_t copySize = size < array->_size ? size : array->_size;
-            std::size_t initSize = size < array->_size ? 0 : size - array->_size;
+            std::size_t copySize = size < array._size ? size : array._size;
+            std::size_t initSize = size < array._size ? 0 : size - array._size;
             
-            std::memcpy( newData, array._data, copySize*sizeof(Type) );
+            Type *newData = reinterpret_cast<Type*>( array._allocator->reallocate(array._data, copySize*sizeof(Type), size*sizeof(Type), alignof(Type)) );
             for( std::size_t i = 0; i < initSize; ++i ) {
                 newData[i + copySize] = value;
             }
             
-            array._allocator->free( array._data );
             array._data = newData;
             array._size = size;
             array._capasity = size;
@@ -201,11 +199,8 @@ namespace Core
             // use trim to shrink the capasity
             if( size < array._capasity ) return;
             
-            Type *newData = array._allocator->allocate( size * sizeof(Type) );
-            
-            std::memcpy( newData, array._data, array._size * sizeof(Type) );
+            Type *newData = reinterpret_cast<Type*>( array._allocator->reallocate(array._data, array._size*sizeof(Type), size*sizeof(Type), alignof(Type)) );
             
-            array._allocator->free( array._data );
             array._data = newData;
             array._capasity = size;
         }
@@ -220,10 +215,8 @@ namespace Core
             
             std::size_t size = array._size + excess;
             
-            Type *newData = array._allocator->allocate( size * sizeof(Type) );
-            std::memcpy( newData, array._data, array._size * sizeof(Type) );
+            Type *newData = reinterpret_cast<Type*>( array._allocator->reallocate(array._data, array._size*sizeof(Type), size*sizeof(Type), alignof(Type)) );
             
-            array._allocator->free( array._data );
             array._data = newData;
             array._capasity = size;
         }
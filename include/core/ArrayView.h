@@ -0,0 +1,182 @@
+#pragma once
+
+#include "Containers.h"
+#include "Array.h"
+#include "Assume.h"
+
+#include <algorithm>
+
+namespace Core
+{
+    template< typename Type >
+    ArrayView<Type>::ArrayView( const Type *data, std::size_t size ) :
+        _data(data),
+        _size(size)
+    {
+    }
+    
+    template< typename Type >
+    ArrayView<Type>::ArrayView( const Array<Type> &array ) :
+        _data(array._data),
+        _size(array._size)
+    {
+    }
+    
+    template< typename Type >
+    ArrayView<Type>::ArrayView( MutableArrayView<Type> view ) :
+        _data(view._data),
+        _size(view._size)
+    {
+    }
+    
+    template< typename Type >
+    template< std::size_t Size >
+    ArrayView<Type>::ArrayView( const Type (&data)[Size] ) :
+        _data(data),
+        _size(Size)
+    {
+    }
+    
+    template< typename Type >
+    const Type& ArrayView<Type>::operator [] ( std::size_t index ) const
+    {
+        ASSUME_TRUE( index < _size );
+        return _data[index];
+    }
+    
+    template< typename Type >
+    MutableArrayView<Type>::MutableArrayView( Type *data, std::size_t size ) :
+        _data(data),
+        _size(size)
+    {
+    }
+    
+    template< typename Type >
+    MutableArrayView<Type>::MutableArrayView( Array<Type> &array ) :
+        _data(array._data),
+        _size(array._size)
+    {
+    }
+    
+    template< typename Type >
+    template< std::size_t Size >
+    MutableArrayView<Type>::MutableArrayView( Type (&data)[Size] ) :
+        _data(data),
+        _size(Size)
+    {
+    }
+    
+    template< typename Type >
+    Type& MutableArrayView<Type>::operator [] ( std::size_t index ) const
+    {
+        ASSUME_TRUE( index < _size );
+        return _data[index];
+    }
+    
+    namespace array
+    {
+        template< typename Type >
+        std::size_t size( ArrayView<Type> view )
+        {
+            return view._size;
+        }
+        
+        template< typename Type >
+        std::size_t size( MutableArrayView<Type> view )
+        {
+            return view._size;
+        }
+        
+        template< typename Type >
+        const Type* begin( ArrayView<Type> view )
+        {
+            return view._data;
+        }
+        
+        template< typename Type >
+        const Type* end( ArrayView<Type> view )
+        {
+            return view._data + view._size;
+        }
+        
+        template< typename Type >
+        Type* begin( MutableArrayView<Type> view )
+        {
+            return view._data;
+        }
+        
+        template< typename Type >
+        Type* end( MutableArrayView<Type> view )
+        {
+            return view._data + view._size;
+        }
+        
+        /* Returns a view of count elements starting at start
+         * The view is only valid until the array is resized or destroyed
+         */
+        template< typename Type >
+        ArrayView<Type> slice( const Array<Type> &array, std::size_t start, std::size_t count )
+        {
+            ASSUME_TRUE( start + count <= array._size );
+            return ArrayView<Type>( array._data + start, count );
+        }
+        
+        template< typename Type >
+        MutableArrayView<Type> mutableSlice( Array<Type> &array, std::size_t start, std::size_t count )
+        {
+            ASSUME_TRUE( start + count <= array._size );
+            return MutableArrayView<Type>( array._data + start, count );
+        }
+        
+        template< typename Type >
+        ArrayView<Type> slice( ArrayView<Type> view, std::size_t start, std::size_t count )
+        {
+            ASSUME_TRUE( start + count <= view._size );
+            return ArrayView<Type>( view._data + start, count );
+        }
+        
+        template< typename Type >
+        MutableArrayView<Type> slice( MutableArrayView<Type> view, std::size_t start, std::size_t count )
+        {
+            ASSUME_TRUE( start + count <= view._size );
+            return MutableArrayView<Type>( view._data + start, count );
+        }
+        
+        template< typename Type >
+        void sort( MutableArrayView<Type> view )
+        {
+            if( view._data == nullptr ) return;
+            std::sort( view._data, view._data + view._size );
+        }
+        
+        /* Returns the index of the first element that isn't less than value,
+         * the elements must be sorted
+         */
+        template< typename Type >
+        std::size_t lowerBound( ArrayView<Type> view, const Type &value )
+        {
+            return std::lower_bound( begin(view), end(view), value ) - begin(view);
+        }
+        
+        template< typename Type >
+        std::size_t lowerBound( const Array<Type> &array, const Type &value )
+        {
+            return lowerBound( ArrayView<Type>(array), value );
+        }
+        
+        /* Returns the index of the first element equal to value,
+         * or size(view) if there is none
+         */
+        template< typename Type >
+        std::size_t find( ArrayView<Type> view, const Type &value )
+        {
+            return std::find( begin(view), end(view), value ) - begin(view);
+        }
+        
+        template< typename Type >
+        std::size_t find( const Array<Type> &array, const Type &value )
+        {
+            return find( ArrayView<Type>(array), value );
+        }
+    }
+}
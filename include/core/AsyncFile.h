@@ -0,0 +1,108 @@
+#pragma once
+
+#include "JobSystem.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Core
+{
+    class Allocator;
+
+    struct AsyncIO;
+    struct AsyncFile;
+
+    enum class AsyncIOBackend {
+        // io_uring when the kernel allows it, otherwise the thread pool
+        Auto,
+        IoUring,
+        // blocking preads on a pool of threads
+        ThreadPool
+    };
+
+    // queued reads are submitted in priority order, zero initialized requests are Normal
+    enum class IOPriority {
+        Normal,
+        High,
+        Low
+    };
+    static const std::size_t IO_PRIORITY_COUNT = 3;
+
+    struct ReadRequest;
+
+    // result is the number of bytes read, or a negative errno
+    typedef void (*ReadCallback)( const ReadRequest &request, int64_t result );
+
+    // zero initialize requests, and set what is used
+    struct ReadRequest {
+        AsyncFile *file;
+        uint64_t offset;
+        void *buffer;
+        uint32_t size;
+        IOPriority priority;
+
+        // each is optional, they are all done by asyncIO::poll
+        ReadCallback callback;
+        void *userData;
+        // set to the result
+        int64_t *result;
+        // increased when the read is queued, and decreased when it has completed
+        JobCounter *counter;
+        // set if jobs of this system wait on counter, so it is decreased with jobSystem::decrementCounter
+        JobSystem *system;
+    };
+
+    /* Creates a context for async reads, with at most queueDepth reads in flight
+     * threadCount is the size of the thread pool, if that backend is used
+     * Returns nullptr if IoUring was asked for and isn't available
+     * A context and its files are used from one thread
+     */
+    AsyncIO* createAsyncIO( Allocator *allocator, std::size_t queueDepth = 256,
+                            AsyncIOBackend backend = AsyncIOBackend::Auto, std::size_t threadCount = 4 );
+
+    /* waits for the reads in flight, queued reads that weren't submitted are completed with -ECANCELED,
+     * so their callbacks are called and their counters reach zero
+     */
+    void destroyAsyncIO( AsyncIO *io );
+
+    namespace asyncIO
+    {
+        // the backend that is used, never Auto
+        AsyncIOBackend backend( const AsyncIO *io );
+
+        // Returns nullptr if the file couldn't be opened
+        AsyncFile* open( AsyncIO *io, const char *path );
+        void close( AsyncIO *io, AsyncFile *file );
+        uint64_t fileSize( const AsyncFile *file );
+
+        /* Allocates count buffers of bufferSize bytes from the contexts allocator,
+         * with io_uring they are registered so reads into them skip mapping the pages for each read
+         * Can only be done once, while no reads are in flight
+         */
+        bool registerBuffers( AsyncIO *io, std::size_t bufferSize, std::size_t count );
+
+        // a registered buffer, or nullptr if they are all in use
+        void* acquireBuffer( AsyncIO *io );
+        void releaseBuffer( AsyncIO *io, void *buffer );
+        std::size_t bufferSize( const AsyncIO *io );
+
+        // queues reads, they aren't started until submit
+        void read( AsyncIO *io, const ReadRequest &request );
+        void read( AsyncIO *io, const ReadRequest *requests, std::size_t count );
+
+        // starts as many queued reads as there is room for in a single batch, Returns the number started
+        std::size_t submit( AsyncIO *io );
+
+        /* Completes the finished reads, and submits queued reads in their place
+         * If wait is set it blocks until at least one read has completed, unless none are in flight
+         * Returns the number of reads completed
+         */
+        std::size_t poll( AsyncIO *io, bool wait = false );
+
+        // reads that are queued or in flight
+        std::size_t pending( const AsyncIO *io );
+
+        // submits and polls until counter reaches zero
+        void wait( AsyncIO *io, const JobCounter &counter );
+    }
+}
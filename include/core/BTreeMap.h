@@ -0,0 +1,372 @@
+#pragma once
+
+#include "Containers.h"
+#include "Allocator.h"
+#include "Assume.h"
+
+#include <cstring>
+#include <new>
+#include <utility>
+
+namespace Core
+{
+    namespace detail
+    {
+        template< typename Key, typename Value >
+        typename BTreeMap<Key,Value>::LeafNode* btreeAllocateLeaf( BTreeMap<Key,Value> &map )
+        {
+            typedef typename BTreeMap<Key,Value>::LeafNode LeafNode;
+
+            void *memory = map._allocator->allocate( sizeof(LeafNode), CACHE_LINE_SIZE );
+            LeafNode *leaf = new (memory) LeafNode;
+            leaf->count = 0;
+            leaf->leaf = true;
+            leaf->next = nullptr;
+            return leaf;
+        }
+
+        template< typename Key, typename Value >
+        typename BTreeMap<Key,Value>::InnerNode* btreeAllocateInner( BTreeMap<Key,Value> &map )
+        {
+            typedef typename BTreeMap<Key,Value>::InnerNode InnerNode;
+
+            void *memory = map._allocator->allocate( sizeof(InnerNode), CACHE_LINE_SIZE );
+            InnerNode *inner = new (memory) InnerNode;
+            inner->count = 0;
+            inner->leaf = false;
+            return inner;
+        }
+
+        template< typename Key, typename Value >
+        void btreeFreeNode( BTreeMap<Key,Value> &map, typename BTreeMap<Key,Value>::Node *node )
+        {
+            typedef typename BTreeMap<Key,Value>::InnerNode InnerNode;
+
+            if( !node->leaf ) {
+                InnerNode *inner = static_cast<InnerNode*>( node );
+                for( uint32_t i=0; i <= inner->count; ++i ) {
+                    btreeFreeNode( map, inner->children[i] );
+                }
+            }
+            map._allocator->free( node );
+        }
+
+        template< typename Key, typename Value >
+        bool btreeIsFull( const typename BTreeMap<Key,Value>::Node *node )
+        {
+            return node->count == (node->leaf ? BTreeMap<Key,Value>::LEAF_CAPASITY : BTreeMap<Key,Value>::INNER_CAPASITY);
+        }
+
+        // number of keys less than key, nodes are small enough that a branch free scan beats a binary search
+        template< typename Key >
+        uint32_t btreeLowerBound( const Key *keys, uint32_t count, const Key &key )
+        {
+            uint32_t index = 0;
+            for( uint32_t i=0; i < count; ++i ) {
+                index += keys[i] < key;
+            }
+            return index;
+        }
+
+        // number of keys less than or equal to key, which is the child that may contain key
+        template< typename Key >
+        uint32_t btreeChildIndex( const Key *keys, uint32_t count, const Key &key )
+        {
+            uint32_t index = 0;
+            for( uint32_t i=0; i < count; ++i ) {
+                index += !(key < keys[i]);
+            }
+            return index;
+        }
+
+        /* Splits the full child at index in parent into two nodes,
+         * parent must not be full
+         */
+        template< typename Key, typename Value >
+        void btreeSplitChild( BTreeMap<Key,Value> &map, typename BTreeMap<Key,Value>::InnerNode *parent, uint32_t index )
+        {
+            typedef typename BTreeMap<Key,Value>::Node Node;
+            typedef typename BTreeMap<Key,Value>::LeafNode LeafNode;
+            typedef typename BTreeMap<Key,Value>::InnerNode InnerNode;
+
+            Node *child = parent->children[index];
+            Node *right = nullptr;
+            Key separator;
+
+            if( child->leaf ) {
+                LeafNode *left = static_cast<LeafNode*>( child );
+                LeafNode *newLeaf = btreeAllocateLeaf( map );
+
+                uint32_t mid = left->count / 2;
+                newLeaf->count = left->count - mid;
+                std::memcpy( newLeaf->keys, left->keys + mid, newLeaf->count*sizeof(Key) );
+                std::memcpy( newLeaf->values, left->values + mid, newLeaf->count*sizeof(Value) );
+                left->count = mid;
+
+                newLeaf->next = left->next;
+                left->next = newLeaf;
+
+                // leaves keep all keys, the separator is a copy of the first key in the right leaf
+                separator = newLeaf->keys[0];
+                right = newLeaf;
+            }
+            else {
+                InnerNode *left = static_cast<InnerNode*>( child );
+                InnerNode *newInner = btreeAllocateInner( map );
+
+                uint32_t mid = left->count / 2;
+                newInner->count = left->count - mid - 1;
+                std::memcpy( newInner->keys, left->keys + mid + 1, newInner->count*sizeof(Key) );
+                std::memcpy( newInner->children, left->children + mid + 1, (newInner->count+1)*sizeof(Node*) );
+                left->count = mid;
+
+                // the middle key moves up into the parent
+                separator = left->keys[mid];
+                right = newInner;
+            }
+
+            std::memmove( parent->keys + index + 1, parent->keys + index, (parent->count - index)*sizeof(Key) );
+            std::memmove( parent->children + index + 2, parent->children + index + 1, (parent->count - index)*sizeof(Node*) );
+            parent->keys[index] = separator;
+            parent->children[index+1] = right;
+            parent->count++;
+        }
+
+        template< typename Key, typename Value >
+        typename BTreeMap<Key,Value>::LeafNode* btreeFindLeaf( const BTreeMap<Key,Value> &map, const Key &key )
+        {
+            typedef typename BTreeMap<Key,Value>::Node Node;
+            typedef typename BTreeMap<Key,Value>::InnerNode InnerNode;
+
+            Node *node = map._root;
+            if( !node ) return nullptr;
+
+            while( !node->leaf ) {
+                InnerNode *inner = static_cast<InnerNode*>( node );
+                node = inner->children[ btreeChildIndex(inner->keys, inner->count, key) ];
+            }
+            return static_cast<typename BTreeMap<Key,Value>::LeafNode*>( node );
+        }
+
+        // moves the iterator past empty leaves and the end of a leaf
+        template< typename Iterator >
+        Iterator btreeNormalize( Iterator it )
+        {
+            while( it.leaf && it.index >= it.leaf->count ) {
+                it.leaf = it.leaf->next;
+                it.index = 0;
+            }
+            return it;
+        }
+    }
+
+    template< typename Key, typename Value >
+    BTreeMap<Key,Value>::BTreeMap( BTreeMap &&move )
+    {
+        *this = std::move( move );
+    }
+
+    template< typename Key, typename Value >
+    BTreeMap<Key,Value>::BTreeMap( Allocator *allocator ) :
+        _allocator(allocator)
+    {
+    }
+
+    template< typename Key, typename Value >
+    BTreeMap<Key,Value>::~BTreeMap()
+    {
+        if( _allocator && _root ) {
+            detail::btreeFreeNode( *this, _root );
+        }
+    }
+
+    template< typename Key, typename Value >
+    BTreeMap<Key,Value>& BTreeMap<Key,Value>::operator = ( BTreeMap &&move )
+    {
+        if( this == &move ) return *this;
+        if( _allocator && _root ) {
+            detail::btreeFreeNode( *this, _root );
+        }
+
+        _allocator = move._allocator;
+        _root = move._root;
+        _first = move._first;
+        _size = move._size;
+
+        move._allocator = nullptr;
+        move._root = nullptr;
+        move._first = nullptr;
+        move._size = 0;
+
+        return *this;
+    }
+
+    namespace btreeMap
+    {
+        template< typename Key, typename Value >
+        std::size_t size( const BTreeMap<Key,Value> &map )
+        {
+            return map._size;
+        }
+
+        template< typename Key, typename Value >
+        void clear( BTreeMap<Key,Value> &map )
+        {
+            if( map._root ) {
+                detail::btreeFreeNode( map, map._root );
+            }
+            map._root = nullptr;
+            map._first = nullptr;
+            map._size = 0;
+        }
+
+        template< typename Key, typename Value >
+        Value* find( BTreeMap<Key,Value> &map, const Key &key )
+        {
+            typename BTreeMap<Key,Value>::LeafNode *leaf = detail::btreeFindLeaf( map, key );
+            if( !leaf ) return nullptr;
+
+            uint32_t index = detail::btreeLowerBound( leaf->keys, leaf->count, key );
+            if( index == leaf->count || key < leaf->keys[index] ) return nullptr;
+            return &leaf->values[index];
+        }
+
+        template< typename Key, typename Value >
+        const Value* find( const BTreeMap<Key,Value> &map, const Key &key )
+        {
+            return find( const_cast<BTreeMap<Key,Value>&>(map), key );
+        }
+
+        /* Inserts or replaces the value for key,
+         * full nodes are split on the way down, so the insert never has to walk back up
+         * Returns true if the key wasn't already in the map
+         */
+        template< typename Key, typename Value >
+        bool insert( BTreeMap<Key,Value> &map, const Key &key, const Value &value )
+        {
+            typedef typename BTreeMap<Key,Value>::Node Node;
+            typedef typename BTreeMap<Key,Value>::LeafNode LeafNode;
+            typedef typename BTreeMap<Key,Value>::InnerNode InnerNode;
+
+            ASSUME_TRUE( map._allocator != nullptr );
+
+            if( !map._root ) {
+                LeafNode *leaf = detail::btreeAllocateLeaf( map );
+                map._root = leaf;
+                map._first = leaf;
+            }
+
+            if( detail::btreeIsFull<Key,Value>(map._root) ) {
+                InnerNode *root = detail::btreeAllocateInner( map );
+                root->children[0] = map._root;
+                detail::btreeSplitChild( map, root, 0 );
+                map._root = root;
+            }
+
+            Node *node = map._root;
+            while( !node->leaf ) {
+                InnerNode *inner = static_cast<InnerNode*>( node );
+                uint32_t index = detail::btreeChildIndex( inner->keys, inner->count, key );
+
+                if( detail::btreeIsFull<Key,Value>(inner->children[index]) ) {
+                    detail::btreeSplitChild( map, inner, index );
+                    if( !(key < inner->keys[index]) ) index++;
+                }
+                node = inner->children[index];
+            }
+
+            LeafNode *leaf = static_cast<LeafNode*>( node );
+            uint32_t index = detail::btreeLowerBound( leaf->keys, leaf->count, key );
+            if( index < leaf->count && !(key < leaf->keys[index]) ) {
+                leaf->values[index] = value;
+                return false;
+            }
+
+            std::memmove( leaf->keys + index + 1, leaf->keys + index, (leaf->count - index)*sizeof(Key) );
+            std::memmove( leaf->values + index + 1, leaf->values + index, (leaf->count - index)*sizeof(Value) );
+            leaf->keys[index] = key;
+            leaf->values[index] = value;
+            leaf->count++;
+            map._size++;
+
+            return true;
+        }
+
+        /* Erases key from the map
+         * Nodes are not merged when they become sparse, clear or rebuild the map to compact it
+         * Returns false if the key wasn't in the map
+         */
+        template< typename Key, typename Value >
+        bool erase( BTreeMap<Key,Value> &map, const Key &key )
+        {
+            typename BTreeMap<Key,Value>::LeafNode *leaf = detail::btreeFindLeaf( map, key );
+            if( !leaf ) return false;
+
+            uint32_t index = detail::btreeLowerBound( leaf->keys, leaf->count, key );
+            if( index == leaf->count || key < leaf->keys[index] ) return false;
+
+            std::memmove( leaf->keys + index, leaf->keys + index + 1, (leaf->count - index - 1)*sizeof(Key) );
+            std::memmove( leaf->values + index, leaf->values + index + 1, (leaf->count - index - 1)*sizeof(Value) );
+            leaf->count--;
+            map._size--;
+
+            return true;
+        }
+
+        template< typename Key, typename Value >
+        typename BTreeMap<Key,Value>::Iterator begin( const BTreeMap<Key,Value> &map )
+        {
+            typename BTreeMap<Key,Value>::Iterator it;
+                it.leaf = map._first;
+                it.index = 0;
+            return detail::btreeNormalize( it );
+        }
+
+        // Returns a iterator to the first element with a key that isn't less than key
+        template< typename Key, typename Value >
+        typename BTreeMap<Key,Value>::Iterator lowerBound( const BTreeMap<Key,Value> &map, const Key &key )
+        {
+            typename BTreeMap<Key,Value>::Iterator it;
+                it.leaf = detail::btreeFindLeaf( map, key );
+                it.index = it.leaf ? detail::btreeLowerBound( it.leaf->keys, it.leaf->count, key ) : 0;
+            return detail::btreeNormalize( it );
+        }
+
+        template< typename Iterator >
+        bool isEnd( const Iterator &it )
+        {
+            return it.leaf == nullptr;
+        }
+
+        template< typename Iterator >
+        Iterator next( Iterator it )
+        {
+            ASSUME_TRUE( it.leaf != nullptr );
+            it.index++;
+            return detail::btreeNormalize( it );
+        }
+
+        template< typename Iterator >
+        auto key( const Iterator &it ) -> decltype( it.leaf->keys[0] )
+        {
+            return it.leaf->keys[it.index];
+        }
+
+        template< typename Iterator >
+        auto value( const Iterator &it ) -> decltype( it.leaf->values[0] )
+        {
+            return it.leaf->values[it.index];
+        }
+
+        /* Calls function( const Key &key, Value &value ) for every element with first <= key < last, in order
+         */
+        template< typename Key, typename Value, typename Function >
+        void forEachInRange( const BTreeMap<Key,Value> &map, const Key &first, const Key &last, Function function )
+        {
+            for( typename BTreeMap<Key,Value>::Iterator it = lowerBound(map, first); !isEnd(it); it = next(it) ) {
+                if( !(key(it) < last) ) break;
+                function( key(it), value(it) );
+            }
+        }
+    }
+}
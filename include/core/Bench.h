@@ -0,0 +1,127 @@
+#pragma once
+
+#include "Array.h"
+#include "PerfCounters.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <initializer_list>
+
+namespace Core
+{
+    /* What a benchmark function gets for each sample,
+     * it must run the measured code iterations times
+     */
+    struct BenchContext {
+        uint64_t iterations;
+        // the parameter of this run, 0 for benchmarks without parameters
+        int64_t parameter;
+
+        // time and counters between bench::pause and bench::resume, that aren't counted
+        uint64_t _pausedNs,
+                 _pauseStart;
+        PerfCounters *_perf;
+        PerfCounterValues _pausedCounters,
+                          _pauseCounters;
+    };
+
+    typedef void (*BenchFunction)( BenchContext &context );
+
+    struct BenchOptions {
+        // only benchmarks with this in their name run, nullptr runs all of them
+        const char *filter = nullptr;
+        // each benchmark runs this long before it is measured
+        double warmupMs = 50.0;
+        // the iterations are calibrated so each sample takes at least this long
+        double sampleMs = 10.0;
+        uint32_t samples = 15;
+        // counts PerfCounters for each benchmark, if they can be opened
+        bool perfCounters = false;
+
+        // results are written to these when set
+        const char *jsonPath = nullptr;
+        const char *csvPath = nullptr;
+        // a json or csv file from an earlier run, to compare with
+        const char *baselinePath = nullptr;
+        // a change in the median beyond this fraction, that is larger than the noise, counts as a change
+        double threshold = 0.05;
+
+        // progress and the results table, nullptr for quiet
+        FILE *output = stdout;
+    };
+
+    // the time of one iteration of a run
+    struct BenchResult {
+        const char *name;
+        int64_t parameter;
+        uint64_t iterations;
+        uint32_t samples;
+        double medianNs,
+               // median absolute deviation of the samples
+               madNs,
+               minNs,
+               maxNs;
+        // totals of every sample, cycles is 0 unless counted
+        PerfCounterValues counters;
+        uint64_t countedIterations;
+    };
+
+    namespace bench
+    {
+        /* Registers function to run once for each parameter, or once with parameter 0 without any
+         * name must outlive the benchmarks, use it through CORE_BENCH
+         */
+        int add( const char *name, BenchFunction function, std::initializer_list<int64_t> parameters = {} );
+
+        // excludes the time until resume from the sample, for setup inside the loop
+        void pause( BenchContext &context );
+        void resume( BenchContext &context );
+
+        // keeps the compiler from optimizing away value, or the code computing it
+        template< typename Type >
+        inline void doNotOptimize( const Type &value )
+        {
+            asm volatile( "" : : "r,m"(value) : "memory" );
+        }
+
+        // makes the compiler assume all memory was read and written
+        inline void clobber()
+        {
+            asm volatile( "" : : : "memory" );
+        }
+
+        double median( double *values, std::size_t count );
+        // the median distance from the median, less sensitive to outliers than the standard deviation
+        double medianAbsoluteDeviation( double *values, std::size_t count );
+
+        // runs the registered benchmarks that match options.filter
+        void run( const BenchOptions &options, Array<BenchResult> &results );
+
+        bool writeJson( const char *path, const Array<BenchResult> &results );
+        bool writeCsv( const char *path, const Array<BenchResult> &results );
+
+        /* Compares results with a file from writeJson or writeCsv, and prints the changes to output
+         * Returns the number of regressions, or -1 if the file couldn't be read
+         */
+        int compare( const Array<BenchResult> &results, const char *baselinePath, double threshold, FILE *output );
+
+        /* Parses the command line into options, Returns false and prints the usage on bad arguments
+         * --filter=name --samples=n --sample-ms=ms --warmup-ms=ms --counters
+         * --json=path --csv=path --baseline=path --threshold=fraction
+         */
+        bool parseOptions( int argc, char **argv, BenchOptions &options );
+
+        /* Parses the command line, runs, writes and compares, for the main of a benchmark executable
+         * Returns 1 on bad arguments or regressions against the baseline, the allocators must be initialized
+         */
+        int main( int argc, char **argv );
+    }
+}
+
+#define CORE_BENCH_CONCAT_( a, b ) a##b
+#define CORE_BENCH_CONCAT( a, b ) CORE_BENCH_CONCAT_( a, b )
+
+// registers function as a benchmark, with the parameters after it
+#define CORE_BENCH( function, ... ) \
+    static const int CORE_BENCH_CONCAT( coreBench, __LINE__ ) = ::Core::bench::add( #function, function, { __VA_ARGS__ } )
@@ -0,0 +1,256 @@
+#pragma once
+
+#include "Containers.h"
+#include "Array.h"
+#include "ArrayView.h"
+#include "SoAArray.h"
+#include "StringTable.h"
+#include "Assume.h"
+
+#include <cstring>
+
+namespace Core
+{
+    /* A relocatable binary container format
+     *
+     * [BinaryFileHeader][BinarySection * sectionCount][padding][section payloads]
+     *
+     * Every payload starts at a BINARY_SECTION_ALIGNMENT boundary, and refers to its content with
+     * offsets from the start of the section instead of pointers, so a mapped file can be read in place
+     */
+    // 2 has 64 bit string hashes
+    static const uint32_t BINARY_FORMAT_VERSION = 2;
+    static const std::size_t BINARY_SECTION_ALIGNMENT = 64;
+
+    enum class BinarySectionType : uint32_t {
+        Array = 1,
+        SoAArray = 2,
+        StringTable = 3
+    };
+
+    struct BinaryFileHeader {
+        char magic[4];
+        uint32_t version;
+        uint32_t sectionCount;
+        uint32_t reserved;
+    };
+
+    struct BinarySection {
+        uint32_t id;
+        BinarySectionType type;
+        uint32_t elementSize;
+        uint32_t reserved;
+        // number of elements, or strings for a string table
+        uint64_t count;
+        // from the start of the file
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    struct BinarySoAColumn {
+        // from the start of the section
+        uint64_t offset;
+        uint32_t elementSize;
+        uint32_t reserved;
+    };
+
+    struct BinaryStringEntry {
+        uint64_t hash;
+        uint32_t length;
+        uint32_t reserved;
+        // from the start of the section, 0 for a empty slot
+        uint64_t offset;
+    };
+
+    // collects sections in memory, until they are written out with binaryWriter::write or writeFile
+    struct BinaryWriter {
+        BinaryWriter( Allocator *allocator );
+
+        Array<uint8_t> _payload;
+        Array<BinarySection> _sections;
+    };
+
+    // reads sections in place from a buffer, that must stay alive while the reader is used
+    struct BinaryReader {
+        const uint8_t *_data = nullptr;
+        std::size_t _size = 0;
+        const BinaryFileHeader *_header = nullptr;
+        const BinarySection *_sections = nullptr;
+    };
+
+    namespace binaryWriter
+    {
+        /* Adds size bytes to the payload, at the start of a new aligned section
+         * Returns the offset from the start of the payload
+         */
+        std::size_t appendSection( BinaryWriter &writer, const void *data, std::size_t size );
+
+        // grows the section that was added last
+        std::size_t appendToSection( BinaryWriter &writer, const void *data, std::size_t size );
+
+        void addSection( BinaryWriter &writer, uint32_t id, BinarySectionType type, uint32_t elementSize, uint64_t count, std::size_t offset );
+
+        template< typename Type >
+        void addArray( BinaryWriter &writer, uint32_t id, ArrayView<Type> values )
+        {
+            static_assert( std::is_trivial<Type>::value, "Only trivial types can be written!" );
+
+            std::size_t offset = appendSection( writer, values._data, values._size*sizeof(Type) );
+            addSection( writer, id, BinarySectionType::Array, sizeof(Type), values._size, offset );
+        }
+
+        template< typename Type >
+        void addArray( BinaryWriter &writer, uint32_t id, const Array<Type> &values )
+        {
+            addArray( writer, id, ArrayView<Type>(values) );
+        }
+
+        template< typename... Types >
+        void addSoAArray( BinaryWriter &writer, uint32_t id, const SoAArray<Types...> &values )
+        {
+            static const std::size_t COLUMN_COUNT = sizeof...(Types);
+            static const std::size_t sizes[] = { sizeof(Types)... };
+
+            // the column table, then every column aligned like in the SoAArray
+            BinarySoAColumn columns[COLUMN_COUNT];
+            std::size_t offset = sizeof(columns);
+            for( std::size_t i=0; i < COLUMN_COUNT; ++i ) {
+                offset = ((offset + BINARY_SECTION_ALIGNMENT-1) / BINARY_SECTION_ALIGNMENT) * BINARY_SECTION_ALIGNMENT;
+                columns[i].offset = offset;
+                columns[i].elementSize = uint32_t( sizes[i] );
+                columns[i].reserved = 0;
+                offset += sizes[i]*values._size;
+            }
+
+            std::size_t start = appendSection( writer, columns, sizeof(columns) );
+            for( std::size_t i=0; i < COLUMN_COUNT; ++i ) {
+                std::size_t padding = start + columns[i].offset - array::size(writer._payload);
+                appendToSection( writer, nullptr, padding );
+                appendToSection( writer, values._columns[i], sizes[i]*values._size );
+            }
+
+            addSection( writer, id, BinarySectionType::SoAArray, uint32_t(COLUMN_COUNT), values._size, start );
+        }
+
+        void addStringTable( BinaryWriter &writer, uint32_t id, const StringTable &table );
+
+        // total size of the file
+        std::size_t size( const BinaryWriter &writer );
+
+        // writes the file into data, which must have room for size(writer) bytes
+        void write( const BinaryWriter &writer, void *data );
+
+        bool writeFile( const BinaryWriter &writer, const char *path );
+    }
+
+    namespace detail
+    {
+        /* true if count elements of elementSize bytes, offset bytes from the start of section, are inside it
+         * open checked that the section is inside the file, so they are in the file as well
+         */
+        inline bool binaryFits( const BinarySection &section, uint64_t offset, uint64_t count, uint64_t elementSize )
+        {
+            if( offset > section.size ) return false;
+            // divided instead of multiplied, so a huge count can't overflow
+            return elementSize == 0 || count <= (section.size - offset) / elementSize;
+        }
+
+        // the column table of a SoAArray section, nullptr if it doesn't fit in the section
+        inline const BinarySoAColumn* binarySoAColumns( const uint8_t *data, const BinarySection &section )
+        {
+            if( !binaryFits(section, 0, section.elementSize, sizeof(BinarySoAColumn)) ) return nullptr;
+            return reinterpret_cast<const BinarySoAColumn*>( data + section.offset );
+        }
+
+        // true if column is aligned for elements of elementSize, and holds count of them inside the section
+        inline bool binaryColumnFits( const BinarySection &section, const BinarySoAColumn &column, std::size_t elementSize, std::size_t alignment )
+        {
+            return column.elementSize == elementSize && column.offset % alignment == 0 &&
+                   binaryFits( section, column.offset, section.count, elementSize );
+        }
+    }
+
+    namespace binaryReader
+    {
+        /* Validates the header and section table
+         * The content of a section is validated by the functions that read it, which treat a section
+         * that doesn't fit its own size as if it didn't exist
+         * data must be aligned to BINARY_SECTION_ALIGNMENT, a mapped file always is
+         * Returns false if the data isn't a valid file of this version
+         */
+        bool open( BinaryReader &reader, const void *data, std::size_t size );
+
+        // Returns nullptr if there is no section with id
+        const BinarySection* findSection( const BinaryReader &reader, uint32_t id );
+
+        /* Returns a view of the elements in a array section, directly in the file data
+         * Returns a empty view if the section doesn't exist, or doesn't hold elements of Type
+         */
+        template< typename Type >
+        ArrayView<Type> array( const BinaryReader &reader, uint32_t id )
+        {
+            const BinarySection *section = findSection( reader, id );
+            if( !section || section->type != BinarySectionType::Array || section->elementSize != sizeof(Type) ) {
+                return ArrayView<Type>();
+            }
+            if( !detail::binaryFits(*section, 0, section->count, sizeof(Type)) ) {
+                return ArrayView<Type>();
+            }
+            return ArrayView<Type>( reinterpret_cast<const Type*>(reader._data + section->offset), std::size_t(section->count) );
+        }
+
+        // Returns a view of column in a SoAArray section, or a empty view
+        template< typename Type >
+        ArrayView<Type> soaColumn( const BinaryReader &reader, uint32_t id, std::size_t column )
+        {
+            const BinarySection *section = findSection( reader, id );
+            if( !section || section->type != BinarySectionType::SoAArray || column >= section->elementSize ) {
+                return ArrayView<Type>();
+            }
+
+            const BinarySoAColumn *columns = detail::binarySoAColumns( reader._data, *section );
+            if( !columns || !detail::binaryColumnFits(*section, columns[column], sizeof(Type), alignof(Type)) ) {
+                return ArrayView<Type>();
+            }
+            return ArrayView<Type>( reinterpret_cast<const Type*>(reader._data + section->offset + columns[column].offset), std::size_t(section->count) );
+        }
+
+        /* copies a SoAArray section into values
+         * Returns false if the columns doesn't match, or don't fit in the section
+         */
+        template< typename... Types >
+        bool loadSoAArray( const BinaryReader &reader, uint32_t id, SoAArray<Types...> &values )
+        {
+            static const std::size_t sizes[] = { sizeof(Types)... };
+
+            const BinarySection *section = findSection( reader, id );
+            if( !section || section->type != BinarySectionType::SoAArray || section->elementSize != sizeof...(Types) ) {
+                return false;
+            }
+
+            // copied with memcpy, so the columns don't need to be aligned
+            const BinarySoAColumn *columns = detail::binarySoAColumns( reader._data, *section );
+            if( !columns ) return false;
+            for( std::size_t i=0; i < sizeof...(Types); ++i ) {
+                if( !detail::binaryColumnFits(*section, columns[i], sizes[i], 1) ) return false;
+            }
+
+            soaArray::resize( values, std::size_t(section->count) );
+            for( std::size_t i=0; i < sizeof...(Types); ++i ) {
+                std::memcpy( values._columns[i], reader._data + section->offset + columns[i].offset, sizes[i]*values._size );
+            }
+            return true;
+        }
+
+        /* Looks up a string in a string table section in place
+         * Returns nullptr if the string or the section doesn't exist, or the string doesn't fit in the section
+         */
+        const char* lookupString( const BinaryReader &reader, uint32_t id, StringId string );
+
+        /* interns every string of a string table section into table
+         * Returns false, without interning any, if a string doesn't fit in the section,
+         * or false after interning some, if a string collides with a different one already in table
+         */
+        bool loadStringTable( const BinaryReader &reader, uint32_t id, StringTable &table );
+    }
+}
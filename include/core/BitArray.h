@@ -0,0 +1,123 @@
+#pragma once
+
+#include "Containers.h"
+#include "Assume.h"
+
+namespace Core
+{
+    namespace bitArray
+    {
+        inline std::size_t size( const BitArray &array )
+        {
+            return array._size;
+        }
+
+        inline bool isNull( const BitArray &array )
+        {
+            return array._words == nullptr;
+        }
+
+        // number of words used to store size(array) bits
+        inline std::size_t wordCount( const BitArray &array )
+        {
+            return (array._size + BitArray::WORD_BITS-1) / BitArray::WORD_BITS;
+        }
+
+        inline uint64_t* words( BitArray &array )
+        {
+            return array._words;
+        }
+
+        inline const uint64_t* words( const BitArray &array )
+        {
+            return array._words;
+        }
+
+        inline bool test( const BitArray &array, std::size_t index )
+        {
+            ASSUME_TRUE( index < array._size );
+            return (array._words[index / BitArray::WORD_BITS] >> (index % BitArray::WORD_BITS)) & 1;
+        }
+
+        inline void set( BitArray &array, std::size_t index )
+        {
+            ASSUME_TRUE( index < array._size );
+            array._words[index / BitArray::WORD_BITS] |= uint64_t(1) << (index % BitArray::WORD_BITS);
+        }
+
+        inline void clear( BitArray &array, std::size_t index )
+        {
+            ASSUME_TRUE( index < array._size );
+            array._words[index / BitArray::WORD_BITS] &= ~(uint64_t(1) << (index % BitArray::WORD_BITS));
+        }
+
+        inline void assign( BitArray &array, std::size_t index, bool value )
+        {
+            if( value ) set( array, index );
+            else clear( array, index );
+        }
+
+        /* Returns the index of the first set bit at or after index,
+         * or size(array) if there is none
+         */
+        inline std::size_t findNextSet( const BitArray &array, std::size_t index )
+        {
+            if( index >= array._size ) return array._size;
+
+            std::size_t word = index / BitArray::WORD_BITS;
+            uint64_t bits = array._words[word] & (~uint64_t(0) << (index % BitArray::WORD_BITS));
+
+            const std::size_t count = wordCount( array );
+            while( bits == 0 ) {
+                if( ++word == count ) return array._size;
+                bits = array._words[word];
+            }
+
+            // compiles to tzcnt when bmi is available
+            return word * BitArray::WORD_BITS + __builtin_ctzll( bits );
+        }
+
+        /* Calls function( index ) for every set bit, in order
+         */
+        template< typename Function >
+        void forEachSet( const BitArray &array, Function function )
+        {
+            const std::size_t count = wordCount( array );
+            for( std::size_t word=0; word < count; ++word ) {
+                uint64_t bits = array._words[word];
+                while( bits ) {
+                    function( word * BitArray::WORD_BITS + __builtin_ctzll(bits) );
+                    // clear the lowest set bit
+                    bits &= bits - 1;
+                }
+            }
+        }
+
+        /* Resizes the array to size bits,
+         * if the new size is bigger than the old one,
+         * the new bits are cleared
+         */
+        void resize( BitArray &array, std::size_t size );
+
+        /* Reserves space for size bits
+         * If the new size is smaller than the old capasity, do nothing
+         */
+        void reserve( BitArray &array, std::size_t size );
+
+        void setAll( BitArray &array );
+        void clearAll( BitArray &array );
+
+        // number of set bits
+        std::size_t popcount( const BitArray &array );
+
+        /* Bulk operations, applied word by word to the whole array
+         * both arrays must have the same size
+         * Uses AVX2 when the cpu supports it
+         */
+        void andAssign( BitArray &dest, const BitArray &src );
+        void orAssign( BitArray &dest, const BitArray &src );
+        void xorAssign( BitArray &dest, const BitArray &src );
+        // dest = dest & ~src
+        void andNotAssign( BitArray &dest, const BitArray &src );
+    }
+}
@@ -0,0 +1,261 @@
+#pragma once
+
+#include "Containers.h"
+#include "Array.h"
+#include "Allocator.h"
+#include "Assume.h"
+
+#include <cstring>
+#include <utility>
+
+namespace Core
+{
+    namespace chunkedArray
+    {
+        template< typename Type, std::size_t ChunkShift >
+        void freeChunks( ChunkedArray<Type,ChunkShift> &array )
+        {
+            Allocator *allocator = array._chunks._allocator;
+            for( std::size_t i=0; i < array::size(array._chunks); ++i ) {
+                allocator->free( array._chunks[i] );
+            }
+            array._chunks._size = 0;
+        }
+    }
+
+    template< typename Type, std::size_t ChunkShift >
+    ChunkedArray<Type,ChunkShift>::ChunkedArray( const ChunkedArray &copy )
+    {
+        *this = copy;
+    }
+
+    template< typename Type, std::size_t ChunkShift >
+    ChunkedArray<Type,ChunkShift>::ChunkedArray( ChunkedArray &&move ) :
+        _chunks( std::move(move._chunks) ),
+        _size( move._size )
+    {
+        move._size = 0;
+    }
+
+    template< typename Type, std::size_t ChunkShift >
+    ChunkedArray<Type,ChunkShift>::ChunkedArray( Allocator *allocator ) :
+        _chunks(allocator)
+    {
+    }
+
+    template< typename Type, std::size_t ChunkShift >
+    ChunkedArray<Type,ChunkShift>::~ChunkedArray()
+    {
+        if( _chunks._allocator ) {
+            chunkedArray::freeChunks( *this );
+        }
+    }
+
+    template< typename Type, std::size_t ChunkShift >
+    ChunkedArray<Type,ChunkShift>& ChunkedArray<Type,ChunkShift>::operator = ( const ChunkedArray &copy )
+    {
+        ASSUME_TRUE( copy._chunks._allocator != nullptr );
+
+        if( this == &copy ) return *this;
+        if( _chunks._allocator ) {
+            chunkedArray::freeChunks( *this );
+        }
+
+        // only copy the chunks that are in use
+        std::size_t chunkCount = (copy._size + CHUNK_MASK) >> ChunkShift;
+
+        _chunks = Array<Type*>( copy._chunks._allocator );
+        array::reserve( _chunks, chunkCount );
+        for( std::size_t i=0; i < chunkCount; ++i ) {
+            Type *chunk = reinterpret_cast<Type*>( _chunks._allocator->allocate(CHUNK_SIZE*sizeof(Type), alignof(Type)) );
+            std::size_t used = copy._size - (i << ChunkShift);
+            std::memcpy( chunk, copy._chunks[i], (used < CHUNK_SIZE ? used : CHUNK_SIZE)*sizeof(Type) );
+            array::pushBack( _chunks, chunk );
+        }
+        _size = copy._size;
+
+        return *this;
+    }
+
+    template< typename Type, std::size_t ChunkShift >
+    ChunkedArray<Type,ChunkShift>& ChunkedArray<Type,ChunkShift>::operator = ( ChunkedArray &&move )
+    {
+        if( this == &move ) return *this;
+        if( _chunks._allocator ) {
+            chunkedArray::freeChunks( *this );
+        }
+
+        _chunks = std::move( move._chunks );
+        _size = move._size;
+
+        move._size = 0;
+
+        return *this;
+    }
+
+    template< typename Type, std::size_t ChunkShift >
+    Type& ChunkedArray<Type,ChunkShift>::operator [] ( std::size_t index )
+    {
+        ASSUME_TRUE( index < _size );
+        return _chunks._data[index >> ChunkShift][index & CHUNK_MASK];
+    }
+
+    template< typename Type, std::size_t ChunkShift >
+    const Type& ChunkedArray<Type,ChunkShift>::operator [] ( std::size_t index ) const
+    {
+        ASSUME_TRUE( index < _size );
+        return _chunks._data[index >> ChunkShift][index & CHUNK_MASK];
+    }
+
+    namespace chunkedArray
+    {
+        template< typename Type, std::size_t ChunkShift >
+        std::size_t size( const ChunkedArray<Type,ChunkShift> &array )
+        {
+            return array._size;
+        }
+
+        template< typename Type, std::size_t ChunkShift >
+        std::size_t capasity( const ChunkedArray<Type,ChunkShift> &array )
+        {
+            return array::size(array._chunks) << ChunkShift;
+        }
+
+        // number of chunks that holds elements
+        template< typename Type, std::size_t ChunkShift >
+        std::size_t chunkCount( const ChunkedArray<Type,ChunkShift> &array )
+        {
+            return (array._size + ChunkedArray<Type,ChunkShift>::CHUNK_MASK) >> ChunkShift;
+        }
+
+        template< typename Type, std::size_t ChunkShift >
+        Type* chunk( ChunkedArray<Type,ChunkShift> &array, std::size_t index )
+        {
+            ASSUME_TRUE( index < array::size(array._chunks) );
+            return array._chunks[index];
+        }
+
+        template< typename Type, std::size_t ChunkShift >
+        const Type* chunk( const ChunkedArray<Type,ChunkShift> &array, std::size_t index )
+        {
+            ASSUME_TRUE( index < array::size(array._chunks) );
+            return array._chunks[index];
+        }
+
+        // number of elements in use in chunk index
+        template< typename Type, std::size_t ChunkShift >
+        std::size_t chunkSize( const ChunkedArray<Type,ChunkShift> &array, std::size_t index )
+        {
+            std::size_t start = index << ChunkShift;
+            if( start >= array._size ) return 0;
+
+            std::size_t count = array._size - start;
+            return count < ChunkedArray<Type,ChunkShift>::CHUNK_SIZE ? count : ChunkedArray<Type,ChunkShift>::CHUNK_SIZE;
+        }
+
+        /* Calls function( Type *elements, std::size_t count ) for every chunk in use,
+         * prefer this over indexing when iterating over all elements
+         */
+        template< typename Type, std::size_t ChunkShift, typename Function >
+        void forEachChunk( ChunkedArray<Type,ChunkShift> &array, Function function )
+        {
+            const std::size_t count = chunkCount( array );
+            for( std::size_t i=0; i < count; ++i ) {
+                function( array._chunks[i], chunkSize(array, i) );
+            }
+        }
+
+        template< typename Type, std::size_t ChunkShift, typename Function >
+        void forEachChunk( const ChunkedArray<Type,ChunkShift> &array, Function function )
+        {
+            const std::size_t count = chunkCount( array );
+            for( std::size_t i=0; i < count; ++i ) {
+                function( static_cast<const Type*>(array._chunks[i]), chunkSize(array, i) );
+            }
+        }
+
+        /* Reserves space for size elements by adding chunks,
+         * existing elements are never moved
+         */
+        template< typename Type, std::size_t ChunkShift >
+        void reserve( ChunkedArray<Type,ChunkShift> &array, std::size_t size )
+        {
+            typedef ChunkedArray<Type,ChunkShift> Chunked;
+            Allocator *allocator = array._chunks._allocator;
+            ASSUME_TRUE( allocator != nullptr );
+
+            std::size_t needed = (size + Chunked::CHUNK_MASK) >> ChunkShift;
+            while( array::size(array._chunks) < needed ) {
+                Type *chunk = reinterpret_cast<Type*>( allocator->allocate(Chunked::CHUNK_SIZE*sizeof(Type), alignof(Type)) );
+                array::pushBack( array._chunks, chunk );
+            }
+        }
+
+        /* Frees the chunks that aren't in use
+         */
+        template< typename Type, std::size_t ChunkShift >
+        void trim( ChunkedArray<Type,ChunkShift> &array )
+        {
+            std::size_t used = chunkCount( array );
+            while( array::size(array._chunks) > used ) {
+                array._chunks._allocator->free( array::popBack(array._chunks) );
+            }
+        }
+
+        /* Resizes the array to size elements,
+         * if the new size is bigger than the old one,
+         * initilize the new elements to '\0'
+         * Chunks are kept when shrinking, use trim to free them
+         */
+        template< typename Type, std::size_t ChunkShift >
+        void resize( ChunkedArray<Type,ChunkShift> &array, std::size_t size )
+        {
+            typedef ChunkedArray<Type,ChunkShift> Chunked;
+
+            reserve( array, size );
+
+            std::size_t index = array._size;
+            while( index < size ) {
+                std::size_t offset = index & Chunked::CHUNK_MASK;
+                std::size_t count = Chunked::CHUNK_SIZE - offset;
+                if( count > size - index ) count = size - index;
+
+                std::memset( array._chunks[index >> ChunkShift] + offset, 0, count*sizeof(Type) );
+                index += count;
+            }
+            array._size = size;
+        }
+
+        template< typename Type, std::size_t ChunkShift >
+        void clear( ChunkedArray<Type,ChunkShift> &array )
+        {
+            array._size = 0;
+        }
+
+        /* Appends value, and returns a reference to the new element
+         * The reference stays valid until the element is removed
+         */
+        template< typename Type, std::size_t ChunkShift >
+        Type& pushBack( ChunkedArray<Type,ChunkShift> &array, const Type &value )
+        {
+            if( (array._size >> ChunkShift) == array::size(array._chunks) ) {
+                reserve( array, array._size+1 );
+            }
+
+            Type &element = array._chunks[array._size >> ChunkShift][array._size & ChunkedArray<Type,ChunkShift>::CHUNK_MASK];
+            element = value;
+            array._size++;
+
+            return element;
+        }
+
+        template< typename Type, std::size_t ChunkShift >
+        Type popBack( ChunkedArray<Type,ChunkShift> &array )
+        {
+            ASSUME_TRUE( array._size > 0 );
+
+            array._size--;
+            return array._chunks[array._size >> ChunkShift][array._size & ChunkedArray<Type,ChunkShift>::CHUNK_MASK];
+        }
+    }
+}
@@ -0,0 +1,423 @@
+#pragma once
+
+#include "Containers.h"
+#include "Allocator.h"
+#include "Assume.h"
+#include "Epoch.h"
+
+#include <atomic>
+#include <mutex>
+#include <new>
+
+namespace Core
+{
+    template< typename Key, typename Value, typename Hash >
+    const uint32_t ConcurrentHashMap<Key,Value,Hash>::EMPTY;
+
+    template< typename Key, typename Value, typename Hash >
+    const uint32_t ConcurrentHashMap<Key,Value,Hash>::TOMBSTONE;
+
+    namespace detail
+    {
+        // spreads the bits of the hash, std::hash is the identity for integers
+        inline uint64_t concurrentMixHash( uint64_t hash )
+        {
+            hash ^= hash >> 33;
+            hash *= 0xff51afd7ed558ccdull;
+            hash ^= hash >> 33;
+            hash *= 0xc4ceb9fe1a85ec53ull;
+            hash ^= hash >> 33;
+            return hash;
+        }
+
+        template< typename Key, typename Value, typename Hash >
+        uint64_t concurrentHashKey( const ConcurrentHashMap<Key,Value,Hash> &map, const Key &key )
+        {
+            return concurrentMixHash( uint64_t(map._hash(key)) );
+        }
+
+        // the top bits pick the shard
+        template< typename Key, typename Value, typename Hash >
+        typename ConcurrentHashMap<Key,Value,Hash>::Shard& concurrentShard( ConcurrentHashMap<Key,Value,Hash> &map, uint64_t hash )
+        {
+            return map._shards[(hash >> 56) % ConcurrentHashMap<Key,Value,Hash>::SHARD_COUNT];
+        }
+
+        // the low bits are stored in the slot, moved past the EMPTY and TOMBSTONE markers
+        inline uint32_t concurrentSlotHash( uint64_t hash )
+        {
+            uint32_t result = uint32_t( hash );
+            return result < 2 ? result + 2 : result;
+        }
+
+        template< typename Map >
+        constexpr std::size_t concurrentHeaderSize()
+        {
+            // round up to nearest cache line, so the slots start at one
+            return ((sizeof(typename Map::Table) + CACHE_LINE_SIZE-1) / CACHE_LINE_SIZE) * CACHE_LINE_SIZE;
+        }
+
+        template< typename Map >
+        typename Map::Slot* concurrentSlots( typename Map::Table *table )
+        {
+            return reinterpret_cast<typename Map::Slot*>( reinterpret_cast<uint8_t*>(table) + concurrentHeaderSize<Map>() );
+        }
+
+        template< typename Map >
+        typename Map::Table* concurrentCreateTable( Map &map, std::size_t capasity, typename Map::Table *previous )
+        {
+            typedef typename Map::Table Table;
+            typedef typename Map::Slot Slot;
+
+            void *memory = map._allocator->allocate( concurrentHeaderSize<Map>() + capasity*sizeof(Slot), CACHE_LINE_SIZE );
+
+            Table *table = new (memory) Table;
+            table->previous.store( previous, std::memory_order_release );
+            table->complete.store( previous == nullptr, std::memory_order_relaxed );
+            table->capasity = capasity;
+            table->used = 0;
+            table->migrated = 0;
+
+            Slot *slots = concurrentSlots<Map>( table );
+            for( std::size_t i=0; i < capasity; ++i ) {
+                Slot *slot = new (slots + i) Slot;
+                slot->hash.store( Map::EMPTY, std::memory_order_relaxed );
+            }
+            return table;
+        }
+
+        // frees table and every table it replaced
+        template< typename Map >
+        void concurrentFreeTables( Map &map, typename Map::Table *table )
+        {
+            while( table ) {
+                typename Map::Table *previous = table->previous.load( std::memory_order_relaxed );
+                table->~Table();
+                map._allocator->free( table );
+                table = previous;
+            }
+        }
+
+        // ReclaimFunction for a table retired to a EpochManager
+        template< typename Map >
+        void concurrentReclaimTable( void *ptr, void *allocator )
+        {
+            static_cast<typename Map::Table*>( ptr )->~Table();
+            static_cast<Allocator*>( allocator )->free( ptr );
+        }
+
+        // Returns the live slot holding key, or nullptr
+        template< typename Map, typename Key >
+        typename Map::Slot* concurrentFind( typename Map::Table *table, uint32_t hash, const Key &key )
+        {
+            typename Map::Slot *slots = concurrentSlots<Map>( table );
+            const std::size_t mask = table->capasity - 1;
+
+            // a table always has empty slots, but bound the probe anyway so a lookup never spins
+            std::size_t index = hash & mask;
+            for( std::size_t i=0; i < table->capasity; ++i ) {
+                uint32_t slotHash = slots[index].hash.load( std::memory_order_acquire );
+                if( slotHash == Map::EMPTY ) return nullptr;
+                if( slotHash == hash && slots[index].key == key ) return slots + index;
+
+                index = (index + 1) & mask;
+            }
+            return nullptr;
+        }
+
+        // writes key and value to the first empty slot, then publishes it for readers
+        template< typename Map, typename Key, typename Value >
+        void concurrentPlace( typename Map::Table *table, uint32_t hash, const Key &key, const Value &value )
+        {
+            typename Map::Slot *slots = concurrentSlots<Map>( table );
+            const std::size_t mask = table->capasity - 1;
+            ASSUME_TRUE( table->used < table->capasity );
+
+            std::size_t index = hash & mask;
+            while( slots[index].hash.load(std::memory_order_relaxed) != Map::EMPTY ) {
+                index = (index + 1) & mask;
+            }
+
+            slots[index].key = key;
+            slots[index].value = value;
+            slots[index].hash.store( hash, std::memory_order_release );
+            table->used++;
+        }
+
+        /* Moves up to count slots from the replaced table into table
+         * Keys that already are in table were assigned after the resize and are newer
+         * The old slots are left live, so readers that haven't reached table yet still find them
+         */
+        template< typename Map >
+        void concurrentMigrate( typename Map::Table *table, std::size_t count )
+        {
+            typedef typename Map::Slot Slot;
+            if( table->complete.load(std::memory_order_relaxed) ) return;
+
+            typename Map::Table *previous = table->previous.load( std::memory_order_relaxed );
+            Slot *slots = concurrentSlots<Map>( previous );
+
+            std::size_t end = table->migrated + count < previous->capasity ? table->migrated + count : previous->capasity;
+            for( std::size_t i=table->migrated; i < end; ++i ) {
+                uint32_t hash = slots[i].hash.load( std::memory_order_relaxed );
+                if( hash == Map::EMPTY || hash == Map::TOMBSTONE ) continue;
+
+                if( !concurrentFind<Map>(table, hash, slots[i].key) ) {
+                    concurrentPlace<Map>( table, hash, slots[i].key, slots[i].value );
+                }
+            }
+
+            table->migrated = end;
+            if( end == previous->capasity ) {
+                table->complete.store( true, std::memory_order_release );
+            }
+        }
+
+        /* Returns the table of shard that writes go to, with room for one more slot
+         * Starts a resize when the table is 3/4 full, and moves a few slots of a ongoing resize
+         * The shard must be locked
+         */
+        template< typename Map >
+        typename Map::Table* concurrentBeginWrite( Map &map, typename Map::Shard &shard )
+        {
+            typedef typename Map::Table Table;
+
+            Table *table = shard.table.load( std::memory_order_relaxed );
+            if( !table ) {
+                table = concurrentCreateTable( map, Map::MIN_CAPASITY, nullptr );
+                shard.table.store( table, std::memory_order_release );
+                return table;
+            }
+
+            concurrentMigrate<Map>( table, Map::MIGRATE_STEP );
+            if( (table->used + 1)*4 <= table->capasity*3 ) {
+                return table;
+            }
+
+            // the last resize must be done before its table can be replaced
+            concurrentMigrate<Map>( table, table->capasity );
+
+            // sized by the live keys, so tables full of tombstones don't grow
+            std::size_t capasity = Map::MIN_CAPASITY;
+            while( capasity < (shard.size.load(std::memory_order_relaxed) + 1)*4 ) capasity <<= 1;
+
+            Table *newTable = concurrentCreateTable( map, capasity, table );
+            shard.table.store( newTable, std::memory_order_release );
+
+            concurrentMigrate<Map>( newTable, Map::MIGRATE_STEP );
+            return newTable;
+        }
+    }
+
+    template< typename Key, typename Value, typename Hash >
+    ConcurrentHashMap<Key,Value,Hash>::ConcurrentHashMap( Allocator *allocator, Hash hash ) :
+        _allocator(allocator),
+        _hash(hash)
+    {
+        ASSUME_TRUE( _allocator != nullptr );
+        for( std::size_t i=0; i < SHARD_COUNT; ++i ) {
+            _shards[i].table.store( nullptr, std::memory_order_relaxed );
+            _shards[i].size.store( 0, std::memory_order_relaxed );
+        }
+    }
+
+    template< typename Key, typename Value, typename Hash >
+    ConcurrentHashMap<Key,Value,Hash>::~ConcurrentHashMap()
+    {
+        for( std::size_t i=0; i < SHARD_COUNT; ++i ) {
+            detail::concurrentFreeTables( *this, _shards[i].table.load(std::memory_order_relaxed) );
+        }
+    }
+
+    namespace concurrentHashMap
+    {
+        /* Copies the value of key into value, Returns false if the key isn't in the map
+         * Never locks, and never waits for writers
+         */
+        template< typename Key, typename Value, typename Hash >
+        bool find( const ConcurrentHashMap<Key,Value,Hash> &map, const Key &key, Value &value )
+        {
+            typedef ConcurrentHashMap<Key,Value,Hash> Map;
+
+            const uint64_t hash = detail::concurrentHashKey( map, key );
+            const typename Map::Shard &shard = map._shards[(hash >> 56) % Map::SHARD_COUNT];
+
+            typename Map::Table *table = shard.table.load( std::memory_order_acquire );
+            while( table ) {
+                /* previous is read before complete, reclaim only clears it once the table is complete,
+                 * so a reader that sees it cleared also sees complete and doesn't need it
+                 */
+                typename Map::Table *previous = table->previous.load( std::memory_order_acquire );
+                // if every slot was moved before the search, there is no need to look in the replaced table
+                bool complete = table->complete.load( std::memory_order_acquire );
+
+                typename Map::Slot *slot = detail::concurrentFind<Map>( table, detail::concurrentSlotHash(hash), key );
+                if( slot ) {
+                    value = slot->value;
+                    return true;
+                }
+                if( complete ) break;
+
+                table = previous;
+            }
+            return false;
+        }
+
+        template< typename Key, typename Value, typename Hash >
+        bool contains( const ConcurrentHashMap<Key,Value,Hash> &map, const Key &key )
+        {
+            Value value;
+            return find( map, key, value );
+        }
+
+        // number of keys, might already be out of date if other threads are writing
+        template< typename Key, typename Value, typename Hash >
+        std::size_t size( const ConcurrentHashMap<Key,Value,Hash> &map )
+        {
+            std::size_t result = 0;
+            for( std::size_t i=0; i < ConcurrentHashMap<Key,Value,Hash>::SHARD_COUNT; ++i ) {
+                result += map._shards[i].size.load( std::memory_order_relaxed );
+            }
+            return result;
+        }
+
+        /* Adds key with value, if the key isn't already in the map
+         * Returns true if the key was added
+         */
+        template< typename Key, typename Value, typename Hash >
+        bool insert( ConcurrentHashMap<Key,Value,Hash> &map, const Key &key, const Value &value )
+        {
+            typedef ConcurrentHashMap<Key,Value,Hash> Map;
+
+            const uint64_t hash = detail::concurrentHashKey( map, key );
+            const uint32_t stored = detail::concurrentSlotHash( hash );
+            typename Map::Shard &shard = detail::concurrentShard( map, hash );
+
+            std::lock_guard<std::mutex> lock( shard.lock );
+            typename Map::Table *table = detail::concurrentBeginWrite( map, shard );
+
+            if( detail::concurrentFind<Map>(table, stored, key) ) return false;
+            if( !table->complete.load(std::memory_order_relaxed) && detail::concurrentFind<Map>(table->previous.load(std::memory_order_relaxed), stored, key) ) return false;
+
+            detail::concurrentPlace<Map>( table, stored, key, value );
+            shard.size.fetch_add( 1, std::memory_order_relaxed );
+            return true;
+        }
+
+        /* Adds key with value, or replaces the value if the key already is in the map
+         * The new value is published in a new slot before the old one is removed,
+         * so readers see either the old or the new value
+         */
+        template< typename Key, typename Value, typename Hash >
+        void assign( ConcurrentHashMap<Key,Value,Hash> &map, const Key &key, const Value &value )
+        {
+            typedef ConcurrentHashMap<Key,Value,Hash> Map;
+
+            const uint64_t hash = detail::concurrentHashKey( map, key );
+            const uint32_t stored = detail::concurrentSlotHash( hash );
+            typename Map::Shard &shard = detail::concurrentShard( map, hash );
+
+            std::lock_guard<std::mutex> lock( shard.lock );
+            typename Map::Table *table = detail::concurrentBeginWrite( map, shard );
+
+            // a old value in the replaced table is shadowed by the new one, and isn't moved
+            typename Map::Slot *old = detail::concurrentFind<Map>( table, stored, key );
+            bool existed = old != nullptr ||
+                           (!table->complete.load(std::memory_order_relaxed) && detail::concurrentFind<Map>(table->previous.load(std::memory_order_relaxed), stored, key));
+
+            detail::concurrentPlace<Map>( table, stored, key, value );
+            if( old ) {
+                old->hash.store( Map::TOMBSTONE, std::memory_order_release );
+            }
+            if( !existed ) {
+                shard.size.fetch_add( 1, std::memory_order_relaxed );
+            }
+        }
+
+        // Returns true if the key was in the map
+        template< typename Key, typename Value, typename Hash >
+        bool erase( ConcurrentHashMap<Key,Value,Hash> &map, const Key &key )
+        {
+            typedef ConcurrentHashMap<Key,Value,Hash> Map;
+
+            const uint64_t hash = detail::concurrentHashKey( map, key );
+            const uint32_t stored = detail::concurrentSlotHash( hash );
+            typename Map::Shard &shard = detail::concurrentShard( map, hash );
+
+            std::lock_guard<std::mutex> lock( shard.lock );
+            typename Map::Table *table = shard.table.load( std::memory_order_relaxed );
+            if( !table ) return false;
+
+            detail::concurrentMigrate<Map>( table, Map::MIGRATE_STEP );
+
+            // remove it from the replaced table first, readers look there last
+            bool found = false;
+            if( !table->complete.load(std::memory_order_relaxed) ) {
+                if( typename Map::Slot *slot = detail::concurrentFind<Map>(table->previous.load(std::memory_order_relaxed), stored, key) ) {
+                    slot->hash.store( Map::TOMBSTONE, std::memory_order_release );
+                    found = true;
+                }
+            }
+            if( typename Map::Slot *slot = detail::concurrentFind<Map>(table, stored, key) ) {
+                slot->hash.store( Map::TOMBSTONE, std::memory_order_release );
+                found = true;
+            }
+
+            if( found ) {
+                shard.size.fetch_sub( 1, std::memory_order_relaxed );
+            }
+            return found;
+        }
+
+        /* Frees the tables that resizes have replaced
+         * Readers may still be using them, so only call this when no other thread is using the map
+         */
+        template< typename Key, typename Value, typename Hash >
+        void reclaim( ConcurrentHashMap<Key,Value,Hash> &map )
+        {
+            typedef ConcurrentHashMap<Key,Value,Hash> Map;
+
+            for( std::size_t i=0; i < Map::SHARD_COUNT; ++i ) {
+                std::lock_guard<std::mutex> lock( map._shards[i].lock );
+
+                // a table that isn't complete still needs the one it replaced
+                typename Map::Table *table = map._shards[i].table.load( std::memory_order_relaxed );
+                while( table && !table->complete.load(std::memory_order_relaxed) ) {
+                    table = table->previous.load( std::memory_order_relaxed );
+                }
+                if( table ) {
+                    detail::concurrentFreeTables( map, table->previous.load(std::memory_order_relaxed) );
+                    table->previous.store( nullptr, std::memory_order_release );
+                }
+            }
+        }
+
+        /* Retires the tables that resizes have replaced to thread's epoch manager, instead of freeing them
+         * Can be called while other threads use the map, as long as every find is done while pinned
+         */
+        template< typename Key, typename Value, typename Hash >
+        void reclaim( ConcurrentHashMap<Key,Value,Hash> &map, EpochThread *thread )
+        {
+            typedef ConcurrentHashMap<Key,Value,Hash> Map;
+
+            for( std::size_t i=0; i < Map::SHARD_COUNT; ++i ) {
+                std::lock_guard<std::mutex> lock( map._shards[i].lock );
+
+                typename Map::Table *table = map._shards[i].table.load( std::memory_order_relaxed );
+                while( table && !table->complete.load(std::memory_order_relaxed) ) {
+                    table = table->previous.load( std::memory_order_relaxed );
+                }
+                if( !table ) continue;
+
+                // readers that still have the retired tables follow them to their end, so only the newest is cut off
+                typename Map::Table *retired = table->previous.load( std::memory_order_relaxed );
+                table->previous.store( nullptr, std::memory_order_release );
+                while( retired ) {
+                    typename Map::Table *previous = retired->previous.load( std::memory_order_relaxed );
+                    epoch::retire( thread, retired, detail::concurrentReclaimTable<Map>, map._allocator );
+                    retired = previous;
+                }
+            }
+        }
+    }
+}
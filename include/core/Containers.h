@@ -1,12 +1,28 @@
 #pragma once
 
+#include <atomic>
 #include <cstdint>
+#include <functional>
+#include <mutex>
 #include <type_traits>
 
 namespace Core 
 {
     class Allocator;
     
+    static const std::size_t CACHE_LINE_SIZE = 64;
+    
+    namespace detail
+    {
+        template< typename... Types >
+        struct AllTrivial : std::true_type {};
+        
+        template< typename Type, typename... Rest >
+        struct AllTrivial<Type, Rest...> : 
+            std::integral_constant<bool, std::is_trivial<Type>::value && AllTrivial<Rest...>::value> 
+        {};
+    }
+    
     // a dynamic array for POD Types
     template< typename Type >
     struct Array {
@@ -31,4 +47,430 @@ namespace Core
                     
     };
     
-}
\ No newline at end of file
+    template< typename Type >
+    struct MutableArrayView;
+    
+    // a non owning, read only view of contiguous elements
+    template< typename Type >
+    struct ArrayView {
+        ArrayView() = default;
+        ArrayView( const Type *data, std::size_t size );
+        ArrayView( const Array<Type> &array );
+        ArrayView( MutableArrayView<Type> view );
+        template< std::size_t Size >
+        ArrayView( const Type (&data)[Size] );
+        
+        const Type& operator [] ( std::size_t index ) const;
+        
+        const Type *_data = nullptr;
+        std::size_t _size = 0;
+    };
+    
+    // a non owning view of contiguous elements, that allows modifying the elements
+    template< typename Type >
+    struct MutableArrayView {
+        MutableArrayView() = default;
+        MutableArrayView( Type *data, std::size_t size );
+        MutableArrayView( Array<Type> &array );
+        template< std::size_t Size >
+        MutableArrayView( Type (&data)[Size] );
+        
+        Type& operator [] ( std::size_t index ) const;
+        
+        Type *_data = nullptr;
+        std::size_t _size = 0;
+    };
+    
+    // a dynamic structure of arrays for POD Types,
+    // every type is stored in its own column, all columns share one allocation
+    template< typename... Types >
+    struct SoAArray {
+        static_assert( sizeof...(Types) > 0, "SoAArray needs at least one column!" );
+        static_assert( detail::AllTrivial<Types...>::value, "SoAArray only supports trivial types!" );
+        
+        static const std::size_t COLUMN_COUNT = sizeof...(Types);
+        static const std::size_t COLUMN_ALIGNMENT = 64;
+        
+        SoAArray() = default;
+        SoAArray( const SoAArray &copy );
+        SoAArray( SoAArray &&move );
+        SoAArray( Allocator *allocator );
+        ~SoAArray();
+        
+        SoAArray& operator = ( const SoAArray &copy );
+        SoAArray& operator = ( SoAArray &&move );
+        
+        Allocator *_allocator = nullptr;
+        void *_buffer = nullptr;
+        void *_columns[COLUMN_COUNT] = {};
+        std::size_t _size = 0,
+                    _capasity = 0;
+    };
+    
+    // a bounded lock free queue for POD Types, with one producer and one consumer thread
+    // the capasity is rounded up to a power of two
+    template< typename Type >
+    struct SpscQueue {
+        static_assert( std::is_trivial<Type>::value, "SpscQueue only supports trivial types!" );
+        
+        SpscQueue( Allocator *allocator, std::size_t capasity );
+        ~SpscQueue();
+        
+        SpscQueue( const SpscQueue& ) = delete;
+        SpscQueue& operator = ( const SpscQueue& ) = delete;
+        
+        Allocator *_allocator = nullptr;
+        Type *_data = nullptr;
+        std::size_t _mask = 0;
+        
+        // written by the consumer
+        alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> _head;
+        std::size_t _cachedTail = 0;
+        
+        // written by the producer
+        alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> _tail;
+        std::size_t _cachedHead = 0;
+    };
+    
+    // a bounded lock free queue for POD Types, with any number of producers and consumers
+    // the capasity is rounded up to a power of two
+    template< typename Type >
+    struct MpmcQueue {
+        static_assert( std::is_trivial<Type>::value, "MpmcQueue only supports trivial types!" );
+        
+        struct Cell {
+            std::atomic<std::size_t> sequence;
+            Type value;
+        };
+        
+        MpmcQueue( Allocator *allocator, std::size_t capasity );
+        ~MpmcQueue();
+        
+        MpmcQueue( const MpmcQueue& ) = delete;
+        MpmcQueue& operator = ( const MpmcQueue& ) = delete;
+        
+        Allocator *_allocator = nullptr;
+        Cell *_cells = nullptr;
+        std::size_t _mask = 0;
+        
+        alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> _head;
+        alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> _tail;
+    };
+    
+    // a dense array of POD Types addressed by generational handles
+    // Handle is either uint32_t ( 20 bit index, 12 bit generation ) or uint64_t ( 32 bit index, 32 bit generation )
+    template< typename Type, typename Handle = uint32_t >
+    struct SlotMap {
+        static_assert( std::is_trivial<Type>::value, "SlotMap only supports trivial types!" );
+        static_assert( std::is_same<Handle,uint32_t>::value || std::is_same<Handle,uint64_t>::value, "SlotMap handles must be uint32_t or uint64_t!" );
+        
+        static const unsigned INDEX_BITS = sizeof(Handle) == 4 ? 20 : 32;
+        static const Handle INDEX_MASK = (Handle(1) << INDEX_BITS) - 1;
+        static const Handle GENERATION_MASK = Handle(~Handle(0)) >> INDEX_BITS;
+        static const uint32_t FREE_LIST_END = ~uint32_t(0);
+        
+        // a handle with generation 0 is never valid
+        static const Handle NULL_HANDLE = 0;
+        
+        struct Slot {
+            // index into the dense arrays, or the next free slot
+            uint32_t index;
+            // odd while the slot holds an element and even while it is free, so handles only ever have odd generations
+            uint32_t generation;
+        };
+        
+        SlotMap() = default;
+        SlotMap( Allocator *allocator );
+        
+        Array<Type> _values;
+        Array<uint32_t> _valueSlots;
+        Array<Slot> _slots;
+        uint32_t _freeHead = FREE_LIST_END;
+    };
+    
+    // a dynamic array of bits, packed into 64 bit words
+    // bits past the size are always kept cleared
+    struct BitArray {
+        static const std::size_t WORD_BITS = 64;
+        static const std::size_t WORD_ALIGNMENT = 32;
+        
+        BitArray() = default;
+        BitArray( const BitArray &copy );
+        BitArray( BitArray &&move );
+        BitArray( Allocator *allocator );
+        ~BitArray();
+        
+        BitArray& operator = ( const BitArray &copy );
+        BitArray& operator = ( BitArray &&move );
+        
+        Allocator *_allocator = nullptr;
+        uint64_t *_words = nullptr;
+        // _size is in bits, _capasity is in words
+        std::size_t _size = 0,
+                    _capasity = 0;
+    };
+    
+    // a dynamic array for POD Types, stored in fixed size chunks of 2^ChunkShift elements
+    // growing never moves existing elements, so pointers to them stay valid
+    template< typename Type, std::size_t ChunkShift = 10 >
+    struct ChunkedArray {
+        static_assert( std::is_trivial<Type>::value, "ChunkedArray only supports trivial types!" );
+        
+        static const std::size_t CHUNK_SIZE = std::size_t(1) << ChunkShift;
+        static const std::size_t CHUNK_MASK = CHUNK_SIZE - 1;
+        
+        ChunkedArray() = default;
+        ChunkedArray( const ChunkedArray &copy );
+        ChunkedArray( ChunkedArray &&move );
+        ChunkedArray( Allocator *allocator );
+        ~ChunkedArray();
+        
+        ChunkedArray& operator = ( const ChunkedArray &copy );
+        ChunkedArray& operator = ( ChunkedArray &&move );
+        
+        Type& operator [] ( std::size_t index );
+        const Type& operator [] ( std::size_t index ) const;
+        
+        Array<Type*> _chunks;
+        std::size_t _size = 0;
+    };
+    
+    // a sorted map for POD Types, keys and values are stored in parallel arrays
+    template< typename Key, typename Value >
+    struct FlatMap {
+        static_assert( std::is_trivial<Key>::value && std::is_trivial<Value>::value, "FlatMap only supports trivial types!" );
+        
+        FlatMap() = default;
+        FlatMap( Allocator *allocator );
+        
+        Array<Key> _keys;
+        Array<Value> _values;
+        // false while in bulk mode, until the arrays are sorted again
+        bool _sorted = true;
+    };
+    
+    // a ordered map for POD Types, stored in a B+ tree with nodes sized to a few cache lines
+    template< typename Key, typename Value >
+    struct BTreeMap {
+        static_assert( std::is_trivial<Key>::value && std::is_trivial<Value>::value, "BTreeMap only supports trivial types!" );
+        
+        static const std::size_t NODE_SIZE = 4*CACHE_LINE_SIZE;
+        static const std::size_t NODE_HEADER_SIZE = 2*sizeof(void*);
+        
+        static const std::size_t LEAF_CAPASITY_ = (NODE_SIZE - NODE_HEADER_SIZE - sizeof(void*)) / (sizeof(Key) + sizeof(Value));
+        static const std::size_t INNER_CAPASITY_ = (NODE_SIZE - NODE_HEADER_SIZE - sizeof(void*)) / (sizeof(Key) + sizeof(void*));
+        
+        // always room for at least 3 keys, so a split node is never empty
+        static const std::size_t LEAF_CAPASITY = LEAF_CAPASITY_ < 3 ? 3 : LEAF_CAPASITY_;
+        static const std::size_t INNER_CAPASITY = INNER_CAPASITY_ < 3 ? 3 : INNER_CAPASITY_;
+        
+        struct Node {
+            uint32_t count;
+            bool leaf;
+        };
+        
+        struct LeafNode : Node {
+            Key keys[LEAF_CAPASITY];
+            Value values[LEAF_CAPASITY];
+            LeafNode *next;
+        };
+        
+        struct InnerNode : Node {
+            Key keys[INNER_CAPASITY];
+            Node *children[INNER_CAPASITY+1];
+        };
+        
+        struct Iterator {
+            LeafNode *leaf;
+            uint32_t index;
+        };
+        
+        BTreeMap() = default;
+        BTreeMap( BTreeMap &&move );
+        BTreeMap( Allocator *allocator );
+        ~BTreeMap();
+        
+        BTreeMap( const BTreeMap& ) = delete;
+        BTreeMap& operator = ( const BTreeMap& ) = delete;
+        
+        BTreeMap& operator = ( BTreeMap &&move );
+        
+        Allocator *_allocator = nullptr;
+        Node *_root = nullptr;
+        LeafNode *_first = nullptr;
+        std::size_t _size = 0;
+    };
+    
+    // a read only search index over sorted POD keys, stored in eytzinger (breadth first) order
+    template< typename Key >
+    struct StaticSearchIndex {
+        static_assert( std::is_trivial<Key>::value, "StaticSearchIndex only supports trivial types!" );
+        
+        StaticSearchIndex() = default;
+        StaticSearchIndex( Allocator *allocator );
+        
+        // 1 based, _keys[0] is unused
+        Array<Key> _keys;
+        // the index in the sorted array of each key
+        Array<uint32_t> _ranks;
+    };
+    
+    // a dynamic array for POD Types, where copies share the buffer until one of them is modified
+    template< typename Type >
+    struct SharedArray {
+        static_assert( std::is_trivial<Type>::value, "SharedArray only supports trivial types!" );
+        
+        // placed in front of the elements in the same allocation
+        struct Buffer {
+            std::atomic<uint32_t> references;
+            Allocator *allocator;
+            std::size_t capasity;
+        };
+        
+        SharedArray() = default;
+        SharedArray( const SharedArray &copy );
+        SharedArray( SharedArray &&move );
+        SharedArray( Allocator *allocator );
+        ~SharedArray();
+        
+        SharedArray& operator = ( const SharedArray &copy );
+        SharedArray& operator = ( SharedArray &&move );
+        
+        // read only, use sharedArray::mutableData or set to modify
+        const Type& operator [] ( std::size_t index ) const;
+        
+        Allocator *_allocator = nullptr;
+        Buffer *_buffer = nullptr;
+        std::size_t _size = 0;
+    };
+    
+    // a d-ary heap of POD Types, the element that Compare orders first is at the top
+    // with the default std::less the smallest element is at the top
+    template< typename Type, typename Compare = std::less<Type>, std::size_t Arity = 4 >
+    struct PriorityQueue {
+        static_assert( std::is_trivial<Type>::value, "PriorityQueue only supports trivial types!" );
+        static_assert( Arity >= 2, "PriorityQueue needs at least 2 children per node!" );
+        
+        static const uint32_t NO_POSITION = ~uint32_t(0);
+        
+        PriorityQueue() = default;
+        PriorityQueue( Allocator *allocator, Compare compare = Compare() );
+        
+        Array<Type> _heap;
+        
+        // only used when the index map is enabled,
+        // the id of each element in the heap, and the heap position of each id
+        Array<uint32_t> _ids;
+        Array<uint32_t> _positions;
+        bool _indexed = false;
+        
+        Compare _compare;
+    };
+
+    // unsigned 32 bit integers packed with a fixed number of bits each
+    // values are stored in blocks of BLOCK_SIZE, so every block takes exactly _bits words
+    struct PackedIntArray {
+        static const std::size_t BLOCK_SIZE = 64;
+
+        PackedIntArray() = default;
+        PackedIntArray( Allocator *allocator, uint32_t bits );
+
+        // whole blocks, followed by one padding word so blocks can be decoded with unaligned loads
+        Array<uint64_t> _words;
+        uint32_t _bits = 0;
+        std::size_t _size = 0;
+    };
+
+    // unsigned 32 bit integers in frame of reference blocks of BLOCK_SIZE values,
+    // each block is packed as the offsets from its smallest value, with just enough bits for the largest offset
+    // values are appended to _pending, until there is a full block to pack
+    struct DeltaIntArray {
+        static const std::size_t BLOCK_SIZE = 64;
+
+        struct Block {
+            uint32_t base;
+            uint32_t bits;
+            // index of the first word of the block
+            std::size_t word;
+        };
+
+        DeltaIntArray() = default;
+        DeltaIntArray( Allocator *allocator );
+
+        Array<Block> _blocks;
+        // followed by one padding word, like in PackedIntArray
+        Array<uint64_t> _words;
+        uint32_t _pending[BLOCK_SIZE];
+        std::size_t _size = 0;
+    };
+
+    // unsigned 32 bit integers as variable length integers with 7 bits per byte,
+    // with the byte offset of every BLOCK_SIZE value so it can be accessed by block
+    struct VarintArray {
+        static const std::size_t BLOCK_SIZE = 64;
+
+        VarintArray() = default;
+        VarintArray( Allocator *allocator );
+
+        Array<uint8_t> _bytes;
+        Array<std::size_t> _blockOffsets;
+        std::size_t _size = 0;
+    };
+
+    // a hash map of POD Keys and Values shared between threads
+    // lookups never lock or retry, writers lock one of SHARD_COUNT shards
+    // a full shard moves its slots to a bigger table a few at a time, during later writes
+    template< typename Key, typename Value, typename Hash = std::hash<Key> >
+    struct ConcurrentHashMap {
+        static_assert( std::is_trivial<Key>::value, "ConcurrentHashMap only supports trivial keys!" );
+        static_assert( std::is_trivial<Value>::value, "ConcurrentHashMap only supports trivial values!" );
+        
+        static const std::size_t SHARD_COUNT = 16;
+        static const std::size_t MIN_CAPASITY = 16;
+        // slots moved to the new table by each write while a shard is resizing
+        static const std::size_t MIGRATE_STEP = 32;
+        
+        static const uint32_t EMPTY = 0;
+        static const uint32_t TOMBSTONE = 1;
+        
+        struct Slot {
+            // EMPTY, TOMBSTONE or the hash of the key, published after the key and value are written
+            std::atomic<uint32_t> hash;
+            Key key;
+            Value value;
+        };
+        
+        // placed in front of the slots in the same allocation
+        struct Table {
+            /* the table this one replaced, it is kept until reclaim since readers may still use it
+             * reclaim clears it while readers follow it, so it is atomic
+             */
+            std::atomic<Table*> previous;
+            // set once every slot of previous has been moved here
+            std::atomic<bool> complete;
+            std::size_t capasity;
+            // live slots and tombstones
+            std::size_t used;
+            // slots of previous that have been moved
+            std::size_t migrated;
+        };
+        
+        struct alignas(CACHE_LINE_SIZE) Shard {
+            std::mutex lock;
+            std::atomic<Table*> table;
+            // number of keys
+            std::atomic<std::size_t> size;
+        };
+        
+        ConcurrentHashMap( Allocator *allocator, Hash hash = Hash() );
+        ~ConcurrentHashMap();
+        
+        ConcurrentHashMap( const ConcurrentHashMap& ) = delete;
+        ConcurrentHashMap& operator = ( const ConcurrentHashMap& ) = delete;
+        
+        Allocator *_allocator;
+        Hash _hash;
+        Shard _shards[SHARD_COUNT];
+    };
+    
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Core
+{
+    class Allocator;
+
+    struct EpochManager;
+    struct EpochThread;
+
+    typedef void (*ReclaimFunction)( void *ptr, void *data );
+
+    /* Epoch based reclamation, for memory that lock free readers may still be reading after it was unlinked
+     * Readers pin the current epoch while they use shared pointers, and unlinked memory is retired
+     * instead of freed, it is freed once every thread that was pinned when it was retired has unpinned
+     * At most maxThreads threads can be registered at the same time
+     */
+    EpochManager* createEpochManager( Allocator *allocator, std::size_t maxThreads = 64 );
+
+    // frees everything that is still retired, no thread may be pinned
+    void destroyEpochManager( EpochManager *manager );
+
+    namespace epoch
+    {
+        // Returns nullptr if maxThreads threads are already registered
+        EpochThread* registerThread( EpochManager *manager );
+
+        // memory retired by the thread is handed to the manager, and freed by a later collect
+        void unregisterThread( EpochThread *thread );
+
+        // pins can nest, only the outermost pin and unpin do anything
+        void pin( EpochThread *thread );
+        void unpin( EpochThread *thread );
+
+        // frees ptr to allocator once no thread can be reading it
+        void retire( EpochThread *thread, void *ptr, Allocator *allocator );
+        // calls function with ptr and data once no thread can be reading it
+        void retire( EpochThread *thread, void *ptr, ReclaimFunction function, void *data );
+
+        /* Advances the epoch if every pinned thread has seen the current one,
+         * and frees what the thread retired at least two epochs ago, Returns the number freed
+         * retire also collects every so often
+         */
+        std::size_t collect( EpochThread *thread );
+
+        uint64_t currentEpoch( const EpochManager *manager );
+
+        // the number of retired pointers that haven't been freed yet, by every thread
+        std::size_t retiredCount( const EpochManager *manager );
+    }
+
+    // pins the epoch for a scope
+    class EpochGuard {
+        EpochGuard( const EpochGuard& ) = delete;
+        EpochGuard& operator = ( const EpochGuard& ) = delete;
+    public:
+        explicit EpochGuard( EpochThread *thread ) :
+            mThread(thread)
+        {
+            epoch::pin( mThread );
+        }
+
+        ~EpochGuard()
+        {
+            epoch::unpin( mThread );
+        }
+
+    private:
+        EpochThread *mThread;
+    };
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+
+namespace Core
+{
+    class Allocator;
+
+    struct Fiber;
+
+    // must never return, a fiber ends by switching to another fiber
+    typedef void (*FiberFunction)( void *data );
+
+    /* Creates a allocator of stackSize stacks, with a inaccessible guard page below each stack
+     * so a stack overflow faults instead of overwriting other memory
+     * Stacks are mapped in chunks, and reused once they are freed, it can be used from any thread
+     */
+    Allocator* createGuardedStackAllocator( std::size_t stackSize, Allocator *backer );
+    void destroyGuardedStackAllocator( Allocator *allocator );
+
+    /* Creates a fiber that calls function with data, the first time it is switched to
+     * The stack is stackSize bytes from stacks
+     */
+    Fiber* createFiber( Allocator *allocator, Allocator *stacks, std::size_t stackSize, FiberFunction function, void *data );
+
+    // a fiber for the stack of the calling thread, so it can switch to other fibers and back
+    Fiber* createThreadFiber( Allocator *allocator );
+
+    // restarts a fiber that isn't running, so it calls function the next time it is switched to
+    void resetFiber( Fiber *fiber, FiberFunction function, void *data );
+
+    void destroyFiber( Fiber *fiber );
+
+    /* Saves the registers of the running fiber into from, and continues running to
+     * Returns when another fiber switches back to from, possibly on another thread
+     */
+    void switchFiber( Fiber *from, Fiber *to );
+}
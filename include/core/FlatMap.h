@@ -0,0 +1,203 @@
+#pragma once
+
+#include "Containers.h"
+#include "Array.h"
+#include "Assume.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace Core
+{
+    template< typename Key, typename Value >
+    FlatMap<Key,Value>::FlatMap( Allocator *allocator ) :
+        _keys(allocator),
+        _values(allocator)
+    {
+    }
+
+    namespace flatMap
+    {
+        template< typename Key, typename Value >
+        std::size_t size( const FlatMap<Key,Value> &map )
+        {
+            return array::size( map._keys );
+        }
+
+        template< typename Key, typename Value >
+        const Key* keys( const FlatMap<Key,Value> &map )
+        {
+            return array::begin( map._keys );
+        }
+
+        template< typename Key, typename Value >
+        Value* values( FlatMap<Key,Value> &map )
+        {
+            return array::begin( map._values );
+        }
+
+        template< typename Key, typename Value >
+        const Value* values( const FlatMap<Key,Value> &map )
+        {
+            return array::begin( map._values );
+        }
+
+        /* Returns the index of the first key that isn't less than key,
+         * the loop has a fixed trip count and compiles to a conditional move
+         */
+        template< typename Key, typename Value >
+        std::size_t lowerBound( const FlatMap<Key,Value> &map, const Key &key )
+        {
+            ASSUME_TRUE( map._sorted );
+
+            std::size_t count = size( map );
+            if( count == 0 ) return 0;
+
+            const Key *first = array::begin( map._keys );
+            const Key *base = first;
+            while( count > 1 ) {
+                std::size_t half = count / 2;
+                base = (base[half] < key) ? base + half : base;
+                count -= half;
+            }
+            return (base - first) + (*base < key);
+        }
+
+        // Returns the index of the first key that is greater than key
+        template< typename Key, typename Value >
+        std::size_t upperBound( const FlatMap<Key,Value> &map, const Key &key )
+        {
+            ASSUME_TRUE( map._sorted );
+
+            std::size_t count = size( map );
+            if( count == 0 ) return 0;
+
+            const Key *first = array::begin( map._keys );
+            const Key *base = first;
+            while( count > 1 ) {
+                std::size_t half = count / 2;
+                base = (key < base[half]) ? base : base + half;
+                count -= half;
+            }
+            return (base - first) + !(key < *base);
+        }
+
+        template< typename Key, typename Value >
+        Value* find( FlatMap<Key,Value> &map, const Key &key )
+        {
+            std::size_t index = lowerBound( map, key );
+            if( index == size(map) || key < map._keys[index] ) return nullptr;
+            return &map._values[index];
+        }
+
+        template< typename Key, typename Value >
+        const Value* find( const FlatMap<Key,Value> &map, const Key &key )
+        {
+            std::size_t index = lowerBound( map, key );
+            if( index == size(map) || key < map._keys[index] ) return nullptr;
+            return &map._values[index];
+        }
+
+        /* Inserts or replaces the value for key,
+         * Returns true if the key wasn't already in the map
+         */
+        template< typename Key, typename Value >
+        bool insert( FlatMap<Key,Value> &map, const Key &key, const Value &value )
+        {
+            std::size_t index = lowerBound( map, key );
+            if( index < size(map) && !(key < map._keys[index]) ) {
+                map._values[index] = value;
+                return false;
+            }
+
+            // grow by one, and shift the tail up to make room
+            array::pushBack( map._keys, key );
+            array::pushBack( map._values, value );
+
+            std::size_t tail = size(map) - 1 - index;
+            std::memmove( array::begin(map._keys) + index + 1, array::begin(map._keys) + index, tail*sizeof(Key) );
+            std::memmove( array::begin(map._values) + index + 1, array::begin(map._values) + index, tail*sizeof(Value) );
+            map._keys[index] = key;
+            map._values[index] = value;
+
+            return true;
+        }
+
+        /* Erases key from the map
+         * Returns false if the key wasn't in the map
+         */
+        template< typename Key, typename Value >
+        bool erase( FlatMap<Key,Value> &map, const Key &key )
+        {
+            std::size_t index = lowerBound( map, key );
+            if( index == size(map) || key < map._keys[index] ) return false;
+
+            std::size_t tail = size(map) - 1 - index;
+            std::memmove( array::begin(map._keys) + index, array::begin(map._keys) + index + 1, tail*sizeof(Key) );
+            std::memmove( array::begin(map._values) + index, array::begin(map._values) + index + 1, tail*sizeof(Value) );
+            array::popBack( map._keys );
+            array::popBack( map._values );
+
+            return true;
+        }
+
+        template< typename Key, typename Value >
+        void clear( FlatMap<Key,Value> &map )
+        {
+            map._keys._size = 0;
+            map._values._size = 0;
+            map._sorted = true;
+        }
+
+        /* Appends key and value without keeping the map sorted,
+         * call finishBulk before using any lookups
+         */
+        template< typename Key, typename Value >
+        void bulkInsert( FlatMap<Key,Value> &map, const Key &key, const Value &value )
+        {
+            array::pushBack( map._keys, key );
+            array::pushBack( map._values, value );
+            map._sorted = false;
+        }
+
+        /* Sorts the map after bulkInsert,
+         * if a key was inserted more than once, the last value wins
+         */
+        template< typename Key, typename Value >
+        void finishBulk( FlatMap<Key,Value> &map )
+        {
+            if( map._sorted ) return;
+
+            struct Entry {
+                Key key;
+                Value value;
+            };
+
+            const std::size_t count = size( map );
+            Array<Entry> entries( map._keys._allocator );
+            array::resize( entries, count );
+            for( std::size_t i=0; i < count; ++i ) {
+                entries[i].key = map._keys[i];
+                entries[i].value = map._values[i];
+            }
+
+            std::stable_sort( array::begin(entries), array::end(entries), []( const Entry &a, const Entry &b ) {
+                return a.key < b.key;
+            });
+
+            std::size_t unique = 0;
+            for( std::size_t i=0; i < count; ++i ) {
+                if( unique > 0 && !(map._keys[unique-1] < entries[i].key) ) {
+                    map._values[unique-1] = entries[i].value;
+                    continue;
+                }
+                map._keys[unique] = entries[i].key;
+                map._values[unique] = entries[i].value;
+                unique++;
+            }
+            map._keys._size = unique;
+            map._values._size = unique;
+            map._sorted = true;
+        }
+    }
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "Assume.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace Core
+{
+    class Allocator;
+
+    struct JobSystem;
+    struct Job;
+
+    typedef void (*JobFunction)( JobSystem *system, void *data );
+
+    // counts the jobs that have been run but not finished yet
+    struct JobCounter {
+        std::atomic<uint32_t> value;
+
+        JobCounter() : value(0) {}
+    };
+
+    // bytes of data that are copied into each job
+    static const std::size_t JOB_DATA_SIZE = 56;
+    // jobs that can depend on a single job
+    static const std::size_t JOB_MAX_DEPENDENTS = 6;
+    // size of the stacks of the fibers the worker threads run jobs on
+    static const std::size_t JOB_STACK_SIZE = 64*1024;
+
+    /* Creates a job system with workerCount workers, 0 uses one per hardware thread
+     * The calling thread is worker 0, it only runs jobs while it waits in jobSystem::wait,
+     * a thread is started for each of the other workers, which runs jobs on fibers
+     */
+    JobSystem* createJobSystem( Allocator *allocator, std::size_t workerCount = 0 );
+
+    // called from the thread that created the system, every job that was run must be finished
+    void destroyJobSystem( JobSystem *system );
+
+    namespace jobSystem
+    {
+        std::size_t workerCount( const JobSystem *system );
+
+        // index of the worker the calling thread is, or -1 if it isn't one of the workers
+        int currentWorker( const JobSystem *system );
+
+        /* Creates a job that calls function with a copy of size bytes of data
+         * The job record comes from the pool of the calling worker,
+         * it isn't scheduled until it is run, and is freed once it has finished
+         */
+        Job* createJob( JobSystem *system, JobFunction function, const void *data = nullptr, std::size_t size = 0 );
+
+        template< typename Type >
+        Job* createJob( JobSystem *system, JobFunction function, const Type &data )
+        {
+            static_assert( std::is_trivially_copyable<Type>::value, "Job data must be trivially copyable!" );
+            static_assert( sizeof(Type) <= JOB_DATA_SIZE, "Job data is too big!" );
+            return createJob( system, function, &data, sizeof(Type) );
+        }
+
+        /* job isn't started until dependency has finished
+         * Both jobs must be created but not yet run
+         */
+        void addDependency( Job *job, Job *dependency );
+
+        // the counter is increased when the job is run, and decreased when it has finished
+        void setCounter( Job *job, JobCounter *counter );
+
+        /* Decreases counter by one, and wakes a worker if any job is suspended in waitForCounter
+         * Counters decreased by anything other than a finished job, like a async read, must be decreased
+         * this way, or a job waiting on them can stay suspended while every worker sleeps
+         */
+        void decrementCounter( JobSystem *system, JobCounter &counter );
+
+        /* Schedules the job on the calling workers queue, once all its dependencies have finished
+         * The job may not be used after this
+         */
+        void run( JobSystem *system, Job *job );
+
+        // creates and runs a job counted by counter
+        void run( JobSystem *system, JobFunction function, const void *data, std::size_t size, JobCounter *counter );
+
+        /* Runs other jobs until counter reaches zero
+         * Can be called from any thread, also from inside a job
+         */
+        void wait( JobSystem *system, const JobCounter &counter );
+
+        /* Suspends the calling job until counter reaches zero, its worker thread runs other jobs meanwhile
+         * The job may continue on another worker thread, so nothing tied to the thread can be held across it,
+         * like a lock or a profile scope, whose begin and end would go to different threads' rings
+         * A AllocationTagScope is the exception, the tag is moved along with the job
+         * Called from a thread that isn't running on a fiber, like worker 0, it waits like wait
+         */
+        void waitForCounter( JobSystem *system, const JobCounter &counter );
+
+        typedef void (*ParallelForFunction)( std::size_t begin, std::size_t end, void *data );
+
+        /* Calls function for the range [0, count) split into batches of batchSize,
+         * and waits for all of them to finish
+         */
+        void parallelFor( JobSystem *system, std::size_t count, std::size_t batchSize, ParallelForFunction function, void *data );
+    }
+}
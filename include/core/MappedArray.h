@@ -0,0 +1,113 @@
+#pragma once
+
+#include "Containers.h"
+#include "Array.h"
+#include "Assume.h"
+
+namespace Core
+{
+    enum class MapMode {
+        // the array maps the file read only, and can't be modified or resized
+        ReadOnly,
+        // the array maps the file shared, changes are written back to the file
+        ReadWrite
+    };
+    
+    /* Creates a allocator that owns a single mapping of the file at path,
+     * data and size are set to the mapping and the size of the file
+     * reallocate grows or shrinks the file with ftruncate and mremap, and fails a assumption if it can't,
+     * freeing the mapping unmaps it, closes the file and destroys the allocator,
+     * and freeUsed truncates the file to the used size before that
+     * Returns nullptr if the file couldn't be opened or mapped
+     */
+    Allocator* createMappedFileAllocator( const char *path, MapMode mode, void **data, std::size_t *size );
+    
+    /* Resizes the file and the mapping owned by allocator to size bytes
+     * Returns the mapping, or nullptr if it couldn't be resized, the old mapping is kept then
+     */
+    void* resizeMappedFile( Allocator *allocator, std::size_t size );
+    
+    // msyncs the mapping owned by allocator
+    void flushMappedFile( Allocator *allocator );
+    
+    /* Truncates the file to usedSize bytes, if it's writable,
+     * and frees the mapping and the allocator
+     */
+    void closeMappedFile( Allocator *allocator, std::size_t usedSize );
+    
+    namespace mappedArray
+    {
+        /* Maps the file at path into array, the array gets the elements that are already in the file
+         * In ReadWrite mode the file is created if it doesn't exist
+         * Mapped arrays can be moved, but not copied
+         * Returns false if the file couldn't be opened, or its size isn't a multiple of sizeof(Type)
+         */
+        template< typename Type >
+        bool open( Array<Type> &array, const char *path, MapMode mode )
+        {
+            void *data = nullptr;
+            std::size_t size = 0;
+            
+            Allocator *allocator = createMappedFileAllocator( path, mode, &data, &size );
+            if( !allocator ) return false;
+            
+            if( size % sizeof(Type) != 0 ) {
+                closeMappedFile( allocator, size );
+                return false;
+            }
+            
+            array = Array<Type>();
+            array._allocator = allocator;
+            array._data = static_cast<Type*>( data );
+            array._size = size / sizeof(Type);
+            array._capasity = array._size;
+            
+            return true;
+        }
+        
+        /* Reserves capasity for size elements in the file, like array::reserve
+         * Growing a mapped array through pushBack or reserve fails a assumption if the file can't grow,
+         * a full disk or a file size limit for example, this returns false instead and leaves the array as it was
+         */
+        template< typename Type >
+        bool reserve( Array<Type> &array, std::size_t size )
+        {
+            ASSUME_TRUE( array._allocator != nullptr );
+            if( size <= array._capasity ) return true;
+            
+            void *data = resizeMappedFile( array._allocator, size*sizeof(Type) );
+            if( !data ) return false;
+            
+            array._data = static_cast<Type*>( data );
+            array._capasity = size;
+            return true;
+        }
+        
+        /* Writes the modified pages back to the file
+         * The file may be longer than the array until it's closed or trimmed, since growing reserves capasity in the file
+         * Growing doesn't sync, only this, trim and close do
+         */
+        template< typename Type >
+        void flush( Array<Type> &array )
+        {
+            ASSUME_TRUE( array._allocator != nullptr );
+            flushMappedFile( array._allocator );
+        }
+        
+        /* Truncates the file to the size of the array, and unmaps it
+         * Destroying the array does the same
+         */
+        template< typename Type >
+        void close( Array<Type> &array )
+        {
+            if( array._allocator == nullptr ) return;
+            
+            closeMappedFile( array._allocator, array._size*sizeof(Type) );
+            
+            array._allocator = nullptr;
+            array._data = nullptr;
+            array._size = 0;
+            array._capasity = 0;
+        }
+    }
+}
@@ -0,0 +1,201 @@
+#pragma once
+
+#include "Containers.h"
+#include "Array.h"
+#include "ArrayView.h"
+#include "Assume.h"
+
+namespace Core
+{
+    namespace detail
+    {
+        // reads the bits wide value at index from packed words
+        inline uint32_t extractBits( const uint64_t *words, uint32_t bits, std::size_t index )
+        {
+            if( bits == 0 ) return 0;
+
+            const std::size_t bit = index * bits;
+            const std::size_t shift = bit % 64;
+            const uint64_t *word = words + bit / 64;
+
+            uint64_t value = word[0] >> shift;
+            if( shift + bits > 64 ) {
+                value |= word[1] << (64 - shift);
+            }
+            return uint32_t( value & ((uint64_t(1) << bits) - 1) );
+        }
+
+        /* Decodes the 64 bits wide values of a block starting at words
+         * reads up to one word past the block, which is why the packed arrays keep a padding word
+         */
+        void unpackBlock( const uint64_t *words, uint32_t bits, uint32_t *values );
+
+        // packs 64 values into bits words, the words must be cleared
+        void packBlock( const uint32_t *values, uint32_t bits, uint64_t *words );
+    }
+
+    namespace packedIntArray
+    {
+        // smallest number of bits that can hold value
+        inline uint32_t requiredBits( uint32_t value )
+        {
+            return value ? 32 - __builtin_clz(value) : 0;
+        }
+
+        inline std::size_t size( const PackedIntArray &array )
+        {
+            return array._size;
+        }
+
+        inline uint32_t bits( const PackedIntArray &array )
+        {
+            return array._bits;
+        }
+
+        inline std::size_t blockCount( const PackedIntArray &array )
+        {
+            return (array._size + PackedIntArray::BLOCK_SIZE-1) / PackedIntArray::BLOCK_SIZE;
+        }
+
+        inline uint32_t get( const PackedIntArray &array, std::size_t index )
+        {
+            ASSUME_TRUE( index < array._size );
+            return detail::extractBits( array._words._data, array._bits, index );
+        }
+
+        // value must fit in bits(array) bits
+        void set( PackedIntArray &array, std::size_t index, uint32_t value );
+
+        /* Resizes the array to size values,
+         * if the new size is bigger than the old one, the new values are 0
+         */
+        void resize( PackedIntArray &array, std::size_t size );
+        void reserve( PackedIntArray &array, std::size_t size );
+        void pushBack( PackedIntArray &array, uint32_t value );
+        void clear( PackedIntArray &array );
+
+        // Replaces the values, with as few bits per value as the largest value needs
+        void assign( PackedIntArray &array, ArrayView<uint32_t> values );
+
+        /* Decodes a block into values, which must have room for BLOCK_SIZE values
+         * Returns the number of values in the block, only the last block can be partial
+         */
+        std::size_t decodeBlock( const PackedIntArray &array, std::size_t block, uint32_t *values );
+
+        // decodes count values starting at first
+        void decode( const PackedIntArray &array, std::size_t first, std::size_t count, uint32_t *values );
+    }
+
+    namespace deltaIntArray
+    {
+        inline std::size_t size( const DeltaIntArray &array )
+        {
+            return array._size;
+        }
+
+        // including the partial block of pending values
+        inline std::size_t blockCount( const DeltaIntArray &array )
+        {
+            return (array._size + DeltaIntArray::BLOCK_SIZE-1) / DeltaIntArray::BLOCK_SIZE;
+        }
+
+        inline uint32_t get( const DeltaIntArray &array, std::size_t index )
+        {
+            ASSUME_TRUE( index < array._size );
+
+            std::size_t block = index / DeltaIntArray::BLOCK_SIZE,
+                        offset = index % DeltaIntArray::BLOCK_SIZE;
+            if( block >= array::size(array._blocks) ) {
+                return array._pending[offset];
+            }
+
+            const DeltaIntArray::Block &packed = array._blocks[block];
+            return packed.base + detail::extractBits( array._words._data + packed.word, packed.bits, offset );
+        }
+
+        void pushBack( DeltaIntArray &array, uint32_t value );
+        void clear( DeltaIntArray &array );
+        void assign( DeltaIntArray &array, ArrayView<uint32_t> values );
+
+        /* Decodes a block into values, which must have room for BLOCK_SIZE values
+         * Returns the number of values in the block
+         */
+        std::size_t decodeBlock( const DeltaIntArray &array, std::size_t block, uint32_t *values );
+
+        // number of bytes used by the packed blocks
+        std::size_t byteSize( const DeltaIntArray &array );
+    }
+
+    namespace varint
+    {
+        static const std::size_t MAX_BYTES = 5;
+
+        // Returns the number of bytes written, at most MAX_BYTES
+        inline std::size_t encode( uint32_t value, uint8_t *bytes )
+        {
+            std::size_t count = 0;
+            while( value >= 0x80 ) {
+                bytes[count++] = uint8_t( value | 0x80 );
+                value >>= 7;
+            }
+            bytes[count++] = uint8_t( value );
+            return count;
+        }
+
+        // Returns the number of bytes read
+        inline std::size_t decode( const uint8_t *bytes, uint32_t *value )
+        {
+            uint32_t result = 0;
+            std::size_t count = 0;
+            uint32_t shift = 0;
+            for(;;) {
+                uint8_t byte = bytes[count++];
+                result |= uint32_t(byte & 0x7f) << shift;
+                if( !(byte & 0x80) ) break;
+                shift += 7;
+            }
+            *value = result;
+            return count;
+        }
+
+        /* Encodes count values, bytes must have room for count*MAX_BYTES bytes
+         * Returns the number of bytes written
+         */
+        std::size_t encodeN( const uint32_t *values, std::size_t count, uint8_t *bytes );
+
+        /* Decodes count values, so a stream can be decoded in parts
+         * Returns the number of bytes read
+         */
+        std::size_t decodeN( const uint8_t *bytes, std::size_t count, uint32_t *values );
+    }
+
+    namespace varintArray
+    {
+        inline std::size_t size( const VarintArray &array )
+        {
+            return array._size;
+        }
+
+        inline std::size_t byteSize( const VarintArray &array )
+        {
+            return array::size( array._bytes );
+        }
+
+        inline std::size_t blockCount( const VarintArray &array )
+        {
+            return array::size( array._blockOffsets );
+        }
+
+        // decodes from the start of the block of index
+        uint32_t get( const VarintArray &array, std::size_t index );
+
+        void pushBack( VarintArray &array, uint32_t value );
+        void clear( VarintArray &array );
+        void assign( VarintArray &array, ArrayView<uint32_t> values );
+
+        /* Decodes a block into values, which must have room for BLOCK_SIZE values
+         * Returns the number of values in the block
+         */
+        std::size_t decodeBlock( const VarintArray &array, std::size_t block, uint32_t *values );
+    }
+}
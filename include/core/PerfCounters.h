@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Core
+{
+    class Allocator;
+
+    struct PerfCounters;
+
+    enum class PerfCounter {
+        Cycles,
+        Instructions,
+        CacheMisses,
+        BranchMisses,
+        LLCLoads
+    };
+    static const std::size_t PERF_COUNTER_COUNT = 5;
+
+    /* counts of the current thread, counters that aren't available stay 0
+     * The counts are raw, they aren't scaled up when other events share the pmu,
+     * the counters are one group that is counted all at once, so ratios like ipc stay exact
+     */
+    struct PerfCounterValues {
+        uint64_t cycles,
+                 instructions,
+                 cacheMisses,
+                 branchMisses,
+                 llcLoads;
+    };
+
+    /* Opens the hardware counters for the calling thread with perf_event_open, counting user space only
+     * Returns nullptr if none of them could be opened, perf_event_paranoid above 2 or no PMU in a VM for example
+     */
+    PerfCounters* createPerfCounters( Allocator *allocator );
+    // can be called from any thread
+    void destroyPerfCounters( PerfCounters *counters );
+
+    namespace perfCounters
+    {
+        bool available( const PerfCounters *counters, PerfCounter counter );
+
+        // true if reads use rdpmc instead of a syscall, which it only does when rdpmc is allowed and faster
+        bool usesRdpmc( const PerfCounters *counters );
+
+        /* Reads the counts since the counters were created, only from the thread that created them
+         * With rdpmc a read is a few dozen cycles, otherwise it is a read syscall for all of them
+         */
+        void read( PerfCounters *counters, PerfCounterValues &values );
+
+        // 0 for a count that went backwards, like when a read failed, instead of wrapping around
+        inline uint64_t difference( uint64_t end, uint64_t begin )
+        {
+            return end > begin ? end - begin : 0;
+        }
+
+        inline PerfCounterValues difference( const PerfCounterValues &end, const PerfCounterValues &begin )
+        {
+            PerfCounterValues result;
+            result.cycles = difference( end.cycles, begin.cycles );
+            result.instructions = difference( end.instructions, begin.instructions );
+            result.cacheMisses = difference( end.cacheMisses, begin.cacheMisses );
+            result.branchMisses = difference( end.branchMisses, begin.branchMisses );
+            result.llcLoads = difference( end.llcLoads, begin.llcLoads );
+            return result;
+        }
+
+        inline void add( PerfCounterValues &values, const PerfCounterValues &other )
+        {
+            values.cycles += other.cycles;
+            values.instructions += other.instructions;
+            values.cacheMisses += other.cacheMisses;
+            values.branchMisses += other.branchMisses;
+            values.llcLoads += other.llcLoads;
+        }
+
+        // instructions per cycle, 0 without cycles
+        inline double ipc( const PerfCounterValues &values )
+        {
+            return values.cycles > 0 ? double(values.instructions) / double(values.cycles) : 0.0;
+        }
+    }
+}
@@ -0,0 +1,253 @@
+#pragma once
+
+#include "Containers.h"
+#include "Array.h"
+#include "Assume.h"
+
+namespace Core
+{
+    template< typename Type, typename Compare, std::size_t Arity >
+    const uint32_t PriorityQueue<Type,Compare,Arity>::NO_POSITION;
+
+    template< typename Type, typename Compare, std::size_t Arity >
+    PriorityQueue<Type,Compare,Arity>::PriorityQueue( Allocator *allocator, Compare compare ) :
+        _heap(allocator),
+        _ids(allocator),
+        _positions(allocator),
+        _compare(compare)
+    {
+    }
+
+    namespace detail
+    {
+        // places value and id at position, keeping the index map up to date
+        template< typename Type, typename Compare, std::size_t Arity >
+        void heapPlace( PriorityQueue<Type,Compare,Arity> &queue, std::size_t position, const Type &value, uint32_t id )
+        {
+            queue._heap._data[position] = value;
+            if( queue._indexed ) {
+                queue._ids._data[position] = id;
+                queue._positions._data[id] = uint32_t( position );
+            }
+        }
+
+        template< typename Type, typename Compare, std::size_t Arity >
+        void heapSiftUp( PriorityQueue<Type,Compare,Arity> &queue, std::size_t position )
+        {
+            Type *heap = queue._heap._data;
+            const Type value = heap[position];
+            const uint32_t id = queue._indexed ? queue._ids._data[position] : 0;
+
+            // move the hole up instead of swapping
+            while( position > 0 ) {
+                std::size_t parent = (position - 1) / Arity;
+                if( !queue._compare(value, heap[parent]) ) break;
+
+                heapPlace( queue, position, heap[parent], queue._indexed ? queue._ids._data[parent] : 0 );
+                position = parent;
+            }
+            heapPlace( queue, position, value, id );
+        }
+
+        template< typename Type, typename Compare, std::size_t Arity >
+        void heapSiftDown( PriorityQueue<Type,Compare,Arity> &queue, std::size_t position )
+        {
+            Type *heap = queue._heap._data;
+            const std::size_t size = queue._heap._size;
+            const Type value = heap[position];
+            const uint32_t id = queue._indexed ? queue._ids._data[position] : 0;
+
+            for(;;) {
+                std::size_t first = position*Arity + 1;
+                if( first >= size ) break;
+
+                // the children are next to each other, so finding the best one touches few cache lines
+                std::size_t last = first + Arity < size ? first + Arity : size;
+                std::size_t best = first;
+                for( std::size_t child = first+1; child < last; ++child ) {
+                    if( queue._compare(heap[child], heap[best]) ) best = child;
+                }
+
+                if( !queue._compare(heap[best], value) ) break;
+
+                heapPlace( queue, position, heap[best], queue._indexed ? queue._ids._data[best] : 0 );
+                position = best;
+            }
+            heapPlace( queue, position, value, id );
+        }
+    }
+
+    namespace priorityQueue
+    {
+        template< typename Type, typename Compare, std::size_t Arity >
+        std::size_t size( const PriorityQueue<Type,Compare,Arity> &queue )
+        {
+            return array::size( queue._heap );
+        }
+
+        template< typename Type, typename Compare, std::size_t Arity >
+        bool isEmpty( const PriorityQueue<Type,Compare,Arity> &queue )
+        {
+            return array::size( queue._heap ) == 0;
+        }
+
+        template< typename Type, typename Compare, std::size_t Arity >
+        const Type& top( const PriorityQueue<Type,Compare,Arity> &queue )
+        {
+            return queue._heap[0];
+        }
+
+        template< typename Type, typename Compare, std::size_t Arity >
+        void clear( PriorityQueue<Type,Compare,Arity> &queue )
+        {
+            if( queue._indexed ) {
+                for( std::size_t i=0; i < array::size(queue._ids); ++i ) {
+                    queue._positions[queue._ids[i]] = PriorityQueue<Type,Compare,Arity>::NO_POSITION;
+                }
+            }
+            queue._heap._size = 0;
+            queue._ids._size = 0;
+        }
+
+        /* Enables tracking the heap position of each element by id,
+         * elements must then be pushed with a id below idCount, and can be updated with decreaseKey
+         * The queue must be empty
+         */
+        template< typename Type, typename Compare, std::size_t Arity >
+        void enableIndexMap( PriorityQueue<Type,Compare,Arity> &queue, std::size_t idCount )
+        {
+            ASSUME_TRUE( isEmpty(queue) );
+
+            queue._indexed = true;
+            array::resize( queue._positions, idCount, PriorityQueue<Type,Compare,Arity>::NO_POSITION );
+        }
+
+        template< typename Type, typename Compare, std::size_t Arity >
+        bool contains( const PriorityQueue<Type,Compare,Arity> &queue, uint32_t id )
+        {
+            ASSUME_TRUE( queue._indexed );
+            return id < array::size(queue._positions) && queue._positions[id] != PriorityQueue<Type,Compare,Arity>::NO_POSITION;
+        }
+
+        // id of the top element, only with the index map enabled
+        template< typename Type, typename Compare, std::size_t Arity >
+        uint32_t topId( const PriorityQueue<Type,Compare,Arity> &queue )
+        {
+            ASSUME_TRUE( queue._indexed );
+            return queue._ids[0];
+        }
+
+        /* Appends a element without restoring the heap order,
+         * call heapify once all elements are pushed
+         */
+        template< typename Type, typename Compare, std::size_t Arity >
+        void pushUnordered( PriorityQueue<Type,Compare,Arity> &queue, const Type &value )
+        {
+            ASSUME_TRUE( !queue._indexed );
+            array::pushBack( queue._heap, value );
+        }
+
+        template< typename Type, typename Compare, std::size_t Arity >
+        void pushUnordered( PriorityQueue<Type,Compare,Arity> &queue, const Type &value, uint32_t id )
+        {
+            ASSUME_TRUE( queue._indexed );
+            ASSUME_TRUE( id < array::size(queue._positions) );
+            ASSUME_TRUE( !contains(queue, id) );
+
+            queue._positions[id] = uint32_t( array::size(queue._heap) );
+            array::pushBack( queue._heap, value );
+            array::pushBack( queue._ids, id );
+        }
+
+        /* Restores the heap order bottom up, in O(n)
+         */
+        template< typename Type, typename Compare, std::size_t Arity >
+        void heapify( PriorityQueue<Type,Compare,Arity> &queue )
+        {
+            const std::size_t count = size( queue );
+            if( count < 2 ) return;
+
+            for( std::size_t parent = (count - 2) / Arity + 1; parent > 0; --parent ) {
+                detail::heapSiftDown( queue, parent-1 );
+            }
+        }
+
+        template< typename Type, typename Compare, std::size_t Arity >
+        void push( PriorityQueue<Type,Compare,Arity> &queue, const Type &value )
+        {
+            pushUnordered( queue, value );
+            detail::heapSiftUp( queue, size(queue)-1 );
+        }
+
+        template< typename Type, typename Compare, std::size_t Arity >
+        void push( PriorityQueue<Type,Compare,Arity> &queue, const Type &value, uint32_t id )
+        {
+            pushUnordered( queue, value, id );
+            detail::heapSiftUp( queue, size(queue)-1 );
+        }
+
+        template< typename Type, typename Compare, std::size_t Arity >
+        Type pop( PriorityQueue<Type,Compare,Arity> &queue )
+        {
+            ASSUME_TRUE( !isEmpty(queue) );
+
+            Type result = queue._heap[0];
+            Type last = array::popBack( queue._heap );
+
+            uint32_t lastId = 0;
+            if( queue._indexed ) {
+                queue._positions[queue._ids[0]] = PriorityQueue<Type,Compare,Arity>::NO_POSITION;
+                lastId = array::popBack( queue._ids );
+            }
+
+            if( !isEmpty(queue) ) {
+                detail::heapPlace( queue, 0, last, lastId );
+                detail::heapSiftDown( queue, 0 );
+            }
+            return result;
+        }
+
+        /* Pops up to count elements in order into values
+         * Returns the number of elements that was popped
+         */
+        template< typename Type, typename Compare, std::size_t Arity >
+        std::size_t popN( PriorityQueue<Type,Compare,Arity> &queue, Type *values, std::size_t count )
+        {
+            std::size_t popped = 0;
+            while( popped < count && !isEmpty(queue) ) {
+                values[popped++] = pop( queue );
+            }
+            return popped;
+        }
+
+        /* Replaces the value of element id, and moves it to its new place in the heap
+         */
+        template< typename Type, typename Compare, std::size_t Arity >
+        void update( PriorityQueue<Type,Compare,Arity> &queue, uint32_t id, const Type &value )
+        {
+            ASSUME_TRUE( contains(queue, id) );
+
+            std::size_t position = queue._positions[id];
+            bool up = queue._compare( value, queue._heap[position] );
+            queue._heap[position] = value;
+
+            if( up ) detail::heapSiftUp( queue, position );
+            else detail::heapSiftDown( queue, position );
+        }
+
+        /* Replaces the value of element id with one that Compare orders before the old value,
+         * which can only move the element towards the top
+         */
+        template< typename Type, typename Compare, std::size_t Arity >
+        void decreaseKey( PriorityQueue<Type,Compare,Arity> &queue, uint32_t id, const Type &value )
+        {
+            ASSUME_TRUE( contains(queue, id) );
+
+            std::size_t position = queue._positions[id];
+            ASSUME_TRUE( !queue._compare(queue._heap[position], value) );
+
+            queue._heap[position] = value;
+            detail::heapSiftUp( queue, position );
+        }
+    }
+}
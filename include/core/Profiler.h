@@ -0,0 +1,179 @@
+#pragma once
+
+#include "Array.h"
+#include "PerfCounters.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+#if defined(__x86_64__) || defined(__i386__)
+#   include <x86intrin.h>
+#else
+#   include <chrono>
+#endif
+
+namespace Core
+{
+    class Allocator;
+
+    // where a scope is, one static for each CORE_PROFILE_SCOPE
+    struct alignas(8) ProfileSite {
+        const char *name;
+        const char *file;
+        int line;
+    };
+
+    // the aggregated time of every completed run of a site
+    struct ProfileSummary {
+        const ProfileSite *site;
+        uint64_t count;
+        // including the scopes inside it
+        double totalMs;
+        // excluding the scopes inside it
+        double selfMs;
+        double minMs,
+               maxMs;
+        // including the scopes inside it, only counted if the profiler was started with perfCounters
+        PerfCounterValues counters;
+    };
+
+    namespace detail
+    {
+        // the site, with the lowest bit set for end events
+        struct ProfileEvent {
+            uint64_t time;
+            uintptr_t site;
+        };
+
+        /* Events of a single thread, written only by that thread and read by profiler::collect
+         * When it is full new events are dropped
+         */
+        struct alignas(CACHE_LINE_SIZE) ProfileRing {
+            ProfileEvent *events;
+            uint64_t mask;
+            // the counters when each event was recorded, nullptr unless the profiler counts them
+            PerfCounters *perf;
+            PerfCounterValues *counters;
+
+            alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> head;
+            alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> tail;
+            std::atomic<uint64_t> dropped;
+        };
+
+        extern std::atomic<uint64_t> profileGeneration;
+        extern thread_local ProfileRing *profileThreadRing;
+        // the generation profileThreadRing belongs to, a ring from an older one may be freed
+        extern thread_local uint64_t profileThreadGeneration;
+
+        // registers a ring for the calling thread, Returns nullptr if the profiler isn't running
+        ProfileRing* profileRegisterThread();
+
+        inline uint64_t profileTime()
+        {
+#if defined(__x86_64__) || defined(__i386__)
+            return __rdtsc();
+#else
+            return uint64_t( std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count() );
+#endif
+        }
+
+        inline void profileRecord( const ProfileSite *site, uintptr_t end )
+        {
+            ProfileRing *ring = profileThreadRing;
+            if( profileThreadGeneration != profileGeneration.load(std::memory_order_relaxed) ) {
+                ring = profileRegisterThread();
+            }
+            if( !ring ) return;
+
+            uint64_t head = ring->head.load( std::memory_order_relaxed );
+            if( head - ring->tail.load(std::memory_order_acquire) > ring->mask ) {
+                ring->dropped.fetch_add( 1, std::memory_order_relaxed );
+                return;
+            }
+
+            ProfileEvent &event = ring->events[head & ring->mask];
+            event.time = profileTime();
+            event.site = reinterpret_cast<uintptr_t>( site ) | end;
+            if( ring->perf ) {
+                perfCounters::read( ring->perf, ring->counters[head & ring->mask] );
+            }
+            ring->head.store( head+1, std::memory_order_release );
+        }
+    }
+
+    // records the begin and end of a scope, use it through CORE_PROFILE_SCOPE
+    class ProfileScope {
+        ProfileScope( const ProfileScope& ) = delete;
+        ProfileScope& operator = ( const ProfileScope& ) = delete;
+    public:
+        explicit ProfileScope( const ProfileSite *site ) :
+            mSite(site)
+        {
+            detail::profileRecord( mSite, 0 );
+        }
+
+        ~ProfileScope()
+        {
+            detail::profileRecord( mSite, 1 );
+        }
+
+    private:
+        const ProfileSite *mSite;
+    };
+
+    namespace profiler
+    {
+        /* Starts recording, each thread that records gets a ring of eventsPerThread events
+         * With perfCounters each thread also opens PerfCounters, and every event reads them,
+         * which costs a syscall per event when rdpmc isn't allowed
+         * Scopes recorded while the profiler isn't running are ignored
+         */
+        void start( Allocator *allocator, std::size_t eventsPerThread = 64*1024, bool perfCounters = false );
+
+        /* Stops recording and frees everything recorded
+         * No other thread may be inside a scope while it stops
+         */
+        void stop();
+
+        bool running();
+
+        // names the calling thread in the trace, the name is copied
+        void setThreadName( const char *name );
+
+        /* Moves the events in every threads ring into the trace and the summary
+         * Call it every so often, a frame for example, so the rings don't fill up
+         */
+        void collect();
+
+        // clears the trace and the summary
+        void reset();
+
+        // events dropped since start, because a ring was full
+        uint64_t droppedEvents();
+
+        // the summary of every site that has completed a scope, sorted by total time
+        void summary( Array<ProfileSummary> &summary );
+        void printSummary( FILE *file );
+
+        /* Writes the collected scopes as Chrome trace json,
+         * which chrome://tracing and Perfetto can open
+         */
+        bool writeChromeTrace( const char *path );
+    }
+}
+
+#define CORE_PROFILE_CONCAT_( a, b ) a##b
+#define CORE_PROFILE_CONCAT( a, b ) CORE_PROFILE_CONCAT_( a, b )
+
+#ifdef CORE_PROFILE
+#   define CORE_PROFILE_SCOPE( name ) \
+        static const ::Core::ProfileSite CORE_PROFILE_CONCAT( coreProfileSite, __LINE__ ) = { name, __FILE__, __LINE__ }; \
+        ::Core::ProfileScope CORE_PROFILE_CONCAT( coreProfileScope, __LINE__ )( &CORE_PROFILE_CONCAT(coreProfileSite, __LINE__) )
+#   define CORE_PROFILE_THREAD_NAME( name ) ::Core::profiler::setThreadName( name )
+#else
+#   define CORE_PROFILE_SCOPE( name ) (void)0
+#   define CORE_PROFILE_THREAD_NAME( name ) (void)0
+#endif
@@ -0,0 +1,287 @@
+#pragma once
+
+#include "Containers.h"
+#include "Allocator.h"
+#include "Assume.h"
+
+#include <atomic>
+#include <cstring>
+#include <new>
+
+namespace Core
+{
+    namespace detail
+    {
+        inline std::size_t roundUpPowerOfTwo( std::size_t value )
+        {
+            std::size_t result = 1;
+            while( result < value ) result <<= 1;
+            return result;
+        }
+    }
+
+    template< typename Type >
+    SpscQueue<Type>::SpscQueue( Allocator *allocator, std::size_t capasity ) :
+        _allocator(allocator),
+        _head(0),
+        _tail(0)
+    {
+        ASSUME_TRUE( _allocator != nullptr );
+        ASSUME_TRUE( capasity > 0 );
+
+        capasity = detail::roundUpPowerOfTwo( capasity );
+        _data = reinterpret_cast<Type*>( _allocator->allocate(capasity*sizeof(Type), alignof(Type)) );
+        _mask = capasity - 1;
+    }
+
+    template< typename Type >
+    SpscQueue<Type>::~SpscQueue()
+    {
+        if( _allocator && _data ) {
+            _allocator->free( _data );
+        }
+    }
+
+    template< typename Type >
+    MpmcQueue<Type>::MpmcQueue( Allocator *allocator, std::size_t capasity ) :
+        _allocator(allocator),
+        _head(0),
+        _tail(0)
+    {
+        ASSUME_TRUE( _allocator != nullptr );
+        ASSUME_TRUE( capasity > 0 );
+
+        capasity = detail::roundUpPowerOfTwo( capasity );
+        _cells = reinterpret_cast<Cell*>( _allocator->allocate(capasity*sizeof(Cell), alignof(Cell)) );
+        _mask = capasity - 1;
+
+        // each cell is ready to be written by the producer at position 'sequence'
+        for( std::size_t i=0; i < capasity; ++i ) {
+            new (&_cells[i].sequence) std::atomic<std::size_t>( i );
+        }
+    }
+
+    template< typename Type >
+    MpmcQueue<Type>::~MpmcQueue()
+    {
+        if( _allocator && _cells ) {
+            _allocator->free( _cells );
+        }
+    }
+
+    /* Single producer / single consumer queue
+     * push* may only be called from the producer thread,
+     * pop* may only be called from the consumer thread
+     */
+    namespace spscQueue
+    {
+        template< typename Type >
+        std::size_t capasity( const SpscQueue<Type> &queue )
+        {
+            return queue._mask + 1;
+        }
+
+        /* Returns the number of elements in the queue,
+         * only exact when called from the producer or consumer thread while the other one is idle
+         */
+        template< typename Type >
+        std::size_t size( const SpscQueue<Type> &queue )
+        {
+            return queue._tail.load(std::memory_order_acquire) - queue._head.load(std::memory_order_acquire);
+        }
+
+        /* Pushes up to count elements from values,
+         * Returns the number of elements that was pushed
+         */
+        template< typename Type >
+        std::size_t pushN( SpscQueue<Type> &queue, const Type *values, std::size_t count )
+        {
+            const std::size_t capasity = queue._mask + 1;
+            const std::size_t tail = queue._tail.load( std::memory_order_relaxed );
+
+            std::size_t free = capasity - (tail - queue._cachedHead);
+            if( free < count ) {
+                queue._cachedHead = queue._head.load( std::memory_order_acquire );
+                free = capasity - (tail - queue._cachedHead);
+            }
+            if( count > free ) count = free;
+            if( count == 0 ) return 0;
+
+            // copy in at most two parts, in case the range wraps around the end of the buffer
+            std::size_t start = tail & queue._mask;
+            std::size_t first = capasity - start < count ? capasity - start : count;
+            std::memcpy( queue._data + start, values, first*sizeof(Type) );
+            std::memcpy( queue._data, values + first, (count-first)*sizeof(Type) );
+
+            queue._tail.store( tail + count, std::memory_order_release );
+            return count;
+        }
+
+        /* Pops up to count elements into values,
+         * Returns the number of elements that was popped
+         */
+        template< typename Type >
+        std::size_t popN( SpscQueue<Type> &queue, Type *values, std::size_t count )
+        {
+            const std::size_t capasity = queue._mask + 1;
+            const std::size_t head = queue._head.load( std::memory_order_relaxed );
+
+            std::size_t available = queue._cachedTail - head;
+            if( available < count ) {
+                queue._cachedTail = queue._tail.load( std::memory_order_acquire );
+                available = queue._cachedTail - head;
+            }
+            if( count > available ) count = available;
+            if( count == 0 ) return 0;
+
+            std::size_t start = head & queue._mask;
+            std::size_t first = capasity - start < count ? capasity - start : count;
+            std::memcpy( values, queue._data + start, first*sizeof(Type) );
+            std::memcpy( values + first, queue._data, (count-first)*sizeof(Type) );
+
+            queue._head.store( head + count, std::memory_order_release );
+            return count;
+        }
+
+        template< typename Type >
+        bool push( SpscQueue<Type> &queue, const Type &value )
+        {
+            return pushN( queue, &value, 1 ) == 1;
+        }
+
+        template< typename Type >
+        bool pop( SpscQueue<Type> &queue, Type &value )
+        {
+            return popN( queue, &value, 1 ) == 1;
+        }
+    }
+
+    /* Multi producer / multi consumer queue
+     * Every cell carries a sequence number that tells if it's ready to be written or read,
+     * producers and consumers claim cells by advancing tail and head with a CAS
+     */
+    namespace mpmcQueue
+    {
+        template< typename Type >
+        std::size_t capasity( const MpmcQueue<Type> &queue )
+        {
+            return queue._mask + 1;
+        }
+
+        /* Returns the number of elements in the queue,
+         * only an approximation while other threads are pushing or popping
+         */
+        template< typename Type >
+        std::size_t size( const MpmcQueue<Type> &queue )
+        {
+            std::size_t head = queue._head.load( std::memory_order_acquire );
+            std::size_t tail = queue._tail.load( std::memory_order_acquire );
+            return tail > head ? tail - head : 0;
+        }
+
+        /* Pushes up to count elements from values,
+         * Returns the number of elements that was pushed
+         */
+        template< typename Type >
+        std::size_t pushN( MpmcQueue<Type> &queue, const Type *values, std::size_t count )
+        {
+            typedef typename MpmcQueue<Type>::Cell Cell;
+
+            if( count == 0 ) return 0;
+            
+            std::size_t tail = queue._tail.load( std::memory_order_relaxed );
+            std::size_t claimed = 0;
+
+            for(;;) {
+                // count how many cells after tail that are ready for writing,
+                // a ready cell can only be changed by the producer that claims it
+                claimed = 0;
+                while( claimed < count ) {
+                    Cell &cell = queue._cells[(tail+claimed) & queue._mask];
+                    if( cell.sequence.load(std::memory_order_acquire) != tail+claimed ) break;
+                    claimed++;
+                }
+
+                if( claimed == 0 ) {
+                    Cell &cell = queue._cells[tail & queue._mask];
+                    std::size_t sequence = cell.sequence.load( std::memory_order_acquire );
+                    // the cell is still in use from the previous lap, the queue is full
+                    if( sequence < tail ) return 0;
+
+                    tail = queue._tail.load( std::memory_order_relaxed );
+                    continue;
+                }
+
+                if( queue._tail.compare_exchange_weak(tail, tail+claimed, std::memory_order_relaxed) ) {
+                    break;
+                }
+            }
+
+            for( std::size_t i=0; i < claimed; ++i ) {
+                Cell &cell = queue._cells[(tail+i) & queue._mask];
+                cell.value = values[i];
+                cell.sequence.store( tail+i+1, std::memory_order_release );
+            }
+            return claimed;
+        }
+
+        /* Pops up to count elements into values,
+         * Returns the number of elements that was popped
+         */
+        template< typename Type >
+        std::size_t popN( MpmcQueue<Type> &queue, Type *values, std::size_t count )
+        {
+            typedef typename MpmcQueue<Type>::Cell Cell;
+
+            if( count == 0 ) return 0;
+            
+            std::size_t head = queue._head.load( std::memory_order_relaxed );
+            std::size_t claimed = 0;
+
+            for(;;) {
+                // count how many cells after head that are ready for reading,
+                // a ready cell can only be changed by the consumer that claims it
+                claimed = 0;
+                while( claimed < count ) {
+                    Cell &cell = queue._cells[(head+claimed) & queue._mask];
+                    if( cell.sequence.load(std::memory_order_acquire) != head+claimed+1 ) break;
+                    claimed++;
+                }
+
+                if( claimed == 0 ) {
+                    Cell &cell = queue._cells[head & queue._mask];
+                    std::size_t sequence = cell.sequence.load( std::memory_order_acquire );
+                    // the cell hasn't been written yet, the queue is empty
+                    if( sequence < head+1 ) return 0;
+
+                    head = queue._head.load( std::memory_order_relaxed );
+                    continue;
+                }
+
+                if( queue._head.compare_exchange_weak(head, head+claimed, std::memory_order_relaxed) ) {
+                    break;
+                }
+            }
+
+            for( std::size_t i=0; i < claimed; ++i ) {
+                Cell &cell = queue._cells[(head+i) & queue._mask];
+                values[i] = cell.value;
+                // ready for the producer on the next lap
+                cell.sequence.store( head+i+queue._mask+1, std::memory_order_release );
+            }
+            return claimed;
+        }
+
+        template< typename Type >
+        bool push( MpmcQueue<Type> &queue, const Type &value )
+        {
+            return pushN( queue, &value, 1 ) == 1;
+        }
+
+        template< typename Type >
+        bool pop( MpmcQueue<Type> &queue, Type &value )
+        {
+            return popN( queue, &value, 1 ) == 1;
+        }
+    }
+}
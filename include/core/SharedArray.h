@@ -0,0 +1,284 @@
+#pragma once
+
+#include "Containers.h"
+#include "Allocator.h"
+#include "ArrayView.h"
+#include "Assume.h"
+
+#include <atomic>
+#include <cstring>
+#include <new>
+#include <utility>
+
+namespace Core
+{
+    namespace detail
+    {
+        template< typename Type >
+        constexpr std::size_t sharedArrayHeaderSize()
+        {
+            // round up to nearest alignment
+            return ((sizeof(typename SharedArray<Type>::Buffer) + alignof(Type)-1) / alignof(Type)) * alignof(Type);
+        }
+
+        template< typename Type >
+        Type* sharedArrayElements( typename SharedArray<Type>::Buffer *buffer )
+        {
+            return reinterpret_cast<Type*>( reinterpret_cast<uint8_t*>(buffer) + sharedArrayHeaderSize<Type>() );
+        }
+
+        template< typename Type >
+        void sharedArrayRelease( typename SharedArray<Type>::Buffer *buffer )
+        {
+            if( buffer && buffer->references.fetch_sub(1, std::memory_order_acq_rel) == 1 ) {
+                Allocator *allocator = buffer->allocator;
+                buffer->~Buffer();
+                allocator->free( buffer );
+            }
+        }
+    }
+
+    namespace sharedArray
+    {
+        /* Moves the elements into a new buffer owned only by this array
+         * If capasity is smaller than the current size, the array is truncated
+         */
+        template< typename Type >
+        void reallocate( SharedArray<Type> &array, std::size_t capasity )
+        {
+            typedef typename SharedArray<Type>::Buffer Buffer;
+            ASSUME_TRUE( array._allocator != nullptr );
+
+            const std::size_t alignment = alignof(Type) > alignof(Buffer) ? alignof(Type) : alignof(Buffer);
+            void *memory = array._allocator->allocate( detail::sharedArrayHeaderSize<Type>() + capasity*sizeof(Type), alignment );
+
+            Buffer *buffer = new (memory) Buffer;
+            buffer->references.store( 1, std::memory_order_relaxed );
+            buffer->allocator = array._allocator;
+            buffer->capasity = capasity;
+
+            std::size_t copySize = capasity < array._size ? capasity : array._size;
+            if( copySize > 0 ) {
+                std::memcpy( detail::sharedArrayElements<Type>(buffer), detail::sharedArrayElements<Type>(array._buffer), copySize*sizeof(Type) );
+            }
+
+            detail::sharedArrayRelease<Type>( array._buffer );
+            array._buffer = buffer;
+            array._size = copySize;
+        }
+    }
+
+    template< typename Type >
+    SharedArray<Type>::SharedArray( const SharedArray &copy )
+    {
+        *this = copy;
+    }
+
+    template< typename Type >
+    SharedArray<Type>::SharedArray( SharedArray &&move )
+    {
+        *this = std::move( move );
+    }
+
+    template< typename Type >
+    SharedArray<Type>::SharedArray( Allocator *allocator ) :
+        _allocator(allocator)
+    {
+    }
+
+    template< typename Type >
+    SharedArray<Type>::~SharedArray()
+    {
+        detail::sharedArrayRelease<Type>( _buffer );
+    }
+
+    template< typename Type >
+    SharedArray<Type>& SharedArray<Type>::operator = ( const SharedArray &copy )
+    {
+        if( this == &copy ) return *this;
+
+        // take the new reference first, in case both share the buffer
+        if( copy._buffer ) {
+            copy._buffer->references.fetch_add( 1, std::memory_order_relaxed );
+        }
+        detail::sharedArrayRelease<Type>( _buffer );
+
+        _allocator = copy._allocator;
+        _buffer = copy._buffer;
+        _size = copy._size;
+
+        return *this;
+    }
+
+    template< typename Type >
+    SharedArray<Type>& SharedArray<Type>::operator = ( SharedArray &&move )
+    {
+        if( this == &move ) return *this;
+        detail::sharedArrayRelease<Type>( _buffer );
+
+        _allocator = move._allocator;
+        _buffer = move._buffer;
+        _size = move._size;
+
+        move._allocator = nullptr;
+        move._buffer = nullptr;
+        move._size = 0;
+
+        return *this;
+    }
+
+    template< typename Type >
+    const Type& SharedArray<Type>::operator [] ( std::size_t index ) const
+    {
+        ASSUME_TRUE( index < _size );
+        return detail::sharedArrayElements<Type>(_buffer)[index];
+    }
+
+    namespace sharedArray
+    {
+        template< typename Type >
+        bool isNull( const SharedArray<Type> &array )
+        {
+            return array._buffer == nullptr;
+        }
+
+        template< typename Type >
+        std::size_t size( const SharedArray<Type> &array )
+        {
+            return array._size;
+        }
+
+        template< typename Type >
+        std::size_t capasity( const SharedArray<Type> &array )
+        {
+            return array._buffer ? array._buffer->capasity : 0;
+        }
+
+        // true if another array references the same buffer
+        template< typename Type >
+        bool isShared( const SharedArray<Type> &array )
+        {
+            return array._buffer && array._buffer->references.load(std::memory_order_acquire) > 1;
+        }
+
+        template< typename Type >
+        const Type* begin( const SharedArray<Type> &array )
+        {
+            return array._buffer ? detail::sharedArrayElements<Type>(array._buffer) : nullptr;
+        }
+
+        template< typename Type >
+        const Type* end( const SharedArray<Type> &array )
+        {
+            return begin(array) + array._size;
+        }
+
+        template< typename Type >
+        ArrayView<Type> view( const SharedArray<Type> &array )
+        {
+            return ArrayView<Type>( begin(array), array._size );
+        }
+
+        /* Makes sure no other array shares the buffer, copying it if needed
+         * Called by every modifying function
+         */
+        template< typename Type >
+        void makeUnique( SharedArray<Type> &array )
+        {
+            if( isShared(array) ) {
+                reallocate( array, array._buffer->capasity );
+            }
+        }
+
+        /* Returns a pointer to the elements that may be modified
+         * The pointer is only valid until the array is resized or copied
+         */
+        template< typename Type >
+        Type* mutableData( SharedArray<Type> &array )
+        {
+            makeUnique( array );
+            return array._buffer ? detail::sharedArrayElements<Type>(array._buffer) : nullptr;
+        }
+
+        template< typename Type >
+        MutableArrayView<Type> mutableView( SharedArray<Type> &array )
+        {
+            return MutableArrayView<Type>( mutableData(array), array._size );
+        }
+
+        template< typename Type >
+        void set( SharedArray<Type> &array, std::size_t index, const Type &value )
+        {
+            ASSUME_TRUE( index < array._size );
+            mutableData(array)[index] = value;
+        }
+
+        /* Reserves space for size elements
+         * If the new size is smaller than the old capasity, do nothing
+         */
+        template< typename Type >
+        void reserve( SharedArray<Type> &array, std::size_t size )
+        {
+            if( size <= capasity(array) ) return;
+            reallocate( array, size );
+        }
+
+        /* Resizes the array to size elements,
+         * if the new size is bigger than the old one,
+         * initilize the rest of the memory to '\0'
+         */
+        template< typename Type >
+        void resize( SharedArray<Type> &array, std::size_t size )
+        {
+            if( size > capasity(array) ) {
+                reallocate( array, size );
+            }
+            else if( size > array._size ) {
+                makeUnique( array );
+            }
+
+            if( size > array._size ) {
+                std::memset( detail::sharedArrayElements<Type>(array._buffer) + array._size, 0, (size - array._size)*sizeof(Type) );
+            }
+            array._size = size;
+        }
+
+        template< typename Type >
+        void pushBack( SharedArray<Type> &array, const Type &value )
+        {
+            std::size_t capasity = sharedArray::capasity( array );
+            if( capasity == array._size ) {
+                reallocate( array, capasity*2+10 );
+            }
+            else {
+                makeUnique( array );
+            }
+
+            detail::sharedArrayElements<Type>(array._buffer)[array._size] = value;
+            array._size++;
+        }
+
+        // the buffer stays shared, since the other elements aren't touched
+        template< typename Type >
+        Type popBack( SharedArray<Type> &array )
+        {
+            ASSUME_TRUE( array._size > 0 );
+
+            array._size--;
+            return detail::sharedArrayElements<Type>(array._buffer)[array._size];
+        }
+
+        template< typename Type >
+        void assign( SharedArray<Type> &array, ArrayView<Type> values )
+        {
+            array._size = 0;
+            if( isShared(array) || capasity(array) < values._size ) {
+                reallocate( array, values._size );
+            }
+            if( values._size > 0 ) {
+                std::memcpy( detail::sharedArrayElements<Type>(array._buffer), values._data, values._size*sizeof(Type) );
+            }
+            array._size = values._size;
+        }
+    }
+}
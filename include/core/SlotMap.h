@@ -0,0 +1,182 @@
+#pragma once
+
+#include "Containers.h"
+#include "Array.h"
+#include "Assume.h"
+
+namespace Core
+{
+    template< typename Type, typename Handle >
+    SlotMap<Type,Handle>::SlotMap( Allocator *allocator ) :
+        _values(allocator),
+        _valueSlots(allocator),
+        _slots(allocator)
+    {
+    }
+    
+    namespace slotMap
+    {
+        template< typename Type, typename Handle >
+        std::size_t size( const SlotMap<Type,Handle> &map )
+        {
+            return array::size( map._values );
+        }
+        
+        template< typename Type, typename Handle >
+        uint32_t handleIndex( const SlotMap<Type,Handle> &, Handle handle )
+        {
+            return uint32_t( handle & SlotMap<Type,Handle>::INDEX_MASK );
+        }
+        
+        template< typename Type, typename Handle >
+        uint32_t handleGeneration( const SlotMap<Type,Handle> &, Handle handle )
+        {
+            return uint32_t( (handle >> SlotMap<Type,Handle>::INDEX_BITS) & SlotMap<Type,Handle>::GENERATION_MASK );
+        }
+        
+        /* Returns the dense index of the element that handle refers to,
+         * or size(map) if the handle isn't valid
+         */
+        template< typename Type, typename Handle >
+        std::size_t denseIndex( const SlotMap<Type,Handle> &map, Handle handle )
+        {
+            uint32_t index = handleIndex( map, handle );
+            if( index >= array::size(map._slots) ) return size( map );
+            
+            const typename SlotMap<Type,Handle>::Slot &slot = map._slots[index];
+            if( slot.generation != handleGeneration(map, handle) ) return size( map );
+            // a free slot links the free list through its index, and a stale handle can match it once the generation wraps
+            if( (slot.generation & 1) == 0 ) return size( map );
+            
+            return slot.index;
+        }
+        
+        template< typename Type, typename Handle >
+        bool contains( const SlotMap<Type,Handle> &map, Handle handle )
+        {
+            return denseIndex( map, handle ) != size( map );
+        }
+        
+        /* Returns a pointer to the element that handle refers to,
+         * or nullptr if the element has been erased
+         * The pointer is only valid until the next insert or erase
+         */
+        template< typename Type, typename Handle >
+        Type* lookup( SlotMap<Type,Handle> &map, Handle handle )
+        {
+            std::size_t index = denseIndex( map, handle );
+            if( index == size(map) ) return nullptr;
+            return &map._values[index];
+        }
+        
+        template< typename Type, typename Handle >
+        const Type* lookup( const SlotMap<Type,Handle> &map, Handle handle )
+        {
+            std::size_t index = denseIndex( map, handle );
+            if( index == size(map) ) return nullptr;
+            return &map._values[index];
+        }
+        
+        template< typename Type, typename Handle >
+        Handle insert( SlotMap<Type,Handle> &map, const Type &value )
+        {
+            typedef SlotMap<Type,Handle> Map;
+            
+            uint32_t slotIndex = map._freeHead;
+            if( slotIndex != Map::FREE_LIST_END ) {
+                map._freeHead = map._slots[slotIndex].index;
+                map._slots[slotIndex].generation = (map._slots[slotIndex].generation + 1) & Map::GENERATION_MASK;
+            }
+            else {
+                slotIndex = uint32_t( array::size(map._slots) );
+                ASSUME_TRUE( slotIndex <= Map::INDEX_MASK );
+                
+                typename Map::Slot slot;
+                    slot.index = 0;
+                    slot.generation = 1;
+                array::pushBack( map._slots, slot );
+            }
+            
+            typename Map::Slot &slot = map._slots[slotIndex];
+            slot.index = uint32_t( array::size(map._values) );
+            
+            array::pushBack( map._values, value );
+            array::pushBack( map._valueSlots, slotIndex );
+            
+            return (Handle(slot.generation) << Map::INDEX_BITS) | Handle(slotIndex);
+        }
+        
+        /* Erases the element that handle refers to,
+         * the last element is moved into its place to keep the elements dense
+         * Returns false if the handle wasn't valid
+         */
+        template< typename Type, typename Handle >
+        bool erase( SlotMap<Type,Handle> &map, Handle handle )
+        {
+            typedef SlotMap<Type,Handle> Map;
+            
+            std::size_t index = denseIndex( map, handle );
+            if( index == size(map) ) return false;
+            
+            uint32_t lastSlot = array::popBack( map._valueSlots );
+            Type lastValue = array::popBack( map._values );
+            if( index != size(map) ) {
+                map._values[index] = lastValue;
+                map._valueSlots[index] = lastSlot;
+                map._slots[lastSlot].index = uint32_t( index );
+            }
+            
+            uint32_t slotIndex = handleIndex( map, handle );
+            typename Map::Slot &slot = map._slots[slotIndex];
+            
+            // even while free, the mask is odd so a wrap lands on 0, which NULL_HANDLE can't match as it isn't odd
+            slot.generation = (slot.generation + 1) & Map::GENERATION_MASK;
+            
+            slot.index = map._freeHead;
+            map._freeHead = slotIndex;
+            
+            return true;
+        }
+        
+        /* Returns the handle for the element at dense index
+         */
+        template< typename Type, typename Handle >
+        Handle handleAt( const SlotMap<Type,Handle> &map, std::size_t index )
+        {
+            uint32_t slotIndex = map._valueSlots[index];
+            return (Handle(map._slots[slotIndex].generation) << SlotMap<Type,Handle>::INDEX_BITS) | Handle(slotIndex);
+        }
+        
+        template< typename Type, typename Handle >
+        void clear( SlotMap<Type,Handle> &map )
+        {
+            while( size(map) > 0 ) {
+                erase( map, handleAt(map, size(map)-1) );
+            }
+        }
+        
+        template< typename Type, typename Handle >
+        Type* begin( SlotMap<Type,Handle> &map )
+        {
+            return array::begin( map._values );
+        }
+        
+        template< typename Type, typename Handle >
+        Type* end( SlotMap<Type,Handle> &map )
+        {
+            return array::end( map._values );
+        }
+        
+        template< typename Type, typename Handle >
+        const Type* begin( const SlotMap<Type,Handle> &map )
+        {
+            return array::begin( map._values );
+        }
+        
+        template< typename Type, typename Handle >
+        const Type* end( const SlotMap<Type,Handle> &map )
+        {
+            return array::end( map._values );
+        }
+    }
+}
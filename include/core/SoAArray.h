@@ -0,0 +1,310 @@
+#pragma once
+
+#include "Containers.h"
+#include "Allocator.h"
+#include "ArrayView.h"
+#include "Assume.h"
+
+#include <cstring>
+#include <tuple>
+#include <utility>
+
+namespace Core
+{
+    namespace detail
+    {
+        template< std::size_t Column, typename... Types >
+        using SoAColumnType = typename std::tuple_element< Column, std::tuple<Types...> >::type;
+
+        inline std::size_t soaAlignSize( std::size_t size, std::size_t alignment )
+        {
+            // round up to nearest alignment
+            return ((size + alignment-1)/alignment) * alignment;
+        }
+
+        /* Calculates the offset of each column for capasity elements,
+         * every column starts at a COLUMN_ALIGNMENT boundary
+         * Returns the total size of the buffer
+         */
+        template< typename... Types >
+        std::size_t soaLayout( std::size_t capasity, std::size_t *offsets )
+        {
+            static const std::size_t sizes[] = { sizeof(Types)... };
+
+            std::size_t total = 0;
+            for( std::size_t i=0; i < sizeof...(Types); ++i ) {
+                offsets[i] = total;
+                total = soaAlignSize( total + sizes[i]*capasity, SoAArray<Types...>::COLUMN_ALIGNMENT );
+            }
+            return total;
+        }
+
+        template< std::size_t Column, typename SoA >
+        void soaStore( SoA &, std::size_t )
+        {
+        }
+
+        template< std::size_t Column, typename SoA, typename Type, typename... Rest >
+        void soaStore( SoA &array, std::size_t index, const Type &value, const Rest&... rest )
+        {
+            static_cast<Type*>(array._columns[Column])[index] = value;
+            soaStore<Column+1>( array, index, rest... );
+        }
+    }
+
+    namespace soaArray
+    {
+        /* Moves the content to a new buffer with room for capasity elements
+         * If capasity is smaller than the current size, the array is truncated
+         */
+        template< typename... Types >
+        void reallocate( SoAArray<Types...> &array, std::size_t capasity )
+        {
+            ASSUME_TRUE( array._allocator != nullptr );
+
+            static const std::size_t sizes[] = { sizeof(Types)... };
+            std::size_t offsets[sizeof...(Types)];
+
+            std::size_t bufferSize = detail::soaLayout<Types...>( capasity, offsets );
+            std::size_t copySize = capasity < array._size ? capasity : array._size;
+
+            uint8_t *newBuffer = nullptr;
+            if( capasity > 0 ) {
+                newBuffer = static_cast<uint8_t*>( array._allocator->allocate(bufferSize, SoAArray<Types...>::COLUMN_ALIGNMENT) );
+            }
+
+            for( std::size_t i=0; i < sizeof...(Types); ++i ) {
+                void *column = newBuffer ? newBuffer + offsets[i] : nullptr;
+                if( copySize > 0 ) {
+                    std::memcpy( column, array._columns[i], sizes[i]*copySize );
+                }
+                array._columns[i] = column;
+            }
+
+            array._allocator->free( array._buffer );
+            array._buffer = newBuffer;
+            array._size = copySize;
+            array._capasity = capasity;
+        }
+    }
+
+    template< typename... Types >
+    SoAArray<Types...>::SoAArray( const SoAArray &copy )
+    {
+        *this = copy;
+    }
+
+    template< typename... Types >
+    SoAArray<Types...>::SoAArray( SoAArray &&move )
+    {
+        *this = std::move( move );
+    }
+
+    template< typename... Types >
+    SoAArray<Types...>::SoAArray( Allocator *allocator ) :
+        _allocator(allocator)
+    {
+    }
+
+    template< typename... Types >
+    SoAArray<Types...>::~SoAArray()
+    {
+        if( _allocator && _buffer ) {
+            _allocator->free( _buffer );
+        }
+    }
+
+    template< typename... Types >
+    SoAArray<Types...>& SoAArray<Types...>::operator = ( const SoAArray &copy )
+    {
+        ASSUME_TRUE( copy._allocator != nullptr );
+
+        if( this == &copy ) return *this;
+        if( _allocator && _buffer ) {
+            _allocator->free( _buffer );
+        }
+
+        _allocator = copy._allocator;
+        _buffer = nullptr;
+        _size = 0;
+        _capasity = 0;
+        for( std::size_t i=0; i < COLUMN_COUNT; ++i ) {
+            _columns[i] = nullptr;
+        }
+
+        soaArray::reallocate( *this, copy._size );
+
+        static const std::size_t sizes[] = { sizeof(Types)... };
+        for( std::size_t i=0; i < COLUMN_COUNT && copy._size > 0; ++i ) {
+            std::memcpy( _columns[i], copy._columns[i], sizes[i]*copy._size );
+        }
+        _size = copy._size;
+
+        return *this;
+    }
+
+    template< typename... Types >
+    SoAArray<Types...>& SoAArray<Types...>::operator = ( SoAArray &&move )
+    {
+        if( this == &move ) return *this;
+        if( _allocator && _buffer ) {
+            _allocator->free( _buffer );
+        }
+
+        _allocator = move._allocator;
+        _buffer = move._buffer;
+        _size = move._size;
+        _capasity = move._capasity;
+        for( std::size_t i=0; i < COLUMN_COUNT; ++i ) {
+            _columns[i] = move._columns[i];
+            move._columns[i] = nullptr;
+        }
+
+        move._allocator = nullptr;
+        move._buffer = nullptr;
+        move._size = 0;
+        move._capasity = 0;
+
+        return *this;
+    }
+
+    namespace soaArray
+    {
+        template< typename... Types >
+        bool isNull( const SoAArray<Types...> &array )
+        {
+            return array._buffer == nullptr;
+        }
+
+        template< typename... Types >
+        std::size_t size( const SoAArray<Types...> &array )
+        {
+            return array._size;
+        }
+
+        template< typename... Types >
+        std::size_t capasity( const SoAArray<Types...> &array )
+        {
+            return array._capasity;
+        }
+
+        /* Returns a pointer to the first element of column Column,
+         * the column is size(array) elements long and aligned to COLUMN_ALIGNMENT
+         */
+        template< std::size_t Column, typename... Types >
+        detail::SoAColumnType<Column, Types...>* column( SoAArray<Types...> &array )
+        {
+            static_assert( Column < sizeof...(Types), "Column out of range!" );
+            return static_cast< detail::SoAColumnType<Column, Types...>* >( array._columns[Column] );
+        }
+
+        template< std::size_t Column, typename... Types >
+        const detail::SoAColumnType<Column, Types...>* column( const SoAArray<Types...> &array )
+        {
+            static_assert( Column < sizeof...(Types), "Column out of range!" );
+            return static_cast< const detail::SoAColumnType<Column, Types...>* >( array._columns[Column] );
+        }
+
+        template< std::size_t Column, typename... Types >
+        MutableArrayView< detail::SoAColumnType<Column, Types...> > columnView( SoAArray<Types...> &array )
+        {
+            return MutableArrayView< detail::SoAColumnType<Column, Types...> >( column<Column>(array), array._size );
+        }
+
+        template< std::size_t Column, typename... Types >
+        ArrayView< detail::SoAColumnType<Column, Types...> > columnView( const SoAArray<Types...> &array )
+        {
+            return ArrayView< detail::SoAColumnType<Column, Types...> >( column<Column>(array), array._size );
+        }
+
+        template< std::size_t Column, typename... Types >
+        detail::SoAColumnType<Column, Types...>& get( SoAArray<Types...> &array, std::size_t index )
+        {
+            ASSUME_TRUE( index < array._size );
+            return column<Column>(array)[index];
+        }
+
+        template< std::size_t Column, typename... Types >
+        const detail::SoAColumnType<Column, Types...>& get( const SoAArray<Types...> &array, std::size_t index )
+        {
+            ASSUME_TRUE( index < array._size );
+            return column<Column>(array)[index];
+        }
+
+        /* Reserves space for size elements in every column
+         * If the new size is smaller than the old capasity, do nothing
+         * If you want to shrink the capasity, use trim
+         */
+        template< typename... Types >
+        void reserve( SoAArray<Types...> &array, std::size_t size )
+        {
+            // use trim to shrink the capasity
+            if( size <= array._capasity ) return;
+
+            reallocate( array, size );
+        }
+
+        /* Trim space for the array to size + excess
+         * Set excess to 0 if capasity should be the same as the current size
+         */
+        template< typename... Types >
+        void trim( SoAArray<Types...> &array, std::size_t excess = 0 )
+        {
+            reallocate( array, array._size + excess );
+        }
+
+        /* Resizes the array to size elements,
+         * if the new size is bigger than the old one,
+         * initilize the new elements in every column to '\0'
+         */
+        template< typename... Types >
+        void resize( SoAArray<Types...> &array, std::size_t size )
+        {
+            static const std::size_t sizes[] = { sizeof(Types)... };
+
+            reserve( array, size );
+            if( size > array._size ) {
+                for( std::size_t i=0; i < sizeof...(Types); ++i ) {
+                    uint8_t *column = static_cast<uint8_t*>( array._columns[i] );
+                    std::memset( column + sizes[i]*array._size, 0, sizes[i]*(size - array._size) );
+                }
+            }
+            array._size = size;
+        }
+
+        template< typename... Types >
+        void clear( SoAArray<Types...> &array )
+        {
+            array._size = 0;
+        }
+
+        template< typename... Types >
+        void pushBack( SoAArray<Types...> &array, const Types&... values )
+        {
+            if( array._capasity == array._size ) {
+                reserve( array, array._capasity*2+10 );
+            }
+
+            detail::soaStore<0>( array, array._size, values... );
+            array._size++;
+        }
+
+        /* Removes the element at index by moving the last element into its place
+         * Doesn't preserve the order of the elements
+         */
+        template< typename... Types >
+        void swapRemove( SoAArray<Types...> &array, std::size_t index )
+        {
+            ASSUME_TRUE( index < array._size );
+            static const std::size_t sizes[] = { sizeof(Types)... };
+
+            array._size--;
+            if( index == array._size ) return;
+
+            for( std::size_t i=0; i < sizeof...(Types); ++i ) {
+                uint8_t *column = static_cast<uint8_t*>( array._columns[i] );
+                std::memcpy( column + sizes[i]*index, column + sizes[i]*array._size, sizes[i] );
+            }
+        }
+    }
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include "Containers.h"
+#include "Array.h"
+#include "Assume.h"
+
+namespace Core
+{
+    template< typename Key >
+    StaticSearchIndex<Key>::StaticSearchIndex( Allocator *allocator ) :
+        _keys(allocator),
+        _ranks(allocator)
+    {
+    }
+    
+    namespace detail
+    {
+        // fills the eytzinger tree rooted at node with an in order walk over the sorted keys
+        template< typename Key >
+        std::size_t eytzingerBuild( StaticSearchIndex<Key> &index, const Key *sorted, std::size_t position, std::size_t node )
+        {
+            if( node >= array::size(index._keys) ) return position;
+            
+            position = eytzingerBuild( index, sorted, position, 2*node );
+            index._keys[node] = sorted[position];
+            index._ranks[node] = uint32_t( position );
+            position++;
+            return eytzingerBuild( index, sorted, position, 2*node+1 );
+        }
+        
+        // the descent goes right on every 'less than', so the answer is the node where it last went left
+        inline std::size_t eytzingerResolve( std::size_t node )
+        {
+            return node >> (__builtin_ctzll( ~uint64_t(node) ) + 1);
+        }
+    }
+    
+    namespace staticSearchIndex
+    {
+        // number of keys that fit in a cache line, the descent prefetches this far ahead
+        template< typename Key >
+        constexpr std::size_t prefetchStride()
+        {
+            return sizeof(Key) < CACHE_LINE_SIZE ? CACHE_LINE_SIZE / sizeof(Key) : 1;
+        }
+        
+        template< typename Key >
+        std::size_t size( const StaticSearchIndex<Key> &index )
+        {
+            std::size_t count = array::size( index._keys );
+            return count > 0 ? count - 1 : 0;
+        }
+        
+        /* Builds the index from count sorted keys
+         * The sorted keys aren't referenced after the build
+         */
+        template< typename Key >
+        void build( StaticSearchIndex<Key> &index, const Key *sorted, std::size_t count )
+        {
+            ASSUME_TRUE( count < 0xffffffff );
+            
+            array::resize( index._keys, count+1 );
+            array::resize( index._ranks, count+1 );
+            detail::eytzingerBuild( index, sorted, 0, 1 );
+        }
+        
+        template< typename Key >
+        void build( StaticSearchIndex<Key> &index, const Array<Key> &sorted )
+        {
+            build( index, array::begin(sorted), array::size(sorted) );
+        }
+        
+        /* Returns the position in the sorted keys of the first key that isn't less than key,
+         * or size(index) if there is none
+         */
+        template< typename Key >
+        std::size_t lowerBound( const StaticSearchIndex<Key> &index, const Key &key )
+        {
+            const std::size_t count = size( index );
+            const Key *keys = array::begin( index._keys );
+            
+            std::size_t node = 1;
+            while( node <= count ) {
+                __builtin_prefetch( keys + node*prefetchStride<Key>() );
+                node = 2*node + (keys[node] < key);
+            }
+            
+            node = detail::eytzingerResolve( node );
+            return node ? index._ranks[node] : count;
+        }
+        
+        /* Returns the position in the sorted keys of key,
+         * or size(index) if it isn't in the index
+         */
+        template< typename Key >
+        std::size_t find( const StaticSearchIndex<Key> &index, const Key &key )
+        {
+            const std::size_t count = size( index );
+            const Key *keys = array::begin( index._keys );
+            
+            std::size_t node = 1;
+            while( node <= count ) {
+                __builtin_prefetch( keys + node*prefetchStride<Key>() );
+                node = 2*node + (keys[node] < key);
+            }
+            
+            node = detail::eytzingerResolve( node );
+            if( node == 0 || key < keys[node] ) return count;
+            return index._ranks[node];
+        }
+        
+        /* Runs lowerBound for count keys, writing the positions into results
+         * The searches are interleaved in groups, so the cache misses of one search overlap with the others
+         */
+        template< typename Key >
+        void lowerBoundBatch( const StaticSearchIndex<Key> &index, const Key *queries, std::size_t count, std::size_t *results )
+        {
+            static const std::size_t GROUP_SIZE = 16;
+            
+            const std::size_t keyCount = size( index );
+            const Key *keys = array::begin( index._keys );
+            
+            for( std::size_t start=0; start < count; start += GROUP_SIZE ) {
+                const std::size_t groupSize = count - start < GROUP_SIZE ? count - start : GROUP_SIZE;
+                std::size_t nodes[GROUP_SIZE];
+                for( std::size_t i=0; i < groupSize; ++i ) {
+                    nodes[i] = 1;
+                }
+                
+                // every search takes the same number of steps, give or take one
+                bool active = keyCount > 0;
+                while( active ) {
+                    active = false;
+                    for( std::size_t i=0; i < groupSize; ++i ) {
+                        std::size_t node = nodes[i];
+                        if( node > keyCount ) continue;
+                        
+                        __builtin_prefetch( keys + node*prefetchStride<Key>() );
+                        nodes[i] = 2*node + (keys[node] < queries[start+i]);
+                        active = true;
+                    }
+                }
+                
+                for( std::size_t i=0; i < groupSize; ++i ) {
+                    std::size_t node = detail::eytzingerResolve( nodes[i] );
+                    results[start+i] = node ? index._ranks[node] : keyCount;
+                }
+            }
+        }
+    }
+}
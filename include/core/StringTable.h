@@ -0,0 +1,101 @@
+#pragma once
+
+#include "Containers.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Core
+{
+    /* a interned string, the value is the 64 bit FNV-1a hash of the string
+     * 64 bits so collisions are unlikely even with billions of strings, 32 bits would likely collide at 77k
+     */
+    struct StringId {
+        uint64_t value;
+    };
+    
+    inline bool operator == ( StringId a, StringId b ) { return a.value == b.value; }
+    inline bool operator != ( StringId a, StringId b ) { return a.value != b.value; }
+    inline bool operator < ( StringId a, StringId b ) { return a.value < b.value; }
+    
+    // deduplicates strings, and stores them in a arena that never moves them
+    struct StringTable {
+        static const std::size_t ARENA_BLOCK_SIZE = 16*1024;
+        
+        struct Entry {
+            const char *string;
+            uint64_t hash;
+            uint32_t length;
+        };
+        
+        StringTable( Allocator *allocator );
+        ~StringTable();
+        
+        StringTable( const StringTable& ) = delete;
+        StringTable& operator = ( const StringTable& ) = delete;
+        
+        Allocator *_allocator;
+        
+        // open addressed with linear probing, the capasity is always a power of two
+        Array<Entry> _entries;
+        std::size_t _count = 0;
+        
+        Array<char*> _blocks;
+        std::size_t _blockUsed = 0,
+                    _blockSize = 0;
+    };
+    
+    namespace detail
+    {
+        constexpr uint64_t fnv1a( const char *string, uint64_t hash )
+        {
+            return *string ? fnv1a( string+1, (hash ^ uint64_t(uint8_t(*string))) * 1099511628211ull ) : hash;
+        }
+    }
+    
+    namespace stringTable
+    {
+        // can be evaluated at compile time, matches hash( string, strlen(string) )
+        constexpr uint64_t hash( const char *string )
+        {
+            return detail::fnv1a( string, 14695981039346656037ull );
+        }
+        
+        uint64_t hash( const char *string, std::size_t length );
+        
+        /* Returns the id for string, adding it to the table if it isn't already there
+         * Two different strings with the same hash is treated as a failed assumption,
+         * use tryIntern for strings that could be made to collide, like strings from files
+         */
+        StringId intern( StringTable &table, const char *string, std::size_t length );
+        StringId intern( StringTable &table, const char *string );
+        
+        /* Like intern, but Returns false and leaves the table as it was if a different string already has the id
+         * The string that was there first keeps it
+         */
+        bool tryIntern( StringTable &table, const char *string, std::size_t length, StringId &id );
+        
+        // Returns the interned string, or nullptr if the id isn't in the table
+        const char* lookup( const StringTable &table, StringId id );
+        std::size_t length( const StringTable &table, StringId id );
+        
+        // number of unique strings
+        std::size_t size( const StringTable &table );
+        
+        /* The table that STRING_ID checks against in debug builds,
+         * nullptr disables the check
+         * STRING_ID interns into it under a lock, so it can be used from any thread, but the table itself
+         * must not be used directly while STRING_ID may be running on other threads
+         */
+        void setDebugTable( StringTable *table );
+        StringTable* getDebugTable();
+        
+        StringId checkedId( StringId id, const char *string );
+    }
+}
+
+#ifdef NDEBUG
+#   define STRING_ID( string ) ( ::Core::StringId{ ::Core::stringTable::hash(string) } )
+#else
+#   define STRING_ID( string ) ( ::Core::stringTable::checkedId( ::Core::StringId{ ::Core::stringTable::hash(string) }, string ) )
+#endif
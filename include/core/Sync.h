@@ -0,0 +1,327 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace Core
+{
+    /* Counts how a lock is used, each lock can be given one
+     * Only contended paths do more than count the acquisition, so they are cheap to leave on
+     */
+    struct LockStats {
+        const char *name;
+        std::atomic<uint64_t> acquisitions,
+                              // acquisitions that didn't get the lock on the first try
+                              contentions,
+                              // times a waiter spun, or a SeqLock reader retried
+                              spins,
+                              // times a waiter slept in the kernel
+                              sleeps;
+
+        LockStats( const char *name_ = nullptr ) :
+            name(name_),
+            acquisitions(0),
+            contentions(0),
+            spins(0),
+            sleeps(0)
+        {
+        }
+    };
+
+    // hint to the cpu that this is a spin loop
+    inline void cpuRelax()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__)
+        asm volatile( "yield" ::: "memory" );
+#endif
+    }
+
+    namespace detail
+    {
+        // blocks while *address == expected, or until woken
+        void futexWait( std::atomic<uint32_t> *address, uint32_t expected );
+        void futexWake( std::atomic<uint32_t> *address, int count );
+
+        /* Spins with exponentially more pauses each round,
+         * and yields the thread once the rounds are long, in case the holder isn't running
+         */
+        class Backoff {
+        public:
+            static const uint32_t MAX_PAUSES = 1024;
+
+            Backoff() :
+                mPauses(1)
+            {
+            }
+
+            void pause();
+
+        private:
+            uint32_t mPauses;
+        };
+
+        inline void countAcquisition( LockStats *stats )
+        {
+            if( stats ) stats->acquisitions.fetch_add( 1, std::memory_order_relaxed );
+        }
+    }
+
+    // a test and test and set lock, for very short critical sections
+    class SpinLock {
+        SpinLock( const SpinLock& ) = delete;
+        SpinLock& operator = ( const SpinLock& ) = delete;
+    public:
+        explicit SpinLock( LockStats *stats = nullptr ) :
+            mLocked(false),
+            mStats(stats)
+        {
+        }
+
+        void lock()
+        {
+            if( !mLocked.exchange(true, std::memory_order_acquire) ) {
+                detail::countAcquisition( mStats );
+                return;
+            }
+            lockContended();
+        }
+
+        bool tryLock()
+        {
+            if( mLocked.load(std::memory_order_relaxed) || mLocked.exchange(true, std::memory_order_acquire) ) {
+                return false;
+            }
+            detail::countAcquisition( mStats );
+            return true;
+        }
+
+        void unlock()
+        {
+            mLocked.store( false, std::memory_order_release );
+        }
+
+    private:
+        void lockContended();
+
+        std::atomic<bool> mLocked;
+        LockStats *mStats;
+    };
+
+    /* A mutex on a futex, that spins a while before it sleeps
+     * How long it spins adapts to how long waiters needed to spin recently, like glibc's adaptive mutex,
+     * so a mutex that is held briefly spins and one that is held long goes to sleep early
+     * Unlocking without waiters is a single atomic operation, without a syscall
+     */
+    class Mutex {
+        Mutex( const Mutex& ) = delete;
+        Mutex& operator = ( const Mutex& ) = delete;
+    public:
+        // most spins before a waiter sleeps
+        static const int MAX_SPINS = 100;
+
+        explicit Mutex( LockStats *stats = nullptr ) :
+            mState(UNLOCKED),
+            mSpinEstimate(0),
+            mStats(stats)
+        {
+        }
+
+        void lock()
+        {
+            uint32_t state = UNLOCKED;
+            if( mState.compare_exchange_strong(state, LOCKED, std::memory_order_acquire, std::memory_order_relaxed) ) {
+                detail::countAcquisition( mStats );
+                return;
+            }
+            lockContended();
+        }
+
+        bool tryLock()
+        {
+            uint32_t state = UNLOCKED;
+            if( !mState.compare_exchange_strong(state, LOCKED, std::memory_order_acquire, std::memory_order_relaxed) ) {
+                return false;
+            }
+            detail::countAcquisition( mStats );
+            return true;
+        }
+
+        void unlock()
+        {
+            if( mState.exchange(UNLOCKED, std::memory_order_release) == LOCKED_WAITERS ) {
+                detail::futexWake( &mState, 1 );
+            }
+        }
+
+        // the running average of spins contended lockers needed, waiters spin up to about twice that
+        int spinEstimate() const
+        {
+            return mSpinEstimate.load( std::memory_order_relaxed );
+        }
+
+    private:
+        friend class Condition;
+
+        static const uint32_t UNLOCKED = 0,
+                              LOCKED = 1,
+                              LOCKED_WAITERS = 2;
+
+        void lockContended();
+        // locks assuming there are waiters, for threads woken from a Condition
+        void lockWaiter();
+
+        std::atomic<uint32_t> mState;
+        // only a hint, so races between lockers updating it don't matter
+        std::atomic<int> mSpinEstimate;
+        LockStats *mStats;
+    };
+
+    // a condition variable for Mutex, on a futex sequence number
+    class Condition {
+        Condition( const Condition& ) = delete;
+        Condition& operator = ( const Condition& ) = delete;
+    public:
+        Condition() :
+            mSequence(0)
+        {
+        }
+
+        // mutex must be locked, it is unlocked while waiting, wakeups can be spurious
+        void wait( Mutex &mutex );
+
+        template< typename Predicate >
+        void wait( Mutex &mutex, Predicate predicate )
+        {
+            while( !predicate() ) {
+                wait( mutex );
+            }
+        }
+
+        void notifyOne();
+        void notifyAll();
+
+    private:
+        std::atomic<uint32_t> mSequence;
+    };
+
+    /* A reader writer lock that favors readers, readers get the lock whenever no writer holds it,
+     * so writers can starve while readers keep overlapping
+     */
+    class RWLock {
+        RWLock( const RWLock& ) = delete;
+        RWLock& operator = ( const RWLock& ) = delete;
+    public:
+        explicit RWLock( LockStats *stats = nullptr ) :
+            mState(0),
+            mWaiters(0),
+            mStats(stats)
+        {
+        }
+
+        void lockShared()
+        {
+            uint32_t state = mState.load( std::memory_order_relaxed );
+            if( !(state & WRITER) && mState.compare_exchange_weak(state, state+1, std::memory_order_acquire, std::memory_order_relaxed) ) {
+                detail::countAcquisition( mStats );
+                return;
+            }
+            lockSharedContended();
+        }
+
+        void unlockShared()
+        {
+            // sequentially consistent, so the waiters aren't read before the state is released
+            if( mState.fetch_sub(1) == 1 && mWaiters.load() > 0 ) {
+                detail::futexWake( &mState, INT32_MAX );
+            }
+        }
+
+        void lock()
+        {
+            uint32_t state = 0;
+            if( mState.compare_exchange_strong(state, WRITER, std::memory_order_acquire, std::memory_order_relaxed) ) {
+                detail::countAcquisition( mStats );
+                return;
+            }
+            lockContended();
+        }
+
+        void unlock()
+        {
+            mState.store( 0 );
+            if( mWaiters.load() > 0 ) {
+                detail::futexWake( &mState, INT32_MAX );
+            }
+        }
+
+    private:
+        static const uint32_t WRITER = 0x80000000u;
+
+        void lockSharedContended();
+        void lockContended();
+
+        // WRITER if a writer holds it, otherwise the number of readers
+        std::atomic<uint32_t> mState;
+        std::atomic<uint32_t> mWaiters;
+        LockStats *mStats;
+    };
+
+    /* Guards a small trivially copyable value that is read much more often than written
+     * Readers never block writers, they copy the value and retry if a write overlapped
+     */
+    template< typename Type >
+    class SeqLock {
+        static_assert( std::is_trivially_copyable<Type>::value, "SeqLock only supports trivially copyable types!" );
+
+        SeqLock( const SeqLock& ) = delete;
+        SeqLock& operator = ( const SeqLock& ) = delete;
+    public:
+        explicit SeqLock( const Type &value = Type(), LockStats *stats = nullptr ) :
+            mSequence(0),
+            mWriter(stats),
+            mStats(stats)
+        {
+            std::memcpy( &mValue, &value, sizeof(Type) );
+        }
+
+        Type read() const
+        {
+            Type value;
+            for( ;; ) {
+                uint32_t before = mSequence.load( std::memory_order_acquire );
+                if( !(before & 1) ) {
+                    std::memcpy( &value, &mValue, sizeof(Type) );
+                    std::atomic_thread_fence( std::memory_order_acquire );
+                    if( mSequence.load(std::memory_order_relaxed) == before ) {
+                        return value;
+                    }
+                }
+                if( mStats ) mStats->spins.fetch_add( 1, std::memory_order_relaxed );
+                cpuRelax();
+            }
+        }
+
+        // writers are serialized by a spin lock
+        void write( const Type &value )
+        {
+            mWriter.lock();
+            uint32_t sequence = mSequence.load( std::memory_order_relaxed );
+            mSequence.store( sequence+1, std::memory_order_relaxed );
+            std::atomic_thread_fence( std::memory_order_release );
+            std::memcpy( &mValue, &value, sizeof(Type) );
+            mSequence.store( sequence+2, std::memory_order_release );
+            mWriter.unlock();
+        }
+
+    private:
+        // odd while a write is in progress
+        std::atomic<uint32_t> mSequence;
+        Type mValue;
+        SpinLock mWriter;
+        LockStats *mStats;
+    };
+}
@@ -0,0 +1,429 @@
+#pragma once
+
+#if __cplusplus >= 202002L && defined(__cpp_impl_coroutine)
+#   define CORE_HAS_COROUTINES 1
+#endif
+
+#ifdef CORE_HAS_COROUTINES
+
+#include "Allocator.h"
+#include "Assume.h"
+#include "JobSystem.h"
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <optional>
+#include <utility>
+
+namespace Core
+{
+    template< typename Type >
+    class Task;
+
+    namespace task
+    {
+        /* The allocator coroutine frames created on the calling thread are allocated from,
+         * nullptr uses the default allocator
+         * A frame remembers its allocator, so it can be destroyed from any thread
+         */
+        inline Allocator*& frameAllocator()
+        {
+            static thread_local Allocator *allocator = nullptr;
+            return allocator;
+        }
+
+        inline void setFrameAllocator( Allocator *allocator )
+        {
+            frameAllocator() = allocator;
+        }
+    }
+
+    namespace detail
+    {
+        // coroutine frames are allocated from task::frameAllocator, with the allocator stored in front of the frame
+        struct TaskPromiseBase {
+            static const std::size_t FRAME_HEADER_SIZE = 16;
+
+            static void* operator new( std::size_t size )
+            {
+                Allocator *allocator = task::frameAllocator();
+                if( !allocator ) allocator = getDefaultAllocator();
+
+                void *memory = allocator->allocate( size + FRAME_HEADER_SIZE, FRAME_HEADER_SIZE );
+                *static_cast<Allocator**>( memory ) = allocator;
+                return static_cast<char*>( memory ) + FRAME_HEADER_SIZE;
+            }
+
+            static void operator delete( void *ptr )
+            {
+                void *memory = static_cast<char*>( ptr ) - FRAME_HEADER_SIZE;
+                Allocator *allocator = *static_cast<Allocator**>( memory );
+                allocator->free( memory );
+            }
+
+            void unhandled_exception()
+            {
+                std::terminate();
+            }
+        };
+
+        // resumes whatever awaited the task once it finishes
+        struct TaskFinalAwaiter {
+            bool await_ready() noexcept { return false; }
+
+            template< typename Promise >
+            std::coroutine_handle<> await_suspend( std::coroutine_handle<Promise> handle ) noexcept
+            {
+                std::coroutine_handle<> continuation = handle.promise().continuation;
+                return continuation ? continuation : std::noop_coroutine();
+            }
+
+            void await_resume() noexcept {}
+        };
+
+        template< typename Type >
+        struct TaskPromise :
+            public TaskPromiseBase
+        {
+            std::coroutine_handle<> continuation;
+            std::optional<Type> result;
+
+            Task<Type> get_return_object();
+
+            std::suspend_always initial_suspend() noexcept { return {}; }
+            TaskFinalAwaiter final_suspend() noexcept { return {}; }
+
+            template< typename Value >
+            void return_value( Value &&value )
+            {
+                result.emplace( std::forward<Value>(value) );
+            }
+        };
+
+        template<>
+        struct TaskPromise<void> :
+            public TaskPromiseBase
+        {
+            std::coroutine_handle<> continuation;
+
+            Task<void> get_return_object();
+
+            std::suspend_always initial_suspend() noexcept { return {}; }
+            TaskFinalAwaiter final_suspend() noexcept { return {}; }
+
+            void return_void() {}
+        };
+    }
+
+    /* A lazily started coroutine returning Type
+     * It starts when it is awaited, and resumes the awaiting coroutine on the thread it finished on
+     * The frame is destroyed with the task, so the task has to outlive the coroutine
+     */
+    template< typename Type >
+    class Task {
+    public:
+        typedef detail::TaskPromise<Type> promise_type;
+        typedef std::coroutine_handle<promise_type> Handle;
+
+        Task() = default;
+        explicit Task( Handle handle ) :
+            mHandle(handle)
+        {
+        }
+
+        Task( Task &&other ) noexcept :
+            mHandle(other.mHandle)
+        {
+            other.mHandle = nullptr;
+        }
+
+        Task& operator = ( Task &&other ) noexcept
+        {
+            if( this != &other ) {
+                if( mHandle ) mHandle.destroy();
+                mHandle = other.mHandle;
+                other.mHandle = nullptr;
+            }
+            return *this;
+        }
+
+        Task( const Task& ) = delete;
+        Task& operator = ( const Task& ) = delete;
+
+        ~Task()
+        {
+            if( mHandle ) mHandle.destroy();
+        }
+
+        bool done() const
+        {
+            return mHandle && mHandle.done();
+        }
+
+        Handle handle() const
+        {
+            return mHandle;
+        }
+
+        // the returned value, the task must be done
+        Type result()
+        {
+            ASSUME_TRUE( done() );
+            if constexpr( !std::is_void<Type>::value ) {
+                return std::move( *mHandle.promise().result );
+            }
+        }
+
+        auto operator co_await() & noexcept
+        {
+            return Awaiter{ mHandle };
+        }
+
+        auto operator co_await() && noexcept
+        {
+            return Awaiter{ mHandle };
+        }
+
+    private:
+        struct Awaiter {
+            Handle handle;
+
+            bool await_ready() noexcept
+            {
+                return !handle || handle.done();
+            }
+
+            std::coroutine_handle<> await_suspend( std::coroutine_handle<> awaiting ) noexcept
+            {
+                handle.promise().continuation = awaiting;
+                return handle;
+            }
+
+            Type await_resume()
+            {
+                if constexpr( !std::is_void<Type>::value ) {
+                    return std::move( *handle.promise().result );
+                }
+            }
+        };
+
+        Handle mHandle = nullptr;
+    };
+
+    namespace detail
+    {
+        template< typename Type >
+        Task<Type> TaskPromise<Type>::get_return_object()
+        {
+            return Task<Type>( std::coroutine_handle<TaskPromise<Type>>::from_promise(*this) );
+        }
+
+        inline Task<void> TaskPromise<void>::get_return_object()
+        {
+            return Task<void>( std::coroutine_handle<TaskPromise<void>>::from_promise(*this) );
+        }
+
+        /* Runs a task to completion without anyone awaiting it, and then decreases counter
+         * through the job system, so a job waiting on the counter is resumed even if every worker sleeps
+         * Destroys itself when it finishes
+         */
+        struct CompletionTask {
+            struct promise_type :
+                public TaskPromiseBase
+            {
+                JobSystem *system = nullptr;
+                JobCounter *counter = nullptr;
+
+                CompletionTask get_return_object()
+                {
+                    return CompletionTask{ std::coroutine_handle<promise_type>::from_promise(*this) };
+                }
+
+                std::suspend_always initial_suspend() noexcept { return {}; }
+
+                struct FinalAwaiter {
+                    bool await_ready() noexcept { return false; }
+
+                    void await_suspend( std::coroutine_handle<promise_type> handle ) noexcept
+                    {
+                        // whoever waits on the counter may return once it is decreased, so it is the last thing done
+                        JobSystem *system = handle.promise().system;
+                        JobCounter *counter = handle.promise().counter;
+                        handle.destroy();
+                        jobSystem::decrementCounter( system, *counter );
+                    }
+
+                    void await_resume() noexcept {}
+                };
+                FinalAwaiter final_suspend() noexcept { return {}; }
+
+                void return_void() {}
+            };
+
+            std::coroutine_handle<promise_type> handle;
+        };
+
+        template< typename Type >
+        CompletionTask completeTask( Task<Type> &task )
+        {
+            co_await task;
+        }
+
+        inline void resumeJob( JobSystem *, void *data )
+        {
+            std::coroutine_handle<>::from_address( *static_cast<void**>(data) ).resume();
+        }
+
+        struct WaitData {
+            void *address;
+            const JobCounter *counter;
+        };
+
+        inline void waitAndResumeJob( JobSystem *system, void *data )
+        {
+            WaitData wait = *static_cast<WaitData*>( data );
+            jobSystem::waitForCounter( system, *wait.counter );
+            std::coroutine_handle<>::from_address( wait.address ).resume();
+        }
+
+        // starts the task in its own job, counted by counter
+        template< typename Type >
+        void startTask( JobSystem *system, Task<Type> &task, JobCounter *counter )
+        {
+            CompletionTask completion = completeTask( task );
+            completion.handle.promise().system = system;
+            completion.handle.promise().counter = counter;
+            counter->value.fetch_add( 1, std::memory_order_relaxed );
+
+            void *address = completion.handle.address();
+            jobSystem::run( system, resumeJob, &address, sizeof(address), nullptr );
+        }
+
+        struct ScheduleAwaiter {
+            JobSystem *system;
+
+            bool await_ready() noexcept { return false; }
+
+            void await_suspend( std::coroutine_handle<> handle )
+            {
+                void *address = handle.address();
+                jobSystem::run( system, resumeJob, &address, sizeof(address), nullptr );
+            }
+
+            void await_resume() noexcept {}
+        };
+
+        struct CounterAwaiter {
+            JobSystem *system;
+            const JobCounter *counter;
+
+            bool await_ready() noexcept
+            {
+                return counter->value.load( std::memory_order_acquire ) == 0;
+            }
+
+            void await_suspend( std::coroutine_handle<> handle )
+            {
+                WaitData wait = { handle.address(), counter };
+                jobSystem::run( system, waitAndResumeJob, &wait, sizeof(wait), nullptr );
+            }
+
+            void await_resume() noexcept {}
+        };
+
+        struct JobAwaiter {
+            JobSystem *system;
+            Job *job;
+
+            bool await_ready() noexcept { return false; }
+
+            void await_suspend( std::coroutine_handle<> handle )
+            {
+                void *address = handle.address();
+                Job *resume = jobSystem::createJob( system, resumeJob, &address, sizeof(address) );
+                jobSystem::addDependency( resume, job );
+                jobSystem::run( system, resume );
+                jobSystem::run( system, job );
+            }
+
+            void await_resume() noexcept {}
+        };
+    }
+
+    namespace task
+    {
+        // continues the awaiting coroutine in a job on one of the workers
+        inline detail::ScheduleAwaiter schedule( JobSystem *system )
+        {
+            return detail::ScheduleAwaiter{ system };
+        }
+
+        /* continues the awaiting coroutine once counter reaches zero
+         * Anything that completes a JobCounter, like jobs or async file reads, can be awaited this way,
+         * counters decreased outside of jobs must be decreased with jobSystem::decrementCounter
+         */
+        inline detail::CounterAwaiter wait( JobSystem *system, const JobCounter &counter )
+        {
+            return detail::CounterAwaiter{ system, &counter };
+        }
+
+        /* runs a created job, and continues the awaiting coroutine once it has finished
+         * The job must have room for one more dependent
+         */
+        inline detail::JobAwaiter run( JobSystem *system, Job *job )
+        {
+            return detail::JobAwaiter{ system, job };
+        }
+
+        inline detail::JobAwaiter run( JobSystem *system, JobFunction function, const void *data = nullptr, std::size_t size = 0 )
+        {
+            return detail::JobAwaiter{ system, jobSystem::createJob(system, function, data, size) };
+        }
+
+        // runs each task in its own job, and finishes when all of them have, the results stay in the tasks
+        template< typename... Types >
+        Task<void> whenAll( JobSystem *system, Task<Types>&... tasks )
+        {
+            JobCounter counter;
+            (detail::startTask(system, tasks, &counter), ...);
+            co_await wait( system, counter );
+        }
+
+        template< typename Type >
+        Task<void> whenAll( JobSystem *system, Task<Type> *tasks, std::size_t count )
+        {
+            JobCounter counter;
+            for( std::size_t i=0; i < count; ++i ) {
+                detail::startTask( system, tasks[i], &counter );
+            }
+            co_await wait( system, counter );
+        }
+
+        /* Runs the task from code that isn't a coroutine, helping the job system until it has finished
+         * Returns the result of the task
+         */
+        template< typename Type >
+        Type syncWait( JobSystem *system, Task<Type> &task )
+        {
+            JobCounter counter;
+            counter.value.store( 1, std::memory_order_relaxed );
+
+            detail::CompletionTask completion = detail::completeTask( task );
+            completion.handle.promise().system = system;
+            completion.handle.promise().counter = &counter;
+            completion.handle.resume();
+
+            jobSystem::wait( system, counter );
+            return task.result();
+        }
+
+        template< typename Type >
+        Type syncWait( JobSystem *system, Task<Type> &&task )
+        {
+            return syncWait( system, task );
+        }
+    }
+}
+
+#endif
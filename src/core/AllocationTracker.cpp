@@ -0,0 +1,308 @@
+#include "core/AllocationTracker.h"
+#include "core/Allocator.h"
+#include "core/FlatMap.h"
+#include "core/Sync.h"
+#include "core/Assume.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <new>
+
+namespace Core
+{
+    namespace {
+        static const std::size_t HEADER_ALIGNMENT = 16;
+
+        static const AllocationTag UNTAGGED = { "Untagged", "", 0 };
+
+        // in front of every allocation
+        struct Header {
+            // index of the site in AllocationTracker::sites
+            uint32_t site;
+            // from the start of the allocation the backer made
+            uint32_t offset;
+            uint64_t size;
+        };
+        static_assert( sizeof(Header) <= HEADER_ALIGNMENT, "The header must fit in front of the allocation" );
+
+        struct SiteRecord {
+            const AllocationTag *tag;
+            uint64_t liveBytes,
+                     liveCount,
+                     peakBytes,
+                     totalBytes,
+                     totalCount;
+            // the totals at the previous snapshot
+            uint64_t snapshotBytes,
+                     snapshotCount;
+        };
+
+        Header* findHeader( void *ptr )
+        {
+            return reinterpret_cast<Header*>( static_cast<uint8_t*>(ptr) - sizeof(Header) );
+        }
+
+        const char* fileName( const char *path )
+        {
+            const char *name = std::strrchr( path, '/' );
+            return name ? name+1 : path;
+        }
+    }
+
+    class TrackingAllocator :
+        public Allocator
+    {
+    public:
+        TrackingAllocator( AllocationTracker *tracker ) :
+            mTracker(tracker)
+        {
+        }
+
+        virtual void* allocate( std::size_t size, std::size_t alignment )
+        {
+            return allocateTagged( size, alignment, detail::currentAllocationTag );
+        }
+
+        virtual void* allocateTagged( std::size_t size, std::size_t alignment, const AllocationTag *tag );
+        virtual void free( void *ptr );
+        virtual void* reallocate( void *ptr, std::size_t usedSize, std::size_t newSize, std::size_t alignment );
+
+    private:
+        void* allocateForSite( std::size_t size, std::size_t alignment, uint32_t site );
+
+        AllocationTracker *mTracker;
+    };
+
+    struct AllocationTracker {
+        Allocator *backer;
+        TrackingAllocator allocator;
+
+        Mutex lock;
+        Array<SiteRecord> sites;
+        // from the tag to its index in sites
+        FlatMap<uintptr_t, uint32_t> siteIndices;
+        uint64_t liveBytes;
+
+        std::chrono::steady_clock::time_point snapshotTime;
+
+        AllocationTracker( Allocator *backer_ ) :
+            backer(backer_),
+            allocator(this),
+            liveBytes(0),
+            snapshotTime(std::chrono::steady_clock::now())
+        {
+            sites._allocator = backer;
+            siteIndices._keys._allocator = backer;
+            siteIndices._values._allocator = backer;
+        }
+    };
+
+    namespace {
+        // the lock must be held
+        uint32_t findSite( AllocationTracker *tracker, const AllocationTag *tag )
+        {
+            if( !tag ) tag = &UNTAGGED;
+
+            const uintptr_t key = reinterpret_cast<uintptr_t>( tag );
+            const uint32_t *index = flatMap::find( tracker->siteIndices, key );
+            if( index ) return *index;
+
+            SiteRecord record;
+            std::memset( &record, 0, sizeof(record) );
+            record.tag = tag;
+
+            uint32_t site = uint32_t( array::size(tracker->sites) );
+            array::pushBack( tracker->sites, record );
+            flatMap::insert( tracker->siteIndices, key, site );
+            return site;
+        }
+    }
+
+    void* TrackingAllocator::allocateTagged( std::size_t size, std::size_t alignment, const AllocationTag *tag )
+    {
+        uint32_t site;
+        {
+            std::lock_guard<Mutex> lock( mTracker->lock );
+            site = findSite( mTracker, tag );
+        }
+        return allocateForSite( size, alignment, site );
+    }
+
+    void* TrackingAllocator::allocateForSite( std::size_t size, std::size_t alignment, uint32_t site )
+    {
+        // the header takes a whole alignment, so the allocation stays aligned
+        if( alignment < HEADER_ALIGNMENT ) alignment = HEADER_ALIGNMENT;
+
+        void *memory = mTracker->backer->allocate( size + alignment, alignment );
+        if( !memory ) return nullptr;
+
+        void *ptr = static_cast<uint8_t*>( memory ) + alignment;
+        Header *header = findHeader( ptr );
+        header->site = site;
+        header->offset = uint32_t( alignment );
+        header->size = size;
+
+        std::lock_guard<Mutex> lock( mTracker->lock );
+        SiteRecord &record = mTracker->sites[site];
+        record.liveBytes += size;
+        record.liveCount++;
+        record.peakBytes = std::max( record.peakBytes, record.liveBytes );
+        record.totalBytes += size;
+        record.totalCount++;
+        mTracker->liveBytes += size;
+
+        return ptr;
+    }
+
+    void TrackingAllocator::free( void *ptr )
+    {
+        if( !ptr ) return;
+
+        Header *header = findHeader( ptr );
+        {
+            std::lock_guard<Mutex> lock( mTracker->lock );
+            SiteRecord &record = mTracker->sites[header->site];
+            ASSUME_TRUE( record.liveCount > 0 && record.liveBytes >= header->size );
+            record.liveBytes -= header->size;
+            record.liveCount--;
+            mTracker->liveBytes -= header->size;
+        }
+
+        mTracker->backer->free( static_cast<uint8_t*>(ptr) - header->offset );
+    }
+
+    // keeps the site of the allocation it resizes
+    void* TrackingAllocator::reallocate( void *ptr, std::size_t usedSize, std::size_t newSize, std::size_t alignment )
+    {
+        if( !ptr ) return allocate( newSize, alignment );
+
+        void *result = allocateForSite( newSize, alignment, findHeader(ptr)->site );
+        if( result ) {
+            std::memcpy( result, ptr, usedSize < newSize ? usedSize : newSize );
+            free( ptr );
+        }
+        return result;
+    }
+
+    AllocationTracker* createAllocationTracker( Allocator *backer )
+    {
+        ASSUME_TRUE( backer != nullptr );
+
+        void *memory = backer->allocate( sizeof(AllocationTracker), alignof(AllocationTracker) );
+        if( !memory ) return nullptr;
+
+        return new (memory) AllocationTracker( backer );
+    }
+
+    void destroyAllocationTracker( AllocationTracker *tracker )
+    {
+        Allocator *backer = tracker->backer;
+        tracker->~AllocationTracker();
+        backer->free( tracker );
+    }
+
+    namespace allocationTracker
+    {
+        Allocator* allocator( AllocationTracker *tracker )
+        {
+            return &tracker->allocator;
+        }
+
+        uint64_t liveBytes( const AllocationTracker *tracker )
+        {
+            std::lock_guard<Mutex> lock( const_cast<AllocationTracker*>(tracker)->lock );
+            return tracker->liveBytes;
+        }
+
+        void snapshot( AllocationTracker *tracker, Array<AllocationSiteStats> &sites, Array<AllocationSubsystemStats> *subsystems )
+        {
+            sites._size = 0;
+            if( subsystems ) subsystems->_size = 0;
+
+            {
+                std::lock_guard<Mutex> lock( tracker->lock );
+
+                std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+                std::chrono::duration<double> elapsed = now - tracker->snapshotTime;
+                const double scale = elapsed.count() > 0.0 ? 1.0 / elapsed.count() : 0.0;
+                tracker->snapshotTime = now;
+
+                for( SiteRecord *record = array::begin(tracker->sites); record != array::end(tracker->sites); ++record ) {
+                    AllocationSiteStats stats;
+                    stats.tag = record->tag;
+                    stats.liveBytes = record->liveBytes;
+                    stats.liveCount = record->liveCount;
+                    stats.peakBytes = record->peakBytes;
+                    stats.totalBytes = record->totalBytes;
+                    stats.totalCount = record->totalCount;
+                    stats.bytesPerSecond = double(record->totalBytes - record->snapshotBytes) * scale;
+                    stats.allocationsPerSecond = double(record->totalCount - record->snapshotCount) * scale;
+                    array::pushBack( sites, stats );
+
+                    record->snapshotBytes = record->totalBytes;
+                    record->snapshotCount = record->totalCount;
+                }
+            }
+
+            std::sort( array::begin(sites), array::end(sites), []( const AllocationSiteStats &a, const AllocationSiteStats &b ) {
+                return a.liveBytes > b.liveBytes;
+            });
+
+            if( !subsystems ) return;
+
+            for( AllocationSiteStats *site = array::begin(sites); site != array::end(sites); ++site ) {
+                AllocationSubsystemStats *subsystem = array::begin( *subsystems );
+                while( subsystem != array::end(*subsystems) && std::strcmp(subsystem->subsystem, site->tag->subsystem) != 0 ) {
+                    ++subsystem;
+                }
+                if( subsystem == array::end(*subsystems) ) {
+                    AllocationSubsystemStats stats;
+                    std::memset( &stats, 0, sizeof(stats) );
+                    stats.subsystem = site->tag->subsystem;
+                    array::pushBack( *subsystems, stats );
+                    subsystem = array::end(*subsystems) - 1;
+                }
+
+                subsystem->liveBytes += site->liveBytes;
+                subsystem->liveCount += site->liveCount;
+                subsystem->totalBytes += site->totalBytes;
+                subsystem->totalCount += site->totalCount;
+                subsystem->bytesPerSecond += site->bytesPerSecond;
+                subsystem->allocationsPerSecond += site->allocationsPerSecond;
+            }
+
+            std::sort( array::begin(*subsystems), array::end(*subsystems), []( const AllocationSubsystemStats &a, const AllocationSubsystemStats &b ) {
+                return a.liveBytes > b.liveBytes;
+            });
+        }
+
+        void printSnapshot( AllocationTracker *tracker, FILE *file )
+        {
+            Array<AllocationSiteStats> sites( tracker->backer );
+            Array<AllocationSubsystemStats> subsystems( tracker->backer );
+            snapshot( tracker, sites, &subsystems );
+
+            std::fprintf( file, "%-40s %12s %10s %12s %10s %12s %10s\n", "Subsystem", "Live KB", "Live", "Total KB", "Total", "KB/s", "Allocs/s" );
+            for( AllocationSubsystemStats *subsystem = array::begin(subsystems); subsystem != array::end(subsystems); ++subsystem ) {
+                std::fprintf( file, "%-40s %12.1f %10llu %12.1f %10llu %12.1f %10.1f\n",
+                              subsystem->subsystem,
+                              double(subsystem->liveBytes) / 1024.0, (unsigned long long)subsystem->liveCount,
+                              double(subsystem->totalBytes) / 1024.0, (unsigned long long)subsystem->totalCount,
+                              subsystem->bytesPerSecond / 1024.0, subsystem->allocationsPerSecond );
+            }
+
+            std::fprintf( file, "\n%-40s %12s %10s %12s %10s %12s %10s\n", "Site", "Live KB", "Live", "Peak KB", "Total", "KB/s", "Allocs/s" );
+            for( AllocationSiteStats *site = array::begin(sites); site != array::end(sites); ++site ) {
+                char name[128];
+                std::snprintf( name, sizeof(name), "%s %s:%i", site->tag->subsystem, fileName(site->tag->file), site->tag->line );
+                std::fprintf( file, "%-40s %12.1f %10llu %12.1f %10llu %12.1f %10.1f\n",
+                              name,
+                              double(site->liveBytes) / 1024.0, (unsigned long long)site->liveCount,
+                              double(site->peakBytes) / 1024.0, (unsigned long long)site->totalCount,
+                              site->bytesPerSecond / 1024.0, site->allocationsPerSecond );
+            }
+        }
+    }
+}
@@ -3,6 +3,7 @@
 
 #include "dlmalloc.h"
 
+#include <cstring>
 #include <new>
 
 namespace Core 
@@ -76,6 +77,31 @@ namespace Core
         }
     }
     
+    namespace detail
+    {
+        thread_local const AllocationTag *currentAllocationTag = nullptr;
+    }
+    
+    void* Allocator::allocateTagged( std::size_t size, std::size_t alignment, const AllocationTag * )
+    {
+        return allocate( size, alignment );
+    }
+    
+    void Allocator::freeUsed( void *ptr, std::size_t )
+    {
+        free( ptr );
+    }
+    
+    void* Allocator::reallocate( void *ptr, std::size_t usedSize, std::size_t newSize, std::size_t alignment )
+    {
+        void *result = allocate( newSize, alignment );
+        if( ptr ) {
+            std::memcpy( result, ptr, usedSize < newSize ? usedSize : newSize );
+            free( ptr );
+        }
+        return result;
+    }
+    
     class SystemAllocator :
         public Allocator
     {
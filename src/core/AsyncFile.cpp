@@ -0,0 +1,659 @@
+#include "core/AsyncFile.h"
+#include "core/Allocator.h"
+#include "core/Array.h"
+#include "core/Assume.h"
+
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#if defined(__linux__) && defined(__NR_io_uring_setup)
+#   include <linux/io_uring.h>
+#   define CORE_ASYNC_IO_URING 1
+#endif
+
+namespace Core
+{
+    struct AsyncFile {
+        int fd;
+        uint64_t size;
+    };
+
+    namespace {
+        struct InFlight {
+            ReadRequest request;
+            // index of the registered buffer the read is into, or -1
+            int32_t buffer;
+        };
+
+        struct Completion {
+            uint32_t slot;
+            int64_t result;
+        };
+
+        // order queued reads are submitted in
+        static const IOPriority SUBMIT_ORDER[IO_PRIORITY_COUNT] = { IOPriority::High, IOPriority::Normal, IOPriority::Low };
+
+#ifdef CORE_ASYNC_IO_URING
+        /* The parts of a io_uring that are used, set up with the raw syscalls so liburing isn't needed
+         * Only the owning thread touches the submission ring, and reads the completion ring
+         */
+        class Ring {
+        public:
+            Ring() :
+                mFd(-1),
+                mSqRing(nullptr),
+                mCqRing(nullptr),
+                mSqes(nullptr),
+                mSqRingSize(0),
+                mCqRingSize(0),
+                mSqesSize(0),
+                mUnsubmitted(0)
+            {
+            }
+
+            ~Ring()
+            {
+                if( mSqes ) munmap( mSqes, mSqesSize );
+                if( mCqRing && mCqRing != mSqRing ) munmap( mCqRing, mCqRingSize );
+                if( mSqRing ) munmap( mSqRing, mSqRingSize );
+                if( mFd >= 0 ) ::close( mFd );
+            }
+
+            bool init( uint32_t entries )
+            {
+                io_uring_params params;
+                std::memset( &params, 0, sizeof(params) );
+
+                mFd = int( syscall(__NR_io_uring_setup, entries, &params) );
+                if( mFd < 0 ) return false;
+
+                mSqRingSize = params.sq_off.array + params.sq_entries*sizeof(uint32_t);
+                mCqRingSize = params.cq_off.cqes + params.cq_entries*sizeof(io_uring_cqe);
+                if( params.features & IORING_FEAT_SINGLE_MMAP ) {
+                    mSqRingSize = mCqRingSize = mSqRingSize > mCqRingSize ? mSqRingSize : mCqRingSize;
+                }
+
+                mSqRing = mmap( nullptr, mSqRingSize, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, mFd, IORING_OFF_SQ_RING );
+                if( mSqRing == MAP_FAILED ) {
+                    mSqRing = nullptr;
+                    return false;
+                }
+
+                if( params.features & IORING_FEAT_SINGLE_MMAP ) {
+                    mCqRing = mSqRing;
+                }
+                else {
+                    mCqRing = mmap( nullptr, mCqRingSize, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, mFd, IORING_OFF_CQ_RING );
+                    if( mCqRing == MAP_FAILED ) {
+                        mCqRing = nullptr;
+                        return false;
+                    }
+                }
+
+                mSqesSize = params.sq_entries*sizeof(io_uring_sqe);
+                void *sqes = mmap( nullptr, mSqesSize, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, mFd, IORING_OFF_SQES );
+                if( sqes == MAP_FAILED ) return false;
+                mSqes = static_cast<io_uring_sqe*>( sqes );
+
+                uint8_t *sq = static_cast<uint8_t*>( mSqRing );
+                mSqTail = reinterpret_cast<uint32_t*>( sq + params.sq_off.tail );
+                mSqMask = *reinterpret_cast<uint32_t*>( sq + params.sq_off.ring_mask );
+                mSqArray = reinterpret_cast<uint32_t*>( sq + params.sq_off.array );
+
+                uint8_t *cq = static_cast<uint8_t*>( mCqRing );
+                mCqHead = reinterpret_cast<uint32_t*>( cq + params.cq_off.head );
+                mCqTail = reinterpret_cast<uint32_t*>( cq + params.cq_off.tail );
+                mCqMask = *reinterpret_cast<uint32_t*>( cq + params.cq_off.ring_mask );
+                mCqes = reinterpret_cast<io_uring_cqe*>( cq + params.cq_off.cqes );
+
+                return supportsReads();
+            }
+
+            /* Rings can be set up since 5.1, but the read opcodes came in 5.6, along with the probe
+             * On a kernel without them every read would fail with -EINVAL, so the ring isn't used
+             */
+            bool supportsReads()
+            {
+                static const unsigned PROBE_OPS = 256;
+                alignas(io_uring_probe) uint8_t buffer[sizeof(io_uring_probe) + PROBE_OPS*sizeof(io_uring_probe_op)];
+                std::memset( buffer, 0, sizeof(buffer) );
+
+                io_uring_probe *probe = reinterpret_cast<io_uring_probe*>( buffer );
+                if( syscall(__NR_io_uring_register, mFd, IORING_REGISTER_PROBE, probe, PROBE_OPS) != 0 ) {
+                    return false;
+                }
+
+                const uint8_t opcodes[] = { IORING_OP_READ, IORING_OP_READ_FIXED };
+                for( uint8_t opcode : opcodes ) {
+                    if( opcode > probe->last_op || !(probe->ops[opcode].flags & IO_URING_OP_SUPPORTED) ) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+
+            bool registerBuffers( const iovec *buffers, std::size_t count )
+            {
+                return syscall( __NR_io_uring_register, mFd, IORING_REGISTER_BUFFERS, buffers, unsigned(count) ) == 0;
+            }
+
+            // the caller makes sure there is room, by not having more reads in flight than entries
+            void queueRead( uint32_t slot, const ReadRequest &request, int32_t buffer )
+            {
+                uint32_t tail = *mSqTail;
+                uint32_t index = tail & mSqMask;
+
+                io_uring_sqe *sqe = mSqes + index;
+                std::memset( sqe, 0, sizeof(io_uring_sqe) );
+                sqe->opcode = buffer >= 0 ? IORING_OP_READ_FIXED : IORING_OP_READ;
+                sqe->fd = request.file->fd;
+                sqe->off = request.offset;
+                sqe->addr = reinterpret_cast<uintptr_t>( request.buffer );
+                sqe->len = request.size;
+                sqe->user_data = slot;
+                if( buffer >= 0 ) {
+                    sqe->buf_index = uint16_t( buffer );
+                }
+
+                mSqArray[index] = index;
+                __atomic_store_n( mSqTail, tail+1, __ATOMIC_RELEASE );
+                mUnsubmitted++;
+            }
+
+            // submits the queued reads, and waits for at least minComplete completions
+            void enter( uint32_t minComplete )
+            {
+                for( ;; ) {
+                    unsigned flags = minComplete > 0 ? IORING_ENTER_GETEVENTS : 0;
+                    long submitted = syscall( __NR_io_uring_enter, mFd, mUnsubmitted, minComplete, flags, nullptr, 0 );
+                    if( submitted >= 0 ) {
+                        mUnsubmitted -= uint32_t( submitted );
+                        return;
+                    }
+                    if( errno != EINTR ) return;
+                }
+            }
+
+            template< typename Function >
+            std::size_t reap( Function function )
+            {
+                uint32_t head = *mCqHead;
+                uint32_t tail = __atomic_load_n( mCqTail, __ATOMIC_ACQUIRE );
+
+                std::size_t count = 0;
+                for( ; head != tail; ++head, ++count ) {
+                    const io_uring_cqe &cqe = mCqes[head & mCqMask];
+                    function( uint32_t(cqe.user_data), int64_t(cqe.res) );
+                }
+                __atomic_store_n( mCqHead, head, __ATOMIC_RELEASE );
+                return count;
+            }
+
+        private:
+            int mFd;
+            void *mSqRing,
+                 *mCqRing;
+            io_uring_sqe *mSqes;
+            std::size_t mSqRingSize,
+                        mCqRingSize,
+                        mSqesSize;
+
+            uint32_t *mSqTail;
+            uint32_t mSqMask;
+            uint32_t *mSqArray;
+            uint32_t mUnsubmitted;
+
+            uint32_t *mCqHead,
+                     *mCqTail;
+            uint32_t mCqMask;
+            io_uring_cqe *mCqes;
+        };
+#endif
+    }
+
+    struct AsyncIO {
+        AsyncIO( Allocator *allocator_, std::size_t queueDepth_ ) :
+            allocator(allocator_),
+            backend(AsyncIOBackend::ThreadPool),
+            queueDepth(queueDepth_),
+            inFlight(allocator_),
+            freeSlots(allocator_),
+            inFlightCount(0),
+            buffers(nullptr),
+            bufferSize(0),
+            bufferCount(0),
+            registered(false),
+            freeBuffers(allocator_),
+#ifdef CORE_ASYNC_IO_URING
+            ring(nullptr),
+#endif
+            threads(allocator_),
+            work(allocator_),
+            workHead(0),
+            completed(allocator_),
+            quit(false)
+        {
+            for( std::size_t i=0; i < IO_PRIORITY_COUNT; ++i ) {
+                queued[i]._allocator = allocator_;
+                queuedHead[i] = 0;
+            }
+        }
+
+        Allocator *allocator;
+        AsyncIOBackend backend;
+        std::size_t queueDepth;
+
+        // reads waiting to be submitted, one fifo for each priority
+        Array<ReadRequest> queued[IO_PRIORITY_COUNT];
+        std::size_t queuedHead[IO_PRIORITY_COUNT];
+
+        // the submitted reads, indexed by slot
+        Array<InFlight> inFlight;
+        Array<uint32_t> freeSlots;
+        std::size_t inFlightCount;
+
+        uint8_t *buffers;
+        std::size_t bufferSize,
+                    bufferCount;
+        bool registered;
+        Array<void*> freeBuffers;
+
+#ifdef CORE_ASYNC_IO_URING
+        Ring *ring;
+#endif
+
+        // the thread pool, reads are taken from work and put in completed
+        Array<std::thread*> threads;
+        std::mutex lock;
+        std::condition_variable workReady,
+                                workDone;
+        Array<uint32_t> work;
+        std::size_t workHead;
+        Array<Completion> completed;
+        bool quit;
+    };
+
+    namespace {
+        void poolThread( AsyncIO *io )
+        {
+            std::unique_lock<std::mutex> lock( io->lock );
+            for( ;; ) {
+                while( io->workHead == array::size(io->work) && !io->quit ) {
+                    io->workReady.wait( lock );
+                }
+                if( io->workHead == array::size(io->work) ) return;
+
+                uint32_t slot = io->work[io->workHead++];
+                if( io->workHead == array::size(io->work) ) {
+                    io->work._size = 0;
+                    io->workHead = 0;
+                }
+                // the slot doesn't change while the read is in flight
+                ReadRequest request = io->inFlight[slot].request;
+                lock.unlock();
+
+                ssize_t result;
+                do {
+                    result = pread( request.file->fd, request.buffer, request.size, off_t(request.offset) );
+                } while( result < 0 && errno == EINTR );
+
+                Completion completion = { slot, result < 0 ? -int64_t(errno) : int64_t(result) };
+
+                lock.lock();
+                array::pushBack( io->completed, completion );
+                io->workDone.notify_one();
+            }
+        }
+
+        // the registered buffer request reads into, or -1 if it isn't entirely inside one
+        int32_t registeredBuffer( const AsyncIO *io, const ReadRequest &request )
+        {
+            if( !io->registered ) return -1;
+
+            const uint8_t *buffer = static_cast<const uint8_t*>( request.buffer );
+            if( buffer < io->buffers || buffer >= io->buffers + io->bufferSize*io->bufferCount ) return -1;
+
+            std::size_t index = std::size_t(buffer - io->buffers) / io->bufferSize;
+            const uint8_t *end = io->buffers + (index+1)*io->bufferSize;
+            return buffer + request.size <= end ? int32_t(index) : -1;
+        }
+
+        // sets the result, calls the callback and decreases the counter
+        void finish( const ReadRequest &request, int64_t result )
+        {
+            if( request.result ) {
+                *request.result = result;
+            }
+            if( request.callback ) {
+                request.callback( request, result );
+            }
+            if( request.counter && request.system ) {
+                jobSystem::decrementCounter( request.system, *request.counter );
+            }
+            else if( request.counter ) {
+                request.counter->value.fetch_sub( 1, std::memory_order_release );
+            }
+        }
+
+        void complete( AsyncIO *io, uint32_t slot, int64_t result )
+        {
+            ReadRequest request = io->inFlight[slot].request;
+            array::pushBack( io->freeSlots, slot );
+            io->inFlightCount--;
+
+            finish( request, result );
+        }
+
+        bool popQueued( AsyncIO *io, ReadRequest &request )
+        {
+            for( std::size_t i=0; i < IO_PRIORITY_COUNT; ++i ) {
+                std::size_t priority = std::size_t( SUBMIT_ORDER[i] );
+                Array<ReadRequest> &queue = io->queued[priority];
+                std::size_t &head = io->queuedHead[priority];
+                if( head == array::size(queue) ) continue;
+
+                request = queue[head++];
+                if( head == array::size(queue) ) {
+                    queue._size = 0;
+                    head = 0;
+                }
+                return true;
+            }
+            return false;
+        }
+    }
+
+    AsyncIO* createAsyncIO( Allocator *allocator, std::size_t queueDepth, AsyncIOBackend backend, std::size_t threadCount )
+    {
+        ASSUME_TRUE( allocator != nullptr );
+        ASSUME_TRUE( queueDepth > 0 );
+
+        void *memory = allocator->allocate( sizeof(AsyncIO), alignof(AsyncIO) );
+        AsyncIO *io = new (memory) AsyncIO( allocator, queueDepth );
+
+        array::resize( io->inFlight, queueDepth );
+        array::reserve( io->freeSlots, queueDepth );
+        for( std::size_t i=queueDepth; i > 0; --i ) {
+            array::pushBack( io->freeSlots, uint32_t(i-1) );
+        }
+
+#ifdef CORE_ASYNC_IO_URING
+        if( backend != AsyncIOBackend::ThreadPool ) {
+            void *ringMemory = allocator->allocate( sizeof(Ring), alignof(Ring) );
+            Ring *ring = new (ringMemory) Ring;
+            if( ring->init(uint32_t(queueDepth)) ) {
+                io->ring = ring;
+                io->backend = AsyncIOBackend::IoUring;
+            }
+            else {
+                ring->~Ring();
+                allocator->free( ring );
+            }
+        }
+#endif
+
+        if( io->backend != AsyncIOBackend::IoUring ) {
+            if( backend == AsyncIOBackend::IoUring ) {
+                destroyAsyncIO( io );
+                return nullptr;
+            }
+
+            if( threadCount == 0 ) threadCount = 1;
+            for( std::size_t i=0; i < threadCount; ++i ) {
+                void *threadMemory = allocator->allocate( sizeof(std::thread), alignof(std::thread) );
+                array::pushBack( io->threads, new (threadMemory) std::thread(poolThread, io) );
+            }
+        }
+
+        return io;
+    }
+
+    void destroyAsyncIO( AsyncIO *io )
+    {
+        /* Reads that were never submitted are completed as canceled, since read has already counted them,
+         * and the callbacks of the reads in flight may queue more
+         */
+        ReadRequest request;
+        for( ;; ) {
+            while( popQueued(io, request) ) {
+                finish( request, -ECANCELED );
+            }
+            if( io->inFlightCount == 0 ) break;
+            asyncIO::poll( io, true );
+        }
+
+        Allocator *allocator = io->allocator;
+
+        {
+            std::lock_guard<std::mutex> lock( io->lock );
+            io->quit = true;
+            io->workReady.notify_all();
+        }
+        for( std::thread **thread = array::begin(io->threads); thread != array::end(io->threads); ++thread ) {
+            (*thread)->join();
+            (*thread)->~thread();
+            allocator->free( *thread );
+        }
+
+#ifdef CORE_ASYNC_IO_URING
+        if( io->ring ) {
+            io->ring->~Ring();
+            allocator->free( io->ring );
+        }
+#endif
+
+        if( io->buffers ) {
+            allocator->free( io->buffers );
+        }
+
+        io->~AsyncIO();
+        allocator->free( io );
+    }
+
+    namespace asyncIO
+    {
+        AsyncIOBackend backend( const AsyncIO *io )
+        {
+            return io->backend;
+        }
+
+        AsyncFile* open( AsyncIO *io, const char *path )
+        {
+            int fd = ::open( path, O_RDONLY | O_CLOEXEC );
+            if( fd < 0 ) return nullptr;
+
+            struct stat info;
+            if( fstat(fd, &info) != 0 ) {
+                ::close( fd );
+                return nullptr;
+            }
+
+            void *memory = io->allocator->allocate( sizeof(AsyncFile), alignof(AsyncFile) );
+            AsyncFile *file = new (memory) AsyncFile;
+            file->fd = fd;
+            file->size = uint64_t( info.st_size );
+            return file;
+        }
+
+        void close( AsyncIO *io, AsyncFile *file )
+        {
+            ::close( file->fd );
+            io->allocator->free( file );
+        }
+
+        uint64_t fileSize( const AsyncFile *file )
+        {
+            return file->size;
+        }
+
+        bool registerBuffers( AsyncIO *io, std::size_t bufferSize, std::size_t count )
+        {
+            ASSUME_TRUE( io->buffers == nullptr );
+            ASSUME_TRUE( io->inFlightCount == 0 );
+            ASSUME_TRUE( bufferSize > 0 && count > 0 );
+
+            // page aligned, so direct io works with them too
+            const std::size_t alignment = 4096;
+            bufferSize = ((bufferSize + alignment-1) / alignment) * alignment;
+
+            io->buffers = static_cast<uint8_t*>( io->allocator->allocate(bufferSize*count, alignment) );
+            if( !io->buffers ) return false;
+
+            io->bufferSize = bufferSize;
+            io->bufferCount = count;
+            array::reserve( io->freeBuffers, count );
+            for( std::size_t i=count; i > 0; --i ) {
+                array::pushBack( io->freeBuffers, static_cast<void*>(io->buffers + (i-1)*bufferSize) );
+            }
+
+#ifdef CORE_ASYNC_IO_URING
+            if( io->ring ) {
+                Array<iovec> vectors( io->allocator );
+                array::resize( vectors, count );
+                for( std::size_t i=0; i < count; ++i ) {
+                    vectors[i].iov_base = io->buffers + i*bufferSize;
+                    vectors[i].iov_len = bufferSize;
+                }
+                // may fail if too much memory would be locked, then they are used as ordinary buffers
+                io->registered = io->ring->registerBuffers( array::begin(vectors), count );
+            }
+#endif
+            return true;
+        }
+
+        void* acquireBuffer( AsyncIO *io )
+        {
+            if( array::size(io->freeBuffers) == 0 ) return nullptr;
+            return array::popBack( io->freeBuffers );
+        }
+
+        void releaseBuffer( AsyncIO *io, void *buffer )
+        {
+            ASSUME_TRUE( buffer >= io->buffers && buffer < io->buffers + io->bufferSize*io->bufferCount );
+            array::pushBack( io->freeBuffers, buffer );
+        }
+
+        std::size_t bufferSize( const AsyncIO *io )
+        {
+            return io->bufferSize;
+        }
+
+        void read( AsyncIO *io, const ReadRequest &request )
+        {
+            ASSUME_TRUE( request.file != nullptr );
+            ASSUME_TRUE( std::size_t(request.priority) < IO_PRIORITY_COUNT );
+
+            if( request.counter ) {
+                request.counter->value.fetch_add( 1, std::memory_order_relaxed );
+            }
+            array::pushBack( io->queued[std::size_t(request.priority)], request );
+        }
+
+        void read( AsyncIO *io, const ReadRequest *requests, std::size_t count )
+        {
+            for( std::size_t i=0; i < count; ++i ) {
+                read( io, requests[i] );
+            }
+        }
+
+        std::size_t submit( AsyncIO *io )
+        {
+            std::size_t count = 0;
+            ReadRequest request;
+            while( io->inFlightCount < io->queueDepth && popQueued(io, request) ) {
+                uint32_t slot = array::popBack( io->freeSlots );
+                io->inFlight[slot].request = request;
+                io->inFlight[slot].buffer = registeredBuffer( io, request );
+                io->inFlightCount++;
+                count++;
+
+#ifdef CORE_ASYNC_IO_URING
+                if( io->ring ) {
+                    io->ring->queueRead( slot, request, io->inFlight[slot].buffer );
+                    continue;
+                }
+#endif
+                std::lock_guard<std::mutex> lock( io->lock );
+                array::pushBack( io->work, slot );
+                io->workReady.notify_one();
+            }
+
+#ifdef CORE_ASYNC_IO_URING
+            // the whole batch in one syscall
+            if( io->ring && count > 0 ) {
+                io->ring->enter( 0 );
+            }
+#endif
+            return count;
+        }
+
+        std::size_t poll( AsyncIO *io, bool wait )
+        {
+            wait = wait && io->inFlightCount > 0;
+            std::size_t count = 0;
+
+#ifdef CORE_ASYNC_IO_URING
+            if( io->ring ) {
+                auto finish = [io]( uint32_t slot, int64_t result ) { complete( io, slot, result ); };
+                count = io->ring->reap( finish );
+                if( count == 0 && wait ) {
+                    io->ring->enter( 1 );
+                    count = io->ring->reap( finish );
+                }
+                submit( io );
+                return count;
+            }
+#endif
+
+            Array<Completion> completed( io->allocator );
+            {
+                std::unique_lock<std::mutex> lock( io->lock );
+                while( wait && array::size(io->completed) == 0 ) {
+                    io->workDone.wait( lock );
+                }
+                std::swap( completed, io->completed );
+            }
+
+            for( Completion *completion = array::begin(completed); completion != array::end(completed); ++completion ) {
+                complete( io, completion->slot, completion->result );
+            }
+            count = array::size( completed );
+
+            submit( io );
+            return count;
+        }
+
+        std::size_t pending( const AsyncIO *io )
+        {
+            std::size_t count = io->inFlightCount;
+            for( std::size_t i=0; i < IO_PRIORITY_COUNT; ++i ) {
+                count += array::size( io->queued[i] ) - io->queuedHead[i];
+            }
+            return count;
+        }
+
+        void wait( AsyncIO *io, const JobCounter &counter )
+        {
+            while( counter.value.load(std::memory_order_acquire) != 0 ) {
+                submit( io );
+                if( io->inFlightCount == 0 ) {
+                    // the counter is waiting on something else
+                    std::this_thread::yield();
+                    continue;
+                }
+                poll( io, true );
+            }
+        }
+    }
+}
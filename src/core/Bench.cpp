@@ -0,0 +1,499 @@
+#include "core/Bench.h"
+#include "core/Allocator.h"
+#include "core/Assume.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+namespace Core
+{
+    namespace {
+        static const std::size_t MAX_BENCHMARKS = 256;
+        static const std::size_t MAX_PARAMETERS = 16;
+        static const std::size_t MAX_NAME_SIZE = 128;
+        // calibration stops here, for benchmarks the compiler optimized away
+        static const uint64_t MAX_ITERATIONS = uint64_t(1) << 40;
+        // or when a sample takes this many times sampleMs with the paused time, for benchmarks that mostly pause
+        static const double MAX_WALL_SCALE = 10.0;
+
+        struct Registered {
+            const char *name;
+            BenchFunction function;
+            int64_t parameters[MAX_PARAMETERS];
+            uint32_t parameterCount;
+        };
+
+        // benchmarks register during static initialization, before there are any allocators
+        struct Registry {
+            Registered benchmarks[MAX_BENCHMARKS];
+            std::size_t count;
+        };
+
+        Registry& registry()
+        {
+            static Registry registry;
+            return registry;
+        }
+
+        struct BaselineEntry {
+            char name[MAX_NAME_SIZE];
+            int64_t parameter;
+            double medianNs,
+                   madNs;
+        };
+
+        uint64_t now()
+        {
+            return uint64_t( std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count() );
+        }
+
+        /* Returns the nanoseconds the function ran, without the paused time
+         * wallNs gets the time with it
+         */
+        double runSample( const Registered &benchmark, int64_t parameter, uint64_t iterations, PerfCounters *perf, PerfCounterValues *counted, double *wallNs = nullptr )
+        {
+            BenchContext context;
+            std::memset( &context, 0, sizeof(context) );
+            context.iterations = iterations;
+            context.parameter = parameter;
+            context._perf = perf;
+
+            PerfCounterValues before, after;
+            if( perf ) perfCounters::read( perf, before );
+            uint64_t start = now();
+
+            benchmark.function( context );
+
+            uint64_t elapsed = now() - start;
+            if( wallNs ) *wallNs = double( elapsed );
+            if( perf ) {
+                perfCounters::read( perf, after );
+                *counted = perfCounters::difference( perfCounters::difference(after, before), context._pausedCounters );
+            }
+
+            return context._pausedNs < elapsed ? double(elapsed - context._pausedNs) : 0.0;
+        }
+
+        void formatName( char *name, const Registered &benchmark, int64_t parameter )
+        {
+            if( benchmark.parameterCount > 0 ) {
+                std::snprintf( name, MAX_NAME_SIZE, "%s/%lld", benchmark.name, (long long)parameter );
+            }
+            else {
+                std::snprintf( name, MAX_NAME_SIZE, "%s", benchmark.name );
+            }
+        }
+
+        void printHeader( FILE *output, bool counters )
+        {
+            std::fprintf( output, "%-48s %12s %12s %8s %12s", "Benchmark", "Iterations", "Median ns", "MAD %", "Min ns" );
+            if( counters ) {
+                std::fprintf( output, " %6s %12s %12s", "IPC", "Cycles", "Misses" );
+            }
+            std::fprintf( output, "\n" );
+        }
+
+        void printResult( FILE *output, const char *name, const BenchResult &result )
+        {
+            std::fprintf( output, "%-48s %12llu %12.2f %8.2f %12.2f", name, (unsigned long long)result.iterations,
+                          result.medianNs, result.medianNs > 0.0 ? 100.0 * result.madNs / result.medianNs : 0.0, result.minNs );
+            if( result.countedIterations > 0 ) {
+                const double scale = 1.0 / double(result.countedIterations);
+                std::fprintf( output, " %6.2f %12.1f %12.2f", perfCounters::ipc(result.counters),
+                              double(result.counters.cycles) * scale, double(result.counters.cacheMisses) * scale );
+            }
+            std::fprintf( output, "\n" );
+        }
+
+        void writeEscaped( FILE *file, const char *text )
+        {
+            for( ; *text; ++text ) {
+                if( *text == '"' || *text == '\\' ) {
+                    std::fputc( '\\', file );
+                }
+                if( uint8_t(*text) >= 0x20 ) {
+                    std::fputc( *text, file );
+                }
+            }
+        }
+
+        // the value after key in a json line, or nullptr
+        const char* findJsonValue( const char *line, const char *key )
+        {
+            const char *found = std::strstr( line, key );
+            return found ? found + std::strlen( key ) : nullptr;
+        }
+
+        bool parseJsonLine( const char *line, BaselineEntry &entry )
+        {
+            const char *name = findJsonValue( line, "\"name\":\"" );
+            const char *parameter = findJsonValue( line, "\"parameter\":" );
+            const char *median = findJsonValue( line, "\"median_ns\":" );
+            const char *mad = findJsonValue( line, "\"mad_ns\":" );
+            if( !name || !parameter || !median || !mad ) return false;
+
+            std::size_t size = 0;
+            for( ; name[size] && name[size] != '"' && size+1 < MAX_NAME_SIZE; ++size ) {
+                entry.name[size] = name[size];
+            }
+            entry.name[size] = '\0';
+            entry.parameter = std::strtoll( parameter, nullptr, 10 );
+            entry.medianNs = std::strtod( median, nullptr );
+            entry.madNs = std::strtod( mad, nullptr );
+            return true;
+        }
+
+        // name,parameter,iterations,samples,median_ns,mad_ns,...
+        bool parseCsvLine( const char *line, BaselineEntry &entry )
+        {
+            const char *comma = std::strchr( line, ',' );
+            if( !comma || std::strncmp(line, "name,", 5) == 0 ) return false;
+
+            std::size_t size = std::min( std::size_t(comma - line), MAX_NAME_SIZE-1 );
+            std::memcpy( entry.name, line, size );
+            entry.name[size] = '\0';
+
+            char *end = nullptr;
+            entry.parameter = std::strtoll( comma+1, &end, 10 );
+            std::strtoull( end+1, &end, 10 );
+            std::strtoul( end+1, &end, 10 );
+            entry.medianNs = std::strtod( end+1, &end );
+            entry.madNs = std::strtod( end+1, &end );
+            return true;
+        }
+
+        bool readBaseline( const char *path, Array<BaselineEntry> &entries )
+        {
+            FILE *file = std::fopen( path, "r" );
+            if( !file ) return false;
+
+            char line[1024];
+            while( std::fgets(line, sizeof(line), file) ) {
+                BaselineEntry entry;
+                bool parsed = std::strchr( line, '{' ) ? parseJsonLine( line, entry ) : parseCsvLine( line, entry );
+                if( parsed ) {
+                    array::pushBack( entries, entry );
+                }
+            }
+
+            std::fclose( file );
+            return true;
+        }
+
+        void printUsage( const char *program )
+        {
+            std::fprintf( stderr,
+                "Usage: %s [options]\n"
+                "  --filter=name         only run benchmarks with name in their name\n"
+                "  --samples=n           samples of each benchmark, 15 by default\n"
+                "  --sample-ms=ms        the least time of each sample, 10 by default\n"
+                "  --warmup-ms=ms        time to run before sampling, 50 by default\n"
+                "  --counters            count cycles, instructions and cache misses\n"
+                "  --json=path           write the results as json\n"
+                "  --csv=path            write the results as csv\n"
+                "  --baseline=path       compare with the json or csv of an earlier run\n"
+                "  --threshold=fraction  the change that counts as a regression, 0.05 by default\n",
+                program );
+        }
+    }
+
+    namespace bench
+    {
+        int add( const char *name, BenchFunction function, std::initializer_list<int64_t> parameters )
+        {
+            Registry &benchmarks = registry();
+            ASSUME_TRUE( benchmarks.count < MAX_BENCHMARKS );
+            ASSUME_TRUE( parameters.size() <= MAX_PARAMETERS );
+
+            Registered &benchmark = benchmarks.benchmarks[benchmarks.count];
+            benchmark.name = name;
+            benchmark.function = function;
+            benchmark.parameterCount = 0;
+            for( int64_t parameter : parameters ) {
+                benchmark.parameters[benchmark.parameterCount++] = parameter;
+            }
+
+            return int( benchmarks.count++ );
+        }
+
+        void pause( BenchContext &context )
+        {
+            context._pauseStart = now();
+            if( context._perf ) perfCounters::read( context._perf, context._pauseCounters );
+        }
+
+        void resume( BenchContext &context )
+        {
+            if( context._perf ) {
+                PerfCounterValues counters;
+                perfCounters::read( context._perf, counters );
+                perfCounters::add( context._pausedCounters, perfCounters::difference(counters, context._pauseCounters) );
+            }
+            context._pausedNs += now() - context._pauseStart;
+        }
+
+        double median( double *values, std::size_t count )
+        {
+            if( count == 0 ) return 0.0;
+
+            std::size_t half = count / 2;
+            std::nth_element( values, values + half, values + count );
+            double upper = values[half];
+            if( count & 1 ) return upper;
+
+            double lower = *std::max_element( values, values + half );
+            return (lower + upper) * 0.5;
+        }
+
+        double medianAbsoluteDeviation( double *values, std::size_t count )
+        {
+            if( count == 0 ) return 0.0;
+
+            double center = median( values, count );
+            for( std::size_t i=0; i < count; ++i ) {
+                values[i] = std::fabs( values[i] - center );
+            }
+            return median( values, count );
+        }
+
+        void run( const BenchOptions &options, Array<BenchResult> &results )
+        {
+            ASSUME_TRUE( options.samples > 0 );
+            results._size = 0;
+
+            PerfCounters *perf = nullptr;
+            if( options.perfCounters ) {
+                perf = createPerfCounters( results._allocator );
+                if( !perf && options.output ) {
+                    std::fprintf( options.output, "The performance counters couldn't be opened, running without them\n" );
+                }
+            }
+            if( options.output ) printHeader( options.output, perf != nullptr );
+
+            Array<double> times( results._allocator );
+            array::resize( times, options.samples );
+
+            const Registry &benchmarks = registry();
+            for( std::size_t b=0; b < benchmarks.count; ++b ) {
+                const Registered &benchmark = benchmarks.benchmarks[b];
+                if( options.filter && !std::strstr(benchmark.name, options.filter) ) continue;
+
+                const uint32_t runs = benchmark.parameterCount > 0 ? benchmark.parameterCount : 1;
+                for( uint32_t r=0; r < runs; ++r ) {
+                    const int64_t parameter = benchmark.parameterCount > 0 ? benchmark.parameters[r] : 0;
+                    const double sampleNs = options.sampleMs * 1.0e6;
+                    const uint64_t warmupStart = now();
+
+                    // grows the iterations until a sample takes sampleMs, at most tenfold each time
+                    uint64_t iterations = 1;
+                    PerfCounterValues counted;
+                    for( ;; ) {
+                        double wallNs;
+                        double ns = runSample( benchmark, parameter, iterations, nullptr, &counted, &wallNs );
+                        if( ns >= sampleNs || iterations >= MAX_ITERATIONS || wallNs >= MAX_WALL_SCALE * sampleNs ) break;
+
+                        double scale = ns > 0.0 ? 1.2 * sampleNs / ns : 10.0;
+                        scale = std::max( 2.0, std::min(10.0, scale) );
+                        iterations = uint64_t( double(iterations) * scale );
+                    }
+                    while( double(now() - warmupStart) < options.warmupMs * 1.0e6 ) {
+                        runSample( benchmark, parameter, iterations, nullptr, &counted );
+                    }
+
+                    BenchResult result;
+                    std::memset( &result, 0, sizeof(result) );
+                    result.name = benchmark.name;
+                    result.parameter = parameter;
+                    result.iterations = iterations;
+                    result.samples = options.samples;
+
+                    for( uint32_t s=0; s < options.samples; ++s ) {
+                        times[s] = runSample( benchmark, parameter, iterations, perf, &counted ) / double(iterations);
+                        if( perf ) {
+                            perfCounters::add( result.counters, counted );
+                            result.countedIterations += iterations;
+                        }
+                    }
+
+                    result.minNs = *std::min_element( array::begin(times), array::end(times) );
+                    result.maxNs = *std::max_element( array::begin(times), array::end(times) );
+                    result.medianNs = median( array::begin(times), options.samples );
+                    result.madNs = medianAbsoluteDeviation( array::begin(times), options.samples );
+                    array::pushBack( results, result );
+
+                    if( options.output ) {
+                        char name[MAX_NAME_SIZE];
+                        formatName( name, benchmark, parameter );
+                        printResult( options.output, name, result );
+                        std::fflush( options.output );
+                    }
+                }
+            }
+
+            if( perf ) destroyPerfCounters( perf );
+        }
+
+        // one benchmark on each line, so compare can read it back without a json parser
+        bool writeJson( const char *path, const Array<BenchResult> &results )
+        {
+            FILE *file = std::fopen( path, "w" );
+            if( !file ) return false;
+
+            std::fprintf( file, "{\"benchmarks\":[\n" );
+            for( std::size_t i=0; i < array::size(results); ++i ) {
+                const BenchResult &result = results[i];
+                std::fprintf( file, "{\"name\":\"" );
+                writeEscaped( file, result.name );
+                std::fprintf( file, "\",\"parameter\":%lld,\"iterations\":%llu,\"samples\":%u,\"median_ns\":%.4f,\"mad_ns\":%.4f,\"min_ns\":%.4f,\"max_ns\":%.4f",
+                              (long long)result.parameter, (unsigned long long)result.iterations, result.samples,
+                              result.medianNs, result.madNs, result.minNs, result.maxNs );
+                if( result.countedIterations > 0 ) {
+                    const double scale = 1.0 / double(result.countedIterations);
+                    std::fprintf( file, ",\"ipc\":%.4f,\"cycles\":%.4f,\"instructions\":%.4f,\"cache_misses\":%.4f,\"branch_misses\":%.4f,\"llc_loads\":%.4f",
+                                  perfCounters::ipc(result.counters),
+                                  double(result.counters.cycles) * scale, double(result.counters.instructions) * scale,
+                                  double(result.counters.cacheMisses) * scale, double(result.counters.branchMisses) * scale,
+                                  double(result.counters.llcLoads) * scale );
+                }
+                std::fprintf( file, "}%s\n", i+1 < array::size(results) ? "," : "" );
+            }
+            std::fprintf( file, "]}\n" );
+
+            bool written = std::ferror( file ) == 0;
+            std::fclose( file );
+            return written;
+        }
+
+        bool writeCsv( const char *path, const Array<BenchResult> &results )
+        {
+            FILE *file = std::fopen( path, "w" );
+            if( !file ) return false;
+
+            std::fprintf( file, "name,parameter,iterations,samples,median_ns,mad_ns,min_ns,max_ns,ipc,cycles,instructions,cache_misses,branch_misses,llc_loads\n" );
+            for( const BenchResult *result = array::begin(results); result != array::end(results); ++result ) {
+                const double scale = result->countedIterations > 0 ? 1.0 / double(result->countedIterations) : 0.0;
+                std::fprintf( file, "%s,%lld,%llu,%u,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f\n",
+                              result->name, (long long)result->parameter, (unsigned long long)result->iterations, result->samples,
+                              result->medianNs, result->madNs, result->minNs, result->maxNs,
+                              perfCounters::ipc(result->counters),
+                              double(result->counters.cycles) * scale, double(result->counters.instructions) * scale,
+                              double(result->counters.cacheMisses) * scale, double(result->counters.branchMisses) * scale,
+                              double(result->counters.llcLoads) * scale );
+            }
+
+            bool written = std::ferror( file ) == 0;
+            std::fclose( file );
+            return written;
+        }
+
+        int compare( const Array<BenchResult> &results, const char *baselinePath, double threshold, FILE *output )
+        {
+            Array<BaselineEntry> baseline( results._allocator );
+            if( !readBaseline(baselinePath, baseline) ) return -1;
+
+            if( output ) {
+                std::fprintf( output, "\n%-48s %12s %12s %9s\n", "Compared to baseline", "Baseline ns", "Median ns", "Change" );
+            }
+
+            int regressions = 0;
+            for( const BenchResult *result = array::begin(results); result != array::end(results); ++result ) {
+                const BaselineEntry *entry = array::begin( baseline );
+                while( entry != array::end(baseline) && (entry->parameter != result->parameter || std::strcmp(entry->name, result->name) != 0) ) {
+                    ++entry;
+                }
+
+                char name[MAX_NAME_SIZE];
+                if( result->parameter != 0 ) {
+                    std::snprintf( name, MAX_NAME_SIZE, "%s/%lld", result->name, (long long)result->parameter );
+                }
+                else {
+                    std::snprintf( name, MAX_NAME_SIZE, "%s", result->name );
+                }
+
+                if( entry == array::end(baseline) ) {
+                    if( output ) std::fprintf( output, "%-48s %12s %12.2f %9s\n", name, "-", result->medianNs, "new" );
+                    continue;
+                }
+
+                // a change only counts if it is larger than the threshold, and the noise of both runs
+                const double delta = result->medianNs - entry->medianNs;
+                const bool significant = std::fabs(delta) > threshold * entry->medianNs &&
+                                         std::fabs(delta) > result->madNs + entry->madNs;
+                const char *status = "";
+                if( significant && delta > 0.0 ) {
+                    status = "slower";
+                    regressions++;
+                }
+                else if( significant ) {
+                    status = "faster";
+                }
+
+                if( output ) {
+                    const double change = entry->medianNs > 0.0 ? 100.0 * delta / entry->medianNs : 0.0;
+                    std::fprintf( output, "%-48s %12.2f %12.2f %+8.1f%% %s\n", name, entry->medianNs, result->medianNs, change, status );
+                }
+            }
+
+            return regressions;
+        }
+
+        bool parseOptions( int argc, char **argv, BenchOptions &options )
+        {
+            for( int i=1; i < argc; ++i ) {
+                const char *arg = argv[i];
+                const char *value = std::strchr( arg, '=' );
+                value = value ? value+1 : "";
+
+                if( std::strncmp(arg, "--filter=", 9) == 0 ) options.filter = value;
+                else if( std::strncmp(arg, "--samples=", 10) == 0 ) options.samples = uint32_t( std::strtoul(value, nullptr, 10) );
+                else if( std::strncmp(arg, "--sample-ms=", 12) == 0 ) options.sampleMs = std::strtod( value, nullptr );
+                else if( std::strncmp(arg, "--warmup-ms=", 12) == 0 ) options.warmupMs = std::strtod( value, nullptr );
+                else if( std::strcmp(arg, "--counters") == 0 ) options.perfCounters = true;
+                else if( std::strncmp(arg, "--json=", 7) == 0 ) options.jsonPath = value;
+                else if( std::strncmp(arg, "--csv=", 6) == 0 ) options.csvPath = value;
+                else if( std::strncmp(arg, "--baseline=", 11) == 0 ) options.baselinePath = value;
+                else if( std::strncmp(arg, "--threshold=", 12) == 0 ) options.threshold = std::strtod( value, nullptr );
+                else {
+                    printUsage( argv[0] );
+                    return false;
+                }
+            }
+
+            if( options.samples == 0 ) {
+                printUsage( argv[0] );
+                return false;
+            }
+            return true;
+        }
+
+        int main( int argc, char **argv )
+        {
+            BenchOptions options;
+            if( !parseOptions(argc, argv, options) ) return 1;
+
+            Array<BenchResult> results( getDefaultAllocator() );
+            run( options, results );
+
+            if( options.jsonPath && !writeJson(options.jsonPath, results) ) {
+                std::fprintf( stderr, "Couldn't write %s\n", options.jsonPath );
+            }
+            if( options.csvPath && !writeCsv(options.csvPath, results) ) {
+                std::fprintf( stderr, "Couldn't write %s\n", options.csvPath );
+            }
+
+            if( options.baselinePath ) {
+                int regressions = compare( results, options.baselinePath, options.threshold, options.output );
+                if( regressions < 0 ) {
+                    std::fprintf( stderr, "Couldn't read %s\n", options.baselinePath );
+                    return 1;
+                }
+                return regressions > 0 ? 1 : 0;
+            }
+            return 0;
+        }
+    }
+}
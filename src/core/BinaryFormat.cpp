@@ -0,0 +1,274 @@
+#include "core/BinaryFormat.h"
+#include "core/Allocator.h"
+#include "core/Assume.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace Core
+{
+    namespace {
+        static const char MAGIC[4] = { 'C', 'O', 'R', 'E' };
+
+        inline std::size_t alignSize( std::size_t size )
+        {
+            // round up to nearest alignment
+            return ((size + BINARY_SECTION_ALIGNMENT-1) / BINARY_SECTION_ALIGNMENT) * BINARY_SECTION_ALIGNMENT;
+        }
+
+        // the header and section table, padded so the first payload is aligned
+        inline std::size_t headerSize( std::size_t sectionCount )
+        {
+            return alignSize( sizeof(BinaryFileHeader) + sectionCount*sizeof(BinarySection) );
+        }
+
+        // the fixed part of a string table section, followed by capasity entries and the strings
+        struct StringTableHeader {
+            uint32_t count;
+            uint32_t capasity;
+        };
+
+        /* Returns the entries of a string table section
+         * or nullptr if they don't fit in the section, or there isn't a power of two of them for the probing
+         */
+        const BinaryStringEntry* stringEntries( const BinaryReader &reader, const BinarySection *section, uint32_t *capasity )
+        {
+            if( !detail::binaryFits(*section, 0, 1, sizeof(StringTableHeader)) ) return nullptr;
+
+            const uint8_t *data = reader._data + section->offset;
+            *capasity = reinterpret_cast<const StringTableHeader*>(data)->capasity;
+            if( (*capasity & (*capasity - 1)) != 0 ) return nullptr;
+            if( !detail::binaryFits(*section, sizeof(StringTableHeader), *capasity, sizeof(BinaryStringEntry)) ) return nullptr;
+
+            return reinterpret_cast<const BinaryStringEntry*>( data + sizeof(StringTableHeader) );
+        }
+
+        // Returns the string of a used entry, or nullptr if it and its terminator don't fit in the section
+        const char* entryString( const BinaryReader &reader, const BinarySection *section, const BinaryStringEntry &entry )
+        {
+            if( !detail::binaryFits(*section, entry.offset, uint64_t(entry.length) + 1, 1) ) return nullptr;
+
+            const char *string = reinterpret_cast<const char*>( reader._data + section->offset + entry.offset );
+            return string[entry.length] == '\0' ? string : nullptr;
+        }
+    }
+
+    BinaryWriter::BinaryWriter( Allocator *allocator ) :
+        _payload(allocator),
+        _sections(allocator)
+    {
+    }
+
+    namespace binaryWriter
+    {
+        std::size_t appendToSection( BinaryWriter &writer, const void *data, std::size_t size )
+        {
+            std::size_t offset = array::size( writer._payload );
+            if( size == 0 ) return offset;
+
+            std::size_t newSize = offset + size;
+            if( newSize > writer._payload._capasity ) {
+                std::size_t capasity = writer._payload._capasity * 2;
+                array::reserve( writer._payload, capasity > newSize ? capasity : newSize );
+            }
+
+            // a null data pads with zeros
+            if( data ) std::memcpy( writer._payload._data + offset, data, size );
+            else std::memset( writer._payload._data + offset, 0, size );
+
+            writer._payload._size = newSize;
+            return offset;
+        }
+
+        std::size_t appendSection( BinaryWriter &writer, const void *data, std::size_t size )
+        {
+            std::size_t used = array::size( writer._payload );
+            appendToSection( writer, nullptr, alignSize(used) - used );
+            return appendToSection( writer, data, size );
+        }
+
+        void addSection( BinaryWriter &writer, uint32_t id, BinarySectionType type, uint32_t elementSize, uint64_t count, std::size_t offset )
+        {
+            ASSUME_TRUE( offset % BINARY_SECTION_ALIGNMENT == 0 );
+            for( const BinarySection *section = array::begin(writer._sections); section != array::end(writer._sections); ++section ) {
+                ASSUME_TRUE( section->id != id );
+            }
+
+            BinarySection section;
+            section.id = id;
+            section.type = type;
+            section.elementSize = elementSize;
+            section.reserved = 0;
+            section.count = count;
+            // relative to the payload until the file is written
+            section.offset = offset;
+            section.size = array::size(writer._payload) - offset;
+
+            array::pushBack( writer._sections, section );
+        }
+
+        void addStringTable( BinaryWriter &writer, uint32_t id, const StringTable &table )
+        {
+            // keep the slots of the table, so lookups can probe the file directly
+            const std::size_t capasity = array::size( table._entries );
+
+            StringTableHeader header;
+            header.count = uint32_t( table._count );
+            header.capasity = uint32_t( capasity );
+
+            std::size_t start = appendSection( writer, &header, sizeof(header) );
+            std::size_t entriesOffset = appendToSection( writer, nullptr, capasity*sizeof(BinaryStringEntry) );
+
+            for( std::size_t i=0; i < capasity; ++i ) {
+                const StringTable::Entry &entry = table._entries[i];
+                if( !entry.string ) continue;
+
+                std::size_t offset = appendToSection( writer, entry.string, entry.length + 1 );
+
+                BinaryStringEntry stored;
+                stored.hash = entry.hash;
+                stored.length = entry.length;
+                stored.reserved = 0;
+                stored.offset = offset - start;
+                // the payload may have moved, so write through the current pointer
+                std::memcpy( writer._payload._data + entriesOffset + i*sizeof(BinaryStringEntry), &stored, sizeof(stored) );
+            }
+
+            addSection( writer, id, BinarySectionType::StringTable, sizeof(BinaryStringEntry), table._count, start );
+        }
+
+        std::size_t size( const BinaryWriter &writer )
+        {
+            return headerSize( array::size(writer._sections) ) + array::size( writer._payload );
+        }
+
+        void write( const BinaryWriter &writer, void *data )
+        {
+            uint8_t *output = static_cast<uint8_t*>( data );
+            const std::size_t sectionCount = array::size( writer._sections );
+            const std::size_t payloadOffset = headerSize( sectionCount );
+
+            std::memset( output, 0, payloadOffset );
+
+            BinaryFileHeader header;
+            std::memcpy( header.magic, MAGIC, sizeof(MAGIC) );
+            header.version = BINARY_FORMAT_VERSION;
+            header.sectionCount = uint32_t( sectionCount );
+            header.reserved = 0;
+            std::memcpy( output, &header, sizeof(header) );
+
+            BinarySection *sections = reinterpret_cast<BinarySection*>( output + sizeof(header) );
+            for( std::size_t i=0; i < sectionCount; ++i ) {
+                BinarySection section = writer._sections[i];
+                section.offset += payloadOffset;
+                std::memcpy( sections + i, &section, sizeof(section) );
+            }
+
+            if( array::size(writer._payload) > 0 ) {
+                std::memcpy( output + payloadOffset, writer._payload._data, array::size(writer._payload) );
+            }
+        }
+
+        bool writeFile( const BinaryWriter &writer, const char *path )
+        {
+            Allocator *allocator = writer._payload._allocator;
+            const std::size_t fileSize = size( writer );
+
+            void *data = allocator->allocate( fileSize, BINARY_SECTION_ALIGNMENT );
+            write( writer, data );
+
+            bool result = false;
+            if( std::FILE *file = std::fopen(path, "wb") ) {
+                result = std::fwrite( data, 1, fileSize, file ) == fileSize;
+                result = std::fclose( file ) == 0 && result;
+            }
+
+            allocator->free( data );
+            return result;
+        }
+    }
+
+    namespace binaryReader
+    {
+        bool open( BinaryReader &reader, const void *data, std::size_t size )
+        {
+            ASSUME_TRUE( reinterpret_cast<std::uintptr_t>(data) % BINARY_SECTION_ALIGNMENT == 0 );
+            reader = BinaryReader();
+
+            if( size < sizeof(BinaryFileHeader) ) return false;
+
+            const BinaryFileHeader *header = static_cast<const BinaryFileHeader*>( data );
+            if( std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 ) return false;
+            if( header->version != BINARY_FORMAT_VERSION ) return false;
+            if( headerSize(header->sectionCount) > size ) return false;
+
+            const BinarySection *sections = reinterpret_cast<const BinarySection*>( header + 1 );
+            for( uint32_t i=0; i < header->sectionCount; ++i ) {
+                if( sections[i].offset % BINARY_SECTION_ALIGNMENT != 0 ) return false;
+                if( sections[i].offset > size || sections[i].size > size - sections[i].offset ) return false;
+            }
+
+            reader._data = static_cast<const uint8_t*>( data );
+            reader._size = size;
+            reader._header = header;
+            reader._sections = sections;
+            return true;
+        }
+
+        const BinarySection* findSection( const BinaryReader &reader, uint32_t id )
+        {
+            if( !reader._header ) return nullptr;
+
+            // files have few sections, so a linear search is fine
+            for( uint32_t i=0; i < reader._header->sectionCount; ++i ) {
+                if( reader._sections[i].id == id ) {
+                    return reader._sections + i;
+                }
+            }
+            return nullptr;
+        }
+
+        const char* lookupString( const BinaryReader &reader, uint32_t id, StringId string )
+        {
+            const BinarySection *section = findSection( reader, id );
+            if( !section || section->type != BinarySectionType::StringTable ) return nullptr;
+
+            uint32_t capasity = 0;
+            const BinaryStringEntry *entries = stringEntries( reader, section, &capasity );
+            if( !entries || capasity == 0 ) return nullptr;
+
+            // same probing as the StringTable the section was written from, bounded in case no slot is empty
+            const std::size_t mask = capasity - 1;
+            std::size_t slot = string.value & mask;
+            for( uint32_t i=0; i < capasity && entries[slot].offset != 0; ++i ) {
+                if( entries[slot].hash == string.value ) {
+                    return entryString( reader, section, entries[slot] );
+                }
+                slot = (slot + 1) & mask;
+            }
+            return nullptr;
+        }
+
+        bool loadStringTable( const BinaryReader &reader, uint32_t id, StringTable &table )
+        {
+            const BinarySection *section = findSection( reader, id );
+            if( !section || section->type != BinarySectionType::StringTable ) return false;
+
+            uint32_t capasity = 0;
+            const BinaryStringEntry *entries = stringEntries( reader, section, &capasity );
+            if( !entries ) return false;
+
+            for( uint32_t i=0; i < capasity; ++i ) {
+                if( entries[i].offset != 0 && !entryString(reader, section, entries[i]) ) return false;
+            }
+            // the strings come from a file, so a collision is a error and not a failed assumption
+            for( uint32_t i=0; i < capasity; ++i ) {
+                if( entries[i].offset == 0 ) continue;
+
+                StringId interned;
+                if( !stringTable::tryIntern(table, entryString(reader, section, entries[i]), entries[i].length, interned) ) return false;
+            }
+            return true;
+        }
+    }
+}
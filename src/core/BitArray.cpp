@@ -0,0 +1,276 @@
+#include "core/BitArray.h"
+#include "core/Allocator.h"
+
+#include <cstring>
+#include <utility>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#   define CORE_BITARRAY_X86 1
+#   include <immintrin.h>
+#endif
+
+namespace Core
+{
+    namespace {
+        typedef void (*BinaryFunction)( uint64_t *dest, const uint64_t *src, std::size_t count );
+        typedef std::size_t (*PopcountFunction)( const uint64_t *words, std::size_t count );
+
+        void andScalar( uint64_t *dest, const uint64_t *src, std::size_t count ) {
+            for( std::size_t i=0; i < count; ++i ) dest[i] &= src[i];
+        }
+        void orScalar( uint64_t *dest, const uint64_t *src, std::size_t count ) {
+            for( std::size_t i=0; i < count; ++i ) dest[i] |= src[i];
+        }
+        void xorScalar( uint64_t *dest, const uint64_t *src, std::size_t count ) {
+            for( std::size_t i=0; i < count; ++i ) dest[i] ^= src[i];
+        }
+        void andNotScalar( uint64_t *dest, const uint64_t *src, std::size_t count ) {
+            for( std::size_t i=0; i < count; ++i ) dest[i] &= ~src[i];
+        }
+        std::size_t popcountScalar( const uint64_t *words, std::size_t count ) {
+            std::size_t result = 0;
+            for( std::size_t i=0; i < count; ++i ) result += __builtin_popcountll( words[i] );
+            return result;
+        }
+
+#ifdef CORE_BITARRAY_X86
+        // generates a avx2 loop over 4 words at a time, and a scalar loop for the rest
+#       define CORE_BITARRAY_AVX2_FUNCTION( name, vectorOp, scalarOp )                          \
+        __attribute__((target("avx2")))                                                         \
+        void name( uint64_t *dest, const uint64_t *src, std::size_t count ) {                   \
+            std::size_t i = 0;                                                                  \
+            for( ; i+4 <= count; i += 4 ) {                                                     \
+                __m256i a = _mm256_loadu_si256( reinterpret_cast<const __m256i*>(dest+i) );     \
+                __m256i b = _mm256_loadu_si256( reinterpret_cast<const __m256i*>(src+i) );      \
+                _mm256_storeu_si256( reinterpret_cast<__m256i*>(dest+i), vectorOp );            \
+            }                                                                                   \
+            for( ; i < count; ++i ) dest[i] = scalarOp;                                         \
+        }
+
+        CORE_BITARRAY_AVX2_FUNCTION( andAvx2, _mm256_and_si256(a,b), dest[i] & src[i] )
+        CORE_BITARRAY_AVX2_FUNCTION( orAvx2, _mm256_or_si256(a,b), dest[i] | src[i] )
+        CORE_BITARRAY_AVX2_FUNCTION( xorAvx2, _mm256_xor_si256(a,b), dest[i] ^ src[i] )
+        CORE_BITARRAY_AVX2_FUNCTION( andNotAvx2, _mm256_andnot_si256(b,a), dest[i] & ~src[i] )
+
+#       undef CORE_BITARRAY_AVX2_FUNCTION
+
+        __attribute__((target("popcnt")))
+        std::size_t popcountHardware( const uint64_t *words, std::size_t count ) {
+            std::size_t result = 0;
+            for( std::size_t i=0; i < count; ++i ) result += __builtin_popcountll( words[i] );
+            return result;
+        }
+
+        // counts the bits of each nibble with a lookup table in a shuffle,
+        // and sums up the bytes with sad
+        __attribute__((target("avx2,popcnt")))
+        std::size_t popcountAvx2( const uint64_t *words, std::size_t count ) {
+            const __m256i lookup = _mm256_setr_epi8( 0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4,
+                                                     0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4 );
+            const __m256i lowMask = _mm256_set1_epi8( 0x0f );
+
+            __m256i total = _mm256_setzero_si256();
+            std::size_t i = 0;
+            for( ; i+4 <= count; i += 4 ) {
+                __m256i value = _mm256_loadu_si256( reinterpret_cast<const __m256i*>(words+i) );
+                __m256i low = _mm256_and_si256( value, lowMask );
+                __m256i high = _mm256_and_si256( _mm256_srli_epi16(value, 4), lowMask );
+                __m256i bits = _mm256_add_epi8( _mm256_shuffle_epi8(lookup, low), _mm256_shuffle_epi8(lookup, high) );
+                total = _mm256_add_epi64( total, _mm256_sad_epu8(bits, _mm256_setzero_si256()) );
+            }
+
+            std::size_t result = _mm256_extract_epi64( total, 0 ) + _mm256_extract_epi64( total, 1 ) +
+                                 _mm256_extract_epi64( total, 2 ) + _mm256_extract_epi64( total, 3 );
+            for( ; i < count; ++i ) result += __builtin_popcountll( words[i] );
+            return result;
+        }
+#endif
+
+        struct BitFunctions {
+            BinaryFunction andFunction = andScalar,
+                           orFunction = orScalar,
+                           xorFunction = xorScalar,
+                           andNotFunction = andNotScalar;
+            PopcountFunction popcountFunction = popcountScalar;
+
+            BitFunctions() {
+#ifdef CORE_BITARRAY_X86
+                __builtin_cpu_init();
+                if( __builtin_cpu_supports("popcnt") ) {
+                    popcountFunction = popcountHardware;
+                }
+                if( __builtin_cpu_supports("avx2") ) {
+                    andFunction = andAvx2;
+                    orFunction = orAvx2;
+                    xorFunction = xorAvx2;
+                    andNotFunction = andNotAvx2;
+                    if( __builtin_cpu_supports("popcnt") ) {
+                        popcountFunction = popcountAvx2;
+                    }
+                }
+#endif
+            }
+        };
+
+        const BitFunctions& bitFunctions()
+        {
+            static const BitFunctions functions;
+            return functions;
+        }
+
+        inline std::size_t wordsForBits( std::size_t bits )
+        {
+            return (bits + BitArray::WORD_BITS-1) / BitArray::WORD_BITS;
+        }
+
+        // clears the bits past the size in the last word
+        void clearTail( BitArray &array )
+        {
+            std::size_t used = array._size % BitArray::WORD_BITS;
+            if( used ) {
+                array._words[array._size / BitArray::WORD_BITS] &= (uint64_t(1) << used) - 1;
+            }
+        }
+    }
+
+    BitArray::BitArray( const BitArray &copy )
+    {
+        *this = copy;
+    }
+
+    BitArray::BitArray( BitArray &&move )
+    {
+        *this = std::move( move );
+    }
+
+    BitArray::BitArray( Allocator *allocator ) :
+        _allocator(allocator)
+    {
+    }
+
+    BitArray::~BitArray()
+    {
+        if( _allocator && _words ) {
+            _allocator->free( _words );
+        }
+    }
+
+    BitArray& BitArray::operator = ( const BitArray &copy )
+    {
+        ASSUME_TRUE( copy._allocator != nullptr );
+
+        if( this == &copy ) return *this;
+        if( _allocator && _words ) {
+            _allocator->free( _words );
+        }
+
+        _allocator = copy._allocator;
+        _size = copy._size;
+        _capasity = wordsForBits( _size );
+
+        _words = static_cast<uint64_t*>( _allocator->allocate(_capasity*sizeof(uint64_t), WORD_ALIGNMENT) );
+        std::memcpy( _words, copy._words, _capasity*sizeof(uint64_t) );
+
+        return *this;
+    }
+
+    BitArray& BitArray::operator = ( BitArray &&move )
+    {
+        if( this == &move ) return *this;
+        if( _allocator && _words ) {
+            _allocator->free( _words );
+        }
+
+        _allocator = move._allocator;
+        _words = move._words;
+        _size = move._size;
+        _capasity = move._capasity;
+
+        move._allocator = nullptr;
+        move._words = nullptr;
+        move._size = 0;
+        move._capasity = 0;
+
+        return *this;
+    }
+
+    namespace bitArray
+    {
+        void reserve( BitArray &array, std::size_t size )
+        {
+            ASSUME_TRUE( array._allocator != nullptr );
+
+            std::size_t capasity = wordsForBits( size );
+            if( capasity <= array._capasity ) return;
+
+            uint64_t *newWords = static_cast<uint64_t*>( array._allocator->allocate(capasity*sizeof(uint64_t), BitArray::WORD_ALIGNMENT) );
+
+            std::size_t used = wordCount( array );
+            if( used ) {
+                std::memcpy( newWords, array._words, used*sizeof(uint64_t) );
+            }
+            std::memset( newWords+used, 0, (capasity-used)*sizeof(uint64_t) );
+
+            array._allocator->free( array._words );
+            array._words = newWords;
+            array._capasity = capasity;
+        }
+
+        void resize( BitArray &array, std::size_t size )
+        {
+            reserve( array, size );
+
+            if( size < array._size ) {
+                // keep the invariant that bits past the size are cleared
+                std::size_t used = wordCount( array );
+                array._size = size;
+                std::size_t newUsed = wordCount( array );
+                std::memset( array._words+newUsed, 0, (used-newUsed)*sizeof(uint64_t) );
+                clearTail( array );
+            }
+            else {
+                array._size = size;
+            }
+        }
+
+        void setAll( BitArray &array )
+        {
+            std::memset( array._words, 0xff, wordCount(array)*sizeof(uint64_t) );
+            clearTail( array );
+        }
+
+        void clearAll( BitArray &array )
+        {
+            std::memset( array._words, 0, wordCount(array)*sizeof(uint64_t) );
+        }
+
+        std::size_t popcount( const BitArray &array )
+        {
+            return bitFunctions().popcountFunction( array._words, wordCount(array) );
+        }
+
+        void andAssign( BitArray &dest, const BitArray &src )
+        {
+            ASSUME_TRUE( dest._size == src._size );
+            bitFunctions().andFunction( dest._words, src._words, wordCount(dest) );
+        }
+
+        void orAssign( BitArray &dest, const BitArray &src )
+        {
+            ASSUME_TRUE( dest._size == src._size );
+            bitFunctions().orFunction( dest._words, src._words, wordCount(dest) );
+        }
+
+        void xorAssign( BitArray &dest, const BitArray &src )
+        {
+            ASSUME_TRUE( dest._size == src._size );
+            bitFunctions().xorFunction( dest._words, src._words, wordCount(dest) );
+        }
+
+        void andNotAssign( BitArray &dest, const BitArray &src )
+        {
+            ASSUME_TRUE( dest._size == src._size );
+            bitFunctions().andNotFunction( dest._words, src._words, wordCount(dest) );
+        }
+    }
+}
@@ -0,0 +1,278 @@
+#include "core/Epoch.h"
+#include "core/Allocator.h"
+#include "core/Array.h"
+#include "core/Assume.h"
+
+#include <atomic>
+#include <mutex>
+#include <new>
+
+namespace Core
+{
+    namespace {
+        // retired pointers are sorted by epoch modulo this
+        static const std::size_t EPOCH_BUCKETS = 3;
+        // retires between each automatic collect
+        static const std::size_t COLLECT_INTERVAL = 64;
+
+        struct Retired {
+            void *ptr;
+            ReclaimFunction function;
+            void *data;
+        };
+
+        struct Orphan {
+            uint64_t epoch;
+            Retired retired;
+        };
+
+        void freeToAllocator( void *ptr, void *data )
+        {
+            static_cast<Allocator*>( data )->free( ptr );
+        }
+    }
+
+    struct alignas(CACHE_LINE_SIZE) EpochThread {
+        EpochManager *manager;
+        std::atomic<bool> used;
+        // the pinned epoch shifted up by one, with the lowest bit set while pinned
+        std::atomic<uint64_t> state;
+        uint32_t pinDepth;
+
+        Array<Retired> retired[EPOCH_BUCKETS];
+        uint64_t retiredEpoch[EPOCH_BUCKETS];
+        std::size_t sinceCollect;
+    };
+
+    struct EpochManager {
+        Allocator *allocator;
+        EpochThread *threads;
+        std::size_t maxThreads;
+
+        alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> epoch;
+        std::atomic<std::size_t> retiredCount;
+
+        // retired by threads that have unregistered
+        std::mutex orphanLock;
+        Array<Orphan> orphans;
+    };
+
+    namespace {
+        std::size_t reclaim( Array<Retired> &retired )
+        {
+            const std::size_t count = array::size( retired );
+            for( Retired *entry = array::begin(retired); entry != array::end(retired); ++entry ) {
+                entry->function( entry->ptr, entry->data );
+            }
+            retired._size = 0;
+            return count;
+        }
+
+        /* The epoch can advance once every pinned thread has pinned the current one
+         * The fence pairs with the one in pin, so a thread that pinned the old epoch is either seen here,
+         * or sees the unlinks that happened before the retires
+         */
+        void tryAdvance( EpochManager *manager )
+        {
+            uint64_t epoch = manager->epoch.load( std::memory_order_relaxed );
+            std::atomic_thread_fence( std::memory_order_seq_cst );
+
+            for( std::size_t i=0; i < manager->maxThreads; ++i ) {
+                EpochThread &thread = manager->threads[i];
+                if( !thread.used.load(std::memory_order_relaxed) ) continue;
+
+                uint64_t state = thread.state.load( std::memory_order_relaxed );
+                if( (state & 1) && (state >> 1) != epoch ) return;
+            }
+
+            std::atomic_thread_fence( std::memory_order_acquire );
+            manager->epoch.compare_exchange_strong( epoch, epoch+1, std::memory_order_release, std::memory_order_relaxed );
+        }
+
+        std::size_t collectOrphans( EpochManager *manager, uint64_t epoch )
+        {
+            std::unique_lock<std::mutex> lock( manager->orphanLock, std::try_to_lock );
+            if( !lock.owns_lock() ) return 0;
+
+            std::size_t count = 0;
+            for( std::size_t i=0; i < array::size(manager->orphans); ) {
+                Orphan &orphan = manager->orphans[i];
+                if( orphan.epoch + 2 > epoch ) {
+                    ++i;
+                    continue;
+                }
+                orphan.retired.function( orphan.retired.ptr, orphan.retired.data );
+                orphan = manager->orphans[array::size(manager->orphans)-1];
+                array::popBack( manager->orphans );
+                count++;
+            }
+            return count;
+        }
+    }
+
+    EpochManager* createEpochManager( Allocator *allocator, std::size_t maxThreads )
+    {
+        ASSUME_TRUE( allocator != nullptr );
+        ASSUME_TRUE( maxThreads > 0 );
+
+        void *memory = allocator->allocate( sizeof(EpochManager), alignof(EpochManager) );
+        EpochManager *manager = new (memory) EpochManager;
+        manager->allocator = allocator;
+        manager->maxThreads = maxThreads;
+        manager->epoch.store( 0, std::memory_order_relaxed );
+        manager->retiredCount.store( 0, std::memory_order_relaxed );
+        manager->orphans._allocator = allocator;
+
+        manager->threads = static_cast<EpochThread*>( allocator->allocate(maxThreads*sizeof(EpochThread), alignof(EpochThread)) );
+        for( std::size_t i=0; i < maxThreads; ++i ) {
+            EpochThread *thread = new (manager->threads + i) EpochThread;
+            thread->manager = manager;
+            thread->used.store( false, std::memory_order_relaxed );
+            thread->state.store( 0, std::memory_order_relaxed );
+            thread->pinDepth = 0;
+            for( std::size_t b=0; b < EPOCH_BUCKETS; ++b ) {
+                thread->retired[b]._allocator = allocator;
+                thread->retiredEpoch[b] = 0;
+            }
+            thread->sinceCollect = 0;
+        }
+
+        return manager;
+    }
+
+    void destroyEpochManager( EpochManager *manager )
+    {
+        Allocator *allocator = manager->allocator;
+
+        for( std::size_t i=0; i < manager->maxThreads; ++i ) {
+            EpochThread *thread = manager->threads + i;
+            ASSUME_TRUE( !(thread->state.load() & 1) );
+
+            for( std::size_t b=0; b < EPOCH_BUCKETS; ++b ) {
+                reclaim( thread->retired[b] );
+            }
+            thread->~EpochThread();
+        }
+        allocator->free( manager->threads );
+
+        for( Orphan *orphan = array::begin(manager->orphans); orphan != array::end(manager->orphans); ++orphan ) {
+            orphan->retired.function( orphan->retired.ptr, orphan->retired.data );
+        }
+
+        manager->~EpochManager();
+        allocator->free( manager );
+    }
+
+    namespace epoch
+    {
+        EpochThread* registerThread( EpochManager *manager )
+        {
+            for( std::size_t i=0; i < manager->maxThreads; ++i ) {
+                EpochThread *thread = manager->threads + i;
+                bool used = false;
+                if( !thread->used.load(std::memory_order_relaxed) &&
+                    thread->used.compare_exchange_strong(used, true, std::memory_order_acquire) )
+                {
+                    thread->state.store( 0, std::memory_order_relaxed );
+                    thread->pinDepth = 0;
+                    thread->sinceCollect = 0;
+                    return thread;
+                }
+            }
+            return nullptr;
+        }
+
+        void unregisterThread( EpochThread *thread )
+        {
+            ASSUME_TRUE( thread->pinDepth == 0 );
+
+            EpochManager *manager = thread->manager;
+            {
+                std::lock_guard<std::mutex> lock( manager->orphanLock );
+                for( std::size_t b=0; b < EPOCH_BUCKETS; ++b ) {
+                    Array<Retired> &retired = thread->retired[b];
+                    for( Retired *entry = array::begin(retired); entry != array::end(retired); ++entry ) {
+                        Orphan orphan = { thread->retiredEpoch[b], *entry };
+                        array::pushBack( manager->orphans, orphan );
+                    }
+                    retired._size = 0;
+                }
+            }
+
+            thread->used.store( false, std::memory_order_release );
+        }
+
+        void pin( EpochThread *thread )
+        {
+            if( thread->pinDepth++ > 0 ) return;
+
+            uint64_t epoch = thread->manager->epoch.load( std::memory_order_relaxed );
+            thread->state.store( (epoch << 1) | 1, std::memory_order_relaxed );
+            std::atomic_thread_fence( std::memory_order_seq_cst );
+        }
+
+        void unpin( EpochThread *thread )
+        {
+            ASSUME_TRUE( thread->pinDepth > 0 );
+            if( --thread->pinDepth > 0 ) return;
+
+            thread->state.store( 0, std::memory_order_release );
+        }
+
+        void retire( EpochThread *thread, void *ptr, Allocator *allocator )
+        {
+            retire( thread, ptr, freeToAllocator, allocator );
+        }
+
+        void retire( EpochThread *thread, void *ptr, ReclaimFunction function, void *data )
+        {
+            EpochManager *manager = thread->manager;
+            uint64_t epoch = manager->epoch.load( std::memory_order_acquire );
+
+            // the bucket was last used at least three epochs ago, so it's safe to empty
+            std::size_t bucket = epoch % EPOCH_BUCKETS;
+            if( thread->retiredEpoch[bucket] != epoch ) {
+                manager->retiredCount.fetch_sub( reclaim(thread->retired[bucket]), std::memory_order_relaxed );
+                thread->retiredEpoch[bucket] = epoch;
+            }
+
+            Retired retired = { ptr, function, data };
+            array::pushBack( thread->retired[bucket], retired );
+            manager->retiredCount.fetch_add( 1, std::memory_order_relaxed );
+
+            if( ++thread->sinceCollect >= COLLECT_INTERVAL ) {
+                collect( thread );
+            }
+        }
+
+        std::size_t collect( EpochThread *thread )
+        {
+            EpochManager *manager = thread->manager;
+            thread->sinceCollect = 0;
+
+            tryAdvance( manager );
+            uint64_t epoch = manager->epoch.load( std::memory_order_acquire );
+
+            std::size_t count = 0;
+            for( std::size_t b=0; b < EPOCH_BUCKETS; ++b ) {
+                if( thread->retiredEpoch[b] + 2 <= epoch ) {
+                    count += reclaim( thread->retired[b] );
+                }
+            }
+            count += collectOrphans( manager, epoch );
+
+            manager->retiredCount.fetch_sub( count, std::memory_order_relaxed );
+            return count;
+        }
+
+        uint64_t currentEpoch( const EpochManager *manager )
+        {
+            return manager->epoch.load( std::memory_order_relaxed );
+        }
+
+        std::size_t retiredCount( const EpochManager *manager )
+        {
+            return manager->retiredCount.load( std::memory_order_relaxed );
+        }
+    }
+}
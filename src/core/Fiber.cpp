@@ -0,0 +1,303 @@
+#include "core/Fiber.h"
+#include "core/Allocator.h"
+#include "core/Array.h"
+#include "core/Assume.h"
+
+#include <cstdint>
+#include <mutex>
+#include <new>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) && defined(__linux__) && !defined(CORE_FIBER_UCONTEXT)
+#   define CORE_FIBER_X86_64 1
+#else
+#   include <ucontext.h>
+#endif
+
+#ifdef CORE_FIBER_X86_64
+/* Saves the callee saved registers, the sse control word and the x87 control word on the stack,
+ * stores the stack pointer in *from, and restores the same from the stack at to
+ * Everything else is caller saved in the System V abi, so the compiler has already saved it
+ */
+asm(
+    ".text\n"
+    ".globl core_fiber_switch\n"
+    ".type core_fiber_switch,@function\n"
+    "core_fiber_switch:\n"
+    "    pushq %rbp\n"
+    "    pushq %rbx\n"
+    "    pushq %r12\n"
+    "    pushq %r13\n"
+    "    pushq %r14\n"
+    "    pushq %r15\n"
+    "    subq $16, %rsp\n"
+    "    stmxcsr 8(%rsp)\n"
+    "    fnstcw (%rsp)\n"
+    "    movq %rsp, (%rdi)\n"
+    "    movq %rsi, %rsp\n"
+    "    ldmxcsr 8(%rsp)\n"
+    "    fldcw (%rsp)\n"
+    "    addq $16, %rsp\n"
+    "    popq %r15\n"
+    "    popq %r14\n"
+    "    popq %r13\n"
+    "    popq %r12\n"
+    "    popq %rbx\n"
+    "    popq %rbp\n"
+    "    ret\n"
+    ".size core_fiber_switch,.-core_fiber_switch\n"
+
+    // the first switch to a new fiber returns here, with the fiber in r12 and the entry function in r13
+    ".globl core_fiber_start\n"
+    ".type core_fiber_start,@function\n"
+    "core_fiber_start:\n"
+    "    movq %r12, %rdi\n"
+    "    callq *%r13\n"
+    "    ud2\n"
+    ".size core_fiber_start,.-core_fiber_start\n"
+);
+
+extern "C" void core_fiber_switch( void **from, void *to );
+extern "C" void core_fiber_start();
+#endif
+
+namespace Core
+{
+    struct Fiber {
+        Allocator *allocator;
+        Allocator *stacks;
+        void *stack;
+        std::size_t stackSize;
+
+        FiberFunction function;
+        void *data;
+
+#ifdef CORE_FIBER_X86_64
+        void *stackPointer;
+#else
+        ucontext_t context;
+#endif
+    };
+
+    namespace {
+        static const std::size_t STACKS_PER_CHUNK = 16;
+
+        inline std::size_t pageSize()
+        {
+            static const std::size_t size = std::size_t( sysconf(_SC_PAGESIZE) );
+            return size;
+        }
+
+        class GuardedStackAllocator :
+            public Allocator
+        {
+        public:
+            GuardedStackAllocator( Allocator *backer, std::size_t stackSize ) :
+                mBacker(backer),
+                mStackSize(((stackSize + pageSize()-1) / pageSize()) * pageSize()),
+                mFree(nullptr),
+                mChunks(backer)
+            {
+            }
+
+            virtual ~GuardedStackAllocator()
+            {
+                const std::size_t chunkSize = (pageSize() + mStackSize) * STACKS_PER_CHUNK;
+                for( void **chunk = array::begin(mChunks); chunk != array::end(mChunks); ++chunk ) {
+                    munmap( *chunk, chunkSize );
+                }
+            }
+
+            Allocator* backer() const
+            {
+                return mBacker;
+            }
+
+            virtual void* allocate( std::size_t size, std::size_t alignment )
+            {
+                ASSUME_TRUE( size <= mStackSize );
+                ASSUME_TRUE( alignment <= pageSize() );
+
+                std::lock_guard<std::mutex> lock( mLock );
+                if( !mFree && !grow() ) return nullptr;
+
+                FreeStack *stack = mFree;
+                mFree = stack->next;
+                return stack;
+            }
+
+            virtual void free( void *ptr )
+            {
+                if( !ptr ) return;
+
+                std::lock_guard<std::mutex> lock( mLock );
+                FreeStack *stack = static_cast<FreeStack*>( ptr );
+                stack->next = mFree;
+                mFree = stack;
+            }
+
+        private:
+            // stored at the bottom of free stacks
+            struct FreeStack {
+                FreeStack *next;
+            };
+
+            // maps STACKS_PER_CHUNK stacks, each with its guard page below it
+            bool grow()
+            {
+                const std::size_t stride = pageSize() + mStackSize;
+                void *chunk = mmap( nullptr, stride*STACKS_PER_CHUNK, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0 );
+                if( chunk == MAP_FAILED ) return false;
+
+                array::pushBack( mChunks, chunk );
+
+                uint8_t *base = static_cast<uint8_t*>( chunk );
+                for( std::size_t i=0; i < STACKS_PER_CHUNK; ++i ) {
+                    uint8_t *guard = base + i*stride;
+                    mprotect( guard, pageSize(), PROT_NONE );
+
+                    FreeStack *stack = reinterpret_cast<FreeStack*>( guard + pageSize() );
+                    stack->next = mFree;
+                    mFree = stack;
+                }
+                return true;
+            }
+
+            Allocator *mBacker;
+            std::size_t mStackSize;
+
+            std::mutex mLock;
+            FreeStack *mFree;
+            Array<void*> mChunks;
+        };
+
+#ifdef CORE_FIBER_X86_64
+        void fiberEntry( Fiber *fiber )
+        {
+            fiber->function( fiber->data );
+            ASSUME_TRUE( false && "A fiber function returned" );
+        }
+
+        void initContext( Fiber *fiber )
+        {
+            // the stack grows down, the start must leave the stack 16 byte aligned after core_fiber_start's call
+            uintptr_t top = (reinterpret_cast<uintptr_t>(fiber->stack) + fiber->stackSize) & ~uintptr_t(15);
+            uint64_t *stack = reinterpret_cast<uint64_t*>( top - 16 );
+
+            *--stack = reinterpret_cast<uint64_t>( core_fiber_start );
+            *--stack = 0; // rbp
+            *--stack = 0; // rbx
+            *--stack = reinterpret_cast<uint64_t>( fiber ); // r12
+            *--stack = reinterpret_cast<uint64_t>( fiberEntry ); // r13
+            *--stack = 0; // r14
+            *--stack = 0; // r15
+            *--stack = 0x1f80; // default mxcsr
+            *--stack = 0x037f; // default x87 control word
+
+            fiber->stackPointer = stack;
+        }
+#else
+        // makecontext only passes int arguments, so the pointer is split in two
+        void fiberEntry( unsigned high, unsigned low )
+        {
+            Fiber *fiber = reinterpret_cast<Fiber*>( (uintptr_t(high) << 32) | uintptr_t(low) );
+            fiber->function( fiber->data );
+            ASSUME_TRUE( false && "A fiber function returned" );
+        }
+
+        void initContext( Fiber *fiber )
+        {
+            getcontext( &fiber->context );
+            fiber->context.uc_stack.ss_sp = fiber->stack;
+            fiber->context.uc_stack.ss_size = fiber->stackSize;
+            fiber->context.uc_link = nullptr;
+
+            uint64_t pointer = reinterpret_cast<uintptr_t>( fiber );
+            makecontext( &fiber->context, reinterpret_cast<void(*)()>(fiberEntry), 2, unsigned(pointer >> 32), unsigned(pointer) );
+        }
+#endif
+
+        Fiber* allocateFiber( Allocator *allocator )
+        {
+            void *memory = allocator->allocate( sizeof(Fiber), alignof(Fiber) );
+            Fiber *fiber = new (memory) Fiber;
+            fiber->allocator = allocator;
+            fiber->stacks = nullptr;
+            fiber->stack = nullptr;
+            fiber->stackSize = 0;
+            fiber->function = nullptr;
+            fiber->data = nullptr;
+            return fiber;
+        }
+    }
+
+    Allocator* createGuardedStackAllocator( std::size_t stackSize, Allocator *backer )
+    {
+        if( !backer ) backer = getDefaultAllocator();
+
+        void *memory = backer->allocate( sizeof(GuardedStackAllocator), alignof(GuardedStackAllocator) );
+        return new (memory) GuardedStackAllocator( backer, stackSize );
+    }
+
+    void destroyGuardedStackAllocator( Allocator *allocator )
+    {
+        GuardedStackAllocator *stacks = static_cast<GuardedStackAllocator*>( allocator );
+        Allocator *backer = stacks->backer();
+
+        stacks->~GuardedStackAllocator();
+        backer->free( stacks );
+    }
+
+    Fiber* createFiber( Allocator *allocator, Allocator *stacks, std::size_t stackSize, FiberFunction function, void *data )
+    {
+        ASSUME_TRUE( function != nullptr );
+
+        void *stack = stacks->allocate( stackSize, 16 );
+        if( !stack ) return nullptr;
+
+        Fiber *fiber = allocateFiber( allocator );
+        fiber->stacks = stacks;
+        fiber->stack = stack;
+        fiber->stackSize = stackSize;
+
+        resetFiber( fiber, function, data );
+        return fiber;
+    }
+
+    Fiber* createThreadFiber( Allocator *allocator )
+    {
+        // the context is filled in by the first switch away from the thread
+        return allocateFiber( allocator );
+    }
+
+    void resetFiber( Fiber *fiber, FiberFunction function, void *data )
+    {
+        ASSUME_TRUE( fiber->stack != nullptr );
+
+        fiber->function = function;
+        fiber->data = data;
+        initContext( fiber );
+    }
+
+    void destroyFiber( Fiber *fiber )
+    {
+        if( fiber->stacks ) {
+            fiber->stacks->free( fiber->stack );
+        }
+
+        Allocator *allocator = fiber->allocator;
+        fiber->~Fiber();
+        allocator->free( fiber );
+    }
+
+    void switchFiber( Fiber *from, Fiber *to )
+    {
+#ifdef CORE_FIBER_X86_64
+        core_fiber_switch( &from->stackPointer, to->stackPointer );
+#else
+        swapcontext( &from->context, &to->context );
+#endif
+    }
+}
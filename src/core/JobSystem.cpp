@@ -0,0 +1,741 @@
+#include "core/JobSystem.h"
+#include "core/Allocator.h"
+#include "core/Array.h"
+#include "core/Fiber.h"
+#include "core/Queue.h"
+#include "core/Assume.h"
+
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <thread>
+
+namespace Core
+{
+    struct alignas(CACHE_LINE_SIZE) Job {
+        JobFunction function;
+        JobCounter *counter;
+        // 1 until the job is run, plus one for each unfinished dependency
+        std::atomic<int32_t> pending;
+        uint16_t dependentCount;
+        // the worker whose pool the record came from, or EXTERNAL_POOL
+        uint16_t pool;
+        Job *dependents[JOB_MAX_DEPENDENTS];
+        alignas(8) uint8_t data[JOB_DATA_SIZE];
+    };
+    static_assert( sizeof(Job) == 2*CACHE_LINE_SIZE, "Jobs should fill two cache lines!" );
+
+    namespace {
+        static const std::size_t DEQUE_CAPASITY = 4096;
+        static const std::size_t INJECTED_CAPASITY = 4096;
+        static const std::size_t POOL_CHUNK_JOBS = 64;
+        static const uint16_t EXTERNAL_POOL = 0xFFFF;
+        // times a idle worker looks for jobs before it sleeps
+        static const int IDLE_SPINS = 64;
+        static const std::size_t FIBER_STACK_SIZE = JOB_STACK_SIZE;
+
+        /* Chase-Lev work stealing deque, with the memory orders from
+         * "Correct and Efficient Work-Stealing for Weak Memory Models" ( Lê et al. 2013 )
+         * The owner pushes and pops at the bottom, other workers steal from the top
+         */
+        class JobDeque {
+        public:
+            JobDeque() :
+                mTop(0),
+                mBottom(0)
+            {
+                for( std::size_t i=0; i < DEQUE_CAPASITY; ++i ) {
+                    mJobs[i].store( nullptr, std::memory_order_relaxed );
+                }
+            }
+
+            // Returns false if the deque is full
+            bool push( Job *job )
+            {
+                int64_t bottom = mBottom.load( std::memory_order_relaxed );
+                int64_t top = mTop.load( std::memory_order_acquire );
+                if( bottom - top >= int64_t(DEQUE_CAPASITY) ) return false;
+
+                mJobs[bottom % DEQUE_CAPASITY].store( job, std::memory_order_relaxed );
+                std::atomic_thread_fence( std::memory_order_release );
+                mBottom.store( bottom+1, std::memory_order_relaxed );
+                return true;
+            }
+
+            Job* pop()
+            {
+                int64_t bottom = mBottom.load( std::memory_order_relaxed ) - 1;
+                mBottom.store( bottom, std::memory_order_relaxed );
+                std::atomic_thread_fence( std::memory_order_seq_cst );
+                int64_t top = mTop.load( std::memory_order_relaxed );
+
+                if( top > bottom ) {
+                    mBottom.store( bottom+1, std::memory_order_relaxed );
+                    return nullptr;
+                }
+
+                Job *job = mJobs[bottom % DEQUE_CAPASITY].load( std::memory_order_relaxed );
+                if( top == bottom ) {
+                    // the last job, race the thieves for it
+                    if( !mTop.compare_exchange_strong(top, top+1, std::memory_order_seq_cst, std::memory_order_relaxed) ) {
+                        job = nullptr;
+                    }
+                    mBottom.store( bottom+1, std::memory_order_relaxed );
+                }
+                return job;
+            }
+
+            // Returns nullptr if the deque is empty, or another thread took the job first
+            Job* steal()
+            {
+                int64_t top = mTop.load( std::memory_order_acquire );
+                std::atomic_thread_fence( std::memory_order_seq_cst );
+                int64_t bottom = mBottom.load( std::memory_order_acquire );
+                if( top >= bottom ) return nullptr;
+
+                Job *job = mJobs[top % DEQUE_CAPASITY].load( std::memory_order_relaxed );
+                if( !mTop.compare_exchange_strong(top, top+1, std::memory_order_seq_cst, std::memory_order_relaxed) ) {
+                    return nullptr;
+                }
+                return job;
+            }
+
+        private:
+            alignas(CACHE_LINE_SIZE) std::atomic<int64_t> mTop;
+            alignas(CACHE_LINE_SIZE) std::atomic<int64_t> mBottom;
+            alignas(CACHE_LINE_SIZE) std::atomic<Job*> mJobs[DEQUE_CAPASITY];
+        };
+
+        /* A free list of job records, allocated in chunks
+         * The free list is only used by the thread that owns the pool, other threads give the jobs they
+         * finished back through a lock free list, which the owner takes all of once its own list is empty
+         */
+        class JobPool {
+        public:
+            JobPool( Allocator *allocator ) :
+                mAllocator(allocator),
+                mFree(nullptr),
+                mChunks(allocator),
+                mReturned(nullptr)
+            {
+            }
+
+            ~JobPool()
+            {
+                for( void **chunk = array::begin(mChunks); chunk != array::end(mChunks); ++chunk ) {
+                    mAllocator->free( *chunk );
+                }
+            }
+
+            Job* allocate()
+            {
+                if( !mFree ) {
+                    mFree = mReturned.exchange( nullptr, std::memory_order_acquire );
+                }
+                if( !mFree ) {
+                    Job *chunk = static_cast<Job*>( mAllocator->allocate(POOL_CHUNK_JOBS*sizeof(Job), alignof(Job)) );
+                    array::pushBack( mChunks, static_cast<void*>(chunk) );
+                    for( std::size_t i=0; i < POOL_CHUNK_JOBS; ++i ) {
+                        free( chunk + i );
+                    }
+                }
+
+                Job *job = mFree;
+                mFree = job->dependents[0];
+                return job;
+            }
+
+            // only from the thread that owns the pool
+            void free( Job *job )
+            {
+                // the free lists are linked through the first dependent
+                job->dependents[0] = mFree;
+                mFree = job;
+            }
+
+            /* From any other thread
+             * The owner only ever takes the whole list, so pushing can't see a node that was taken and pushed again
+             */
+            void giveBack( Job *job )
+            {
+                Job *head = mReturned.load( std::memory_order_relaxed );
+                do {
+                    job->dependents[0] = head;
+                } while( !mReturned.compare_exchange_weak(head, job, std::memory_order_release, std::memory_order_relaxed) );
+            }
+
+        private:
+            Allocator *mAllocator;
+            Job *mFree;
+            Array<void*> mChunks;
+            alignas(CACHE_LINE_SIZE) std::atomic<Job*> mReturned;
+        };
+
+        struct alignas(CACHE_LINE_SIZE) Worker {
+            Worker( JobSystem *system_, int index_, Allocator *allocator ) :
+                system(system_),
+                index(index_),
+                pool(allocator),
+                random(uint32_t(index_)*2654435761u + 1),
+                threadFiber(nullptr),
+                currentFiber(nullptr),
+                recycleFiber(nullptr),
+                parkFiber(nullptr),
+                parkCounter(nullptr)
+            {
+            }
+
+            JobSystem *system;
+            int index;
+            JobDeque deque;
+            JobPool pool;
+            // for picking workers to steal from
+            uint32_t random;
+            std::thread thread;
+
+            // the stack of the thread, and the fiber it is running, worker 0 runs jobs on its own stack
+            Fiber *threadFiber;
+            Fiber *currentFiber;
+            // what the fiber switched to has to do, once the fiber it switched from is no longer running
+            Fiber *recycleFiber;
+            Fiber *parkFiber;
+            const JobCounter *parkCounter;
+        };
+
+        struct WaitingFiber {
+            Fiber *fiber;
+            const JobCounter *counter;
+        };
+
+        thread_local Worker *currentThreadWorker = nullptr;
+
+        /* Fibers can continue on another thread after a switch, and the compiler may keep
+         * the address of a thread local across a call, so it is always read through here
+         */
+        __attribute__((noinline)) Worker* threadWorker()
+        {
+            asm volatile( "" ::: "memory" );
+            return currentThreadWorker;
+        }
+
+        // sets the allocation tag of the thread the fiber is on now, Returns the one it had
+        __attribute__((noinline)) const AllocationTag* exchangeAllocationTag( const AllocationTag *tag )
+        {
+            asm volatile( "" ::: "memory" );
+            const AllocationTag *previous = detail::currentAllocationTag;
+            detail::currentAllocationTag = tag;
+            return previous;
+        }
+    }
+
+    struct JobSystem {
+        JobSystem( Allocator *allocator_ ) :
+            allocator(allocator_),
+            workers(allocator_),
+            injected(allocator_, INJECTED_CAPASITY),
+            externalPool(allocator_),
+            stacks(nullptr),
+            freeFibers(allocator_),
+            waiting(allocator_),
+            waitingCount(0),
+            queued(0),
+            sleeping(0),
+            quit(false)
+        {
+        }
+
+        Allocator *allocator;
+        Array<Worker*> workers;
+
+        // jobs run from threads that aren't workers, or that didn't fit in a deque
+        MpmcQueue<Job*> injected;
+
+        // for job records created by threads that aren't workers
+        std::mutex externalLock;
+        JobPool externalPool;
+
+        // stacks for the fibers the worker threads run jobs on
+        Allocator *stacks;
+        std::mutex fiberLock;
+        Array<Fiber*> freeFibers;
+        // fibers suspended in waitForCounter
+        Array<WaitingFiber> waiting;
+        std::atomic<int> waitingCount;
+
+        // jobs in the queues, idle workers sleep until there are any
+        alignas(CACHE_LINE_SIZE) std::atomic<int64_t> queued;
+        std::atomic<int> sleeping;
+        std::mutex sleepLock;
+        std::condition_variable wake;
+        std::atomic<bool> quit;
+    };
+
+    namespace {
+        inline Worker* currentWorker( JobSystem *system )
+        {
+            Worker *worker = threadWorker();
+            return worker && worker->system == system ? worker : nullptr;
+        }
+
+        Job* allocateJob( JobSystem *system )
+        {
+            Job *job;
+            if( Worker *worker = currentWorker(system) ) {
+                job = worker->pool.allocate();
+                job->pool = uint16_t( worker->index );
+                return job;
+            }
+            std::lock_guard<std::mutex> lock( system->externalLock );
+            job = system->externalPool.allocate();
+            job->pool = EXTERNAL_POOL;
+            return job;
+        }
+
+        // the job goes back to the pool it came from, or the pools of the threads that only finish jobs would grow forever
+        void freeJob( JobSystem *system, Job *job )
+        {
+            Worker *worker = currentWorker( system );
+            if( worker && job->pool == uint16_t(worker->index) ) {
+                worker->pool.free( job );
+                return;
+            }
+            JobPool &pool = job->pool == EXTERNAL_POOL ? system->externalPool : system->workers[job->pool]->pool;
+            pool.giveBack( job );
+        }
+
+        void execute( JobSystem *system, Job *job );
+
+        void wakeWorker( JobSystem *system )
+        {
+            if( system->sleeping.load() > 0 ) {
+                std::lock_guard<std::mutex> lock( system->sleepLock );
+                system->wake.notify_one();
+            }
+        }
+
+        // puts a job without unfinished dependencies in a queue
+        void schedule( JobSystem *system, Job *job )
+        {
+            system->queued.fetch_add( 1 );
+
+            Worker *worker = currentWorker( system );
+            if( !(worker && worker->deque.push(job)) && !mpmcQueue::push(system->injected, job) ) {
+                // every queue is full, so run it here instead
+                system->queued.fetch_sub( 1 );
+                execute( system, job );
+                return;
+            }
+            wakeWorker( system );
+        }
+
+        // a fiber may be parked on the counter while every worker sleeps, so one of them has to resume it
+        // the counter is decreased before sleeping is checked, and sleepers do it the other way around
+        void decreaseCounter( JobSystem *system, JobCounter *counter )
+        {
+            if( counter->value.fetch_sub(1) == 1 && system->waitingCount.load() > 0 ) {
+                wakeWorker( system );
+            }
+        }
+
+        void execute( JobSystem *system, Job *job )
+        {
+            job->function( system, job->data );
+
+            for( uint32_t i=0; i < job->dependentCount; ++i ) {
+                Job *dependent = job->dependents[i];
+                if( dependent->pending.fetch_sub(1, std::memory_order_acq_rel) == 1 ) {
+                    schedule( system, dependent );
+                }
+            }
+
+            JobCounter *counter = job->counter;
+            freeJob( system, job );
+
+            if( counter ) {
+                decreaseCounter( system, counter );
+            }
+        }
+
+        // looks in the workers own deque, the injected queue, and then tries to steal from the other workers
+        Job* findJob( JobSystem *system, Worker *worker )
+        {
+            Job *job = worker ? worker->deque.pop() : nullptr;
+            if( !job ) {
+                mpmcQueue::pop( system->injected, job );
+            }
+
+            const std::size_t count = array::size( system->workers );
+            if( !job && count > 1 ) {
+                static std::atomic<uint32_t> externalRandom( 0 );
+                uint32_t random;
+                if( worker ) {
+                    // xorshift
+                    worker->random ^= worker->random << 13;
+                    worker->random ^= worker->random >> 17;
+                    worker->random ^= worker->random << 5;
+                    random = worker->random;
+                }
+                else {
+                    random = externalRandom.fetch_add( 1, std::memory_order_relaxed );
+                }
+
+                for( std::size_t i=0; i < count && !job; ++i ) {
+                    Worker *victim = system->workers[(random + i) % count];
+                    if( victim != worker ) {
+                        job = victim->deque.steal();
+                    }
+                }
+            }
+
+            if( job ) {
+                system->queued.fetch_sub( 1 );
+            }
+            return job;
+        }
+
+        void fiberLoop( void *data );
+
+        Fiber* acquireFiber( JobSystem *system )
+        {
+            Fiber *fiber = nullptr;
+            {
+                std::lock_guard<std::mutex> lock( system->fiberLock );
+                if( array::size(system->freeFibers) > 0 ) {
+                    fiber = array::popBack( system->freeFibers );
+                }
+            }
+
+            if( fiber ) {
+                resetFiber( fiber, fiberLoop, system );
+                return fiber;
+            }
+            fiber = createFiber( system->allocator, system->stacks, FIBER_STACK_SIZE, fiberLoop, system );
+            ASSUME_TRUE( fiber != nullptr );
+            return fiber;
+        }
+
+        // finishes a switch, the fiber switched from has saved its registers by now
+        void afterSwitch( JobSystem *system )
+        {
+            Worker *worker = currentWorker( system );
+            if( worker->recycleFiber ) {
+                std::lock_guard<std::mutex> lock( system->fiberLock );
+                array::pushBack( system->freeFibers, worker->recycleFiber );
+                worker->recycleFiber = nullptr;
+            }
+            if( worker->parkFiber ) {
+                WaitingFiber waiting = { worker->parkFiber, worker->parkCounter };
+                {
+                    std::lock_guard<std::mutex> lock( system->fiberLock );
+                    array::pushBack( system->waiting, waiting );
+                    system->waitingCount.fetch_add( 1 );
+                }
+                worker->parkFiber = nullptr;
+                worker->parkCounter = nullptr;
+            }
+        }
+
+        // true if a fiber waiting in waitForCounter can be resumed
+        bool waitingReady( JobSystem *system )
+        {
+            if( system->waitingCount.load() == 0 ) return false;
+
+            std::lock_guard<std::mutex> lock( system->fiberLock );
+            for( const WaitingFiber *waiting = array::begin(system->waiting); waiting != array::end(system->waiting); ++waiting ) {
+                if( waiting->counter->value.load() == 0 ) return true;
+            }
+            return false;
+        }
+
+        // switches to a waiting fiber whose counter has reached zero, and recycles the running fiber
+        void resumeWaiting( JobSystem *system, Worker *worker )
+        {
+            Fiber *resumed = nullptr;
+            {
+                std::lock_guard<std::mutex> lock( system->fiberLock );
+                const std::size_t count = array::size( system->waiting );
+                for( std::size_t i=0; i < count; ++i ) {
+                    if( system->waiting[i].counter->value.load(std::memory_order_acquire) == 0 ) {
+                        resumed = system->waiting[i].fiber;
+                        system->waiting[i] = system->waiting[count-1];
+                        array::popBack( system->waiting );
+                        system->waitingCount.fetch_sub( 1 );
+                        break;
+                    }
+                }
+            }
+            if( !resumed ) return;
+
+            Fiber *self = worker->currentFiber;
+            worker->recycleFiber = self;
+            worker->currentFiber = resumed;
+            switchFiber( self, resumed );
+            ASSUME_TRUE( false && "A recycled fiber was resumed" );
+        }
+
+        /* Runs on the fibers of the worker threads
+         * A job that waits in waitForCounter parks the fiber it runs on, and a new fiber continues the loop
+         */
+        void fiberLoop( void *data )
+        {
+            JobSystem *system = static_cast<JobSystem*>( data );
+            afterSwitch( system );
+
+            int idle = 0;
+            while( !system->quit.load(std::memory_order_relaxed) ) {
+                Worker *worker = currentWorker( system );
+                if( system->waitingCount.load(std::memory_order_relaxed) > 0 ) {
+                    resumeWaiting( system, worker );
+                }
+
+                if( Job *job = findJob(system, worker) ) {
+                    execute( system, job );
+                    idle = 0;
+                    continue;
+                }
+
+                if( ++idle < IDLE_SPINS ) {
+                    std::this_thread::yield();
+                    continue;
+                }
+
+                // sleeping is increased before queued and the waiting counters are checked, and schedule and execute
+                // do it the other way around, so either this worker sees the work or they see the sleeper
+                std::unique_lock<std::mutex> lock( system->sleepLock );
+                system->sleeping.fetch_add( 1 );
+                while( system->queued.load() <= 0 && !waitingReady(system) && !system->quit.load() ) {
+                    system->wake.wait( lock );
+                }
+                system->sleeping.fetch_sub( 1 );
+                idle = 0;
+            }
+
+            // back to the stack of the thread this fiber ended up on
+            Worker *worker = currentWorker( system );
+            Fiber *self = worker->currentFiber;
+            worker->recycleFiber = self;
+            worker->currentFiber = nullptr;
+            switchFiber( self, worker->threadFiber );
+        }
+
+        void workerThread( Worker *worker )
+        {
+            JobSystem *system = worker->system;
+            currentThreadWorker = worker;
+
+            worker->threadFiber = createThreadFiber( system->allocator );
+            worker->currentFiber = acquireFiber( system );
+            switchFiber( worker->threadFiber, worker->currentFiber );
+
+            // the system has quit
+            afterSwitch( system );
+            destroyFiber( worker->threadFiber );
+            worker->threadFiber = nullptr;
+
+            currentThreadWorker = nullptr;
+        }
+
+        struct ParallelForBatch {
+            jobSystem::ParallelForFunction function;
+            void *data;
+            std::size_t begin,
+                        end;
+        };
+
+        void parallelForJob( JobSystem *, void *data )
+        {
+            ParallelForBatch *batch = static_cast<ParallelForBatch*>( data );
+            batch->function( batch->begin, batch->end, batch->data );
+        }
+    }
+
+    JobSystem* createJobSystem( Allocator *allocator, std::size_t workerCount )
+    {
+        ASSUME_TRUE( allocator != nullptr );
+        ASSUME_TRUE( currentThreadWorker == nullptr );
+
+        if( workerCount == 0 ) {
+            workerCount = std::thread::hardware_concurrency();
+            if( workerCount == 0 ) workerCount = 1;
+        }
+        ASSUME_TRUE( workerCount < EXTERNAL_POOL );
+
+        void *memory = allocator->allocate( sizeof(JobSystem), alignof(JobSystem) );
+        JobSystem *system = new (memory) JobSystem( allocator );
+        system->stacks = createGuardedStackAllocator( FIBER_STACK_SIZE, allocator );
+
+        array::reserve( system->workers, workerCount );
+        for( std::size_t i=0; i < workerCount; ++i ) {
+            void *workerMemory = allocator->allocate( sizeof(Worker), alignof(Worker) );
+            array::pushBack( system->workers, new (workerMemory) Worker(system, int(i), allocator) );
+        }
+
+        // the calling thread is worker 0
+        currentThreadWorker = system->workers[0];
+        for( std::size_t i=1; i < workerCount; ++i ) {
+            Worker *worker = system->workers[i];
+            worker->thread = std::thread( workerThread, worker );
+        }
+
+        return system;
+    }
+
+    void destroyJobSystem( JobSystem *system )
+    {
+        ASSUME_TRUE( currentThreadWorker == system->workers[0] );
+        ASSUME_TRUE( system->queued.load() == 0 );
+        ASSUME_TRUE( system->waitingCount.load() == 0 );
+
+        {
+            std::lock_guard<std::mutex> lock( system->sleepLock );
+            system->quit.store( true );
+            system->wake.notify_all();
+        }
+
+        Allocator *allocator = system->allocator;
+        for( Worker **worker = array::begin(system->workers); worker != array::end(system->workers); ++worker ) {
+            if( (*worker)->thread.joinable() ) {
+                (*worker)->thread.join();
+            }
+            if( currentThreadWorker == *worker ) {
+                currentThreadWorker = nullptr;
+            }
+            (*worker)->~Worker();
+            allocator->free( *worker );
+        }
+
+        for( Fiber **fiber = array::begin(system->freeFibers); fiber != array::end(system->freeFibers); ++fiber ) {
+            destroyFiber( *fiber );
+        }
+        destroyGuardedStackAllocator( system->stacks );
+
+        system->~JobSystem();
+        allocator->free( system );
+    }
+
+    namespace jobSystem
+    {
+        std::size_t workerCount( const JobSystem *system )
+        {
+            return array::size( system->workers );
+        }
+
+        int currentWorker( const JobSystem *system )
+        {
+            Worker *worker = currentThreadWorker;
+            return worker && worker->system == system ? worker->index : -1;
+        }
+
+        Job* createJob( JobSystem *system, JobFunction function, const void *data, std::size_t size )
+        {
+            ASSUME_TRUE( function != nullptr );
+            ASSUME_TRUE( size <= JOB_DATA_SIZE );
+
+            Job *job = allocateJob( system );
+            job->function = function;
+            job->counter = nullptr;
+            job->pending.store( 1, std::memory_order_relaxed );
+            job->dependentCount = 0;
+            if( size > 0 ) {
+                std::memcpy( job->data, data, size );
+            }
+            return job;
+        }
+
+        void addDependency( Job *job, Job *dependency )
+        {
+            ASSUME_TRUE( dependency->dependentCount < JOB_MAX_DEPENDENTS );
+
+            dependency->dependents[dependency->dependentCount++] = job;
+            job->pending.fetch_add( 1, std::memory_order_relaxed );
+        }
+
+        void setCounter( Job *job, JobCounter *counter )
+        {
+            job->counter = counter;
+        }
+
+        void decrementCounter( JobSystem *system, JobCounter &counter )
+        {
+            decreaseCounter( system, &counter );
+        }
+
+        void run( JobSystem *system, Job *job )
+        {
+            if( job->counter ) {
+                job->counter->value.fetch_add( 1, std::memory_order_relaxed );
+            }
+            if( job->pending.fetch_sub(1, std::memory_order_acq_rel) == 1 ) {
+                schedule( system, job );
+            }
+        }
+
+        void run( JobSystem *system, JobFunction function, const void *data, std::size_t size, JobCounter *counter )
+        {
+            Job *job = createJob( system, function, data, size );
+            setCounter( job, counter );
+            run( system, job );
+        }
+
+        void wait( JobSystem *system, const JobCounter &counter )
+        {
+            Worker *worker = Core::currentWorker( system );
+            while( counter.value.load(std::memory_order_acquire) != 0 ) {
+                if( Job *job = findJob(system, worker) ) {
+                    execute( system, job );
+                    continue;
+                }
+                // a thread that isn't on a fiber can't resume parked fibers, so it makes sure a worker is awake to
+                if( waitingReady(system) ) {
+                    wakeWorker( system );
+                }
+                std::this_thread::yield();
+            }
+        }
+
+        void waitForCounter( JobSystem *system, const JobCounter &counter )
+        {
+            if( counter.value.load(std::memory_order_acquire) == 0 ) return;
+
+            Worker *worker = Core::currentWorker( system );
+            if( !worker || !worker->currentFiber ) {
+                // not on a fiber, so the thread has to help until the counter is done
+                wait( system, counter );
+                return;
+            }
+
+            // the allocation tag belongs to the job, not the thread, so it goes with the fiber
+            const AllocationTag *tag = exchangeAllocationTag( nullptr );
+
+            // the next fiber parks this one once it is switched away from
+            Fiber *self = worker->currentFiber;
+            Fiber *next = acquireFiber( system );
+            worker->parkFiber = self;
+            worker->parkCounter = &counter;
+            worker->currentFiber = next;
+            switchFiber( self, next );
+
+            // resumed, possibly on another worker thread
+            afterSwitch( system );
+            exchangeAllocationTag( tag );
+        }
+
+        void parallelFor( JobSystem *system, std::size_t count, std::size_t batchSize, ParallelForFunction function, void *data )
+        {
+            ASSUME_TRUE( batchSize > 0 );
+
+            JobCounter counter;
+            for( std::size_t begin=0; begin < count; begin += batchSize ) {
+                ParallelForBatch batch;
+                batch.function = function;
+                batch.data = data;
+                batch.begin = begin;
+                batch.end = begin + batchSize < count ? begin + batchSize : count;
+
+                run( system, parallelForJob, &batch, sizeof(batch), &counter );
+            }
+            wait( system, counter );
+        }
+    }
+}
@@ -0,0 +1,201 @@
+#include "core/MappedArray.h"
+#include "core/Allocator.h"
+#include "core/Assume.h"
+
+#include <new>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Core 
+{
+    namespace {
+        inline std::size_t pageSize()
+        {
+            static const std::size_t size = std::size_t( sysconf(_SC_PAGESIZE) );
+            return size;
+        }
+        
+        // a empty file still gets a mapping, so there always is a block for the array to free
+        inline std::size_t mappingLength( std::size_t size )
+        {
+            return size > 0 ? size : pageSize();
+        }
+    }
+    
+    class MappedFileAllocator :
+        public Allocator
+    {
+    public:
+        MappedFileAllocator( Allocator *backer, int file, MapMode mode ) :
+            mBacker(backer),
+            mFile(file),
+            mMode(mode),
+            mData(nullptr),
+            mSize(0),
+            mLength(0)
+        {
+        }
+        
+        bool map( std::size_t size )
+        {
+            int protection = mMode == MapMode::ReadWrite ? PROT_READ|PROT_WRITE : PROT_READ;
+            
+            void *data = mmap( nullptr, mappingLength(size), protection, MAP_SHARED, mFile, 0 );
+            if( data == MAP_FAILED ) return false;
+            
+            mData = data;
+            mSize = size;
+            mLength = mappingLength( size );
+            return true;
+        }
+        
+        void* data() const
+        {
+            return mData;
+        }
+        
+        virtual void* allocate( std::size_t size, std::size_t alignment )
+        {
+            // the allocator only owns one block, the mapping
+            ASSUME_TRUE( mData == nullptr );
+            return nullptr;
+        }
+        
+        /* Resizes the file and the mapping to newSize
+         * Returns false and leaves both as they were if either fails, a full disk or a file size limit for example
+         */
+        bool resize( std::size_t newSize )
+        {
+            ASSUME_TRUE( mMode == MapMode::ReadWrite );
+            
+            // whatever is cut off by a shrink is gone, so the rest is written back first
+            if( newSize < mSize ) {
+                flush();
+            }
+            
+            if( ftruncate(mFile, off_t(newSize)) != 0 ) {
+                return false;
+            }
+            
+            void *data = mremap( mData, mLength, mappingLength(newSize), MREMAP_MAYMOVE );
+            if( data == MAP_FAILED ) {
+                ftruncate( mFile, off_t(mSize) );
+                return false;
+            }
+            
+            mData = data;
+            mSize = newSize;
+            mLength = mappingLength( newSize );
+            return true;
+        }
+        
+        virtual void* reallocate( void *ptr, std::size_t usedSize, std::size_t newSize, std::size_t alignment )
+        {
+            ASSUME_TRUE( ptr == mData );
+            ASSUME_TRUE( alignment <= pageSize() );
+            
+            // Array has no way to fail, use mappedArray::reserve to handle a file that can't grow
+            bool resized = resize( newSize );
+            ASSUME_TRUE( resized && "The mapped file couldn't be resized" );
+            return mData;
+        }
+        
+        virtual void free( void *ptr )
+        {
+            ASSUME_TRUE( ptr == mData );
+            close( mSize );
+        }
+        
+        // the file is as long as the capasity of the array, the rest isn't elements
+        virtual void freeUsed( void *ptr, std::size_t usedSize )
+        {
+            ASSUME_TRUE( ptr == mData );
+            close( usedSize );
+        }
+        
+        void flush()
+        {
+            if( mMode == MapMode::ReadWrite && mSize > 0 ) {
+                msync( mData, mSize, MS_SYNC );
+            }
+        }
+        
+        void close( std::size_t usedSize )
+        {
+            if( mMode == MapMode::ReadWrite ) {
+                flush();
+                if( usedSize != mSize ) {
+                    ftruncate( mFile, off_t(usedSize) );
+                }
+            }
+            
+            munmap( mData, mLength );
+            ::close( mFile );
+            
+            Allocator *backer = mBacker;
+            this->~MappedFileAllocator();
+            backer->free( this );
+        }
+        
+    private:
+        Allocator *mBacker;
+        int mFile;
+        MapMode mMode;
+        
+        void *mData;
+        std::size_t mSize,
+                    mLength;
+    };
+    
+    Allocator* createMappedFileAllocator( const char *path, MapMode mode, void **data, std::size_t *size )
+    {
+        int file = -1;
+        if( mode == MapMode::ReadWrite ) {
+            file = open( path, O_RDWR|O_CREAT|O_CLOEXEC, 0644 );
+        }
+        else {
+            file = open( path, O_RDONLY|O_CLOEXEC );
+        }
+        if( file < 0 ) return nullptr;
+        
+        struct stat info;
+        if( fstat(file, &info) != 0 ) {
+            ::close( file );
+            return nullptr;
+        }
+        
+        Allocator *backer = getDefaultAllocator();
+        void *memory = backer->allocate( sizeof(MappedFileAllocator), alignof(MappedFileAllocator) );
+        MappedFileAllocator *allocator = new (memory) MappedFileAllocator( backer, file, mode );
+        
+        if( !allocator->map(std::size_t(info.st_size)) ) {
+            allocator->~MappedFileAllocator();
+            backer->free( memory );
+            ::close( file );
+            return nullptr;
+        }
+        
+        *data = allocator->data();
+        *size = std::size_t( info.st_size );
+        return allocator;
+    }
+    
+    void* resizeMappedFile( Allocator *allocator, std::size_t size )
+    {
+        MappedFileAllocator *mapped = static_cast<MappedFileAllocator*>( allocator );
+        return mapped->resize( size ) ? mapped->data() : nullptr;
+    }
+    
+    void flushMappedFile( Allocator *allocator )
+    {
+        static_cast<MappedFileAllocator*>( allocator )->flush();
+    }
+    
+    void closeMappedFile( Allocator *allocator, std::size_t usedSize )
+    {
+        static_cast<MappedFileAllocator*>( allocator )->close( usedSize );
+    }
+}
@@ -0,0 +1,472 @@
+#include "core/PackedIntArray.h"
+#include "core/Allocator.h"
+
+#include <cstring>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#   define CORE_PACKEDINT_X86 1
+#   include <immintrin.h>
+#endif
+
+namespace Core
+{
+    namespace {
+        static const std::size_t BLOCK_SIZE = 64;
+
+        typedef void (*UnpackFunction)( const uint64_t *words, uint32_t bits, uint32_t *values );
+
+        void unpackScalar( const uint64_t *words, uint32_t bits, uint32_t *values )
+        {
+            for( std::size_t i=0; i < BLOCK_SIZE; ++i ) {
+                values[i] = detail::extractBits( words, bits, i );
+            }
+        }
+
+#ifdef CORE_PACKEDINT_X86
+        /* Every value is at most 32 bits and starts within a byte, so it can be read with a
+         * unaligned 64 bit load from its first byte and shifted into place
+         * Value i+8 starts exactly bits bytes after value i, so the shifts are the same for every group of 8
+         */
+        __attribute__((target("avx2")))
+        void unpackAvx2( const uint64_t *words, uint32_t bits, uint32_t *values )
+        {
+            const long long *bytes = reinterpret_cast<const long long*>( words );
+            const __m256i mask = _mm256_set1_epi64x( (int64_t(1) << bits) - 1 );
+            // the 64 bit lanes hold values 0-3 and 4-7 interleaved as 32 bit elements
+            const __m256i order = _mm256_setr_epi32( 0, 2, 4, 6, 1, 3, 5, 7 );
+            const __m128i step = _mm_set1_epi32( int(bits) );
+
+            __m128i lowOffsets = _mm_setr_epi32( 0, bits >> 3, (2*bits) >> 3, (3*bits) >> 3 );
+            __m128i highOffsets = _mm_setr_epi32( (4*bits) >> 3, (5*bits) >> 3, (6*bits) >> 3, (7*bits) >> 3 );
+            const __m256i lowShifts = _mm256_setr_epi64x( 0, bits & 7, (2*bits) & 7, (3*bits) & 7 );
+            const __m256i highShifts = _mm256_setr_epi64x( (4*bits) & 7, (5*bits) & 7, (6*bits) & 7, (7*bits) & 7 );
+
+            for( std::size_t i=0; i < BLOCK_SIZE; i += 8 ) {
+                __m256i low = _mm256_i32gather_epi64( bytes, lowOffsets, 1 );
+                __m256i high = _mm256_i32gather_epi64( bytes, highOffsets, 1 );
+                low = _mm256_and_si256( _mm256_srlv_epi64(low, lowShifts), mask );
+                high = _mm256_and_si256( _mm256_srlv_epi64(high, highShifts), mask );
+
+                __m256i result = _mm256_or_si256( low, _mm256_slli_epi64(high, 32) );
+                _mm256_storeu_si256( reinterpret_cast<__m256i*>(values+i), _mm256_permutevar8x32_epi32(result, order) );
+
+                lowOffsets = _mm_add_epi32( lowOffsets, step );
+                highOffsets = _mm_add_epi32( highOffsets, step );
+            }
+        }
+#endif
+
+        struct PackedFunctions {
+            UnpackFunction unpackFunction = unpackScalar;
+
+            PackedFunctions() {
+#ifdef CORE_PACKEDINT_X86
+                __builtin_cpu_init();
+                if( __builtin_cpu_supports("avx2") ) {
+                    unpackFunction = unpackAvx2;
+                }
+#endif
+            }
+        };
+
+        const PackedFunctions& packedFunctions()
+        {
+            static const PackedFunctions functions;
+            return functions;
+        }
+
+        inline std::size_t blocksFor( std::size_t size )
+        {
+            return (size + BLOCK_SIZE-1) / BLOCK_SIZE;
+        }
+
+        // grows words to size, clearing the new words
+        void growWords( Array<uint64_t> &words, std::size_t size )
+        {
+            if( size <= words._size ) return;
+            if( size > words._capasity ) {
+                std::size_t capasity = words._capasity*2 + 10;
+                array::reserve( words, capasity > size ? capasity : size );
+            }
+            std::memset( words._data + words._size, 0, (size - words._size)*sizeof(uint64_t) );
+            words._size = size;
+        }
+
+        inline void insertBits( uint64_t *words, uint32_t bits, std::size_t index, uint32_t value )
+        {
+            const std::size_t bit = index * bits;
+            const std::size_t shift = bit % 64;
+            const uint64_t mask = (uint64_t(1) << bits) - 1;
+            uint64_t *word = words + bit / 64;
+
+            word[0] = (word[0] & ~(mask << shift)) | (uint64_t(value) << shift);
+            if( shift + bits > 64 ) {
+                word[1] = (word[1] & ~(mask >> (64 - shift))) | (uint64_t(value) >> (64 - shift));
+            }
+        }
+    }
+
+    namespace detail
+    {
+        void unpackBlock( const uint64_t *words, uint32_t bits, uint32_t *values )
+        {
+            if( bits == 0 ) {
+                std::memset( values, 0, BLOCK_SIZE*sizeof(uint32_t) );
+                return;
+            }
+            packedFunctions().unpackFunction( words, bits, values );
+        }
+
+        void packBlock( const uint32_t *values, uint32_t bits, uint64_t *words )
+        {
+            if( bits == 0 ) return;
+            for( std::size_t i=0; i < BLOCK_SIZE; ++i ) {
+                const std::size_t bit = i * bits;
+                const std::size_t shift = bit % 64;
+
+                words[bit / 64] |= uint64_t(values[i]) << shift;
+                if( shift + bits > 64 ) {
+                    words[bit / 64 + 1] |= uint64_t(values[i]) >> (64 - shift);
+                }
+            }
+        }
+    }
+
+    PackedIntArray::PackedIntArray( Allocator *allocator, uint32_t bits ) :
+        _words(allocator),
+        _bits(bits)
+    {
+        ASSUME_TRUE( bits <= 32 );
+    }
+
+    DeltaIntArray::DeltaIntArray( Allocator *allocator ) :
+        _blocks(allocator),
+        _words(allocator)
+    {
+    }
+
+    VarintArray::VarintArray( Allocator *allocator ) :
+        _bytes(allocator),
+        _blockOffsets(allocator)
+    {
+    }
+
+    namespace packedIntArray
+    {
+        void set( PackedIntArray &array, std::size_t index, uint32_t value )
+        {
+            ASSUME_TRUE( index < array._size );
+            ASSUME_TRUE( requiredBits(value) <= array._bits );
+
+            if( array._bits == 0 ) return;
+            insertBits( array._words._data, array._bits, index, value );
+        }
+
+        void resize( PackedIntArray &array, std::size_t size )
+        {
+            if( array._bits == 0 ) {
+                array._size = size;
+                return;
+            }
+
+            if( size < array._size ) {
+                // clear the rest of the last block, so growing it again gives zeros
+                std::size_t end = blocksFor(size) * BLOCK_SIZE;
+                for( std::size_t i=size; i < end && i < array._size; ++i ) {
+                    insertBits( array._words._data, array._bits, i, 0 );
+                }
+
+                // keep the padding word cleared
+                array._words._size = blocksFor(size) * array._bits + 1;
+                array._words._data[array._words._size-1] = 0;
+            }
+            else {
+                growWords( array._words, blocksFor(size) * array._bits + 1 );
+            }
+            array._size = size;
+        }
+
+        void reserve( PackedIntArray &array, std::size_t size )
+        {
+            if( array._bits == 0 ) return;
+            array::reserve( array._words, blocksFor(size) * array._bits + 1 );
+        }
+
+        void pushBack( PackedIntArray &array, uint32_t value )
+        {
+            std::size_t index = array._size;
+            if( index % BLOCK_SIZE == 0 ) {
+                resize( array, index+1 );
+            }
+            else {
+                array._size++;
+            }
+            set( array, index, value );
+        }
+
+        void clear( PackedIntArray &array )
+        {
+            resize( array, 0 );
+        }
+
+        void assign( PackedIntArray &array, ArrayView<uint32_t> values )
+        {
+            uint32_t largest = 0;
+            for( std::size_t i=0; i < values._size; ++i ) {
+                largest |= values._data[i];
+            }
+
+            clear( array );
+            array._bits = requiredBits( largest );
+            resize( array, values._size );
+
+            if( array._bits == 0 ) return;
+
+            // whole blocks are packed at once, the words are cleared by resize
+            std::size_t full = values._size / BLOCK_SIZE;
+            for( std::size_t block=0; block < full; ++block ) {
+                detail::packBlock( values._data + block*BLOCK_SIZE, array._bits, array._words._data + block*array._bits );
+            }
+            for( std::size_t i=full*BLOCK_SIZE; i < values._size; ++i ) {
+                insertBits( array._words._data, array._bits, i, values._data[i] );
+            }
+        }
+
+        std::size_t decodeBlock( const PackedIntArray &array, std::size_t block, uint32_t *values )
+        {
+            ASSUME_TRUE( block < blockCount(array) );
+
+            detail::unpackBlock( array._words._data + block*array._bits, array._bits, values );
+
+            std::size_t remaining = array._size - block*BLOCK_SIZE;
+            return remaining < BLOCK_SIZE ? remaining : BLOCK_SIZE;
+        }
+
+        void decode( const PackedIntArray &array, std::size_t first, std::size_t count, uint32_t *values )
+        {
+            ASSUME_TRUE( first + count <= array._size );
+
+            std::size_t index = first;
+            const std::size_t end = first + count;
+
+            // single values up to the first block boundary, then whole blocks straight into values
+            for( ; index < end && index % BLOCK_SIZE != 0; ++index ) {
+                *values++ = get( array, index );
+            }
+            for( ; index + BLOCK_SIZE <= end; index += BLOCK_SIZE ) {
+                detail::unpackBlock( array._words._data + (index / BLOCK_SIZE)*array._bits, array._bits, values );
+                values += BLOCK_SIZE;
+            }
+            for( ; index < end; ++index ) {
+                *values++ = get( array, index );
+            }
+        }
+    }
+
+    namespace deltaIntArray
+    {
+        namespace {
+            void packPending( DeltaIntArray &array )
+            {
+                uint32_t smallest = array._pending[0],
+                         largest = array._pending[0];
+                for( std::size_t i=1; i < BLOCK_SIZE; ++i ) {
+                    smallest = array._pending[i] < smallest ? array._pending[i] : smallest;
+                    largest = array._pending[i] > largest ? array._pending[i] : largest;
+                }
+
+                DeltaIntArray::Block block;
+                block.base = smallest;
+                block.bits = packedIntArray::requiredBits( largest - smallest );
+                // the new block starts at the old padding word
+                block.word = array::size(array._words) > 0 ? array::size(array._words) - 1 : 0;
+
+                uint32_t offsets[BLOCK_SIZE];
+                for( std::size_t i=0; i < BLOCK_SIZE; ++i ) {
+                    offsets[i] = array._pending[i] - smallest;
+                }
+
+                growWords( array._words, block.word + block.bits + 1 );
+                detail::packBlock( offsets, block.bits, array._words._data + block.word );
+
+                array::pushBack( array._blocks, block );
+            }
+        }
+
+        void pushBack( DeltaIntArray &array, uint32_t value )
+        {
+            array._pending[array._size % BLOCK_SIZE] = value;
+            array._size++;
+
+            if( array._size % BLOCK_SIZE == 0 ) {
+                packPending( array );
+            }
+        }
+
+        void clear( DeltaIntArray &array )
+        {
+            array._blocks._size = 0;
+            array._words._size = 0;
+            array._size = 0;
+        }
+
+        void assign( DeltaIntArray &array, ArrayView<uint32_t> values )
+        {
+            clear( array );
+            array::reserve( array._blocks, values._size / BLOCK_SIZE );
+            for( std::size_t i=0; i < values._size; ++i ) {
+                pushBack( array, values._data[i] );
+            }
+        }
+
+        std::size_t decodeBlock( const DeltaIntArray &array, std::size_t block, uint32_t *values )
+        {
+            ASSUME_TRUE( block < blockCount(array) );
+
+            if( block >= array::size(array._blocks) ) {
+                std::size_t count = array._size % BLOCK_SIZE;
+                std::memcpy( values, array._pending, count*sizeof(uint32_t) );
+                return count;
+            }
+
+            const DeltaIntArray::Block &packed = array._blocks[block];
+            detail::unpackBlock( array._words._data + packed.word, packed.bits, values );
+            for( std::size_t i=0; i < BLOCK_SIZE; ++i ) {
+                values[i] += packed.base;
+            }
+            return BLOCK_SIZE;
+        }
+
+        std::size_t byteSize( const DeltaIntArray &array )
+        {
+            return array::size(array._words)*sizeof(uint64_t) + array::size(array._blocks)*sizeof(DeltaIntArray::Block);
+        }
+    }
+
+    namespace varint
+    {
+        std::size_t encodeN( const uint32_t *values, std::size_t count, uint8_t *bytes )
+        {
+            std::size_t written = 0;
+            for( std::size_t i=0; i < count; ++i ) {
+                written += encode( values[i], bytes + written );
+            }
+            return written;
+        }
+
+        std::size_t decodeN( const uint8_t *bytes, std::size_t count, uint32_t *values )
+        {
+            std::size_t read = 0,
+                        i = 0;
+
+#ifdef CORE_PACKEDINT_X86
+            // small values are common, so widen 16 single byte values at a time
+            // there are at least as many bytes left as values, so the loads stay in the stream
+            const __m128i zero = _mm_setzero_si128();
+            while( i + 16 <= count ) {
+                __m128i chunk = _mm_loadu_si128( reinterpret_cast<const __m128i*>(bytes + read) );
+                unsigned continued = unsigned( _mm_movemask_epi8(chunk) );
+
+                if( continued == 0 ) {
+                    __m128i low = _mm_unpacklo_epi8( chunk, zero ),
+                            high = _mm_unpackhi_epi8( chunk, zero );
+                    _mm_storeu_si128( reinterpret_cast<__m128i*>(values + i), _mm_unpacklo_epi16(low, zero) );
+                    _mm_storeu_si128( reinterpret_cast<__m128i*>(values + i + 4), _mm_unpackhi_epi16(low, zero) );
+                    _mm_storeu_si128( reinterpret_cast<__m128i*>(values + i + 8), _mm_unpacklo_epi16(high, zero) );
+                    _mm_storeu_si128( reinterpret_cast<__m128i*>(values + i + 12), _mm_unpackhi_epi16(high, zero) );
+                    read += 16;
+                    i += 16;
+                    continue;
+                }
+
+                // copy the single byte values in front of the first long one, then decode it
+                unsigned singles = unsigned( __builtin_ctz(continued) );
+                for( unsigned j=0; j < singles; ++j ) {
+                    values[i++] = bytes[read++];
+                }
+                read += decode( bytes + read, values + i );
+                i++;
+            }
+#endif
+
+            for( ; i < count; ++i ) {
+                read += decode( bytes + read, values + i );
+            }
+            return read;
+        }
+    }
+
+    namespace varintArray
+    {
+        namespace {
+            // skips count values starting at bytes, Returns the number of bytes skipped
+            std::size_t skip( const uint8_t *bytes, std::size_t count )
+            {
+                std::size_t read = 0;
+                while( count > 0 ) {
+                    if( !(bytes[read++] & 0x80) ) count--;
+                }
+                return read;
+            }
+        }
+
+        uint32_t get( const VarintArray &array, std::size_t index )
+        {
+            ASSUME_TRUE( index < array._size );
+
+            const uint8_t *bytes = array._bytes._data + array._blockOffsets[index / BLOCK_SIZE];
+            bytes += skip( bytes, index % BLOCK_SIZE );
+
+            uint32_t value;
+            varint::decode( bytes, &value );
+            return value;
+        }
+
+        void pushBack( VarintArray &array, uint32_t value )
+        {
+            if( array._size % BLOCK_SIZE == 0 ) {
+                array::pushBack( array._blockOffsets, array::size(array._bytes) );
+            }
+
+            uint8_t bytes[varint::MAX_BYTES];
+            std::size_t count = varint::encode( value, bytes );
+            for( std::size_t i=0; i < count; ++i ) {
+                array::pushBack( array._bytes, bytes[i] );
+            }
+            array._size++;
+        }
+
+        void clear( VarintArray &array )
+        {
+            array._bytes._size = 0;
+            array._blockOffsets._size = 0;
+            array._size = 0;
+        }
+
+        void assign( VarintArray &array, ArrayView<uint32_t> values )
+        {
+            clear( array );
+            array::reserve( array._bytes, values._size*varint::MAX_BYTES );
+            array::reserve( array._blockOffsets, blocksFor(values._size) );
+
+            for( std::size_t i=0; i < values._size; i += BLOCK_SIZE ) {
+                std::size_t count = values._size - i < BLOCK_SIZE ? values._size - i : BLOCK_SIZE;
+
+                array::pushBack( array._blockOffsets, array::size(array._bytes) );
+                array._bytes._size += varint::encodeN( values._data + i, count, array._bytes._data + array._bytes._size );
+            }
+            array._size = values._size;
+        }
+
+        std::size_t decodeBlock( const VarintArray &array, std::size_t block, uint32_t *values )
+        {
+            ASSUME_TRUE( block < blockCount(array) );
+
+            std::size_t remaining = array._size - block*BLOCK_SIZE;
+            std::size_t count = remaining < BLOCK_SIZE ? remaining : BLOCK_SIZE;
+
+            varint::decodeN( array._bytes._data + array._blockOffsets[block], count, values );
+            return count;
+        }
+    }
+}
@@ -0,0 +1,241 @@
+#include "core/PerfCounters.h"
+#include "core/Allocator.h"
+#include "core/Assume.h"
+
+#include <linux/perf_event.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <new>
+
+#if defined(__x86_64__) || defined(__i386__)
+#   include <x86intrin.h>
+#endif
+
+namespace Core
+{
+    namespace {
+        struct CounterConfig {
+            uint32_t type;
+            uint64_t config;
+        };
+
+        const CounterConfig COUNTER_CONFIGS[PERF_COUNTER_COUNT] = {
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+            { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_ACCESS << 16) }
+        };
+
+        uint64_t PerfCounterValues::* const COUNTER_FIELDS[PERF_COUNTER_COUNT] = {
+            &PerfCounterValues::cycles,
+            &PerfCounterValues::instructions,
+            &PerfCounterValues::cacheMisses,
+            &PerfCounterValues::branchMisses,
+            &PerfCounterValues::llcLoads
+        };
+
+        int openCounter( const CounterConfig &config, int group )
+        {
+            perf_event_attr attr;
+            std::memset( &attr, 0, sizeof(attr) );
+            attr.size = sizeof(attr);
+            attr.type = config.type;
+            attr.config = config.config;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            // the group is only scheduled as a whole, so its counts are never scaled by the enabled and running times
+            attr.read_format = PERF_FORMAT_GROUP;
+
+            return int( syscall(SYS_perf_event_open, &attr, 0, -1, group, 0) );
+        }
+
+#if defined(__x86_64__) || defined(__i386__)
+        /* Reads the count through the mapped page and rdpmc, following the protocol in linux/perf_event.h
+         * The count is the same raw count a read syscall returns
+         * Returns false if the counter isn't on the pmu right now, or the page has no counter width
+         */
+        bool readMapped( const perf_event_mmap_page *page, uint64_t &count )
+        {
+            const volatile perf_event_mmap_page *mapped = page;
+            uint32_t sequence, index, width;
+            do {
+                sequence = mapped->lock;
+                asm volatile( "" ::: "memory" );
+
+                index = mapped->index;
+                width = mapped->pmc_width;
+                count = mapped->offset;
+                if( index && width > 0 && width <= 64 ) {
+                    int64_t pmc = int64_t( __builtin_ia32_rdpmc(int(index-1)) );
+                    // sign extend from the width of the counter
+                    pmc = int64_t( uint64_t(pmc) << (64 - width) );
+                    pmc >>= 64 - width;
+                    count += uint64_t( pmc );
+                }
+
+                asm volatile( "" ::: "memory" );
+            } while( mapped->lock != sequence );
+
+            return index != 0 && width > 0 && width <= 64;
+        }
+#endif
+    }
+
+    struct PerfCounters {
+        Allocator *allocator;
+        // -1 for counters that couldn't be opened
+        int fds[PERF_COUNTER_COUNT];
+        int leader;
+        // the counters in the order a group read returns them
+        uint32_t order[PERF_COUNTER_COUNT];
+        uint32_t openCount;
+
+        perf_event_mmap_page *pages[PERF_COUNTER_COUNT];
+        bool rdpmc;
+    };
+
+    namespace {
+        void readSyscall( PerfCounters *counters, PerfCounterValues &values )
+        {
+            // count and a value for each counter
+            uint64_t buffer[1 + PERF_COUNTER_COUNT];
+            ssize_t size = ::read( counters->leader, buffer, sizeof(buffer) );
+            if( size < ssize_t(sizeof(uint64_t)) ) return;
+
+            uint64_t count = buffer[0] < counters->openCount ? buffer[0] : counters->openCount;
+            if( count > uint64_t(size) / sizeof(uint64_t) - 1 ) count = uint64_t(size) / sizeof(uint64_t) - 1;
+            for( uint64_t i=0; i < count; ++i ) {
+                values.*COUNTER_FIELDS[counters->order[i]] = buffer[1+i];
+            }
+        }
+
+        // Returns false if a counter isn't on the pmu right now
+        bool readRdpmc( PerfCounters *counters, PerfCounterValues &values )
+        {
+#if defined(__x86_64__) || defined(__i386__)
+            for( uint32_t i=0; i < counters->openCount; ++i ) {
+                uint32_t counter = counters->order[i];
+                if( !readMapped(counters->pages[counter], values.*COUNTER_FIELDS[counter]) ) return false;
+            }
+            return true;
+#else
+            (void)counters;
+            (void)values;
+            return false;
+#endif
+        }
+    }
+
+    PerfCounters* createPerfCounters( Allocator *allocator )
+    {
+        ASSUME_TRUE( allocator != nullptr );
+
+        int fds[PERF_COUNTER_COUNT];
+        int leader = -1;
+        for( std::size_t i=0; i < PERF_COUNTER_COUNT; ++i ) {
+            fds[i] = openCounter( COUNTER_CONFIGS[i], leader );
+            if( leader == -1 ) leader = fds[i];
+        }
+        if( leader == -1 ) return nullptr;
+
+        void *memory = allocator->allocate( sizeof(PerfCounters), alignof(PerfCounters) );
+        PerfCounters *counters = new (memory) PerfCounters;
+        counters->allocator = allocator;
+        counters->leader = leader;
+        counters->openCount = 0;
+        counters->rdpmc = false;
+
+        for( std::size_t i=0; i < PERF_COUNTER_COUNT; ++i ) {
+            counters->fds[i] = fds[i];
+            counters->pages[i] = nullptr;
+            if( fds[i] != -1 ) {
+                counters->order[counters->openCount++] = uint32_t( i );
+            }
+        }
+
+#if defined(__x86_64__) || defined(__i386__)
+        // the kernel only allows rdpmc for counters that are mapped
+        const long pageSize = sysconf( _SC_PAGESIZE );
+        counters->rdpmc = true;
+        for( uint32_t i=0; i < counters->openCount; ++i ) {
+            uint32_t counter = counters->order[i];
+            void *page = mmap( nullptr, pageSize, PROT_READ, MAP_SHARED, counters->fds[counter], 0 );
+            if( page == MAP_FAILED ) {
+                counters->rdpmc = false;
+                break;
+            }
+            counters->pages[counter] = static_cast<perf_event_mmap_page*>( page );
+            if( !counters->pages[counter]->cap_user_rdpmc ) {
+                counters->rdpmc = false;
+            }
+        }
+
+        /* Hypervisors can trap rdpmc, which makes it slower than the syscall that reads every counter at once
+         * so keep whichever is faster
+         */
+        if( counters->rdpmc ) {
+            static const int CALIBRATION_READS = 8;
+            PerfCounterValues values;
+
+            uint64_t start = __rdtsc();
+            for( int i=0; i < CALIBRATION_READS; ++i ) readSyscall( counters, values );
+            uint64_t syscallTime = __rdtsc() - start;
+
+            start = __rdtsc();
+            for( int i=0; i < CALIBRATION_READS; ++i ) readRdpmc( counters, values );
+            uint64_t rdpmcTime = __rdtsc() - start;
+
+            counters->rdpmc = rdpmcTime < syscallTime;
+        }
+#endif
+
+        return counters;
+    }
+
+    void destroyPerfCounters( PerfCounters *counters )
+    {
+        const long pageSize = sysconf( _SC_PAGESIZE );
+        for( std::size_t i=0; i < PERF_COUNTER_COUNT; ++i ) {
+            if( counters->pages[i] ) {
+                munmap( counters->pages[i], pageSize );
+            }
+        }
+        // the leader last, it holds the group
+        for( std::size_t i=0; i < PERF_COUNTER_COUNT; ++i ) {
+            if( counters->fds[i] != -1 && counters->fds[i] != counters->leader ) {
+                close( counters->fds[i] );
+            }
+        }
+        close( counters->leader );
+
+        Allocator *allocator = counters->allocator;
+        counters->~PerfCounters();
+        allocator->free( counters );
+    }
+
+    namespace perfCounters
+    {
+        bool available( const PerfCounters *counters, PerfCounter counter )
+        {
+            return counters->fds[std::size_t(counter)] != -1;
+        }
+
+        bool usesRdpmc( const PerfCounters *counters )
+        {
+            return counters->rdpmc;
+        }
+
+        void read( PerfCounters *counters, PerfCounterValues &values )
+        {
+            std::memset( &values, 0, sizeof(values) );
+
+            // both give the same raw counts, so a scope can begin with one and end with the other
+            if( counters->rdpmc && readRdpmc(counters, values) ) return;
+            readSyscall( counters, values );
+        }
+    }
+}
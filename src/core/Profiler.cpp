@@ -0,0 +1,414 @@
+#include "core/Profiler.h"
+#include "core/Allocator.h"
+#include "core/Array.h"
+#include "core/FlatMap.h"
+#include "core/Assume.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <new>
+
+namespace Core
+{
+    namespace detail
+    {
+        std::atomic<uint64_t> profileGeneration( 0 );
+        thread_local ProfileRing *profileThreadRing = nullptr;
+        thread_local uint64_t profileThreadGeneration = 0;
+    }
+
+    namespace {
+        static const std::size_t THREAD_NAME_SIZE = 32;
+
+        struct OpenScope {
+            const ProfileSite *site;
+            uint64_t begin;
+            // time spent in the scopes inside it
+            uint64_t children;
+            PerfCounterValues counters;
+        };
+
+        struct TraceScope {
+            const ProfileSite *site;
+            uint32_t thread;
+            uint64_t begin,
+                     end;
+            PerfCounterValues counters;
+        };
+
+        struct SiteStats {
+            uint64_t count;
+            uint64_t total,
+                     self,
+                     min,
+                     max;
+            PerfCounterValues counters;
+        };
+
+        struct ProfileThread {
+            detail::ProfileRing ring;
+            uint32_t id;
+            char name[THREAD_NAME_SIZE];
+            // scopes that have begun but not ended, as of the last collect
+            Array<OpenScope> open;
+        };
+
+        struct ProfilerState {
+            Allocator *allocator;
+            std::size_t eventsPerThread;
+            bool perfCounters;
+
+            uint64_t startTime;
+            std::chrono::steady_clock::time_point startClock;
+
+            std::mutex lock;
+            Array<ProfileThread*> threads;
+            Array<TraceScope> trace;
+            FlatMap<uintptr_t, SiteStats> sites;
+        };
+
+        std::atomic<ProfilerState*> profilerState( nullptr );
+
+        // ticks of detail::profileTime per millisecond, measured over the time the profiler has run
+        double ticksPerMs( const ProfilerState *state )
+        {
+#if defined(__x86_64__) || defined(__i386__)
+            uint64_t ticks = detail::profileTime() - state->startTime;
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - state->startClock;
+            if( ticks == 0 || elapsed.count() <= 0.0 ) return 1.0e6;
+            return double(ticks) / elapsed.count();
+#else
+            (void)state;
+            return 1.0e6;
+#endif
+        }
+
+        void addScope( ProfilerState *state, const ProfileSite *site, uint64_t duration, uint64_t self, const PerfCounterValues &counters )
+        {
+            const uintptr_t key = reinterpret_cast<uintptr_t>( site );
+            SiteStats *stats = flatMap::find( state->sites, key );
+            if( !stats ) {
+                SiteStats initial;
+                std::memset( &initial, 0, sizeof(initial) );
+                initial.min = ~uint64_t(0);
+                flatMap::insert( state->sites, key, initial );
+                stats = flatMap::find( state->sites, key );
+            }
+
+            stats->count++;
+            stats->total += duration;
+            stats->self += self;
+            stats->min = std::min( stats->min, duration );
+            stats->max = std::max( stats->max, duration );
+            perfCounters::add( stats->counters, counters );
+        }
+
+        // pairs the begin and end events of thread into scopes
+        void drain( ProfilerState *state, ProfileThread *thread )
+        {
+            detail::ProfileRing &ring = thread->ring;
+            const uint64_t head = ring.head.load( std::memory_order_acquire );
+            uint64_t tail = ring.tail.load( std::memory_order_relaxed );
+
+            for( ; tail != head; ++tail ) {
+                const detail::ProfileEvent &event = ring.events[tail & ring.mask];
+                const ProfileSite *site = reinterpret_cast<const ProfileSite*>( event.site & ~uintptr_t(1) );
+
+                PerfCounterValues counters;
+                if( ring.counters ) {
+                    counters = ring.counters[tail & ring.mask];
+                }
+                else {
+                    std::memset( &counters, 0, sizeof(counters) );
+                }
+
+                if( !(event.site & 1) ) {
+                    OpenScope open = { site, event.time, 0, counters };
+                    array::pushBack( thread->open, open );
+                    continue;
+                }
+
+                // a dropped begin leaves its end unmatched, and a dropped end leaves its begin open
+                std::size_t depth = array::size( thread->open );
+                while( depth > 0 && thread->open[depth-1].site != site ) {
+                    depth--;
+                }
+                if( depth == 0 ) continue;
+                thread->open._size = depth;
+
+                OpenScope open = array::popBack( thread->open );
+                uint64_t duration = event.time - open.begin;
+                if( array::size(thread->open) > 0 ) {
+                    thread->open[array::size(thread->open)-1].children += duration;
+                }
+
+                TraceScope scope = { site, thread->id, open.begin, event.time, perfCounters::difference(counters, open.counters) };
+                array::pushBack( state->trace, scope );
+                addScope( state, site, duration, duration > open.children ? duration - open.children : 0, scope.counters );
+            }
+
+            ring.tail.store( tail, std::memory_order_release );
+        }
+
+        void writeEscaped( FILE *file, const char *text )
+        {
+            for( ; *text; ++text ) {
+                if( *text == '"' || *text == '\\' ) {
+                    std::fputc( '\\', file );
+                }
+                if( uint8_t(*text) >= 0x20 ) {
+                    std::fputc( *text, file );
+                }
+            }
+        }
+    }
+
+    namespace detail
+    {
+        ProfileRing* profileRegisterThread()
+        {
+            // read before the state, so a start in between registers the thread again
+            profileThreadGeneration = profileGeneration.load( std::memory_order_acquire );
+            profileThreadRing = nullptr;
+
+            ProfilerState *state = profilerState.load( std::memory_order_acquire );
+            if( !state ) return nullptr;
+
+            std::lock_guard<std::mutex> lock( state->lock );
+
+            void *memory = state->allocator->allocate( sizeof(ProfileThread), alignof(ProfileThread) );
+            ProfileThread *thread = new (memory) ProfileThread;
+            thread->ring.events = static_cast<ProfileEvent*>( state->allocator->allocate(state->eventsPerThread*sizeof(ProfileEvent), alignof(ProfileEvent)) );
+            thread->ring.mask = state->eventsPerThread - 1;
+            thread->ring.perf = nullptr;
+            thread->ring.counters = nullptr;
+            if( state->perfCounters ) {
+                // opened by the thread itself, since they count the thread that opens them
+                thread->ring.perf = createPerfCounters( state->allocator );
+                if( thread->ring.perf ) {
+                    thread->ring.counters = static_cast<PerfCounterValues*>( state->allocator->allocate(state->eventsPerThread*sizeof(PerfCounterValues), alignof(PerfCounterValues)) );
+                }
+            }
+            thread->ring.head.store( 0, std::memory_order_relaxed );
+            thread->ring.tail.store( 0, std::memory_order_relaxed );
+            thread->ring.dropped.store( 0, std::memory_order_relaxed );
+            thread->id = uint32_t( array::size(state->threads) );
+            std::snprintf( thread->name, THREAD_NAME_SIZE, "Thread %u", thread->id );
+            thread->open._allocator = state->allocator;
+
+            array::pushBack( state->threads, thread );
+
+            profileThreadRing = &thread->ring;
+            return &thread->ring;
+        }
+    }
+
+    namespace profiler
+    {
+        void start( Allocator *allocator, std::size_t eventsPerThread, bool perfCounters )
+        {
+            ASSUME_TRUE( allocator != nullptr );
+            ASSUME_TRUE( profilerState.load() == nullptr );
+
+            std::size_t capasity = 2;
+            while( capasity < eventsPerThread ) capasity *= 2;
+
+            void *memory = allocator->allocate( sizeof(ProfilerState), alignof(ProfilerState) );
+            ProfilerState *state = new (memory) ProfilerState;
+            state->allocator = allocator;
+            state->eventsPerThread = capasity;
+            state->perfCounters = perfCounters;
+            state->startTime = detail::profileTime();
+            state->startClock = std::chrono::steady_clock::now();
+            state->threads._allocator = allocator;
+            state->trace._allocator = allocator;
+            state->sites._keys._allocator = allocator;
+            state->sites._values._allocator = allocator;
+
+            profilerState.store( state, std::memory_order_release );
+            // every thread registers again, with the new state
+            detail::profileGeneration.fetch_add( 1 );
+        }
+
+        void stop()
+        {
+            ProfilerState *state = profilerState.exchange( nullptr );
+            if( !state ) return;
+            detail::profileGeneration.fetch_add( 1 );
+
+            Allocator *allocator = state->allocator;
+            for( ProfileThread **thread = array::begin(state->threads); thread != array::end(state->threads); ++thread ) {
+                allocator->free( (*thread)->ring.events );
+                if( (*thread)->ring.perf ) {
+                    destroyPerfCounters( (*thread)->ring.perf );
+                    allocator->free( (*thread)->ring.counters );
+                }
+                (*thread)->~ProfileThread();
+                allocator->free( *thread );
+            }
+
+            state->~ProfilerState();
+            allocator->free( state );
+        }
+
+        bool running()
+        {
+            return profilerState.load( std::memory_order_relaxed ) != nullptr;
+        }
+
+        void setThreadName( const char *name )
+        {
+            ProfilerState *state = profilerState.load( std::memory_order_acquire );
+            if( !state ) return;
+
+            detail::ProfileRing *ring = detail::profileThreadRing;
+            if( detail::profileThreadGeneration != detail::profileGeneration.load(std::memory_order_relaxed) ) {
+                ring = detail::profileRegisterThread();
+            }
+            if( !ring ) return;
+
+            // the ring is the first member of the thread
+            std::lock_guard<std::mutex> lock( state->lock );
+            ProfileThread *thread = reinterpret_cast<ProfileThread*>( ring );
+            std::snprintf( thread->name, THREAD_NAME_SIZE, "%s", name );
+        }
+
+        void collect()
+        {
+            ProfilerState *state = profilerState.load( std::memory_order_acquire );
+            if( !state ) return;
+
+            std::lock_guard<std::mutex> lock( state->lock );
+            for( ProfileThread **thread = array::begin(state->threads); thread != array::end(state->threads); ++thread ) {
+                drain( state, *thread );
+            }
+        }
+
+        void reset()
+        {
+            ProfilerState *state = profilerState.load( std::memory_order_acquire );
+            if( !state ) return;
+
+            std::lock_guard<std::mutex> lock( state->lock );
+            state->trace._size = 0;
+            flatMap::clear( state->sites );
+        }
+
+        uint64_t droppedEvents()
+        {
+            ProfilerState *state = profilerState.load( std::memory_order_acquire );
+            if( !state ) return 0;
+
+            std::lock_guard<std::mutex> lock( state->lock );
+            uint64_t dropped = 0;
+            for( ProfileThread **thread = array::begin(state->threads); thread != array::end(state->threads); ++thread ) {
+                dropped += (*thread)->ring.dropped.load( std::memory_order_relaxed );
+            }
+            return dropped;
+        }
+
+        void summary( Array<ProfileSummary> &summary )
+        {
+            summary._size = 0;
+
+            ProfilerState *state = profilerState.load( std::memory_order_acquire );
+            if( !state ) return;
+
+            std::lock_guard<std::mutex> lock( state->lock );
+            const double scale = 1.0 / ticksPerMs( state );
+
+            const std::size_t count = flatMap::size( state->sites );
+            const uintptr_t *keys = flatMap::keys( state->sites );
+            const SiteStats *values = flatMap::values( state->sites );
+            for( std::size_t i=0; i < count; ++i ) {
+                ProfileSummary entry;
+                entry.site = reinterpret_cast<const ProfileSite*>( keys[i] );
+                entry.count = values[i].count;
+                entry.totalMs = double(values[i].total) * scale;
+                entry.selfMs = double(values[i].self) * scale;
+                entry.minMs = double(values[i].min) * scale;
+                entry.maxMs = double(values[i].max) * scale;
+                entry.counters = values[i].counters;
+                array::pushBack( summary, entry );
+            }
+
+            std::sort( array::begin(summary), array::end(summary), []( const ProfileSummary &a, const ProfileSummary &b ) {
+                return a.totalMs > b.totalMs;
+            });
+        }
+
+        void printSummary( FILE *file )
+        {
+            ProfilerState *state = profilerState.load( std::memory_order_acquire );
+            if( !state ) return;
+
+            Array<ProfileSummary> entries( state->allocator );
+            summary( entries );
+
+            std::fprintf( file, "%-32s %10s %12s %12s %10s %10s %10s", "Scope", "Count", "Total ms", "Self ms", "Avg ms", "Min ms", "Max ms" );
+            if( state->perfCounters ) {
+                std::fprintf( file, " %6s %14s %14s", "IPC", "Misses/call", "LLC loads/call" );
+            }
+            std::fprintf( file, "\n" );
+
+            for( ProfileSummary *entry = array::begin(entries); entry != array::end(entries); ++entry ) {
+                std::fprintf( file, "%-32s %10llu %12.3f %12.3f %10.4f %10.4f %10.4f",
+                              entry->site->name, (unsigned long long)entry->count, entry->totalMs, entry->selfMs,
+                              entry->totalMs / double(entry->count), entry->minMs, entry->maxMs );
+                if( state->perfCounters ) {
+                    std::fprintf( file, " %6.2f %14.1f %14.1f", perfCounters::ipc(entry->counters),
+                                  double(entry->counters.cacheMisses) / double(entry->count),
+                                  double(entry->counters.llcLoads) / double(entry->count) );
+                }
+                std::fprintf( file, "\n" );
+            }
+        }
+
+        bool writeChromeTrace( const char *path )
+        {
+            ProfilerState *state = profilerState.load( std::memory_order_acquire );
+            if( !state ) return false;
+
+            FILE *file = std::fopen( path, "w" );
+            if( !file ) return false;
+
+            std::lock_guard<std::mutex> lock( state->lock );
+            const double ticksPerUs = ticksPerMs( state ) / 1000.0;
+
+            std::fprintf( file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n" );
+
+            bool first = true;
+            for( ProfileThread **thread = array::begin(state->threads); thread != array::end(state->threads); ++thread ) {
+                std::fprintf( file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"", first ? "" : ",\n", (*thread)->id );
+                writeEscaped( file, (*thread)->name );
+                std::fprintf( file, "\"}}" );
+                first = false;
+            }
+
+            // complete events, with the begin time and duration in microseconds
+            for( TraceScope *scope = array::begin(state->trace); scope != array::end(state->trace); ++scope ) {
+                std::fprintf( file, "%s{\"name\":\"", first ? "" : ",\n" );
+                writeEscaped( file, scope->site->name );
+                std::fprintf( file, "\",\"cat\":\"core\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"file\":\"",
+                              scope->thread, double(scope->begin - state->startTime) / ticksPerUs, double(scope->end - scope->begin) / ticksPerUs );
+                writeEscaped( file, scope->site->file );
+                std::fprintf( file, "\",\"line\":%i", scope->site->line );
+                if( state->perfCounters ) {
+                    std::fprintf( file, ",\"cycles\":%llu,\"instructions\":%llu,\"cacheMisses\":%llu,\"branchMisses\":%llu,\"llcLoads\":%llu",
+                                  (unsigned long long)scope->counters.cycles, (unsigned long long)scope->counters.instructions,
+                                  (unsigned long long)scope->counters.cacheMisses, (unsigned long long)scope->counters.branchMisses,
+                                  (unsigned long long)scope->counters.llcLoads );
+                }
+                std::fprintf( file, "}}" );
+                first = false;
+            }
+
+            std::fprintf( file, "\n]}\n" );
+            bool written = std::ferror( file ) == 0;
+            std::fclose( file );
+            return written;
+        }
+    }
+}
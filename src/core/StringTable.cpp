@@ -0,0 +1,185 @@
+#include "core/StringTable.h"
+#include "core/Array.h"
+#include "core/Allocator.h"
+#include "core/Assume.h"
+
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <utility>
+
+namespace Core
+{
+    namespace {
+        static const std::size_t MIN_ENTRIES = 64;
+        
+        // STRING_ID is used from any thread, so the debug table is only touched with the lock held
+        std::atomic<StringTable*> debugTable( nullptr );
+        std::mutex debugLock;
+        
+        // Returns the slot for hash, either the one holding it or the empty slot where it should go
+        std::size_t findSlot( const StringTable &table, uint64_t hash )
+        {
+            const std::size_t mask = array::size(table._entries) - 1;
+            std::size_t slot = hash & mask;
+            while( table._entries[slot].string && table._entries[slot].hash != hash ) {
+                slot = (slot + 1) & mask;
+            }
+            return slot;
+        }
+        
+        void grow( StringTable &table )
+        {
+            std::size_t capasity = array::size(table._entries) * 2;
+            if( capasity < MIN_ENTRIES ) capasity = MIN_ENTRIES;
+            
+            Array<StringTable::Entry> entries( std::move(table._entries) );
+            table._entries = Array<StringTable::Entry>( table._allocator );
+            array::resize( table._entries, capasity );
+            
+            for( const StringTable::Entry *entry = array::begin(entries); entry != array::end(entries); ++entry ) {
+                if( entry->string ) {
+                    table._entries[findSlot(table, entry->hash)] = *entry;
+                }
+            }
+        }
+        
+        // Returns the entry with hash, or nullptr
+        const StringTable::Entry* findEntry( const StringTable &table, uint64_t hash )
+        {
+            if( table._count == 0 ) return nullptr;
+            const StringTable::Entry &entry = table._entries[findSlot(table, hash)];
+            return entry.string ? &entry : nullptr;
+        }
+        
+        // copies the string into the arena, strings are never moved once they are stored
+        const char* store( StringTable &table, const char *string, std::size_t length )
+        {
+            if( table._blockUsed + length + 1 > table._blockSize ) {
+                std::size_t size = length + 1 > StringTable::ARENA_BLOCK_SIZE ? length + 1 : StringTable::ARENA_BLOCK_SIZE;
+                char *block = static_cast<char*>( table._allocator->allocate(size, 1) );
+                array::pushBack( table._blocks, block );
+                
+                table._blockUsed = 0;
+                table._blockSize = size;
+            }
+            
+            char *result = table._blocks[array::size(table._blocks)-1] + table._blockUsed;
+            std::memcpy( result, string, length );
+            result[length] = '\0';
+            
+            table._blockUsed += length + 1;
+            return result;
+        }
+    }
+    
+    StringTable::StringTable( Allocator *allocator ) :
+        _allocator(allocator),
+        _entries(allocator),
+        _blocks(allocator)
+    {
+        ASSUME_TRUE( _allocator != nullptr );
+    }
+    
+    StringTable::~StringTable()
+    {
+        for( char **block = array::begin(_blocks); block != array::end(_blocks); ++block ) {
+            _allocator->free( *block );
+        }
+        if( debugTable == this ) {
+            debugTable = nullptr;
+        }
+    }
+    
+    namespace stringTable
+    {
+        uint64_t hash( const char *string, std::size_t length )
+        {
+            uint64_t hash = 14695981039346656037ull;
+            for( std::size_t i=0; i < length; ++i ) {
+                hash = (hash ^ uint64_t(uint8_t(string[i]))) * 1099511628211ull;
+            }
+            return hash;
+        }
+        
+        bool tryIntern( StringTable &table, const char *string, std::size_t length, StringId &id )
+        {
+            ASSUME_TRUE( length < 0xffffffff );
+            
+            id.value = hash( string, length );
+            
+            // looked up before growing, so interning a string that is already there never rehashes
+            if( const StringTable::Entry *entry = findEntry(table, id.value) ) {
+                // same hash, it has to be the same string
+                return entry->length == length && std::memcmp( entry->string, string, length ) == 0;
+            }
+            
+            // keep the load factor at or below 1/2
+            if( (table._count+1)*2 > array::size(table._entries) ) {
+                grow( table );
+            }
+            
+            StringTable::Entry &entry = table._entries[findSlot(table, id.value)];
+            entry.string = store( table, string, length );
+            entry.hash = id.value;
+            entry.length = uint32_t( length );
+            table._count++;
+            
+            return true;
+        }
+        
+        StringId intern( StringTable &table, const char *string, std::size_t length )
+        {
+            StringId id;
+            bool interned = tryIntern( table, string, length, id );
+            ASSUME_TRUE( interned && "Two different strings have the same StringId" );
+            return id;
+        }
+        
+        StringId intern( StringTable &table, const char *string )
+        {
+            return intern( table, string, std::strlen(string) );
+        }
+        
+        const char* lookup( const StringTable &table, StringId id )
+        {
+            const StringTable::Entry *entry = findEntry( table, id.value );
+            return entry ? entry->string : nullptr;
+        }
+        
+        std::size_t length( const StringTable &table, StringId id )
+        {
+            const StringTable::Entry *entry = findEntry( table, id.value );
+            return entry ? entry->length : 0;
+        }
+        
+        std::size_t size( const StringTable &table )
+        {
+            return table._count;
+        }
+        
+        void setDebugTable( StringTable *table )
+        {
+            // once this returns no check is using the previous table
+            std::lock_guard<std::mutex> lock( debugLock );
+            debugTable.store( table, std::memory_order_relaxed );
+        }
+        
+        StringTable* getDebugTable()
+        {
+            return debugTable.load( std::memory_order_relaxed );
+        }
+        
+        StringId checkedId( StringId id, const char *string )
+        {
+            if( !debugTable.load(std::memory_order_relaxed) ) return id;
+            
+            std::lock_guard<std::mutex> lock( debugLock );
+            if( StringTable *table = debugTable.load(std::memory_order_relaxed) ) {
+                // interning asserts if the id collides with a different string
+                intern( *table, string );
+            }
+            return id;
+        }
+    }
+}
@@ -0,0 +1,185 @@
+#include "core/Sync.h"
+
+#include <climits>
+#include <thread>
+
+#ifdef __linux__
+#   include <linux/futex.h>
+#   include <sys/syscall.h>
+#   include <unistd.h>
+#endif
+
+namespace Core
+{
+    namespace detail
+    {
+#ifdef __linux__
+        void futexWait( std::atomic<uint32_t> *address, uint32_t expected )
+        {
+            syscall( SYS_futex, reinterpret_cast<uint32_t*>(address), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0 );
+        }
+
+        void futexWake( std::atomic<uint32_t> *address, int count )
+        {
+            syscall( SYS_futex, reinterpret_cast<uint32_t*>(address), FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0 );
+        }
+#else
+        // without futexes waiters just yield, and wakes are implied by the value changing
+        void futexWait( std::atomic<uint32_t> *address, uint32_t expected )
+        {
+            if( address->load() == expected ) {
+                std::this_thread::yield();
+            }
+        }
+
+        void futexWake( std::atomic<uint32_t> *, int )
+        {
+        }
+#endif
+
+        void Backoff::pause()
+        {
+            if( mPauses > MAX_PAUSES ) {
+                std::this_thread::yield();
+                return;
+            }
+            for( uint32_t i=0; i < mPauses; ++i ) {
+                cpuRelax();
+            }
+            mPauses *= 2;
+        }
+    }
+
+    void SpinLock::lockContended()
+    {
+        if( mStats ) mStats->contentions.fetch_add( 1, std::memory_order_relaxed );
+
+        detail::Backoff backoff;
+        uint64_t spins = 0;
+        do {
+            // wait for it to look free before trying again, so the cache line isn't written while it's held
+            while( mLocked.load(std::memory_order_relaxed) ) {
+                backoff.pause();
+                spins++;
+            }
+        } while( mLocked.exchange(true, std::memory_order_acquire) );
+
+        if( mStats ) {
+            mStats->acquisitions.fetch_add( 1, std::memory_order_relaxed );
+            mStats->spins.fetch_add( spins, std::memory_order_relaxed );
+        }
+    }
+
+    /* The three state mutex from "Futexes Are Tricky" ( Drepper 2011 ),
+     * a waiter that sleeps marks the lock LOCKED_WAITERS, so unlock knows to wake someone
+     * The spin limit follows the estimate like PTHREAD_MUTEX_ADAPTIVE_NP, and the estimate moves 1/8 of
+     * the way to what this waiter spun, which is the whole limit when it gave up and slept
+     */
+    void Mutex::lockContended()
+    {
+        if( mStats ) mStats->contentions.fetch_add( 1, std::memory_order_relaxed );
+
+        const int estimate = mSpinEstimate.load( std::memory_order_relaxed );
+        const int limit = estimate*2 + 10 < MAX_SPINS ? estimate*2 + 10 : MAX_SPINS;
+
+        int spins = 0;
+        bool locked = false;
+        while( spins < limit ) {
+            spins++;
+            uint32_t state = UNLOCKED;
+            if( mState.load(std::memory_order_relaxed) == UNLOCKED &&
+                mState.compare_exchange_weak(state, LOCKED, std::memory_order_acquire, std::memory_order_relaxed) ) {
+                locked = true;
+                break;
+            }
+            cpuRelax();
+        }
+        mSpinEstimate.store( estimate + (spins - estimate)/8, std::memory_order_relaxed );
+        if( mStats ) mStats->spins.fetch_add( uint64_t(spins), std::memory_order_relaxed );
+
+        if( !locked ) lockWaiter();
+        if( mStats ) mStats->acquisitions.fetch_add( 1, std::memory_order_relaxed );
+    }
+
+    void Mutex::lockWaiter()
+    {
+        // whoever gets it this way can't know if there are other waiters, so it leaves it as LOCKED_WAITERS
+        while( mState.exchange(LOCKED_WAITERS, std::memory_order_acquire) != UNLOCKED ) {
+            if( mStats ) mStats->sleeps.fetch_add( 1, std::memory_order_relaxed );
+            detail::futexWait( &mState, LOCKED_WAITERS );
+        }
+    }
+
+    void Condition::wait( Mutex &mutex )
+    {
+        uint32_t sequence = mSequence.load( std::memory_order_relaxed );
+        mutex.unlock();
+        detail::futexWait( &mSequence, sequence );
+        mutex.lockWaiter();
+    }
+
+    void Condition::notifyOne()
+    {
+        mSequence.fetch_add( 1, std::memory_order_relaxed );
+        detail::futexWake( &mSequence, 1 );
+    }
+
+    void Condition::notifyAll()
+    {
+        mSequence.fetch_add( 1, std::memory_order_relaxed );
+        detail::futexWake( &mSequence, INT_MAX );
+    }
+
+    void RWLock::lockSharedContended()
+    {
+        if( mStats ) mStats->contentions.fetch_add( 1, std::memory_order_relaxed );
+
+        detail::Backoff backoff;
+        for( int round=0; ; ++round ) {
+            uint32_t state = mState.load( std::memory_order_relaxed );
+            if( !(state & WRITER) ) {
+                if( mState.compare_exchange_weak(state, state+1, std::memory_order_acquire, std::memory_order_relaxed) ) break;
+                continue;
+            }
+
+            if( round < Mutex::MAX_SPINS ) {
+                if( mStats ) mStats->spins.fetch_add( 1, std::memory_order_relaxed );
+                backoff.pause();
+                continue;
+            }
+
+            // the waiter count is raised before the state is checked again by the futex, and unlock does the reverse
+            mWaiters.fetch_add( 1 );
+            if( mStats ) mStats->sleeps.fetch_add( 1, std::memory_order_relaxed );
+            detail::futexWait( &mState, state );
+            mWaiters.fetch_sub( 1 );
+        }
+        if( mStats ) mStats->acquisitions.fetch_add( 1, std::memory_order_relaxed );
+    }
+
+    void RWLock::lockContended()
+    {
+        if( mStats ) mStats->contentions.fetch_add( 1, std::memory_order_relaxed );
+
+        detail::Backoff backoff;
+        for( int round=0; ; ++round ) {
+            uint32_t state = mState.load( std::memory_order_relaxed );
+            if( state == 0 ) {
+                if( mState.compare_exchange_weak(state, WRITER, std::memory_order_acquire, std::memory_order_relaxed) ) break;
+                continue;
+            }
+
+            if( round < Mutex::MAX_SPINS ) {
+                if( mStats ) mStats->spins.fetch_add( 1, std::memory_order_relaxed );
+                backoff.pause();
+                continue;
+            }
+
+            mWaiters.fetch_add( 1 );
+            if( mStats ) mStats->sleeps.fetch_add( 1, std::memory_order_relaxed );
+            detail::futexWait( &mState, state );
+            mWaiters.fetch_sub( 1 );
+        }
+        if( mStats ) mStats->acquisitions.fetch_add( 1, std::memory_order_relaxed );
+    }
+}
@@ -0,0 +1,168 @@
+#include "catch.hpp"
+
+#include "core/AllocationTracker.h"
+#include "core/Allocator.h"
+#include "core/Array.h"
+
+#include <cstring>
+#include <thread>
+
+
+namespace {
+    const Core::AllocationSiteStats* findSite( Core::Array<Core::AllocationSiteStats> &sites, const char *subsystem )
+    {
+        for( Core::AllocationSiteStats *site = Core::array::begin(sites); site != Core::array::end(sites); ++site ) {
+            if( std::strcmp(site->tag->subsystem, subsystem) == 0 ) return site;
+        }
+        return nullptr;
+    }
+
+    void* allocateMesh( Core::Allocator *allocator, std::size_t size )
+    {
+        return CORE_ALLOCATE( allocator, "Mesh", size, 16 );
+    }
+}
+
+TEST_CASE( "[Core][AllocationTracker]" )
+{
+    Core::initAllocators();
+
+    using namespace Core::allocationTracker;
+
+    Core::AllocationTracker *tracker = Core::createAllocationTracker( Core::getDefaultAllocator() );
+    Core::Allocator *allocator = Core::allocationTracker::allocator( tracker );
+
+    SECTION( "Tagged" ) {
+        Core::Array<Core::AllocationSiteStats> sites( Core::getDefaultAllocator() );
+
+        void *meshes[4];
+        for( int i=0; i < 4; ++i ) {
+            meshes[i] = allocateMesh( allocator, 100 );
+            REQUIRE( meshes[i] != nullptr );
+            REQUIRE( (reinterpret_cast<uintptr_t>(meshes[i]) % 16) == 0 );
+        }
+        void *untagged = allocator->allocate( 50, 1 );
+        void *aligned = CORE_ALLOCATE( allocator, "Texture", 256, 256 );
+        REQUIRE( (reinterpret_cast<uintptr_t>(aligned) % 256) == 0 );
+
+        REQUIRE( liveBytes(tracker) == 4*100 + 50 + 256 );
+
+        snapshot( tracker, sites );
+        REQUIRE( Core::array::size(sites) == 3 );
+        // sorted by live bytes
+        REQUIRE( std::strcmp(sites[0].tag->subsystem, "Mesh") == 0 );
+        REQUIRE( sites[0].liveBytes == 400 );
+        REQUIRE( sites[0].liveCount == 4 );
+        REQUIRE( std::strstr(sites[0].tag->file, "test_allocation_tracker.cpp") != nullptr );
+        REQUIRE( findSite(sites, "Untagged")->liveBytes == 50 );
+        REQUIRE( findSite(sites, "Texture")->liveBytes == 256 );
+
+        allocator->free( meshes[0] );
+        allocator->free( meshes[1] );
+        allocator->free( untagged );
+        allocator->free( aligned );
+
+        snapshot( tracker, sites );
+        const Core::AllocationSiteStats *mesh = findSite( sites, "Mesh" );
+        REQUIRE( mesh->liveBytes == 200 );
+        REQUIRE( mesh->liveCount == 2 );
+        REQUIRE( mesh->peakBytes == 400 );
+        REQUIRE( mesh->totalBytes == 400 );
+        REQUIRE( mesh->totalCount == 4 );
+        // nothing was allocated since the previous snapshot
+        REQUIRE( mesh->allocationsPerSecond == 0.0 );
+        REQUIRE( findSite(sites, "Untagged")->liveCount == 0 );
+
+        allocator->free( meshes[2] );
+        allocator->free( meshes[3] );
+        REQUIRE( liveBytes(tracker) == 0 );
+    }
+
+    SECTION( "Scopes" ) {
+        Core::Array<Core::AllocationSiteStats> sites( Core::getDefaultAllocator() );
+        Core::Array<Core::AllocationSubsystemStats> subsystems( Core::getDefaultAllocator() );
+
+        {
+            CORE_ALLOCATION_TAG( "Physics" );
+
+            // the array grows with reallocate, which keeps the tag
+            Core::Array<int> bodies( allocator );
+            for( int i=0; i < 1000; ++i ) {
+                Core::array::pushBack( bodies, i );
+            }
+            {
+                CORE_ALLOCATION_TAG( "Audio" );
+                allocator->free( allocator->allocate(64, 8) );
+            }
+            // an explicit tag wins over the scope
+            allocator->free( CORE_ALLOCATE(allocator, "Audio", 32, 8) );
+
+            snapshot( tracker, sites, &subsystems );
+            REQUIRE( Core::array::size(subsystems) == 2 );
+            REQUIRE( std::strcmp(subsystems[0].subsystem, "Physics") == 0 );
+            REQUIRE( subsystems[0].liveBytes >= 1000*sizeof(int) );
+            REQUIRE( subsystems[0].liveCount == 1 );
+            REQUIRE( std::strcmp(subsystems[1].subsystem, "Audio") == 0 );
+            REQUIRE( subsystems[1].liveBytes == 0 );
+            REQUIRE( subsystems[1].totalBytes == 96 );
+            REQUIRE( subsystems[1].totalCount == 2 );
+            REQUIRE( Core::array::size(sites) == 3 );
+        }
+        REQUIRE( Core::detail::currentAllocationTag == nullptr );
+        REQUIRE( liveBytes(tracker) == 0 );
+    }
+
+    SECTION( "Threads" ) {
+        Core::Array<Core::AllocationSiteStats> sites( Core::getDefaultAllocator() );
+
+        std::thread threads[4];
+        for( int t=0; t < 4; ++t ) {
+            threads[t] = std::thread( [allocator]() {
+                void *ptrs[16];
+                for( int i=0; i < 1000; ++i ) {
+                    ptrs[i % 16] = allocateMesh( allocator, 8 );
+                    if( (i % 16) == 15 ) {
+                        for( int j=0; j < 16; ++j ) {
+                            allocator->free( ptrs[j] );
+                        }
+                    }
+                }
+                // 1000 isn't a multiple of 16
+                for( int j=0; j < (1000 % 16); ++j ) {
+                    allocator->free( ptrs[j] );
+                }
+            });
+        }
+        for( int t=0; t < 4; ++t ) {
+            threads[t].join();
+        }
+
+        snapshot( tracker, sites );
+        REQUIRE( Core::array::size(sites) == 1 );
+        REQUIRE( sites[0].totalCount == 4000 );
+        REQUIRE( sites[0].liveCount == 0 );
+        REQUIRE( sites[0].allocationsPerSecond > 0.0 );
+    }
+
+    SECTION( "Print" ) {
+        void *ptr = allocateMesh( allocator, 1024 );
+
+        FILE *file = std::tmpfile();
+        REQUIRE( file != nullptr );
+        printSnapshot( tracker, file );
+
+        char text[1024] = {};
+        std::rewind( file );
+        std::size_t read = std::fread( text, 1, sizeof(text)-1, file );
+        std::fclose( file );
+
+        REQUIRE( read > 0 );
+        REQUIRE( std::strstr(text, "Subsystem") != nullptr );
+        REQUIRE( std::strstr(text, "Mesh test_allocation_tracker.cpp:") != nullptr );
+
+        allocator->free( ptr );
+    }
+
+    Core::destroyAllocationTracker( tracker );
+    Core::destroyAllocators();
+}
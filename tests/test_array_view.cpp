@@ -0,0 +1,73 @@
+#include "catch.hpp"
+
+#include "core/ArrayView.h"
+#include "core/SoAArray.h"
+
+
+TEST_CASE( "[Core][ArrayView]" )
+{
+    Core::initAllocators();
+    
+    using Core::Array;
+    using Core::ArrayView;
+    using Core::MutableArrayView;
+    using namespace Core::array;
+    
+    SECTION( "Construction" ) {
+        Array<int> array( Core::getDefaultAllocator() );
+        for( int i=0; i < 10; ++i ) {
+            pushBack( array, i );
+        }
+        
+        ArrayView<int> view( array );
+        REQUIRE( size(view) == 10 );
+        REQUIRE( begin(view) == begin(array) );
+        REQUIRE( view[9] == 9 );
+        
+        int data[4] = { 4, 3, 2, 1 };
+        MutableArrayView<int> mutableView( data );
+        REQUIRE( size(mutableView) == 4 );
+        mutableView[0] = 5;
+        REQUIRE( data[0] == 5 );
+        
+        ArrayView<int> constView( mutableView );
+        REQUIRE( constView[0] == 5 );
+    }
+    
+    SECTION( "Slices share the storage" ) {
+        Array<int> array( Core::getDefaultAllocator() );
+        for( int i=0; i < 10; ++i ) {
+            pushBack( array, 9-i );
+        }
+        
+        MutableArrayView<int> middle = mutableSlice( array, 2, 5 );
+        REQUIRE( &middle[0] == &array[2] );
+        
+        sort( middle );
+        REQUIRE( array[0] == 9 );
+        REQUIRE( array[2] == 3 );
+        REQUIRE( array[6] == 7 );
+        REQUIRE( array[7] == 2 );
+        
+        ArrayView<int> sorted = slice( array, 2, 5 );
+        REQUIRE( lowerBound(sorted, 5) == 2 );
+        REQUIRE( lowerBound(sorted, 100) == 5 );
+        REQUIRE( find(sorted, 7) == 4 );
+        REQUIRE( find(sorted, 9) == 5 );
+        REQUIRE( find(array, 9) == 0 );
+        REQUIRE( size(slice(sorted, 1, 2)) == 2 );
+    }
+    
+    SECTION( "SoAArray columns" ) {
+        Core::SoAArray<float, int> soa( Core::getDefaultAllocator() );
+        Core::soaArray::pushBack( soa, 1.f, 3 );
+        Core::soaArray::pushBack( soa, 2.f, 1 );
+        
+        MutableArrayView<int> column = Core::soaArray::columnView<1>( soa );
+        REQUIRE( size(column) == 2 );
+        sort( column );
+        REQUIRE( Core::soaArray::get<1>(soa, 0) == 1 );
+    }
+    
+    Core::destroyAllocators();
+}
@@ -0,0 +1,350 @@
+#include "catch.hpp"
+
+#include "core/AsyncFile.h"
+#include "core/Allocator.h"
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+
+namespace {
+    const uint32_t FILE_WORDS = 256*1024;
+
+    uint32_t wordAt( uint64_t offset )
+    {
+        return uint32_t( offset / 4 ) * 2654435761u;
+    }
+
+    bool checkWords( const void *buffer, uint64_t offset, std::size_t count )
+    {
+        const uint32_t *words = static_cast<const uint32_t*>( buffer );
+        for( std::size_t i=0; i < count; ++i ) {
+            if( words[i] != wordAt(offset + i*4) ) return false;
+        }
+        return true;
+    }
+
+    struct Canceled {
+        int completed;
+        int canceled;
+    };
+
+    void countCanceled( const Core::ReadRequest &request, int64_t result )
+    {
+        Canceled *canceled = static_cast<Canceled*>( request.userData );
+        if( result == -ECANCELED ) canceled->canceled++;
+        else canceled->completed++;
+    }
+
+    struct Order {
+        int order[3];
+        int count;
+    };
+
+    void recordOrder( const Core::ReadRequest &request, int64_t result )
+    {
+        Order *order = static_cast<Order*>( request.userData );
+        if( order->count < 3 && result == int64_t(request.size) ) {
+            order->order[order->count] = int( request.priority );
+        }
+        order->count++;
+    }
+
+    struct WaitForRead {
+        const Core::JobCounter *read;
+        std::atomic<bool> *resumed;
+    };
+
+    void waitForReadJob( Core::JobSystem *system, void *data )
+    {
+        WaitForRead wait = *static_cast<WaitForRead*>( data );
+        Core::jobSystem::waitForCounter( system, *wait.read );
+        wait.resumed->store( true );
+    }
+
+    // polls, so it only sees the job resume if something woke a worker for it
+    bool resumedWithin( const std::atomic<bool> &resumed, int milliseconds )
+    {
+        for( int i=0; i < milliseconds && !resumed.load(); ++i ) {
+            std::this_thread::sleep_for( std::chrono::milliseconds(1) );
+        }
+        return resumed.load();
+    }
+
+    void testBackend( Core::AsyncIO *io, const char *path )
+    {
+        using namespace Core::asyncIO;
+
+        REQUIRE( open(io, "test_async_file_missing.bin") == nullptr );
+
+        Core::AsyncFile *file = open( io, path );
+        REQUIRE( file != nullptr );
+        REQUIRE( fileSize(file) == FILE_WORDS*4 );
+
+        Core::Allocator *allocator = Core::getDefaultAllocator();
+
+        // a batch of reads spread over the file, more than fit in the queue at once
+        {
+            const std::size_t READS = 100,
+                              READ_SIZE = 4096;
+            uint8_t *data = static_cast<uint8_t*>( allocator->allocate(READS*READ_SIZE, 16) );
+            int64_t results[READS];
+
+            Core::JobCounter counter;
+            Core::ReadRequest requests[READS];
+            for( std::size_t i=0; i < READS; ++i ) {
+                std::memset( &requests[i], 0, sizeof(Core::ReadRequest) );
+                requests[i].file = file;
+                requests[i].offset = ((i*7919) % (FILE_WORDS*4/READ_SIZE)) * READ_SIZE;
+                requests[i].buffer = data + i*READ_SIZE;
+                requests[i].size = READ_SIZE;
+                requests[i].result = &results[i];
+                requests[i].counter = &counter;
+            }
+            read( io, requests, READS );
+            REQUIRE( pending(io) == READS );
+            REQUIRE( counter.value.load() == READS );
+
+            wait( io, counter );
+            REQUIRE( pending(io) == 0 );
+
+            bool correct = true;
+            for( std::size_t i=0; i < READS; ++i ) {
+                correct = correct && results[i] == int64_t(READ_SIZE);
+                correct = correct && checkWords( requests[i].buffer, requests[i].offset, READ_SIZE/4 );
+            }
+            REQUIRE( correct );
+
+            allocator->free( data );
+        }
+
+        // short reads at the end of the file
+        {
+            uint32_t words[4];
+            int64_t result = -1;
+
+            Core::JobCounter counter;
+            Core::ReadRequest request;
+            std::memset( &request, 0, sizeof(request) );
+            request.file = file;
+            request.offset = FILE_WORDS*4 - 8;
+            request.buffer = words;
+            request.size = sizeof(words);
+            request.result = &result;
+            request.counter = &counter;
+            read( io, request );
+            wait( io, counter );
+
+            REQUIRE( result == 8 );
+            REQUIRE( checkWords(words, FILE_WORDS*4 - 8, 2) );
+        }
+
+        // registered buffers
+        {
+            REQUIRE( registerBuffers(io, 8192, 4) );
+            REQUIRE( bufferSize(io) == 8192 );
+
+            void *buffers[4];
+            for( int i=0; i < 4; ++i ) {
+                buffers[i] = acquireBuffer( io );
+                REQUIRE( buffers[i] != nullptr );
+            }
+            REQUIRE( acquireBuffer(io) == nullptr );
+
+            Core::JobCounter counter;
+            for( int i=0; i < 4; ++i ) {
+                Core::ReadRequest request;
+                std::memset( &request, 0, sizeof(request) );
+                request.file = file;
+                request.offset = uint64_t(i) * 65536;
+                request.buffer = buffers[i];
+                request.size = 8192;
+                request.counter = &counter;
+                read( io, request );
+            }
+            wait( io, counter );
+
+            bool correct = true;
+            for( int i=0; i < 4; ++i ) {
+                correct = correct && checkWords( buffers[i], uint64_t(i) * 65536, 8192/4 );
+                releaseBuffer( io, buffers[i] );
+            }
+            REQUIRE( correct );
+            REQUIRE( acquireBuffer(io) != nullptr );
+        }
+
+        close( io, file );
+    }
+}
+
+TEST_CASE( "[Core][AsyncFile]" )
+{
+    Core::initAllocators();
+
+    using namespace Core::asyncIO;
+
+    const char *path = "test_async_file.bin";
+    {
+        FILE *out = fopen( path, "wb" );
+        REQUIRE( out != nullptr );
+        for( uint32_t i=0; i < FILE_WORDS; ++i ) {
+            uint32_t word = wordAt( uint64_t(i)*4 );
+            fwrite( &word, sizeof(word), 1, out );
+        }
+        fclose( out );
+    }
+
+    Core::Allocator *allocator = Core::getDefaultAllocator();
+
+    SECTION( "Thread pool" ) {
+        Core::AsyncIO *io = Core::createAsyncIO( allocator, 16, Core::AsyncIOBackend::ThreadPool, 2 );
+        REQUIRE( io != nullptr );
+        REQUIRE( backend(io) == Core::AsyncIOBackend::ThreadPool );
+
+        testBackend( io, path );
+        Core::destroyAsyncIO( io );
+    }
+
+    SECTION( "io_uring" ) {
+        // not every kernel, or sandbox, allows io_uring
+        Core::AsyncIO *io = Core::createAsyncIO( allocator, 16, Core::AsyncIOBackend::IoUring );
+        if( io ) {
+            REQUIRE( backend(io) == Core::AsyncIOBackend::IoUring );
+
+            testBackend( io, path );
+            Core::destroyAsyncIO( io );
+        }
+
+        io = Core::createAsyncIO( allocator );
+        REQUIRE( io != nullptr );
+        REQUIRE( backend(io) != Core::AsyncIOBackend::Auto );
+        Core::destroyAsyncIO( io );
+    }
+
+    SECTION( "Priorities" ) {
+        // with a single read in flight, the queued reads start in priority order
+        Core::AsyncIO *io = Core::createAsyncIO( allocator, 1 );
+        Core::AsyncFile *file = open( io, path );
+
+        Order order;
+        order.count = 0;
+
+        uint32_t words[3][16];
+        const Core::IOPriority priorities[3] = { Core::IOPriority::Low, Core::IOPriority::Normal, Core::IOPriority::High };
+
+        Core::JobCounter counter;
+        for( int i=0; i < 3; ++i ) {
+            Core::ReadRequest request;
+            std::memset( &request, 0, sizeof(request) );
+            request.file = file;
+            request.buffer = words[i];
+            request.size = sizeof(words[i]);
+            request.priority = priorities[i];
+            request.callback = recordOrder;
+            request.userData = &order;
+            request.counter = &counter;
+            read( io, request );
+        }
+        wait( io, counter );
+
+        REQUIRE( order.count == 3 );
+        REQUIRE( order.order[0] == int(Core::IOPriority::High) );
+        REQUIRE( order.order[1] == int(Core::IOPriority::Normal) );
+        REQUIRE( order.order[2] == int(Core::IOPriority::Low) );
+
+        close( io, file );
+        Core::destroyAsyncIO( io );
+    }
+
+    SECTION( "Destroy cancels queued reads" ) {
+        // the file belongs to another context, so it outlives the one that is destroyed
+        Core::AsyncIO *owner = Core::createAsyncIO( allocator );
+        Core::AsyncFile *file = open( owner, path );
+
+        Core::AsyncIO *io = Core::createAsyncIO( allocator, 1, Core::AsyncIOBackend::ThreadPool, 1 );
+
+        Canceled canceled = { 0, 0 };
+        uint32_t words[4][16];
+        int64_t results[4];
+
+        Core::JobCounter counter;
+        for( int i=0; i < 4; ++i ) {
+            Core::ReadRequest request;
+            std::memset( &request, 0, sizeof(request) );
+            request.file = file;
+            request.buffer = words[i];
+            request.size = sizeof(words[i]);
+            request.callback = countCanceled;
+            request.userData = &canceled;
+            request.result = results + i;
+            request.counter = &counter;
+            read( io, request );
+        }
+        // one in flight, the rest queued
+        REQUIRE( submit(io) == 1 );
+        Core::destroyAsyncIO( io );
+
+        REQUIRE( counter.value.load() == 0 );
+        REQUIRE( canceled.completed == 1 );
+        REQUIRE( canceled.canceled == 3 );
+        REQUIRE( results[0] == int64_t(sizeof(words[0])) );
+        REQUIRE( results[3] == -ECANCELED );
+
+        close( owner, file );
+        Core::destroyAsyncIO( owner );
+    }
+
+    SECTION( "Jobs wait for reads" ) {
+        Core::JobSystem *system = Core::createJobSystem( allocator, 4 );
+        Core::AsyncIO *io = Core::createAsyncIO( allocator );
+        Core::AsyncFile *file = open( io, path );
+
+        uint32_t words[16];
+        Core::JobCounter read;
+        Core::ReadRequest request;
+        std::memset( &request, 0, sizeof(request) );
+        request.file = file;
+        request.buffer = words;
+        request.size = sizeof(words);
+        request.counter = &read;
+        request.system = system;
+        Core::asyncIO::read( io, request );
+
+        // the job is taken by one of the other workers, which park it and go to sleep
+        std::atomic<bool> resumed( false );
+        WaitForRead waitData = { &read, &resumed };
+        Core::JobCounter jobs;
+        Core::jobSystem::run( system, waitForReadJob, &waitData, sizeof(waitData), &jobs );
+        std::this_thread::sleep_for( std::chrono::milliseconds(50) );
+        REQUIRE( !resumed.load() );
+
+        wait( io, read );
+        REQUIRE( resumedWithin(resumed, 5000) );
+        Core::jobSystem::wait( system, jobs );
+        REQUIRE( checkWords(words, 0, 16) );
+
+        // a counter decreased without the system, jobSystem::wait makes sure a worker resumes the job
+        Core::JobCounter plain;
+        plain.value.store( 1 );
+        resumed.store( false );
+        waitData.read = &plain;
+        Core::jobSystem::run( system, waitForReadJob, &waitData, sizeof(waitData), &jobs );
+        std::this_thread::sleep_for( std::chrono::milliseconds(50) );
+
+        std::thread other( [&plain]() { plain.value.fetch_sub( 1 ); } );
+        other.join();
+        Core::jobSystem::wait( system, jobs );
+        REQUIRE( resumed.load() );
+
+        close( io, file );
+        Core::destroyAsyncIO( io );
+        Core::destroyJobSystem( system );
+    }
+
+    std::remove( path );
+    Core::destroyAllocators();
+}
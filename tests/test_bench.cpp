@@ -0,0 +1,170 @@
+#include "catch.hpp"
+
+#include "core/Bench.h"
+#include "core/Allocator.h"
+
+#include <cstring>
+#include <string>
+#include <thread>
+#include <chrono>
+
+
+namespace {
+    using Core::BenchContext;
+    
+    void testBenchLoop( BenchContext &context )
+    {
+        uint64_t sum = 0;
+        for( uint64_t i=0; i < context.iterations * uint64_t(context.parameter); ++i ) {
+            sum += i;
+            Core::bench::doNotOptimize( sum );
+        }
+    }
+    CORE_BENCH( testBenchLoop, 10, 1000 );
+    
+    // sleeps while paused, which mustn't count
+    void testBenchPaused( BenchContext &context )
+    {
+        for( uint64_t i=0; i < context.iterations; ++i ) {
+            Core::bench::pause( context );
+            std::this_thread::sleep_for( std::chrono::microseconds(100) );
+            Core::bench::resume( context );
+            Core::bench::clobber();
+        }
+    }
+    CORE_BENCH( testBenchPaused );
+    
+    Core::BenchOptions quietOptions( const char *filter )
+    {
+        Core::BenchOptions options;
+        options.filter = filter;
+        options.warmupMs = 0.0;
+        options.sampleMs = 1.0;
+        options.samples = 5;
+        options.output = nullptr;
+        return options;
+    }
+    
+    std::string readFile( const char *path )
+    {
+        std::string text;
+        FILE *file = std::fopen( path, "r" );
+        if( !file ) return text;
+        
+        char buffer[512];
+        std::size_t read;
+        while( (read = std::fread(buffer, 1, sizeof(buffer), file)) > 0 ) {
+            text.append( buffer, read );
+        }
+        std::fclose( file );
+        return text;
+    }
+}
+
+TEST_CASE( "[Core][Bench]" )
+{
+    Core::initAllocators();
+    
+    using namespace Core::bench;
+    
+    SECTION( "Statistics" ) {
+        double odd[] = { 5, 1, 4, 2, 3 };
+        REQUIRE( median(odd, 5) == 3.0 );
+        
+        double even[] = { 8, 1, 4, 2 };
+        REQUIRE( median(even, 4) == 3.0 );
+        
+        // deviations 2, 1, 0, 1, 97
+        double outlier[] = { 1, 2, 3, 4, 100 };
+        REQUIRE( medianAbsoluteDeviation(outlier, 5) == 1.0 );
+        
+        REQUIRE( median(odd, 0) == 0.0 );
+    }
+    
+    SECTION( "Run" ) {
+        Core::Array<Core::BenchResult> results( Core::getDefaultAllocator() );
+        run( quietOptions("testBenchLoop"), results );
+        
+        REQUIRE( Core::array::size(results) == 2 );
+        REQUIRE( std::strcmp(results[0].name, "testBenchLoop") == 0 );
+        REQUIRE( results[0].parameter == 10 );
+        REQUIRE( results[1].parameter == 1000 );
+        
+        for( int i=0; i < 2; ++i ) {
+            REQUIRE( results[i].samples == 5 );
+            REQUIRE( results[i].iterations > 0 );
+            REQUIRE( results[i].minNs <= results[i].medianNs );
+            REQUIRE( results[i].medianNs <= results[i].maxNs );
+            REQUIRE( results[i].madNs >= 0.0 );
+            REQUIRE( results[i].countedIterations == 0 );
+        }
+        // calibrated so both samples take about as long
+        REQUIRE( results[0].iterations > results[1].iterations );
+        REQUIRE( results[0].medianNs < results[1].medianNs );
+    }
+    
+    SECTION( "Pause" ) {
+        Core::Array<Core::BenchResult> results( Core::getDefaultAllocator() );
+        Core::BenchOptions options = quietOptions( "testBenchPaused" );
+        options.samples = 3;
+        run( options, results );
+        
+        REQUIRE( Core::array::size(results) == 1 );
+        REQUIRE( results[0].parameter == 0 );
+        // far less than the 100 microseconds of sleep each iteration
+        REQUIRE( results[0].medianNs < 50000.0 );
+    }
+    
+    SECTION( "Output and compare" ) {
+        Core::Array<Core::BenchResult> results( Core::getDefaultAllocator() );
+        run( quietOptions("testBenchLoop"), results );
+        
+        const char *jsonPath = "test_bench.json";
+        const char *csvPath = "test_bench.csv";
+        REQUIRE( writeJson(jsonPath, results) );
+        REQUIRE( writeCsv(csvPath, results) );
+        
+        std::string json = readFile( jsonPath );
+        REQUIRE( json.find("{\"benchmarks\":[") == 0 );
+        REQUIRE( json.find("\"name\":\"testBenchLoop\",\"parameter\":1000") != std::string::npos );
+        std::string csv = readFile( csvPath );
+        REQUIRE( csv.find("name,parameter,iterations,samples,median_ns,mad_ns") == 0 );
+        REQUIRE( csv.find("testBenchLoop,10,") != std::string::npos );
+        
+        // the same results are no change
+        REQUIRE( compare(results, jsonPath, 0.05, nullptr) == 0 );
+        REQUIRE( compare(results, csvPath, 0.05, nullptr) == 0 );
+        
+        // three times slower than the baseline is a regression, faster isn't
+        Core::Array<Core::BenchResult> slower( results );
+        for( std::size_t i=0; i < Core::array::size(slower); ++i ) {
+            slower[i].medianNs *= 3.0;
+        }
+        REQUIRE( compare(slower, jsonPath, 0.05, nullptr) == 2 );
+        REQUIRE( compare(slower, csvPath, 0.05, nullptr) == 2 );
+        
+        REQUIRE( writeCsv(csvPath, slower) );
+        REQUIRE( compare(results, csvPath, 0.05, nullptr) == 0 );
+        
+        REQUIRE( compare(results, "test_bench_missing.json", 0.05, nullptr) == -1 );
+        
+        std::remove( jsonPath );
+        std::remove( csvPath );
+    }
+    
+    SECTION( "Options" ) {
+        Core::BenchOptions options;
+        const char *args[] = { "bench", "--filter=sort", "--samples=7", "--sample-ms=2.5", "--counters", "--json=out.json", "--baseline=base.csv", "--threshold=0.1" };
+        REQUIRE( parseOptions(8, const_cast<char**>(args), options) );
+        REQUIRE( std::strcmp(options.filter, "sort") == 0 );
+        REQUIRE( options.samples == 7 );
+        REQUIRE( options.sampleMs == 2.5 );
+        REQUIRE( options.perfCounters );
+        REQUIRE( std::strcmp(options.jsonPath, "out.json") == 0 );
+        REQUIRE( options.csvPath == nullptr );
+        REQUIRE( std::strcmp(options.baselinePath, "base.csv") == 0 );
+        REQUIRE( options.threshold == 0.1 );
+    }
+    
+    Core::destroyAllocators();
+}
@@ -0,0 +1,238 @@
+#include "catch.hpp"
+
+#include "core/BinaryFormat.h"
+#include "core/MappedArray.h"
+#include "core/Allocator.h"
+
+#include <cstdio>
+#include <cstring>
+
+
+TEST_CASE( "[Core][BinaryFormat]" )
+{
+    Core::initAllocators();
+
+    using Core::Array;
+    using Core::ArrayView;
+    using Core::SoAArray;
+    using Core::StringTable;
+    using Core::BinaryWriter;
+    using Core::BinaryReader;
+
+    Core::Allocator *allocator = Core::getDefaultAllocator();
+
+    const uint32_t VALUES = 1, PARTICLES = 2, STRINGS = 3;
+
+    {
+        BinaryWriter writer( allocator );
+
+        Array<int> values( allocator );
+        for( int i=0; i < 1000; ++i ) {
+            Core::array::pushBack( values, i*3 );
+        }
+        Core::binaryWriter::addArray( writer, VALUES, values );
+
+        SoAArray<float, uint8_t, double> particles( allocator );
+        for( int i=0; i < 300; ++i ) {
+            Core::soaArray::pushBack( particles, float(i), uint8_t(i), double(i)*0.5 );
+        }
+        Core::binaryWriter::addSoAArray( writer, PARTICLES, particles );
+
+        StringTable table( allocator );
+        Core::stringTable::intern( table, "position" );
+        Core::stringTable::intern( table, "velocity" );
+        Core::binaryWriter::addStringTable( writer, STRINGS, table );
+
+        const std::size_t fileSize = Core::binaryWriter::size( writer );
+        uint8_t *data = static_cast<uint8_t*>( allocator->allocate(fileSize, Core::BINARY_SECTION_ALIGNMENT) );
+        Core::binaryWriter::write( writer, data );
+
+        SECTION( "Read in place" ) {
+            BinaryReader reader;
+            REQUIRE( Core::binaryReader::open(reader, data, fileSize) );
+
+            ArrayView<int> view = Core::binaryReader::array<int>( reader, VALUES );
+            REQUIRE( view._size == 1000 );
+            REQUIRE( reinterpret_cast<const uint8_t*>(view._data) >= data );
+            REQUIRE( reinterpret_cast<const uint8_t*>(view._data) < data + fileSize );
+
+            bool same = true;
+            for( int i=0; i < 1000; ++i ) {
+                same = same && view[i] == i*3;
+            }
+            REQUIRE( same );
+
+            // wrong type or id gives a empty view
+            REQUIRE( Core::binaryReader::array<double>(reader, VALUES)._size == 0 );
+            REQUIRE( Core::binaryReader::array<int>(reader, 42)._size == 0 );
+            REQUIRE( Core::binaryReader::findSection(reader, 42) == nullptr );
+
+            ArrayView<uint8_t> bytes = Core::binaryReader::soaColumn<uint8_t>( reader, PARTICLES, 1 );
+            ArrayView<double> doubles = Core::binaryReader::soaColumn<double>( reader, PARTICLES, 2 );
+            REQUIRE( bytes._size == 300 );
+            REQUIRE( doubles._size == 300 );
+            REQUIRE( (reinterpret_cast<std::uintptr_t>(doubles._data) % Core::BINARY_SECTION_ALIGNMENT) == 0 );
+            REQUIRE( bytes[200] == 200 );
+            REQUIRE( doubles[299] == 149.5 );
+            REQUIRE( Core::binaryReader::soaColumn<double>(reader, PARTICLES, 3)._size == 0 );
+
+            REQUIRE( std::strcmp(Core::binaryReader::lookupString(reader, STRINGS, STRING_ID("velocity")), "velocity") == 0 );
+            REQUIRE( Core::binaryReader::lookupString(reader, STRINGS, Core::StringId{ Core::stringTable::hash("missing") }) == nullptr );
+        }
+
+        SECTION( "Load copies" ) {
+            BinaryReader reader;
+            REQUIRE( Core::binaryReader::open(reader, data, fileSize) );
+
+            SoAArray<float, uint8_t, double> loaded( allocator );
+            REQUIRE( Core::binaryReader::loadSoAArray(reader, PARTICLES, loaded) );
+            REQUIRE( Core::soaArray::size(loaded) == 300 );
+            REQUIRE( Core::soaArray::get<0>(loaded, 123) == 123.f );
+            REQUIRE( Core::soaArray::get<2>(loaded, 10) == 5.0 );
+
+            SoAArray<float, float> wrong( allocator );
+            REQUIRE( !Core::binaryReader::loadSoAArray(reader, PARTICLES, wrong) );
+
+            StringTable strings( allocator );
+            REQUIRE( Core::binaryReader::loadStringTable(reader, STRINGS, strings) );
+            REQUIRE( Core::stringTable::size(strings) == 2 );
+            REQUIRE( std::strcmp(Core::stringTable::lookup(strings, STRING_ID("position")), "position") == 0 );
+        }
+
+        SECTION( "Reject invalid data" ) {
+            BinaryReader reader;
+            REQUIRE( !Core::binaryReader::open(reader, data, 8) );
+
+            data[4] = 99; // version
+            REQUIRE( !Core::binaryReader::open(reader, data, fileSize) );
+            REQUIRE( Core::binaryReader::findSection(reader, VALUES) == nullptr );
+        }
+
+        SECTION( "Reject corrupt sections" ) {
+            uint8_t *corrupt = static_cast<uint8_t*>( allocator->allocate(fileSize, Core::BINARY_SECTION_ALIGNMENT) );
+            BinaryReader reader;
+
+            // a fresh copy of the file, and a writable pointer to one of its sections
+            auto reset = [&]( uint32_t id ) -> Core::BinarySection* {
+                std::memcpy( corrupt, data, fileSize );
+                REQUIRE( Core::binaryReader::open(reader, corrupt, fileSize) );
+                return const_cast<Core::BinarySection*>( Core::binaryReader::findSection(reader, id) );
+            };
+            auto particlesRejected = [&]() {
+                SoAArray<float, uint8_t, double> loaded( allocator );
+                return Core::binaryReader::soaColumn<double>( reader, PARTICLES, 2 )._size == 0 &&
+                       !Core::binaryReader::loadSoAArray( reader, PARTICLES, loaded );
+            };
+            auto stringsRejected = [&]() {
+                StringTable strings( allocator );
+                return Core::binaryReader::lookupString( reader, STRINGS, STRING_ID("velocity") ) == nullptr &&
+                       !Core::binaryReader::loadStringTable( reader, STRINGS, strings ) &&
+                       Core::stringTable::size( strings ) == 0;
+            };
+
+            // array count past the section, and so large that count*elementSize overflows
+            reset( VALUES )->count = 1001;
+            REQUIRE( Core::binaryReader::array<int>(reader, VALUES)._size == 0 );
+            reset( VALUES )->count = (uint64_t(1) << 62) + 1;
+            REQUIRE( Core::binaryReader::array<int>(reader, VALUES)._size == 0 );
+            reset( VALUES )->size = 16;
+            REQUIRE( Core::binaryReader::array<int>(reader, VALUES)._size == 0 );
+
+            Core::BinarySection *particles = reset( PARTICLES );
+            particles->count = uint64_t(1) << 61;
+            REQUIRE( particlesRejected() );
+
+            // the column table itself doesn't fit
+            particles = reset( PARTICLES );
+            particles->size = 2*sizeof(Core::BinarySoAColumn);
+            REQUIRE( particlesRejected() );
+            particles = reset( PARTICLES );
+            particles->elementSize = 0xFFFFFFFF;
+            REQUIRE( Core::binaryReader::soaColumn<float>(reader, PARTICLES, 0)._size == 0 );
+
+            Core::BinarySoAColumn *columns = reinterpret_cast<Core::BinarySoAColumn*>( corrupt + reset(PARTICLES)->offset );
+            columns[2].offset = ~uint64_t(0) - 8;
+            REQUIRE( particlesRejected() );
+            // the other columns are still fine
+            REQUIRE( Core::binaryReader::soaColumn<uint8_t>(reader, PARTICLES, 1)._size == 300 );
+
+            // a view of a misaligned column would be undefined, a copy is fine
+            columns = reinterpret_cast<Core::BinarySoAColumn*>( corrupt + reset(PARTICLES)->offset );
+            columns[2].offset -= 4;
+            REQUIRE( Core::binaryReader::soaColumn<double>(reader, PARTICLES, 2)._size == 0 );
+
+            // the string table header is its count and capasity
+            uint32_t *header = reinterpret_cast<uint32_t*>( corrupt + reset(STRINGS)->offset );
+            const uint32_t capasity = header[1];
+            header[1] = capasity + 1;
+            REQUIRE( stringsRejected() );
+            header = reinterpret_cast<uint32_t*>( corrupt + reset(STRINGS)->offset );
+            header[1] = 0x80000000u;
+            REQUIRE( stringsRejected() );
+            reset( STRINGS )->size = 4;
+            REQUIRE( stringsRejected() );
+
+            Core::BinarySection *strings = reset( STRINGS );
+            Core::BinaryStringEntry *entries = reinterpret_cast<Core::BinaryStringEntry*>( corrupt + strings->offset + 8 );
+            for( uint32_t i=0; i < capasity; ++i ) {
+                if( entries[i].hash == STRING_ID("velocity").value ) entries[i].offset = strings->size;
+            }
+            REQUIRE( stringsRejected() );
+
+            strings = reset( STRINGS );
+            entries = reinterpret_cast<Core::BinaryStringEntry*>( corrupt + strings->offset + 8 );
+            for( uint32_t i=0; i < capasity; ++i ) {
+                if( entries[i].hash == STRING_ID("velocity").value ) entries[i].length = 0xFFFFFFFF;
+            }
+            REQUIRE( stringsRejected() );
+
+            // a string without its terminator
+            strings = reset( STRINGS );
+            entries = reinterpret_cast<Core::BinaryStringEntry*>( corrupt + strings->offset + 8 );
+            for( uint32_t i=0; i < capasity; ++i ) {
+                if( entries[i].hash == STRING_ID("velocity").value ) corrupt[strings->offset + entries[i].offset + entries[i].length] = 'x';
+            }
+            REQUIRE( stringsRejected() );
+
+            // no empty slot, a lookup that misses must still end
+            strings = reset( STRINGS );
+            entries = reinterpret_cast<Core::BinaryStringEntry*>( corrupt + strings->offset + 8 );
+            uint64_t used = 0;
+            for( uint32_t i=0; i < capasity; ++i ) {
+                if( entries[i].offset != 0 ) used = entries[i].offset;
+            }
+            for( uint32_t i=0; i < capasity; ++i ) {
+                if( entries[i].offset == 0 ) {
+                    entries[i].offset = used;
+                    entries[i].hash = 0;
+                }
+            }
+            REQUIRE( Core::binaryReader::lookupString(reader, STRINGS, Core::StringId{ Core::stringTable::hash("missing") }) == nullptr );
+
+            allocator->free( corrupt );
+        }
+
+        SECTION( "Mapped file" ) {
+            const char *path = "test_binary_format.bin";
+            REQUIRE( Core::binaryWriter::writeFile(writer, path) );
+
+            Array<uint8_t> file;
+            REQUIRE( Core::mappedArray::open(file, path, Core::MapMode::ReadOnly) );
+            REQUIRE( Core::array::size(file) == fileSize );
+
+            BinaryReader reader;
+            REQUIRE( Core::binaryReader::open(reader, file._data, Core::array::size(file)) );
+            ArrayView<float> floats = Core::binaryReader::soaColumn<float>( reader, PARTICLES, 0 );
+            REQUIRE( floats._size == 300 );
+            REQUIRE( floats[7] == 7.f );
+            REQUIRE( Core::binaryReader::array<int>(reader, VALUES)[999] == 2997 );
+
+            Core::mappedArray::close( file );
+            std::remove( path );
+        }
+
+        allocator->free( data );
+    }
+
+    Core::destroyAllocators();
+}
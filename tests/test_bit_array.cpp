@@ -0,0 +1,102 @@
+#include "catch.hpp"
+
+#include "core/BitArray.h"
+#include "core/Allocator.h"
+
+
+TEST_CASE( "[Core][BitArray]" )
+{
+    Core::initAllocators();
+    
+    using Core::BitArray;
+    using namespace Core::bitArray;
+    
+    SECTION( "Set / Clear / Test" ) {
+        BitArray array( Core::getDefaultAllocator() );
+        
+        resize( array, 130 );
+        REQUIRE( size(array) == 130 );
+        REQUIRE( wordCount(array) == 3 );
+        REQUIRE( popcount(array) == 0 );
+        
+        set( array, 0 );
+        set( array, 64 );
+        set( array, 129 );
+        REQUIRE( test(array, 0) );
+        REQUIRE( test(array, 1) == false );
+        REQUIRE( test(array, 64) );
+        REQUIRE( test(array, 129) );
+        REQUIRE( popcount(array) == 3 );
+        
+        clear( array, 64 );
+        REQUIRE( test(array, 64) == false );
+        REQUIRE( popcount(array) == 2 );
+        
+        setAll( array );
+        REQUIRE( popcount(array) == 130 );
+        
+        // shrinking clears the bits past the new size
+        resize( array, 70 );
+        resize( array, 130 );
+        REQUIRE( popcount(array) == 70 );
+        REQUIRE( test(array, 69) );
+        REQUIRE( test(array, 70) == false );
+    }
+    
+    SECTION( "Find next set" ) {
+        BitArray array( Core::getDefaultAllocator() );
+        resize( array, 1000 );
+        
+        for( std::size_t i=3; i < 1000; i += 97 ) {
+            set( array, i );
+        }
+        
+        std::size_t found = 0;
+        for( std::size_t i=findNextSet(array, 0); i < size(array); i = findNextSet(array, i+1) ) {
+            REQUIRE( (i % 97) == 3 );
+            found++;
+        }
+        REQUIRE( found == popcount(array) );
+        REQUIRE( findNextSet(array, 1000) == 1000 );
+        REQUIRE( findNextSet(array, 971) == 973 );
+        REQUIRE( findNextSet(array, 974) == 1000 );
+        
+        std::size_t visited = 0;
+        forEachSet( array, [&visited]( std::size_t index ) {
+            visited += index;
+        });
+        REQUIRE( visited == 3+100+197+294+391+488+585+682+779+876+973 );
+    }
+    
+    SECTION( "Bulk operations" ) {
+        BitArray a( Core::getDefaultAllocator() ),
+                 b( Core::getDefaultAllocator() );
+        resize( a, 1003 );
+        resize( b, 1003 );
+        
+        for( std::size_t i=0; i < 1003; ++i ) {
+            if( i % 2 == 0 ) set( a, i );
+            if( i % 3 == 0 ) set( b, i );
+        }
+        
+        BitArray result( a );
+        andAssign( result, b );
+        REQUIRE( popcount(result) == 168 );
+        
+        result = a;
+        orAssign( result, b );
+        REQUIRE( popcount(result) == 502 + 335 - 168 );
+        
+        result = a;
+        xorAssign( result, b );
+        REQUIRE( popcount(result) == 502 + 335 - 2*168 );
+        
+        result = a;
+        andNotAssign( result, b );
+        REQUIRE( popcount(result) == 502 - 168 );
+        REQUIRE( test(result, 2) );
+        REQUIRE( test(result, 6) == false );
+    }
+    
+    Core::destroyAllocators();
+}
@@ -0,0 +1,74 @@
+#include "catch.hpp"
+
+#include "core/BTreeMap.h"
+
+
+TEST_CASE( "[Core][BTreeMap]" )
+{
+    Core::initAllocators();
+    
+    using Core::BTreeMap;
+    using namespace Core::btreeMap;
+    
+    typedef BTreeMap<int, int> TestMap;
+    
+    SECTION( "Insert / Find" ) {
+        TestMap map( Core::getDefaultAllocator() );
+        
+        REQUIRE( find(map, 1) == nullptr );
+        REQUIRE( isEnd(begin(map)) );
+        
+        // enough elements for a few levels of inner nodes
+        for( int i=0; i < 10000; ++i ) {
+            REQUIRE( insert(map, (i*7919) % 10000, i) );
+        }
+        REQUIRE( insert(map, 42, -1) == false );
+        REQUIRE( size(map) == 10000 );
+        
+        for( int i=0; i < 10000; ++i ) {
+            REQUIRE( find(map, (i*7919) % 10000) != nullptr );
+        }
+        REQUIRE( *find(map, 42) == -1 );
+        REQUIRE( find(map, 10000) == nullptr );
+        
+        int expected = 0;
+        bool inOrder = true;
+        for( TestMap::Iterator it = begin(map); !isEnd(it); it = next(it) ) {
+            inOrder = inOrder && key(it) == expected++;
+        }
+        REQUIRE( inOrder );
+        REQUIRE( expected == 10000 );
+    }
+    
+    SECTION( "Erase / Range" ) {
+        TestMap map( Core::getDefaultAllocator() );
+        
+        for( int i=0; i < 1000; ++i ) {
+            insert( map, i, i*2 );
+        }
+        for( int i=0; i < 1000; i += 2 ) {
+            REQUIRE( erase(map, i) );
+        }
+        REQUIRE( erase(map, 0) == false );
+        REQUIRE( size(map) == 500 );
+        REQUIRE( find(map, 10) == nullptr );
+        REQUIRE( *find(map, 11) == 22 );
+        
+        int count = 0, sum = 0;
+        forEachInRange( map, 100, 200, [&count, &sum]( int key, int ) {
+            count++;
+            sum += key;
+        });
+        REQUIRE( count == 50 );
+        REQUIRE( sum == 7500 );
+        
+        REQUIRE( key(lowerBound(map, 500)) == 501 );
+        REQUIRE( isEnd(lowerBound(map, 1000)) );
+        
+        clear( map );
+        REQUIRE( size(map) == 0 );
+        REQUIRE( insert(map, 1, 1) );
+    }
+    
+    Core::destroyAllocators();
+}
@@ -0,0 +1,86 @@
+#include "catch.hpp"
+
+#include "core/ChunkedArray.h"
+
+
+TEST_CASE( "[Core][ChunkedArray]" )
+{
+    Core::initAllocators();
+    
+    using Core::ChunkedArray;
+    using namespace Core::chunkedArray;
+    
+    typedef ChunkedArray<int, 4> TestArray;
+    
+    SECTION( "PushBack / Indexing" ) {
+        TestArray array( Core::getDefaultAllocator() );
+        
+        for( int i=0; i < 100; ++i ) {
+            pushBack( array, i );
+        }
+        REQUIRE( size(array) == 100 );
+        REQUIRE( chunkCount(array) == 7 );
+        REQUIRE( capasity(array) == 112 );
+        REQUIRE( chunkSize(array, 6) == 4 );
+        
+        for( int i=0; i < 100; ++i ) {
+            REQUIRE( array[i] == i );
+        }
+        
+        REQUIRE( popBack(array) == 99 );
+        REQUIRE( size(array) == 99 );
+    }
+    
+    SECTION( "Growing keeps addresses stable" ) {
+        TestArray array( Core::getDefaultAllocator() );
+        
+        int *first = &pushBack( array, 42 );
+        for( int i=0; i < 1000; ++i ) {
+            pushBack( array, i );
+        }
+        REQUIRE( first == &array[0] );
+        REQUIRE( *first == 42 );
+    }
+    
+    SECTION( "Resize / Trim / ForEachChunk" ) {
+        TestArray array( Core::getDefaultAllocator() );
+        
+        resize( array, 40 );
+        REQUIRE( size(array) == 40 );
+        REQUIRE( array[39] == 0 );
+        
+        int count = 0;
+        forEachChunk( array, [&count]( int *elements, std::size_t size ) {
+            for( std::size_t i=0; i < size; ++i ) {
+                elements[i] = count++;
+            }
+        });
+        REQUIRE( count == 40 );
+        REQUIRE( array[33] == 33 );
+        
+        resize( array, 5 );
+        REQUIRE( capasity(array) == 48 );
+        trim( array );
+        REQUIRE( capasity(array) == 16 );
+        REQUIRE( array[4] == 4 );
+    }
+    
+    SECTION( "Copy / Move" ) {
+        TestArray array( Core::getDefaultAllocator() );
+        for( int i=0; i < 50; ++i ) {
+            pushBack( array, i );
+        }
+        
+        TestArray copy( array );
+        REQUIRE( size(copy) == 50 );
+        REQUIRE( &copy[0] != &array[0] );
+        REQUIRE( copy[49] == 49 );
+        
+        TestArray moved( std::move(copy) );
+        REQUIRE( size(moved) == 50 );
+        REQUIRE( size(copy) == 0 );
+        REQUIRE( moved[20] == 20 );
+    }
+    
+    Core::destroyAllocators();
+}
@@ -0,0 +1,131 @@
+#include "catch.hpp"
+
+#include "core/ConcurrentHashMap.h"
+#include "core/Allocator.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+
+TEST_CASE( "[Core][ConcurrentHashMap]" )
+{
+    Core::initAllocators();
+
+    using Core::ConcurrentHashMap;
+    using namespace Core::concurrentHashMap;
+
+    SECTION( "Insert / Find / Erase" ) {
+        ConcurrentHashMap<uint64_t, int> map( Core::getDefaultAllocator() );
+
+        int value = 0;
+        REQUIRE( find(map, uint64_t(1), value) == false );
+        REQUIRE( erase(map, uint64_t(1)) == false );
+
+        REQUIRE( insert(map, uint64_t(1), 10) );
+        REQUIRE( insert(map, uint64_t(1), 20) == false );
+        REQUIRE( find(map, uint64_t(1), value) );
+        REQUIRE( value == 10 );
+
+        assign( map, uint64_t(1), 30 );
+        REQUIRE( find(map, uint64_t(1), value) );
+        REQUIRE( value == 30 );
+        REQUIRE( size(map) == 1 );
+
+        REQUIRE( erase(map, uint64_t(1)) );
+        REQUIRE( contains(map, uint64_t(1)) == false );
+        REQUIRE( size(map) == 0 );
+    }
+
+    SECTION( "Grows while writing" ) {
+        ConcurrentHashMap<uint64_t, uint64_t> map( Core::getDefaultAllocator() );
+
+        bool same = true;
+        for( uint64_t i=0; i < 20000; ++i ) {
+            insert( map, i, i*2 );
+
+            // every key is still found while the shards are resizing
+            uint64_t value = 0;
+            same = same && find(map, i/2, value) && value == (i/2)*2;
+        }
+        REQUIRE( same );
+        REQUIRE( size(map) == 20000 );
+
+        for( uint64_t i=0; i < 20000; i += 2 ) {
+            same = same && erase( map, i );
+        }
+        for( uint64_t i=1; i < 20000; i += 4 ) {
+            assign( map, i, uint64_t(7) );
+        }
+        REQUIRE( same );
+        REQUIRE( size(map) == 10000 );
+
+        reclaim( map );
+        for( uint64_t i=0; i < 20000; ++i ) {
+            uint64_t value = 0;
+            bool found = find( map, i, value );
+            if( i % 2 == 0 ) same = same && !found;
+            else if( i % 4 == 1 ) same = same && found && value == 7;
+            else same = same && found && value == i*2;
+        }
+        REQUIRE( same );
+
+        // tombstones don't make the tables grow forever
+        for( int round=0; round < 50; ++round ) {
+            for( uint64_t i=100000; i < 100100; ++i ) insert( map, i, i );
+            for( uint64_t i=100000; i < 100100; ++i ) erase( map, i );
+        }
+        REQUIRE( size(map) == 10000 );
+    }
+
+    SECTION( "Readers and writers" ) {
+        ConcurrentHashMap<uint64_t, uint64_t> map( Core::getDefaultAllocator() );
+        const uint64_t COUNT = 20000;
+
+        std::atomic<bool> done( false );
+        std::atomic<bool> valid( true );
+
+        // readers must only ever see the value that belongs to a key
+        std::vector<std::thread> readers;
+        for( int i=0; i < 2; ++i ) {
+            readers.emplace_back( [&]() {
+                uint64_t key = 0;
+                while( !done.load() ) {
+                    uint64_t value;
+                    if( find(map, key, value) && value != key*3 ) {
+                        valid.store( false );
+                    }
+                    key = (key + 7) % COUNT;
+                    if( key < 7 ) std::this_thread::yield();
+                }
+            });
+        }
+
+        std::vector<std::thread> writers;
+        for( uint64_t w=0; w < 2; ++w ) {
+            writers.emplace_back( [&map, w]() {
+                for( uint64_t i=w; i < COUNT; i += 2 ) {
+                    insert( map, i, i*3 );
+                    if( i % 3 == 0 ) assign( map, i, i*3 );
+                    if( i % 256 == 0 ) std::this_thread::yield();
+                }
+            });
+        }
+
+        for( std::thread &thread : writers ) thread.join();
+        done.store( true );
+        for( std::thread &thread : readers ) thread.join();
+
+        REQUIRE( valid.load() );
+        REQUIRE( size(map) == COUNT );
+
+        bool same = true;
+        for( uint64_t i=0; i < COUNT; ++i ) {
+            uint64_t value = 0;
+            same = same && find(map, i, value) && value == i*3;
+        }
+        REQUIRE( same );
+    }
+
+    Core::destroyAllocators();
+}
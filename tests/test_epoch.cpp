@@ -0,0 +1,264 @@
+#include "catch.hpp"
+
+#include "core/Epoch.h"
+#include "core/ConcurrentHashMap.h"
+#include "core/Allocator.h"
+
+#include <atomic>
+#include <thread>
+
+
+namespace {
+    struct Node {
+        uint64_t value;
+        uint64_t check;
+    };
+
+    void countReclaim( void *, void *data )
+    {
+        static_cast<std::atomic<int>*>(data)->fetch_add( 1 );
+    }
+
+    struct PoisonData {
+        Core::Allocator *allocator;
+        std::atomic<int> *freed;
+    };
+
+    // overwrites the node before freeing it, so a reader that still has it would notice
+    void poisonReclaim( void *ptr, void *data )
+    {
+        PoisonData *poison = static_cast<PoisonData*>( data );
+        Node *node = static_cast<Node*>( ptr );
+        node->value = 0xdeadbeef;
+        node->check = 0;
+        poison->freed->fetch_add( 1 );
+        poison->allocator->free( node );
+    }
+}
+
+TEST_CASE( "[Core][Epoch]" )
+{
+    Core::initAllocators();
+
+    using namespace Core::epoch;
+
+    Core::Allocator *allocator = Core::getDefaultAllocator();
+    Core::EpochManager *manager = Core::createEpochManager( allocator, 8 );
+
+    SECTION( "Register" ) {
+        Core::EpochThread *threads[8];
+        for( int i=0; i < 8; ++i ) {
+            threads[i] = registerThread( manager );
+            REQUIRE( threads[i] != nullptr );
+        }
+        REQUIRE( registerThread(manager) == nullptr );
+
+        unregisterThread( threads[3] );
+        REQUIRE( registerThread(manager) == threads[3] );
+
+        for( int i=0; i < 8; ++i ) {
+            unregisterThread( threads[i] );
+        }
+    }
+
+    SECTION( "Pinned threads hold back reclamation" ) {
+        Core::EpochThread *writer = registerThread( manager );
+        Core::EpochThread *reader = registerThread( manager );
+
+        std::atomic<int> freed( 0 );
+
+        pin( reader );
+        pin( reader );
+        retire( writer, nullptr, countReclaim, &freed );
+        REQUIRE( retiredCount(manager) == 1 );
+
+        // the epoch can advance once, to the one the reader has, but not past it
+        for( int i=0; i < 10; ++i ) {
+            collect( writer );
+        }
+        REQUIRE( freed.load() == 0 );
+        REQUIRE( currentEpoch(manager) <= 1 );
+
+        // nested, so this one doesn't unpin
+        unpin( reader );
+        collect( writer );
+        REQUIRE( freed.load() == 0 );
+
+        unpin( reader );
+        for( int i=0; i < 3; ++i ) {
+            collect( writer );
+        }
+        REQUIRE( freed.load() == 1 );
+        REQUIRE( retiredCount(manager) == 0 );
+
+        // retired by a thread that unregisters is still freed
+        retire( writer, nullptr, countReclaim, &freed );
+        unregisterThread( writer );
+        for( int i=0; i < 3; ++i ) {
+            collect( reader );
+        }
+        REQUIRE( freed.load() == 2 );
+
+        unregisterThread( reader );
+    }
+
+    SECTION( "Readers and writers" ) {
+        Node *first = static_cast<Node*>( allocator->allocate(sizeof(Node), alignof(Node)) );
+        first->value = 1;
+        first->check = ~uint64_t(1);
+        std::atomic<Node*> shared( first );
+
+        std::atomic<int> freed( 0 );
+        std::atomic<bool> done( false );
+        std::atomic<bool> corrupt( false );
+        PoisonData poison = { allocator, &freed };
+
+        std::thread readers[3];
+        for( int t=0; t < 3; ++t ) {
+            readers[t] = std::thread( [&]() {
+                Core::EpochThread *thread = registerThread( manager );
+                while( !done.load() ) {
+                    Core::EpochGuard guard( thread );
+                    Node *node = shared.load( std::memory_order_acquire );
+                    if( node->check != ~node->value ) corrupt.store( true );
+                    std::this_thread::yield();
+                    if( node->check != ~node->value ) corrupt.store( true );
+                }
+                unregisterThread( thread );
+            });
+        }
+
+        Core::EpochThread *writer = registerThread( manager );
+        const int REPLACES = 5000;
+        for( int i=0; i < REPLACES; ++i ) {
+            Node *node = static_cast<Node*>( allocator->allocate(sizeof(Node), alignof(Node)) );
+            node->value = uint64_t(i) + 2;
+            node->check = ~node->value;
+
+            Node *old = shared.exchange( node, std::memory_order_acq_rel );
+            retire( writer, old, poisonReclaim, &poison );
+        }
+        done.store( true );
+        for( int t=0; t < 3; ++t ) {
+            readers[t].join();
+        }
+
+        REQUIRE( !corrupt.load() );
+
+        // with no readers left, the epoch advances on each collect
+        for( int i=0; i < 3; ++i ) {
+            collect( writer );
+        }
+        REQUIRE( freed.load() == REPLACES );
+
+        unregisterThread( writer );
+        Core::destroyEpochManager( manager );
+        manager = nullptr;
+
+        REQUIRE( freed.load() == REPLACES );
+        allocator->free( shared.load() );
+    }
+
+    SECTION( "ConcurrentHashMap" ) {
+        Core::ConcurrentHashMap<uint64_t, uint64_t> map( allocator );
+
+        std::atomic<bool> done( false );
+        std::atomic<bool> wrong( false );
+        std::thread reader( [&]() {
+            Core::EpochThread *thread = registerThread( manager );
+            while( !done.load() ) {
+                Core::EpochGuard guard( thread );
+                uint64_t value = 0;
+                if( Core::concurrentHashMap::find(map, uint64_t(7), value) && value != 70 ) wrong.store( true );
+            }
+            unregisterThread( thread );
+        });
+
+        // grows through many resizes while the reader looks, replaced tables are retired as it goes
+        Core::EpochThread *writer = registerThread( manager );
+        for( uint64_t i=0; i < 20000; ++i ) {
+            Core::concurrentHashMap::insert( map, i, i*10 );
+            if( (i % 1000) == 0 ) {
+                Core::concurrentHashMap::reclaim( map, writer );
+                collect( writer );
+            }
+        }
+        done.store( true );
+        reader.join();
+
+        REQUIRE( !wrong.load() );
+        REQUIRE( Core::concurrentHashMap::size(map) == 20000 );
+
+        Core::concurrentHashMap::reclaim( map, writer );
+        unregisterThread( writer );
+    }
+
+    SECTION( "ConcurrentHashMap readers and reclaim" ) {
+        static const int READERS = 3;
+        static const uint64_t KEYS = 50000;
+        Core::ConcurrentHashMap<uint64_t, uint64_t> map( allocator );
+
+        // every key below inserted is in the map, and readers must always find it
+        std::atomic<uint64_t> inserted( 0 );
+        std::atomic<bool> done( false );
+        std::atomic<int> missing( 0 ),
+                         wrong( 0 );
+        std::atomic<uint64_t> finds( 0 );
+
+        std::thread readers[READERS];
+        for( int i=0; i < READERS; ++i ) {
+            readers[i] = std::thread( [&, i]() {
+                Core::EpochThread *thread = registerThread( manager );
+                uint64_t random = uint64_t(i)*2654435761u + 1;
+                uint64_t count = 0;
+                while( !done.load() ) {
+                    Core::EpochGuard guard( thread );
+                    const uint64_t limit = inserted.load( std::memory_order_acquire );
+                    if( limit == 0 ) continue;
+
+                    // the newest keys are the ones being moved by resizes
+                    random ^= random << 13;
+                    random ^= random >> 7;
+                    random ^= random << 17;
+                    const uint64_t key = (random & 1) ? limit-1 - (random >> 1) % (limit < 64 ? limit : 64) : (random >> 1) % limit;
+
+                    uint64_t value = 0;
+                    if( !Core::concurrentHashMap::find(map, key, value) ) missing.fetch_add( 1 );
+                    else if( value != key*10 ) wrong.fetch_add( 1 );
+                    ++count;
+                }
+                finds.fetch_add( count );
+                unregisterThread( thread );
+            });
+        }
+
+        // reclaims right after resizes, while readers are still in the old tables
+        Core::EpochThread *writer = registerThread( manager );
+        for( uint64_t i=0; i < KEYS; ++i ) {
+            Core::concurrentHashMap::insert( map, i, i*10 );
+            inserted.store( i+1, std::memory_order_release );
+            if( (i % 16) == 0 ) {
+                Core::concurrentHashMap::reclaim( map, writer );
+                collect( writer );
+            }
+        }
+        done.store( true );
+        for( int i=0; i < READERS; ++i ) {
+            readers[i].join();
+        }
+
+        REQUIRE( finds.load() > 0 );
+        REQUIRE( missing.load() == 0 );
+        REQUIRE( wrong.load() == 0 );
+        REQUIRE( Core::concurrentHashMap::size(map) == KEYS );
+
+        Core::concurrentHashMap::reclaim( map, writer );
+        collect( writer );
+        unregisterThread( writer );
+    }
+
+    if( manager ) {
+        Core::destroyEpochManager( manager );
+    }
+    Core::destroyAllocators();
+}
@@ -0,0 +1,278 @@
+#include "catch.hpp"
+
+#include "core/Fiber.h"
+#include "core/JobSystem.h"
+#include "core/Allocator.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <thread>
+
+
+namespace {
+    struct PingPong {
+        Core::Fiber *thread;
+        Core::Fiber *fiber;
+        int value;
+    };
+
+    void pingPongFiber( void *data )
+    {
+        PingPong *pingPong = static_cast<PingPong*>( data );
+        for( ;; ) {
+            pingPong->value += 1;
+            Core::switchFiber( pingPong->fiber, pingPong->thread );
+        }
+    }
+
+    // uses the stack and floating point registers across switches
+    struct Recursion {
+        Core::Fiber *thread;
+        Core::Fiber *fiber;
+        double result;
+    };
+
+    double recurse( Recursion *recursion, int depth )
+    {
+        volatile char buffer[256];
+        std::memset( (char*)buffer, depth, sizeof(buffer) );
+
+        if( depth == 0 ) {
+            Core::switchFiber( recursion->fiber, recursion->thread );
+            return 0.5;
+        }
+        double value = recurse( recursion, depth-1 ) + double(depth) * 0.25;
+        return value + (buffer[depth % 256] == char(depth) ? 0.0 : 1000.0);
+    }
+
+    void recursionFiber( void *data )
+    {
+        Recursion *recursion = static_cast<Recursion*>( data );
+        recursion->result = recurse( recursion, 100 );
+        for( ;; ) {
+            Core::switchFiber( recursion->fiber, recursion->thread );
+        }
+    }
+
+    struct WaiterData {
+        Core::JobCounter *gate;
+        std::atomic<int> *resumed;
+        std::atomic<bool> *early;
+    };
+
+    void waiterJob( Core::JobSystem *system, void *data )
+    {
+        WaiterData waiter = *static_cast<WaiterData*>( data );
+        Core::jobSystem::waitForCounter( system, *waiter.gate );
+        if( waiter.gate->value.load() != 0 ) {
+            waiter.early->store( true );
+        }
+        waiter.resumed->fetch_add( 1 );
+    }
+
+    void emptyJob( Core::JobSystem *, void * )
+    {
+    }
+
+    // the tag of a scope held across the wait is still set after it, and the thread it left has none
+    struct TaggedData {
+        Core::JobCounter *gate;
+        std::atomic<bool> *kept;
+    };
+
+    void taggedWaiterJob( Core::JobSystem *system, void *data )
+    {
+        TaggedData tagged = *static_cast<TaggedData*>( data );
+
+        CORE_ALLOCATION_TAG( "Waiter" );
+        const Core::AllocationTag *tag = Core::detail::currentAllocationTag;
+        Core::jobSystem::waitForCounter( system, *tagged.gate );
+        if( Core::detail::currentAllocationTag != tag ) {
+            tagged.kept->store( false );
+        }
+    }
+
+    void untaggedJob( Core::JobSystem *, void *data )
+    {
+        if( Core::detail::currentAllocationTag != nullptr ) {
+            static_cast<TaggedData*>(data)->kept->store( false );
+        }
+    }
+
+    struct TreeData {
+        std::atomic<int> *leaves;
+        int depth;
+    };
+
+    void fiberTreeJob( Core::JobSystem *system, void *data )
+    {
+        TreeData tree = *static_cast<TreeData*>( data );
+        if( tree.depth == 0 ) {
+            tree.leaves->fetch_add( 1 );
+            return;
+        }
+
+        Core::JobCounter counter;
+        TreeData child = { tree.leaves, tree.depth-1 };
+        for( int i=0; i < 4; ++i ) {
+            Core::jobSystem::run( system, fiberTreeJob, &child, sizeof(child), &counter );
+        }
+        Core::jobSystem::waitForCounter( system, counter );
+    }
+}
+
+TEST_CASE( "[Core][Fiber]" )
+{
+    Core::initAllocators();
+
+    Core::Allocator *allocator = Core::getDefaultAllocator();
+
+    SECTION( "Guarded stacks" ) {
+        Core::Allocator *stacks = Core::createGuardedStackAllocator( 16*1024, allocator );
+
+        void *stackA = stacks->allocate( 16*1024, 16 );
+        void *stackB = stacks->allocate( 16*1024, 16 );
+        REQUIRE( stackA != nullptr );
+        REQUIRE( stackB != nullptr );
+        REQUIRE( stackA != stackB );
+        REQUIRE( (reinterpret_cast<uintptr_t>(stackA) % 4096) == 0 );
+
+        // the whole stack is usable
+        std::memset( stackA, 0xAB, 16*1024 );
+        std::memset( stackB, 0xCD, 16*1024 );
+        REQUIRE( static_cast<uint8_t*>(stackA)[16*1024-1] == 0xAB );
+
+        stacks->free( stackB );
+        REQUIRE( stacks->allocate(16*1024, 16) == stackB );
+
+        // more than one chunk
+        void *more[40];
+        for( int i=0; i < 40; ++i ) {
+            more[i] = stacks->allocate( 16*1024, 16 );
+            REQUIRE( more[i] != nullptr );
+        }
+        for( int i=0; i < 40; ++i ) {
+            stacks->free( more[i] );
+        }
+
+        Core::destroyGuardedStackAllocator( stacks );
+    }
+
+    SECTION( "Switch" ) {
+        Core::Allocator *stacks = Core::createGuardedStackAllocator( 64*1024, allocator );
+
+        PingPong pingPong;
+        pingPong.value = 0;
+        pingPong.thread = Core::createThreadFiber( allocator );
+        pingPong.fiber = Core::createFiber( allocator, stacks, 64*1024, pingPongFiber, &pingPong );
+
+        for( int i=0; i < 1000; ++i ) {
+            Core::switchFiber( pingPong.thread, pingPong.fiber );
+        }
+        REQUIRE( pingPong.value == 1000 );
+
+        // a reset fiber starts over
+        Recursion recursion;
+        recursion.thread = pingPong.thread;
+        recursion.fiber = pingPong.fiber;
+        recursion.result = 0.0;
+        Core::resetFiber( recursion.fiber, recursionFiber, &recursion );
+
+        Core::switchFiber( recursion.thread, recursion.fiber );
+        REQUIRE( recursion.result == 0.0 );
+        Core::switchFiber( recursion.thread, recursion.fiber );
+        REQUIRE( recursion.result == 0.5 + 0.25*(100*101/2) );
+
+        Core::destroyFiber( pingPong.fiber );
+        Core::destroyFiber( pingPong.thread );
+        Core::destroyGuardedStackAllocator( stacks );
+    }
+
+    SECTION( "Wait for counter" ) {
+        using namespace Core::jobSystem;
+
+        Core::JobSystem *system = Core::createJobSystem( allocator, 4 );
+
+        // the gate job doesn't start before the start job, which is run after all the waiters
+        std::atomic<int> resumed( 0 );
+        std::atomic<bool> early( false );
+        Core::JobCounter gate;
+        Core::JobCounter counter;
+
+        Core::Job *start = createJob( system, emptyJob );
+        Core::Job *gateJob = createJob( system, emptyJob );
+        setCounter( gateJob, &gate );
+        addDependency( gateJob, start );
+        run( system, gateJob );
+
+        WaiterData waiter = { &gate, &resumed, &early };
+        for( int i=0; i < 64; ++i ) {
+            run( system, waiterJob, &waiter, sizeof(waiter), &counter );
+        }
+        run( system, start );
+        waitForCounter( system, counter );
+
+        REQUIRE( resumed.load() == 64 );
+        REQUIRE( !early.load() );
+
+        std::atomic<int> leaves( 0 );
+        TreeData tree = { &leaves, 5 };
+        run( system, fiberTreeJob, &tree, sizeof(tree), &counter );
+        waitForCounter( system, counter );
+
+        REQUIRE( leaves.load() == 4*4*4*4*4 );
+
+        // the workers sleep while the waiters are parked, and are woken to resume them
+        Core::JobCounter sleepGate;
+        start = createJob( system, emptyJob );
+        gateJob = createJob( system, emptyJob );
+        setCounter( gateJob, &sleepGate );
+        addDependency( gateJob, start );
+        run( system, gateJob );
+
+        resumed.store( 0 );
+        WaiterData sleepWaiter = { &sleepGate, &resumed, &early };
+        for( int i=0; i < 8; ++i ) {
+            run( system, waiterJob, &sleepWaiter, sizeof(sleepWaiter), &counter );
+        }
+        std::this_thread::sleep_for( std::chrono::milliseconds(50) );
+
+        const std::clock_t before = std::clock();
+        std::this_thread::sleep_for( std::chrono::milliseconds(200) );
+        const double busySeconds = double(std::clock() - before) / CLOCKS_PER_SEC;
+
+        run( system, start );
+        waitForCounter( system, counter );
+
+        REQUIRE( resumed.load() == 8 );
+        REQUIRE( !early.load() );
+        REQUIRE( busySeconds < 0.1 );
+
+        // allocation tags move with the job
+        std::atomic<bool> kept( true );
+        Core::JobCounter tagGate;
+        start = createJob( system, emptyJob );
+        gateJob = createJob( system, emptyJob );
+        setCounter( gateJob, &tagGate );
+        addDependency( gateJob, start );
+        run( system, gateJob );
+
+        TaggedData tagged = { &tagGate, &kept };
+        for( int i=0; i < 16; ++i ) {
+            run( system, taggedWaiterJob, &tagged, sizeof(tagged), &counter );
+        }
+        for( int i=0; i < 256; ++i ) {
+            run( system, untaggedJob, &tagged, sizeof(tagged), &counter );
+        }
+        run( system, start );
+        waitForCounter( system, counter );
+
+        REQUIRE( kept.load() );
+
+        Core::destroyJobSystem( system );
+    }
+
+    Core::destroyAllocators();
+}
@@ -0,0 +1,61 @@
+#include "catch.hpp"
+
+#include "core/FlatMap.h"
+
+
+TEST_CASE( "[Core][FlatMap]" )
+{
+    Core::initAllocators();
+    
+    using Core::FlatMap;
+    using namespace Core::flatMap;
+    
+    SECTION( "Insert / Find / Erase" ) {
+        FlatMap<int, float> map( Core::getDefaultAllocator() );
+        
+        REQUIRE( find(map, 1) == nullptr );
+        
+        REQUIRE( insert(map, 5, 5.f) );
+        REQUIRE( insert(map, 1, 1.f) );
+        REQUIRE( insert(map, 3, 3.f) );
+        REQUIRE( insert(map, 3, 4.f) == false );
+        REQUIRE( size(map) == 3 );
+        
+        REQUIRE( keys(map)[0] == 1 );
+        REQUIRE( keys(map)[1] == 3 );
+        REQUIRE( keys(map)[2] == 5 );
+        REQUIRE( *find(map, 3) == 4.f );
+        REQUIRE( find(map, 2) == nullptr );
+        
+        REQUIRE( lowerBound(map, 0) == 0 );
+        REQUIRE( lowerBound(map, 3) == 1 );
+        REQUIRE( lowerBound(map, 4) == 2 );
+        REQUIRE( lowerBound(map, 6) == 3 );
+        REQUIRE( upperBound(map, 3) == 2 );
+        REQUIRE( upperBound(map, 5) == 3 );
+        
+        REQUIRE( erase(map, 3) );
+        REQUIRE( erase(map, 3) == false );
+        REQUIRE( size(map) == 2 );
+        REQUIRE( *find(map, 5) == 5.f );
+    }
+    
+    SECTION( "Bulk build" ) {
+        FlatMap<int, int> map( Core::getDefaultAllocator() );
+        
+        for( int i=0; i < 1000; ++i ) {
+            bulkInsert( map, (i*7919) % 1000, i );
+        }
+        bulkInsert( map, 10, -1 );
+        finishBulk( map );
+        
+        REQUIRE( size(map) == 1000 );
+        for( int i=0; i < 1000; ++i ) {
+            REQUIRE( keys(map)[i] == i );
+        }
+        REQUIRE( *find(map, 10) == -1 );
+        REQUIRE( *find(map, 7919 % 1000) == 1 );
+    }
+    
+    Core::destroyAllocators();
+}
@@ -0,0 +1,229 @@
+#include "catch.hpp"
+
+#include "core/JobSystem.h"
+#include "core/Allocator.h"
+#include "core/AllocationTracker.h"
+
+#include <atomic>
+#include <thread>
+
+
+namespace {
+    struct CountData {
+        std::atomic<int> *count;
+    };
+
+    void countJob( Core::JobSystem *, void *data )
+    {
+        static_cast<CountData*>(data)->count->fetch_add( 1 );
+    }
+
+    struct OrderData {
+        std::atomic<int> *next;
+        int expected;
+        std::atomic<bool> *inOrder;
+    };
+
+    void orderJob( Core::JobSystem *, void *data )
+    {
+        OrderData *order = static_cast<OrderData*>( data );
+        if( order->next->fetch_add(1) != order->expected ) {
+            order->inOrder->store( false );
+        }
+    }
+
+    // checks that the jobs it depends on has finished
+    struct FanInData {
+        std::atomic<int> *count;
+        int expected;
+        std::atomic<bool> *finished;
+    };
+
+    void fanInJob( Core::JobSystem *, void *data )
+    {
+        FanInData *fanIn = static_cast<FanInData*>( data );
+        if( fanIn->count->load() != fanIn->expected ) {
+            fanIn->finished->store( false );
+        }
+    }
+
+    // splits itself into child jobs, and waits for them from inside the job
+    struct TreeData {
+        std::atomic<int> *leaves;
+        int depth;
+    };
+
+    void treeJob( Core::JobSystem *system, void *data )
+    {
+        TreeData tree = *static_cast<TreeData*>( data );
+        if( tree.depth == 0 ) {
+            tree.leaves->fetch_add( 1 );
+            return;
+        }
+
+        Core::JobCounter counter;
+        TreeData child = { tree.leaves, tree.depth-1 };
+        for( int i=0; i < 4; ++i ) {
+            Core::jobSystem::run( system, treeJob, &child, sizeof(child), &counter );
+        }
+        Core::jobSystem::wait( system, counter );
+    }
+
+    void sumRange( std::size_t begin, std::size_t end, void *data )
+    {
+        std::atomic<uint64_t> *sum = static_cast<std::atomic<uint64_t>*>( data );
+        uint64_t local = 0;
+        for( std::size_t i=begin; i < end; ++i ) local += i;
+        sum->fetch_add( local );
+    }
+}
+
+TEST_CASE( "[Core][JobSystem]" )
+{
+    Core::initAllocators();
+
+    using namespace Core::jobSystem;
+
+    Core::JobSystem *system = Core::createJobSystem( Core::getDefaultAllocator(), 4 );
+    REQUIRE( workerCount(system) == 4 );
+    REQUIRE( currentWorker(system) == 0 );
+
+    SECTION( "Run / Wait" ) {
+        std::atomic<int> count( 0 );
+        CountData data = { &count };
+
+        Core::JobCounter counter;
+        for( int i=0; i < 10000; ++i ) {
+            run( system, countJob, &data, sizeof(data), &counter );
+        }
+        wait( system, counter );
+
+        REQUIRE( count.load() == 10000 );
+        REQUIRE( counter.value.load() == 0 );
+    }
+
+    SECTION( "Dependencies" ) {
+        std::atomic<int> next( 0 );
+        std::atomic<bool> inOrder( true );
+
+        // a chain, where each job depends on the one before it
+        Core::JobCounter counter;
+        Core::Job *jobs[20];
+        for( int i=0; i < 20; ++i ) {
+            OrderData data = { &next, i, &inOrder };
+            jobs[i] = createJob( system, orderJob, data );
+            setCounter( jobs[i], &counter );
+            if( i > 0 ) addDependency( jobs[i], jobs[i-1] );
+        }
+        // run them backwards, so the order comes only from the dependencies
+        for( int i=19; i >= 0; --i ) {
+            run( system, jobs[i] );
+        }
+        wait( system, counter );
+
+        REQUIRE( next.load() == 20 );
+        REQUIRE( inOrder.load() );
+
+        // a job that waits for several others
+        std::atomic<int> count( 0 );
+        CountData countData = { &count };
+        FanInData fanInData = { &count, 5, &inOrder };
+
+        Core::Job *last = createJob( system, fanInJob, fanInData );
+        setCounter( last, &counter );
+        for( int i=0; i < 5; ++i ) {
+            Core::Job *job = createJob( system, countJob, countData );
+            setCounter( job, &counter );
+            addDependency( last, job );
+            run( system, job );
+        }
+        run( system, last );
+        wait( system, counter );
+
+        REQUIRE( count.load() == 5 );
+        REQUIRE( inOrder.load() );
+    }
+
+    SECTION( "Nested waits" ) {
+        std::atomic<int> leaves( 0 );
+        TreeData tree = { &leaves, 5 };
+
+        Core::JobCounter counter;
+        run( system, treeJob, &tree, sizeof(tree), &counter );
+        wait( system, counter );
+
+        REQUIRE( leaves.load() == 4*4*4*4*4 );
+    }
+
+    SECTION( "Parallel for" ) {
+        std::atomic<uint64_t> sum( 0 );
+        parallelFor( system, 100000, 1000, sumRange, &sum );
+        REQUIRE( sum.load() == uint64_t(100000)*99999/2 );
+    }
+
+    SECTION( "Run from other threads" ) {
+        std::atomic<int> count( 0 );
+        CountData data = { &count };
+
+        int worker = 0;
+        std::thread thread( [system, &data, &worker]() {
+            worker = currentWorker( system );
+
+            Core::JobCounter counter;
+            for( int i=0; i < 1000; ++i ) {
+                run( system, countJob, &data, sizeof(data), &counter );
+            }
+            wait( system, counter );
+        });
+        thread.join();
+
+        REQUIRE( worker == -1 );
+        REQUIRE( count.load() == 1000 );
+    }
+
+    Core::destroyJobSystem( system );
+    Core::destroyAllocators();
+}
+
+TEST_CASE( "[Core][JobSystem][Pools]" )
+{
+    Core::initAllocators();
+
+    using namespace Core::jobSystem;
+
+    Core::AllocationTracker *tracker = Core::createAllocationTracker( Core::getDefaultAllocator() );
+    Core::JobSystem *system = Core::createJobSystem( Core::allocationTracker::allocator(tracker), 4 );
+
+    SECTION( "Records return to their pool" ) {
+        static const int FRAMES = 100;
+        static const int FRAME_JOBS = 2048;
+
+        std::atomic<int> count( 0 );
+        CountData data = { &count };
+        uint64_t warmBytes = 0,
+                 endBytes = 0;
+
+        // jobs submitted from a thread that isn't a worker, and mostly finished by the workers
+        std::thread thread( [&]() {
+            for( int frame=0; frame < FRAMES; ++frame ) {
+                Core::JobCounter counter;
+                for( int i=0; i < FRAME_JOBS; ++i ) {
+                    run( system, countJob, &data, sizeof(data), &counter );
+                }
+                wait( system, counter );
+
+                if( frame == 0 ) warmBytes = Core::allocationTracker::liveBytes( tracker );
+            }
+            endBytes = Core::allocationTracker::liveBytes( tracker );
+        });
+        thread.join();
+
+        REQUIRE( count.load() == FRAMES*FRAME_JOBS );
+        // a frame can have more jobs in flight than the first one had, but never more than a frame of them
+        REQUIRE( endBytes <= warmBytes + FRAME_JOBS*256 );
+    }
+
+    Core::destroyJobSystem( system );
+    Core::destroyAllocationTracker( tracker );
+    Core::destroyAllocators();
+}
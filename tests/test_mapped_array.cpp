@@ -0,0 +1,125 @@
+#include "catch.hpp"
+
+#include "core/MappedArray.h"
+
+#include <csignal>
+#include <cstdio>
+
+#include <sys/resource.h>
+
+
+TEST_CASE( "[Core][MappedArray]" )
+{
+    Core::initAllocators();
+    
+    using Core::Array;
+    using Core::MapMode;
+    using namespace Core::array;
+    
+    const char *path = "test_mapped_array.bin";
+    std::remove( path );
+    
+    SECTION( "Write / Read back" ) {
+        {
+            Array<int> array;
+            REQUIRE( Core::mappedArray::open(array, path, MapMode::ReadWrite) );
+            REQUIRE( size(array) == 0 );
+            
+            for( int i=0; i < 5000; ++i ) {
+                pushBack( array, i );
+            }
+            Core::mappedArray::flush( array );
+            Core::mappedArray::close( array );
+            REQUIRE( isNull(array) );
+        }
+        {
+            Array<int> array;
+            REQUIRE( Core::mappedArray::open(array, path, MapMode::ReadOnly) );
+            REQUIRE( size(array) == 5000 );
+            
+            bool same = true;
+            for( int i=0; i < 5000; ++i ) {
+                same = same && array[i] == i;
+            }
+            REQUIRE( same );
+        }
+        {
+            // reopen and append, destroying the array truncates the file to its size like close
+            Array<int> array;
+            REQUIRE( Core::mappedArray::open(array, path, MapMode::ReadWrite) );
+            pushBack( array, 5000 );
+        }
+        {
+            Array<int> array;
+            REQUIRE( Core::mappedArray::open(array, path, MapMode::ReadOnly) );
+            REQUIRE( size(array) == 5001 );
+            REQUIRE( array[5000] == 5000 );
+        }
+    }
+    
+    SECTION( "Destroying truncates" ) {
+        {
+            Array<int> array;
+            REQUIRE( Core::mappedArray::open(array, path, MapMode::ReadWrite) );
+            pushBack( array, 1 );
+            pushBack( array, 2 );
+            pushBack( array, 3 );
+            REQUIRE( array._capasity > 3 );
+        }
+        {
+            Array<int> array;
+            REQUIRE( Core::mappedArray::open(array, path, MapMode::ReadOnly) );
+            REQUIRE( size(array) == 3 );
+            REQUIRE( array[2] == 3 );
+        }
+    }
+    
+        SECTION( "Invalid files" ) {
+        Array<int> array;
+        REQUIRE( Core::mappedArray::open(array, path, MapMode::ReadOnly) == false );
+        
+        Array<char> bytes;
+        REQUIRE( Core::mappedArray::open(bytes, path, MapMode::ReadWrite) );
+        pushBack( bytes, 'a' );
+        Core::mappedArray::close( bytes );
+        
+        REQUIRE( Core::mappedArray::open(array, path, MapMode::ReadOnly) == false );
+    }
+    
+    SECTION( "File can't grow" ) {
+        Array<int> array;
+        REQUIRE( Core::mappedArray::open(array, path, MapMode::ReadWrite) );
+        for( int i=0; i < 100; ++i ) {
+            pushBack( array, i );
+        }
+        
+        // limit the size of files, going past it fails with EFBIG once SIGXFSZ is ignored
+        struct rlimit limit, saved;
+        getrlimit( RLIMIT_FSIZE, &saved );
+        limit = saved;
+        limit.rlim_cur = 64*1024;
+        setrlimit( RLIMIT_FSIZE, &limit );
+        void (*handler)(int) = std::signal( SIGXFSZ, SIG_IGN );
+        
+        int *data = begin( array );
+        std::size_t oldCapasity = array._capasity;
+        bool reserved = Core::mappedArray::reserve( array, 1024*1024 );
+        
+        setrlimit( RLIMIT_FSIZE, &saved );
+        std::signal( SIGXFSZ, handler );
+        
+        REQUIRE( reserved == false );
+        REQUIRE( begin(array) == data );
+        REQUIRE( array._capasity == oldCapasity );
+        REQUIRE( array[99] == 99 );
+        
+        REQUIRE( Core::mappedArray::reserve(array, 1000) );
+        REQUIRE( array._capasity == 1000 );
+        REQUIRE( array[99] == 99 );
+        Core::mappedArray::close( array );
+    }
+    
+    std::remove( path );
+    
+    Core::destroyAllocators();
+}
@@ -0,0 +1,172 @@
+#include "catch.hpp"
+
+#include "core/PackedIntArray.h"
+#include "core/Allocator.h"
+
+#include <random>
+
+
+TEST_CASE( "[Core][PackedIntArray]" )
+{
+    Core::initAllocators();
+
+    using Core::Array;
+    using Core::ArrayView;
+    using Core::PackedIntArray;
+    using Core::DeltaIntArray;
+    using Core::VarintArray;
+
+    Core::Allocator *allocator = Core::getDefaultAllocator();
+    std::mt19937 random( 1234 );
+
+    SECTION( "Fixed width" ) {
+        bool same = true;
+        for( uint32_t bits=0; bits <= 32; ++bits ) {
+            const uint64_t mask = (uint64_t(1) << bits) - 1;
+
+            Array<uint32_t> values( allocator );
+            for( std::size_t i=0; i < 1000; ++i ) {
+                Core::array::pushBack( values, uint32_t(random() & mask) );
+            }
+
+            PackedIntArray packed( allocator, bits );
+            for( std::size_t i=0; i < 1000; ++i ) {
+                Core::packedIntArray::pushBack( packed, values[i] );
+            }
+            same = same && Core::packedIntArray::size(packed) == 1000;
+            same = same && Core::packedIntArray::blockCount(packed) == 16;
+
+            for( std::size_t i=0; i < 1000; ++i ) {
+                same = same && Core::packedIntArray::get(packed, i) == values[i];
+            }
+
+            uint32_t block[PackedIntArray::BLOCK_SIZE];
+            for( std::size_t b=0; b < 16; ++b ) {
+                std::size_t count = Core::packedIntArray::decodeBlock( packed, b, block );
+                same = same && count == (b == 15 ? 1000 - 15*64 : 64);
+                for( std::size_t i=0; i < count; ++i ) {
+                    same = same && block[i] == values[b*64 + i];
+                }
+            }
+
+            uint32_t decoded[300];
+            Core::packedIntArray::decode( packed, 37, 300, decoded );
+            for( std::size_t i=0; i < 300; ++i ) {
+                same = same && decoded[i] == values[37 + i];
+            }
+        }
+        REQUIRE( same );
+    }
+
+    SECTION( "Set / Resize / Assign" ) {
+        PackedIntArray packed( allocator, 12 );
+        Core::packedIntArray::resize( packed, 200 );
+        REQUIRE( Core::packedIntArray::get(packed, 199) == 0 );
+
+        Core::packedIntArray::set( packed, 5, 4095 );
+        Core::packedIntArray::set( packed, 150, 77 );
+        REQUIRE( Core::packedIntArray::get(packed, 4) == 0 );
+        REQUIRE( Core::packedIntArray::get(packed, 5) == 4095 );
+        REQUIRE( Core::packedIntArray::get(packed, 6) == 0 );
+
+        // shrinking and growing again gives zeros
+        Core::packedIntArray::resize( packed, 140 );
+        Core::packedIntArray::resize( packed, 200 );
+        REQUIRE( Core::packedIntArray::get(packed, 150) == 0 );
+        REQUIRE( Core::packedIntArray::get(packed, 5) == 4095 );
+
+        Array<uint32_t> values( allocator );
+        for( uint32_t i=0; i < 500; ++i ) {
+            Core::array::pushBack( values, i * 7 );
+        }
+        Core::packedIntArray::assign( packed, ArrayView<uint32_t>(values) );
+        REQUIRE( Core::packedIntArray::bits(packed) == Core::packedIntArray::requiredBits(499*7) );
+        REQUIRE( Core::packedIntArray::size(packed) == 500 );
+        REQUIRE( Core::packedIntArray::get(packed, 321) == 321*7 );
+        REQUIRE( Core::packedIntArray::get(packed, 499) == 499*7 );
+    }
+
+    SECTION( "Frame of reference" ) {
+        Array<uint32_t> values( allocator );
+        for( uint32_t i=0; i < 1000; ++i ) {
+            // large values close to each other within a block
+            uint32_t base = i < 500 ? 3000000000u : 7;
+            Core::array::pushBack( values, base + i*3 + uint32_t(random() % 100) );
+        }
+
+        DeltaIntArray delta( allocator );
+        Core::deltaIntArray::assign( delta, ArrayView<uint32_t>(values) );
+        REQUIRE( Core::deltaIntArray::size(delta) == 1000 );
+        REQUIRE( Core::deltaIntArray::blockCount(delta) == 16 );
+        REQUIRE( Core::deltaIntArray::byteSize(delta) < 1000*sizeof(uint32_t) );
+
+        bool same = true;
+        for( std::size_t i=0; i < 1000; ++i ) {
+            same = same && Core::deltaIntArray::get(delta, i) == values[i];
+        }
+
+        uint32_t block[DeltaIntArray::BLOCK_SIZE];
+        for( std::size_t b=0; b < 16; ++b ) {
+            std::size_t count = Core::deltaIntArray::decodeBlock( delta, b, block );
+            same = same && count == (b == 15 ? 1000 - 15*64 : 64);
+            for( std::size_t i=0; i < count; ++i ) {
+                same = same && block[i] == values[b*64 + i];
+            }
+        }
+        REQUIRE( same );
+
+        Core::deltaIntArray::clear( delta );
+        Core::deltaIntArray::pushBack( delta, 42 );
+        REQUIRE( Core::deltaIntArray::get(delta, 0) == 42 );
+    }
+
+    SECTION( "Varint" ) {
+        Array<uint32_t> values( allocator );
+        for( uint32_t i=0; i < 1000; ++i ) {
+            // mostly single byte values, with some long ones in between
+            uint32_t value = i % 37 == 0 ? uint32_t(random()) : uint32_t(random() % 128);
+            Core::array::pushBack( values, value );
+        }
+
+        uint8_t bytes[1000*Core::varint::MAX_BYTES];
+        std::size_t written = Core::varint::encodeN( values._data, 1000, bytes );
+
+        // decoding in parts continues where the last part ended
+        uint32_t decoded[1000];
+        std::size_t read = Core::varint::decodeN( bytes, 300, decoded );
+        read += Core::varint::decodeN( bytes + read, 700, decoded + 300 );
+        REQUIRE( read == written );
+
+        bool same = true;
+        for( std::size_t i=0; i < 1000; ++i ) {
+            same = same && decoded[i] == values[i];
+        }
+
+        VarintArray varints( allocator );
+        Core::varintArray::assign( varints, ArrayView<uint32_t>(values) );
+        REQUIRE( Core::varintArray::byteSize(varints) == written );
+        REQUIRE( Core::varintArray::blockCount(varints) == 16 );
+
+        for( std::size_t i=0; i < 1000; ++i ) {
+            same = same && Core::varintArray::get(varints, i) == values[i];
+        }
+
+        uint32_t block[VarintArray::BLOCK_SIZE];
+        for( std::size_t b=0; b < 16; ++b ) {
+            std::size_t count = Core::varintArray::decodeBlock( varints, b, block );
+            for( std::size_t i=0; i < count; ++i ) {
+                same = same && block[i] == values[b*64 + i];
+            }
+        }
+
+        VarintArray pushed( allocator );
+        for( std::size_t i=0; i < 1000; ++i ) {
+            Core::varintArray::pushBack( pushed, values[i] );
+        }
+        REQUIRE( Core::varintArray::byteSize(pushed) == written );
+        same = same && Core::varintArray::get(pushed, 999) == values[999];
+        REQUIRE( same );
+    }
+
+    Core::destroyAllocators();
+}
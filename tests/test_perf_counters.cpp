@@ -0,0 +1,100 @@
+#include "catch.hpp"
+
+#include "core/PerfCounters.h"
+#include "core/Allocator.h"
+
+#include <cstdlib>
+#include <thread>
+
+
+namespace {
+    uint64_t work( int count )
+    {
+        volatile uint64_t sum = 0;
+        for( int i=0; i < count; ++i ) {
+            sum = sum + uint64_t(i);
+        }
+        return sum;
+    }
+}
+
+TEST_CASE( "[Core][PerfCounters]" )
+{
+    Core::initAllocators();
+
+    using namespace Core::perfCounters;
+
+    Core::PerfCounters *counters = Core::createPerfCounters( Core::getDefaultAllocator() );
+    if( !counters ) {
+        WARN( "perf_event_open isn't allowed, skipping the PerfCounters tests" );
+        Core::destroyAllocators();
+        return;
+    }
+
+    SECTION( "Read" ) {
+        REQUIRE( available(counters, Core::PerfCounter::Instructions) );
+
+        Core::PerfCounterValues begin, end;
+        read( counters, begin );
+        work( 100000 );
+        read( counters, end );
+
+        Core::PerfCounterValues counted = difference( end, begin );
+        // at least a load, an add and a store for each iteration
+        REQUIRE( counted.instructions >= 300000 );
+        REQUIRE( counted.instructions < 100000000 );
+        if( available(counters, Core::PerfCounter::Cycles) ) {
+            REQUIRE( counted.cycles > 0 );
+            REQUIRE( ipc(counted) > 0.0 );
+        }
+
+        // the counts only grow
+        Core::PerfCounterValues previous = end;
+        for( int i=0; i < 100; ++i ) {
+            Core::PerfCounterValues current;
+            read( counters, current );
+            REQUIRE( current.instructions >= previous.instructions );
+            REQUIRE( current.cycles >= previous.cycles );
+            previous = current;
+        }
+    }
+
+    SECTION( "Only the calling thread" ) {
+        Core::PerfCounterValues begin, end;
+        read( counters, begin );
+
+        std::thread thread( []() {
+            work( 10000000 );
+        });
+        thread.join();
+
+        read( counters, end );
+        // the thread ran ten million iterations, this thread only waited for it
+        REQUIRE( difference(end, begin).instructions < 10000000 );
+    }
+
+    SECTION( "Helpers" ) {
+        Core::PerfCounterValues a = { 100, 250, 5, 3, 7 };
+        Core::PerfCounterValues b = { 40, 50, 1, 1, 2 };
+
+        Core::PerfCounterValues d = difference( a, b );
+        REQUIRE( d.cycles == 60 );
+        REQUIRE( d.instructions == 200 );
+        REQUIRE( d.llcLoads == 5 );
+
+        // a count that went backwards doesn't wrap around
+        REQUIRE( difference(b, a).cycles == 0 );
+        REQUIRE( difference(b, a).instructions == 0 );
+
+        add( d, b );
+        REQUIRE( d.cycles == a.cycles );
+        REQUIRE( d.branchMisses == a.branchMisses );
+        REQUIRE( ipc(a) == Approx(2.5) );
+
+        Core::PerfCounterValues zero = {};
+        REQUIRE( ipc(zero) == 0.0 );
+    }
+
+    Core::destroyPerfCounters( counters );
+    Core::destroyAllocators();
+}
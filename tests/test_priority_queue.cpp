@@ -0,0 +1,81 @@
+#include "catch.hpp"
+
+#include "core/PriorityQueue.h"
+
+#include <functional>
+
+
+TEST_CASE( "[Core][PriorityQueue]" )
+{
+    Core::initAllocators();
+    
+    using Core::PriorityQueue;
+    using namespace Core::priorityQueue;
+    
+    SECTION( "Push / Pop" ) {
+        PriorityQueue<int> queue( Core::getDefaultAllocator() );
+        
+        for( int i=0; i < 1000; ++i ) {
+            push( queue, (i*7919) % 1000 );
+        }
+        REQUIRE( size(queue) == 1000 );
+        REQUIRE( top(queue) == 0 );
+        
+        bool inOrder = true;
+        for( int i=0; i < 1000; ++i ) {
+            inOrder = inOrder && pop(queue) == i;
+        }
+        REQUIRE( inOrder );
+        REQUIRE( isEmpty(queue) );
+    }
+    
+    SECTION( "Heapify / PopN" ) {
+        PriorityQueue<int, std::greater<int>, 8> queue( Core::getDefaultAllocator() );
+        
+        for( int i=0; i < 500; ++i ) {
+            pushUnordered( queue, (i*31) % 500 );
+        }
+        heapify( queue );
+        REQUIRE( top(queue) == 499 );
+        
+        int values[10];
+        REQUIRE( popN(queue, values, 10) == 10 );
+        REQUIRE( values[0] == 499 );
+        REQUIRE( values[9] == 490 );
+        REQUIRE( size(queue) == 490 );
+    }
+    
+    SECTION( "Index map / DecreaseKey" ) {
+        PriorityQueue<float> queue( Core::getDefaultAllocator() );
+        enableIndexMap( queue, 100 );
+        
+        for( uint32_t id=0; id < 100; ++id ) {
+            push( queue, float(100+id), id );
+        }
+        REQUIRE( contains(queue, 50) );
+        REQUIRE( topId(queue) == 0 );
+        
+        decreaseKey( queue, 50, 1.f );
+        REQUIRE( topId(queue) == 50 );
+        REQUIRE( top(queue) == 1.f );
+        
+        update( queue, 50, 1000.f );
+        REQUIRE( topId(queue) == 0 );
+        
+        REQUIRE( pop(queue) == 100.f );
+        REQUIRE( contains(queue, 0) == false );
+        
+        float previous = 0.f;
+        bool inOrder = true;
+        while( !isEmpty(queue) ) {
+            uint32_t id = topId( queue );
+            float value = pop( queue );
+            inOrder = inOrder && value >= previous && !contains(queue, id);
+            previous = value;
+        }
+        REQUIRE( inOrder );
+        REQUIRE( previous == 1000.f );
+    }
+    
+    Core::destroyAllocators();
+}
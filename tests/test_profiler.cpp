@@ -0,0 +1,221 @@
+#include "catch.hpp"
+
+#ifndef CORE_PROFILE
+#   define CORE_PROFILE 1
+#endif
+#include "core/Profiler.h"
+#include "core/Allocator.h"
+
+#include <cstring>
+#include <string>
+#include <thread>
+
+
+namespace {
+    void inner()
+    {
+        CORE_PROFILE_SCOPE( "Inner" );
+        volatile int sum = 0;
+        for( int i=0; i < 1000; ++i ) sum = sum + i;
+    }
+
+    void outer()
+    {
+        CORE_PROFILE_SCOPE( "Outer" );
+        inner();
+        inner();
+    }
+
+    const Core::ProfileSummary* findSummary( Core::Array<Core::ProfileSummary> &summary, const char *name )
+    {
+        for( Core::ProfileSummary *entry = Core::array::begin(summary); entry != Core::array::end(summary); ++entry ) {
+            if( std::strcmp(entry->site->name, name) == 0 ) return entry;
+        }
+        return nullptr;
+    }
+
+    std::string readFile( const char *path )
+    {
+        std::string text;
+        FILE *file = std::fopen( path, "r" );
+        if( !file ) return text;
+
+        char buffer[512];
+        std::size_t read;
+        while( (read = std::fread(buffer, 1, sizeof(buffer), file)) > 0 ) {
+            text.append( buffer, read );
+        }
+        std::fclose( file );
+        return text;
+    }
+}
+
+TEST_CASE( "[Core][Profiler]" )
+{
+    Core::initAllocators();
+
+    using namespace Core::profiler;
+
+    Core::Allocator *allocator = Core::getDefaultAllocator();
+
+    SECTION( "Stopped" ) {
+        Core::Array<Core::ProfileSummary> entries( allocator );
+        REQUIRE( !running() );
+        outer();
+
+        start( allocator );
+        REQUIRE( running() );
+        collect();
+        summary( entries );
+        REQUIRE( Core::array::size(entries) == 0 );
+        stop();
+        REQUIRE( !running() );
+
+        // scopes after stop are ignored as well
+        outer();
+        summary( entries );
+        REQUIRE( Core::array::size(entries) == 0 );
+    }
+
+    SECTION( "Nesting" ) {
+        Core::Array<Core::ProfileSummary> entries( allocator );
+        start( allocator );
+        for( int i=0; i < 10; ++i ) {
+            outer();
+        }
+        collect();
+        summary( entries );
+
+        REQUIRE( Core::array::size(entries) == 2 );
+        // sorted by total time, and the outer scope includes the inner ones
+        REQUIRE( std::strcmp(entries[0].site->name, "Outer") == 0 );
+
+        const Core::ProfileSummary *outerSummary = findSummary( entries, "Outer" );
+        const Core::ProfileSummary *innerSummary = findSummary( entries, "Inner" );
+        REQUIRE( outerSummary != nullptr );
+        REQUIRE( innerSummary != nullptr );
+        REQUIRE( outerSummary->count == 10 );
+        REQUIRE( innerSummary->count == 20 );
+        REQUIRE( outerSummary->totalMs >= innerSummary->totalMs );
+        REQUIRE( outerSummary->selfMs <= outerSummary->totalMs - innerSummary->totalMs + 1e-9 );
+        REQUIRE( innerSummary->selfMs == Approx(innerSummary->totalMs) );
+        REQUIRE( innerSummary->minMs <= innerSummary->maxMs );
+        REQUIRE( std::strstr(outerSummary->site->file, "test_profiler.cpp") != nullptr );
+
+        reset();
+        summary( entries );
+        REQUIRE( Core::array::size(entries) == 0 );
+
+        stop();
+    }
+
+    SECTION( "Open scopes" ) {
+        Core::Array<Core::ProfileSummary> entries( allocator );
+        start( allocator );
+        {
+            CORE_PROFILE_SCOPE( "Frame" );
+            inner();
+            // the frame hasn't ended yet, so only the inner scope is done
+            collect();
+            summary( entries );
+            REQUIRE( Core::array::size(entries) == 1 );
+            REQUIRE( std::strcmp(entries[0].site->name, "Inner") == 0 );
+        }
+        collect();
+        summary( entries );
+        REQUIRE( Core::array::size(entries) == 2 );
+        stop();
+    }
+
+    SECTION( "Dropped" ) {
+        Core::Array<Core::ProfileSummary> entries( allocator );
+        start( allocator, 16 );
+        for( int i=0; i < 100; ++i ) {
+            inner();
+        }
+        REQUIRE( droppedEvents() > 0 );
+
+        collect();
+        summary( entries );
+        REQUIRE( Core::array::size(entries) == 1 );
+        REQUIRE( entries[0].count == 8 );
+
+        // collecting makes room again
+        inner();
+        collect();
+        summary( entries );
+        REQUIRE( entries[0].count == 9 );
+        stop();
+    }
+
+    SECTION( "Threads" ) {
+        Core::Array<Core::ProfileSummary> entries( allocator );
+        start( allocator );
+        setThreadName( "Main" );
+
+        std::thread threads[4];
+        for( int i=0; i < 4; ++i ) {
+            threads[i] = std::thread( []() {
+                CORE_PROFILE_THREAD_NAME( "Worker" );
+                for( int j=0; j < 50; ++j ) {
+                    outer();
+                }
+            });
+        }
+        outer();
+        for( int i=0; i < 4; ++i ) {
+            threads[i].join();
+        }
+
+        collect();
+        summary( entries );
+        REQUIRE( findSummary(entries, "Outer")->count == 201 );
+        REQUIRE( findSummary(entries, "Inner")->count == 402 );
+        REQUIRE( droppedEvents() == 0 );
+
+        const char *path = "test_profiler_trace.json";
+        REQUIRE( writeChromeTrace(path) );
+
+        std::string trace = readFile( path );
+        REQUIRE( trace.compare(0, 17, "{\"displayTimeUnit") == 0 );
+        REQUIRE( trace.find("\"traceEvents\":[") != std::string::npos );
+        REQUIRE( trace.find("\"name\":\"Main\"") != std::string::npos );
+        REQUIRE( trace.find("\"name\":\"Worker\"") != std::string::npos );
+        REQUIRE( trace.find("\"name\":\"Outer\",\"cat\":\"core\",\"ph\":\"X\"") != std::string::npos );
+        REQUIRE( trace.compare(trace.size()-3, 3, "]}\n") == 0 );
+        std::remove( path );
+
+        stop();
+    }
+
+    SECTION( "Perf counters" ) {
+        Core::Array<Core::ProfileSummary> entries( allocator );
+
+        Core::PerfCounters *counters = Core::createPerfCounters( allocator );
+        if( counters ) {
+            Core::destroyPerfCounters( counters );
+
+            start( allocator, 1024, true );
+            for( int i=0; i < 10; ++i ) {
+                outer();
+            }
+            collect();
+            summary( entries );
+
+            const Core::ProfileSummary *outerSummary = findSummary( entries, "Outer" );
+            const Core::ProfileSummary *innerSummary = findSummary( entries, "Inner" );
+            // each inner scope loops a thousand times
+            REQUIRE( innerSummary->counters.instructions >= 20*1000 );
+            REQUIRE( outerSummary->counters.instructions >= innerSummary->counters.instructions );
+
+            const char *path = "test_profiler_counters.json";
+            REQUIRE( writeChromeTrace(path) );
+            REQUIRE( readFile(path).find("\"instructions\":") != std::string::npos );
+            std::remove( path );
+
+            stop();
+        }
+    }
+
+    Core::destroyAllocators();
+}
@@ -0,0 +1,140 @@
+#include "catch.hpp"
+
+#include "core/Queue.h"
+
+#include <thread>
+#include <vector>
+
+
+TEST_CASE( "[Core][SpscQueue]" )
+{
+    Core::initAllocators();
+    
+    using Core::SpscQueue;
+    using namespace Core::spscQueue;
+    
+    SECTION( "Capasity is a power of two" ) {
+        SpscQueue<int> queue( Core::getDefaultAllocator(), 100 );
+        REQUIRE( capasity(queue) == 128 );
+    }
+    
+    SECTION( "Push / Pop" ) {
+        SpscQueue<int> queue( Core::getDefaultAllocator(), 4 );
+        
+        REQUIRE( push(queue, 1) );
+        REQUIRE( push(queue, 2) );
+        REQUIRE( push(queue, 3) );
+        REQUIRE( push(queue, 4) );
+        REQUIRE( push(queue, 5) == false );
+        REQUIRE( size(queue) == 4 );
+        
+        int value = 0;
+        REQUIRE( pop(queue, value) );
+        REQUIRE( value == 1 );
+        
+        // wraps around the end of the buffer
+        int values[3] = { 6, 7, 8 };
+        REQUIRE( pushN(queue, values, 3) == 1 );
+        
+        int result[8];
+        REQUIRE( popN(queue, result, 8) == 4 );
+        REQUIRE( result[0] == 2 );
+        REQUIRE( result[3] == 6 );
+        REQUIRE( pop(queue, value) == false );
+    }
+    
+    SECTION( "Producer / Consumer threads" ) {
+        SpscQueue<int> queue( Core::getDefaultAllocator(), 64 );
+        const int COUNT = 100000;
+        
+        std::thread producer( [&queue]() {
+            for( int i=0; i < COUNT; ) {
+                if( push(queue, i) ) ++i;
+                else std::this_thread::yield();
+            }
+        });
+        
+        bool inOrder = true;
+        for( int expected=0; expected < COUNT; ) {
+            int values[16];
+            std::size_t count = popN( queue, values, 16 );
+            if( count == 0 ) std::this_thread::yield();
+            for( std::size_t i=0; i < count; ++i ) {
+                inOrder = inOrder && values[i] == expected++;
+            }
+        }
+        producer.join();
+        
+        REQUIRE( inOrder );
+    }
+    
+    Core::destroyAllocators();
+}
+
+TEST_CASE( "[Core][MpmcQueue]" )
+{
+    Core::initAllocators();
+    
+    using Core::MpmcQueue;
+    using namespace Core::mpmcQueue;
+    
+    SECTION( "Push / Pop" ) {
+        MpmcQueue<int> queue( Core::getDefaultAllocator(), 4 );
+        
+        int values[6] = { 1, 2, 3, 4, 5, 6 };
+        REQUIRE( pushN(queue, values, 6) == 4 );
+        REQUIRE( push(queue, 7) == false );
+        
+        int value = 0;
+        REQUIRE( pop(queue, value) );
+        REQUIRE( value == 1 );
+        REQUIRE( push(queue, 7) );
+        
+        int result[8];
+        REQUIRE( popN(queue, result, 8) == 4 );
+        REQUIRE( result[0] == 2 );
+        REQUIRE( result[3] == 7 );
+        REQUIRE( pop(queue, value) == false );
+    }
+    
+    SECTION( "Multiple producers / consumers" ) {
+        MpmcQueue<int> queue( Core::getDefaultAllocator(), 256 );
+        const int THREADS = 4;
+        const int COUNT = 20000;
+        
+        std::atomic<long long> sum( 0 );
+        std::atomic<int> popped( 0 );
+        std::vector<std::thread> threads;
+        
+        for( int t=0; t < THREADS; ++t ) {
+            threads.emplace_back( [&queue]() {
+                for( int i=1; i <= COUNT; ) {
+                    int batch[4] = { i, i+1, i+2, i+3 };
+                    int count = COUNT-i+1 < 4 ? COUNT-i+1 : 4;
+                    std::size_t pushed = pushN( queue, batch, count );
+                    if( pushed == 0 ) std::this_thread::yield();
+                    i += pushed;
+                }
+            });
+            threads.emplace_back( [&queue, &sum, &popped]() {
+                while( popped.load() < THREADS*COUNT ) {
+                    int values[8];
+                    std::size_t count = popN( queue, values, 8 );
+                    if( count == 0 ) std::this_thread::yield();
+                    for( std::size_t i=0; i < count; ++i ) {
+                        sum += values[i];
+                    }
+                    popped += count;
+                }
+            });
+        }
+        for( std::thread &thread : threads ) {
+            thread.join();
+        }
+        
+        REQUIRE( popped.load() == THREADS*COUNT );
+        REQUIRE( sum.load() == (long long)THREADS * COUNT * (COUNT+1) / 2 );
+    }
+    
+    Core::destroyAllocators();
+}
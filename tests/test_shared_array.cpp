@@ -0,0 +1,69 @@
+#include "catch.hpp"
+
+#include "core/SharedArray.h"
+
+
+TEST_CASE( "[Core][SharedArray]" )
+{
+    Core::initAllocators();
+    
+    using Core::SharedArray;
+    using namespace Core::sharedArray;
+    
+    SECTION( "Copies share the buffer" ) {
+        SharedArray<int> array( Core::getDefaultAllocator() );
+        for( int i=0; i < 100; ++i ) {
+            pushBack( array, i );
+        }
+        REQUIRE( isShared(array) == false );
+        
+        SharedArray<int> copy( array );
+        REQUIRE( isShared(array) );
+        REQUIRE( begin(copy) == begin(array) );
+        REQUIRE( copy[99] == 99 );
+        
+        SharedArray<int> other( Core::getDefaultAllocator() );
+        other = copy;
+        REQUIRE( begin(other) == begin(array) );
+    }
+    
+    SECTION( "Copy on write" ) {
+        SharedArray<int> array( Core::getDefaultAllocator() );
+        resize( array, 10 );
+        set( array, 5, 5 );
+        
+        SharedArray<int> copy( array );
+        set( copy, 5, 6 );
+        REQUIRE( begin(copy) != begin(array) );
+        REQUIRE( array[5] == 5 );
+        REQUIRE( copy[5] == 6 );
+        REQUIRE( isShared(array) == false );
+        REQUIRE( isShared(copy) == false );
+        
+        // popping doesn't copy, pushing does
+        SharedArray<int> second( array );
+        REQUIRE( popBack(second) == 0 );
+        REQUIRE( isShared(second) );
+        pushBack( second, 42 );
+        REQUIRE( isShared(second) == false );
+        REQUIRE( second[9] == 42 );
+        REQUIRE( array[9] == 0 );
+    }
+    
+    SECTION( "Move / Assign" ) {
+        SharedArray<int> array( Core::getDefaultAllocator() );
+        int values[3] = { 1, 2, 3 };
+        assign( array, Core::ArrayView<int>(values) );
+        REQUIRE( size(array) == 3 );
+        
+        SharedArray<int> moved( std::move(array) );
+        REQUIRE( isNull(array) );
+        REQUIRE( moved[2] == 3 );
+        
+        Core::MutableArrayView<int> view = mutableView( moved );
+        view[0] = 7;
+        REQUIRE( moved[0] == 7 );
+    }
+    
+    Core::destroyAllocators();
+}
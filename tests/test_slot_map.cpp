@@ -0,0 +1,98 @@
+#include "catch.hpp"
+
+#include "core/SlotMap.h"
+
+
+TEST_CASE( "[Core][SlotMap]" )
+{
+    Core::initAllocators();
+    
+    using Core::SlotMap;
+    using namespace Core::slotMap;
+    
+    SECTION( "Insert / Lookup / Erase" ) {
+        SlotMap<int> map( Core::getDefaultAllocator() );
+        
+        uint32_t a = insert( map, 1 ),
+                 b = insert( map, 2 ),
+                 c = insert( map, 3 );
+        
+        REQUIRE( size(map) == 3 );
+        REQUIRE( *lookup(map, a) == 1 );
+        REQUIRE( *lookup(map, b) == 2 );
+        REQUIRE( *lookup(map, c) == 3 );
+        REQUIRE( lookup(map, SlotMap<int>::NULL_HANDLE) == nullptr );
+        
+        REQUIRE( erase(map, a) );
+        REQUIRE( erase(map, a) == false );
+        REQUIRE( contains(map, a) == false );
+        REQUIRE( size(map) == 2 );
+        REQUIRE( *lookup(map, b) == 2 );
+        REQUIRE( *lookup(map, c) == 3 );
+        
+        // the slot is reused, but with a new generation
+        uint32_t d = insert( map, 4 );
+        REQUIRE( handleIndex(map, d) == handleIndex(map, a) );
+        REQUIRE( d != a );
+        REQUIRE( lookup(map, a) == nullptr );
+        REQUIRE( *lookup(map, d) == 4 );
+    }
+    
+    SECTION( "Elements are dense" ) {
+        SlotMap<int, uint64_t> map( Core::getDefaultAllocator() );
+        uint64_t handles[100];
+        
+        for( int i=0; i < 100; ++i ) {
+            handles[i] = insert( map, i );
+        }
+        for( int i=0; i < 100; i += 2 ) {
+            erase( map, handles[i] );
+        }
+        REQUIRE( size(map) == 50 );
+        
+        int sum = 0;
+        for( const int *it = begin(map); it != end(map); ++it ) {
+            sum += *it;
+        }
+        REQUIRE( sum == 2500 );
+        
+        for( std::size_t i=0; i < size(map); ++i ) {
+            REQUIRE( *lookup(map, handleAt(map, i)) == begin(map)[i] );
+        }
+        for( int i=1; i < 100; i += 2 ) {
+            REQUIRE( *lookup(map, handles[i]) == i );
+        }
+        
+        clear( map );
+        REQUIRE( size(map) == 0 );
+        REQUIRE( contains(map, handles[1]) == false );
+    }
+    
+    SECTION( "Generation wraps" ) {
+        SlotMap<int> map( Core::getDefaultAllocator() );
+        
+        // another element, so a free slot taken as live would index into the values
+        insert( map, -1 );
+        uint32_t first = insert( map, 0 );
+        uint32_t handle = first;
+        
+        // each round uses two generations, so old handles come around every 2048 rounds
+        bool freeRejected = true;
+        for( int round=0; round < 5000; ++round ) {
+            REQUIRE( erase(map, handle) );
+            if( contains(map, first) || lookup(map, first) != nullptr || erase(map, first) ) {
+                freeRejected = false;
+            }
+            handle = insert( map, round );
+            if( handleGeneration(map, handle) % 2 == 0 ) {
+                freeRejected = false;
+            }
+        }
+        REQUIRE( freeRejected );
+        REQUIRE( size(map) == 2 );
+        REQUIRE( *lookup(map, handle) == 4999 );
+        REQUIRE( lookup(map, SlotMap<int>::NULL_HANDLE) == nullptr );
+    }
+    
+    Core::destroyAllocators();
+}
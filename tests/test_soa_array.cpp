@@ -0,0 +1,81 @@
+#include "catch.hpp"
+
+#include "core/SoAArray.h"
+
+#include <cstdint>
+
+
+TEST_CASE( "[Core][SoAArray]" )
+{
+    Core::initAllocators();
+    
+    using Core::SoAArray;
+    using namespace Core::soaArray;
+    
+    typedef SoAArray<float, int, char> TestArray;
+    
+    SECTION( "Construction / Destruction" ) {
+        TestArray array( Core::getDefaultAllocator() );
+        
+        resize( array, 10 );
+        REQUIRE( size(array) == 10 );
+        REQUIRE( get<1>(array, 9) == 0 );
+    }
+    
+    SECTION( "Columns are aligned" ) {
+        TestArray array( Core::getDefaultAllocator() );
+        
+        resize( array, 13 );
+        REQUIRE( (reinterpret_cast<uintptr_t>(column<0>(array)) % TestArray::COLUMN_ALIGNMENT) == 0 );
+        REQUIRE( (reinterpret_cast<uintptr_t>(column<1>(array)) % TestArray::COLUMN_ALIGNMENT) == 0 );
+        REQUIRE( (reinterpret_cast<uintptr_t>(column<2>(array)) % TestArray::COLUMN_ALIGNMENT) == 0 );
+    }
+    
+    SECTION( "PushBack / SwapRemove" ) {
+        TestArray array( Core::getDefaultAllocator() );
+        
+        for( int i=0; i < 100; ++i ) {
+            pushBack( array, float(i), i*2, char(i) );
+        }
+        REQUIRE( size(array) == 100 );
+        REQUIRE( capasity(array) >= 100 );
+        
+        for( int i=0; i < 100; ++i ) {
+            REQUIRE( column<0>(array)[i] == float(i) );
+            REQUIRE( column<1>(array)[i] == i*2 );
+            REQUIRE( column<2>(array)[i] == char(i) );
+        }
+        
+        swapRemove( array, 10 );
+        REQUIRE( size(array) == 99 );
+        REQUIRE( get<0>(array, 10) == 99.f );
+        REQUIRE( get<1>(array, 10) == 198 );
+        REQUIRE( get<2>(array, 10) == char(99) );
+        
+        swapRemove( array, 98 );
+        REQUIRE( size(array) == 98 );
+    }
+    
+    SECTION( "Copy / Move" ) {
+        TestArray array( Core::getDefaultAllocator() );
+        for( int i=0; i < 20; ++i ) {
+            pushBack( array, float(i), i, char(i) );
+        }
+        
+        TestArray copy( array );
+        REQUIRE( size(copy) == 20 );
+        REQUIRE( column<1>(copy) != column<1>(array) );
+        REQUIRE( get<1>(copy, 19) == 19 );
+        
+        TestArray moved( std::move(copy) );
+        REQUIRE( size(moved) == 20 );
+        REQUIRE( isNull(copy) );
+        REQUIRE( get<0>(moved, 5) == 5.f );
+        
+        trim( moved );
+        REQUIRE( capasity(moved) == 20 );
+        REQUIRE( get<2>(moved, 19) == char(19) );
+    }
+    
+    Core::destroyAllocators();
+}
@@ -0,0 +1,57 @@
+#include "catch.hpp"
+
+#include "core/StaticSearchIndex.h"
+
+#include <algorithm>
+
+
+TEST_CASE( "[Core][StaticSearchIndex]" )
+{
+    Core::initAllocators();
+    
+    using Core::Array;
+    using Core::StaticSearchIndex;
+    using namespace Core::staticSearchIndex;
+    
+    SECTION( "Matches a binary search" ) {
+        for( int count=0; count < 70; ++count ) {
+            Array<int> sorted( Core::getDefaultAllocator() );
+            for( int i=0; i < count; ++i ) {
+                Core::array::pushBack( sorted, i*3 );
+            }
+            
+            StaticSearchIndex<int> index( Core::getDefaultAllocator() );
+            build( index, sorted );
+            REQUIRE( size(index) == std::size_t(count) );
+            
+            for( int key=-2; key < count*3+2; ++key ) {
+                std::size_t expected = std::lower_bound( Core::array::begin(sorted), Core::array::end(sorted), key ) - Core::array::begin(sorted);
+                REQUIRE( lowerBound(index, key) == expected );
+                REQUIRE( find(index, key) == (key >= 0 && key % 3 == 0 && key < count*3 ? expected : std::size_t(count)) );
+            }
+        }
+    }
+    
+    SECTION( "Batched search" ) {
+        Array<int> sorted( Core::getDefaultAllocator() );
+        for( int i=0; i < 1000; ++i ) {
+            Core::array::pushBack( sorted, i*2 );
+        }
+        
+        StaticSearchIndex<int> index( Core::getDefaultAllocator() );
+        build( index, sorted );
+        
+        int queries[100];
+        std::size_t results[100];
+        for( int i=0; i < 100; ++i ) {
+            queries[i] = (i*397) % 2003 - 1;
+        }
+        lowerBoundBatch( index, queries, 100, results );
+        
+        for( int i=0; i < 100; ++i ) {
+            REQUIRE( results[i] == lowerBound(index, queries[i]) );
+        }
+    }
+    
+    Core::destroyAllocators();
+}
@@ -0,0 +1,122 @@
+#include "catch.hpp"
+
+#include "core/StringTable.h"
+#include "core/Array.h"
+#include "core/Allocator.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+
+
+TEST_CASE( "[Core][StringTable]" )
+{
+    Core::initAllocators();
+    
+    using Core::StringId;
+    using Core::StringTable;
+    using namespace Core::stringTable;
+    
+    SECTION( "Intern / Lookup" ) {
+        StringTable table( Core::getDefaultAllocator() );
+        
+        StringId a = intern( table, "position" ),
+                 b = intern( table, "velocity" ),
+                 c = intern( table, std::string("position").c_str() );
+        
+        REQUIRE( a == c );
+        REQUIRE( a != b );
+        REQUIRE( size(table) == 2 );
+        REQUIRE( std::strcmp(lookup(table, a), "position") == 0 );
+        REQUIRE( length(table, b) == 8 );
+        REQUIRE( lookup(table, StringId{ hash("missing") }) == nullptr );
+        
+        // the interned strings never move
+        const char *position = lookup( table, a );
+        for( int i=0; i < 10000; ++i ) {
+            intern( table, std::to_string(i).c_str() );
+        }
+        REQUIRE( size(table) == 10002 );
+        REQUIRE( lookup(table, a) == position );
+        REQUIRE( std::strcmp(lookup(table, intern(table, "9999")), "9999") == 0 );
+    }
+    
+    SECTION( "Compile time ids" ) {
+        static_assert( hash("name") == 0xc4bcadba8e631b86ull, "hash must be constexpr" );
+        
+        StringTable table( Core::getDefaultAllocator() );
+        setDebugTable( &table );
+        
+        StringId id = STRING_ID( "transform" );
+        REQUIRE( id == intern(table, "transform", 9) );
+        REQUIRE( id.value == hash("transform", 9) );
+#ifndef NDEBUG
+        REQUIRE( std::strcmp(lookup(table, id), "transform") == 0 );
+#endif
+        
+        setDebugTable( nullptr );
+    }
+    
+    SECTION( "Debug table from many threads" ) {
+        StringTable table( Core::getDefaultAllocator() );
+        setDebugTable( &table );
+        
+        // the same names from every thread, while the table grows
+        std::thread threads[4];
+        for( int t=0; t < 4; ++t ) {
+            threads[t] = std::thread( []() {
+                char name[32];
+                for( int i=0; i < 20000; ++i ) {
+                    std::snprintf( name, sizeof(name), "component_%d", i );
+                    STRING_ID( name );
+                }
+            });
+        }
+        for( int t=0; t < 4; ++t ) {
+            threads[t].join();
+        }
+        setDebugTable( nullptr );
+        
+#ifndef NDEBUG
+        REQUIRE( size(table) == 20000 );
+        REQUIRE( std::strcmp(lookup(table, STRING_ID("component_19999")), "component_19999") == 0 );
+#endif
+    }
+    
+    SECTION( "Many strings" ) {
+        StringTable table( Core::getDefaultAllocator() );
+        
+        // far past where 32 bit ids would be expected to collide
+        char name[32];
+        for( int i=0; i < 200000; ++i ) {
+            std::snprintf( name, sizeof(name), "entity_%d", i );
+            intern( table, name );
+        }
+        REQUIRE( size(table) == 200000 );
+        REQUIRE( std::strcmp(lookup(table, STRING_ID("entity_123456")), "entity_123456") == 0 );
+        
+        StringId id;
+        REQUIRE( tryIntern(table, "entity_7", 8, id) );
+        REQUIRE( id == STRING_ID("entity_7") );
+        REQUIRE( size(table) == 200000 );
+    }
+    
+    SECTION( "Interning again doesn't grow" ) {
+        StringTable table( Core::getDefaultAllocator() );
+        
+        // fill up to the load factor, one more string would grow the table
+        char name[32];
+        int count = 0;
+        do {
+            std::snprintf( name, sizeof(name), "%d", count++ );
+            intern( table, name );
+        } while( (size(table)+1)*2 <= Core::array::size(table._entries) );
+        const std::size_t capasity = Core::array::size( table._entries );
+        
+        intern( table, "0" );
+        REQUIRE( Core::array::size(table._entries) == capasity );
+    }
+    
+    Core::destroyAllocators();
+}
@@ -0,0 +1,197 @@
+#include "catch.hpp"
+
+#include "core/Sync.h"
+#include "core/Allocator.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+
+namespace {
+    const int THREADS = 4;
+    const int ITERATIONS = 20000;
+
+    // a counter that is only correct if the lock is exclusive
+    template< typename Lock >
+    int countWith( Lock &lock )
+    {
+        int count = 0;
+        std::thread threads[THREADS];
+        for( int t=0; t < THREADS; ++t ) {
+            threads[t] = std::thread( [&lock, &count]() {
+                for( int i=0; i < ITERATIONS; ++i ) {
+                    std::lock_guard<Lock> guard( lock );
+                    count++;
+                }
+            });
+        }
+        for( int t=0; t < THREADS; ++t ) {
+            threads[t].join();
+        }
+        return count;
+    }
+
+    struct Pair {
+        uint64_t a, b;
+    };
+}
+
+TEST_CASE( "[Core][Sync]" )
+{
+    Core::initAllocators();
+
+    SECTION( "SpinLock" ) {
+        Core::LockStats stats( "spin" );
+        Core::SpinLock lock( &stats );
+
+        REQUIRE( lock.tryLock() );
+        REQUIRE( !lock.tryLock() );
+        lock.unlock();
+
+        REQUIRE( countWith(lock) == THREADS*ITERATIONS );
+        REQUIRE( stats.acquisitions.load() == uint64_t(THREADS*ITERATIONS + 1) );
+        REQUIRE( stats.contentions.load() <= stats.acquisitions.load() );
+    }
+
+    SECTION( "Mutex" ) {
+        Core::LockStats stats( "mutex" );
+        Core::Mutex mutex( &stats );
+
+        REQUIRE( mutex.tryLock() );
+        REQUIRE( !mutex.tryLock() );
+        mutex.unlock();
+
+        REQUIRE( countWith(mutex) == THREADS*ITERATIONS );
+        REQUIRE( stats.acquisitions.load() == uint64_t(THREADS*ITERATIONS + 1) );
+
+        // without stats
+        Core::Mutex plain;
+        REQUIRE( countWith(plain) == THREADS*ITERATIONS );
+    }
+
+    SECTION( "Mutex spins adapt" ) {
+        Core::LockStats stats( "adaptive" );
+        Core::Mutex mutex( &stats );
+        REQUIRE( mutex.spinEstimate() == 0 );
+
+        // held far longer than any spin, so every waiter spins its whole limit and sleeps
+        for( int i=0; i < 40; ++i ) {
+            mutex.lock();
+            std::thread waiter( [&mutex]() {
+                mutex.lock();
+                mutex.unlock();
+            });
+            while( stats.contentions.load() <= uint64_t(i) ) {
+                std::this_thread::yield();
+            }
+            std::this_thread::sleep_for( std::chrono::milliseconds(1) );
+            mutex.unlock();
+            waiter.join();
+        }
+        const int estimate = mutex.spinEstimate();
+        REQUIRE( estimate > 50 );
+        REQUIRE( estimate <= int(Core::Mutex::MAX_SPINS) );
+    }
+
+    SECTION( "Condition" ) {
+        Core::Mutex mutex;
+        Core::Condition condition;
+
+        // passes a token back and forth between two threads
+        int turn = 0;
+        int passes = 0;
+        std::thread other( [&]() {
+            for( int i=0; i < 1000; ++i ) {
+                std::lock_guard<Core::Mutex> guard( mutex );
+                condition.wait( mutex, [&]() { return turn == 1; } );
+                turn = 0;
+                passes++;
+                condition.notifyAll();
+            }
+        });
+        for( int i=0; i < 1000; ++i ) {
+            std::lock_guard<Core::Mutex> guard( mutex );
+            condition.wait( mutex, [&]() { return turn == 0; } );
+            turn = 1;
+            passes++;
+            condition.notifyOne();
+        }
+        other.join();
+
+        REQUIRE( passes == 2000 );
+    }
+
+    SECTION( "RWLock" ) {
+        Core::LockStats stats( "rw" );
+        Core::RWLock lock( &stats );
+
+        // readers share it
+        lock.lockShared();
+        lock.lockShared();
+        lock.unlockShared();
+        lock.unlockShared();
+
+        REQUIRE( countWith(lock) == THREADS*ITERATIONS );
+
+        // readers always see both halves written together
+        Pair pair = { 0, 0 };
+        std::atomic<bool> torn( false );
+        std::atomic<bool> done( false );
+
+        std::thread readers[2];
+        for( int t=0; t < 2; ++t ) {
+            readers[t] = std::thread( [&]() {
+                while( !done.load() ) {
+                    lock.lockShared();
+                    if( pair.a != pair.b ) torn.store( true );
+                    lock.unlockShared();
+                    std::this_thread::yield();
+                }
+            });
+        }
+        for( uint64_t i=1; i <= 5000; ++i ) {
+            lock.lock();
+            pair.a = i;
+            pair.b = i;
+            lock.unlock();
+        }
+        done.store( true );
+        for( int t=0; t < 2; ++t ) {
+            readers[t].join();
+        }
+
+        REQUIRE( !torn.load() );
+        REQUIRE( pair.a == 5000 );
+    }
+
+    SECTION( "SeqLock" ) {
+        Core::LockStats stats( "seq" );
+        Pair initial = { 0, 0 };
+        Core::SeqLock<Pair> lock( initial, &stats );
+
+        std::atomic<bool> torn( false );
+        std::atomic<bool> done( false );
+        std::thread reader( [&]() {
+            uint64_t last = 0;
+            while( !done.load() ) {
+                Pair pair = lock.read();
+                if( pair.a != pair.b || pair.a < last ) torn.store( true );
+                last = pair.a;
+            }
+        });
+
+        for( uint64_t i=1; i <= 20000; ++i ) {
+            Pair pair = { i, i };
+            lock.write( pair );
+        }
+        done.store( true );
+        reader.join();
+
+        REQUIRE( !torn.load() );
+        REQUIRE( lock.read().a == 20000 );
+    }
+
+    Core::destroyAllocators();
+}
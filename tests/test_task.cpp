@@ -0,0 +1,207 @@
+#include "catch.hpp"
+
+#include "core/Task.h"
+
+#ifdef CORE_HAS_COROUTINES
+
+#include "core/Allocator.h"
+#include "core/JobSystem.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+
+namespace {
+    class CountingAllocator :
+        public Core::Allocator
+    {
+    public:
+        CountingAllocator( Core::Allocator *backer ) :
+            backer(backer),
+            allocations(0),
+            frees(0)
+        {
+        }
+
+        virtual void* allocate( std::size_t size, std::size_t alignment )
+        {
+            allocations.fetch_add( 1 );
+            return backer->allocate( size, alignment );
+        }
+
+        virtual void free( void *ptr )
+        {
+            frees.fetch_add( 1 );
+            backer->free( ptr );
+        }
+
+        Core::Allocator *backer;
+        std::atomic<int> allocations,
+                         frees;
+    };
+
+    Core::Task<int> value( int value )
+    {
+        co_return value;
+    }
+
+    Core::Task<int> sum( int count )
+    {
+        int total = 0;
+        for( int i=1; i <= count; ++i ) {
+            total += co_await value( i );
+        }
+        co_return total;
+    }
+
+    Core::Task<int> scheduled( Core::JobSystem *system, std::atomic<int> *worker )
+    {
+        co_await Core::task::schedule( system );
+        worker->store( Core::jobSystem::currentWorker(system) );
+        co_return co_await sum( 10 );
+    }
+
+    void storeJobPointer( Core::JobSystem *, void *data )
+    {
+        (*static_cast<std::atomic<int>**>(data))->store( 42 );
+    }
+
+    Core::Task<int> awaitJobPointer( Core::JobSystem *system )
+    {
+        std::atomic<int> stored( 0 );
+        std::atomic<int> *pointer = &stored;
+        co_await Core::task::run( system, storeJobPointer, &pointer, sizeof(pointer) );
+        co_return stored.load();
+    }
+
+    void countJob( Core::JobSystem *, void *data )
+    {
+        (*static_cast<std::atomic<int>**>(data))->fetch_add( 1 );
+    }
+
+    Core::Task<int> awaitCounter( Core::JobSystem *system )
+    {
+        std::atomic<int> count( 0 );
+        std::atomic<int> *pointer = &count;
+
+        Core::JobCounter counter;
+        for( int i=0; i < 100; ++i ) {
+            Core::jobSystem::run( system, countJob, &pointer, sizeof(pointer), &counter );
+        }
+        co_await Core::task::wait( system, counter );
+        co_return count.load();
+    }
+
+    // awaited on a worker, and finished by a thread that isn't one
+    Core::Task<int> awaitOtherThread( Core::JobSystem *system, Core::JobCounter *counter, std::atomic<int> *worker )
+    {
+        co_await Core::task::schedule( system );
+        worker->store( Core::jobSystem::currentWorker(system) );
+        co_await Core::task::wait( system, *counter );
+        co_return 7;
+    }
+
+    Core::Task<void> increment( std::atomic<int> *count )
+    {
+        count->fetch_add( 1 );
+        co_return;
+    }
+
+    Core::Task<int> whenAllMixed( Core::JobSystem *system )
+    {
+        std::atomic<int> count( 0 );
+        Core::Task<int> a = sum( 10 );
+        Core::Task<int> b = value( 7 );
+        Core::Task<void> c = increment( &count );
+
+        co_await Core::task::whenAll( system, a, b, c );
+        co_return a.result() + b.result() + count.load();
+    }
+
+    Core::Task<int> whenAllArray( Core::JobSystem *system )
+    {
+        Core::Task<int> tasks[32];
+        for( int i=0; i < 32; ++i ) {
+            tasks[i] = sum( i );
+        }
+
+        co_await Core::task::whenAll( system, tasks, 32 );
+
+        int total = 0;
+        for( int i=0; i < 32; ++i ) {
+            total += tasks[i].result();
+        }
+        co_return total;
+    }
+}
+
+TEST_CASE( "[Core][Task]" )
+{
+    Core::initAllocators();
+
+    using namespace Core::task;
+
+    Core::JobSystem *system = Core::createJobSystem( Core::getDefaultAllocator(), 4 );
+
+    SECTION( "Await" ) {
+        REQUIRE( syncWait(system, value(3)) == 3 );
+        REQUIRE( syncWait(system, sum(100)) == 5050 );
+
+        Core::Task<int> task = sum( 4 );
+        REQUIRE( !task.done() );
+        REQUIRE( syncWait(system, task) == 10 );
+        REQUIRE( task.done() );
+    }
+
+    SECTION( "Jobs" ) {
+        std::atomic<int> worker( -2 );
+        REQUIRE( syncWait(system, scheduled(system, &worker)) == 55 );
+        REQUIRE( worker.load() >= 0 );
+
+        REQUIRE( syncWait(system, awaitJobPointer(system)) == 42 );
+        REQUIRE( syncWait(system, awaitCounter(system)) == 100 );
+    }
+
+    SECTION( "Counter finished by another thread" ) {
+        Core::JobCounter counter;
+        counter.value.store( 1 );
+        std::atomic<int> worker( -2 );
+
+        // by the time it is decreased the coroutine is parked, and the workers are asleep
+        std::thread other( [system, &counter]() {
+            std::this_thread::sleep_for( std::chrono::milliseconds(50) );
+            Core::jobSystem::decrementCounter( system, counter );
+        });
+        REQUIRE( syncWait(system, awaitOtherThread(system, &counter, &worker)) == 7 );
+        other.join();
+        REQUIRE( worker.load() >= 0 );
+    }
+
+    SECTION( "When all" ) {
+        REQUIRE( syncWait(system, whenAllMixed(system)) == 55 + 7 + 1 );
+
+        int expected = 0;
+        for( int i=0; i < 32; ++i ) expected += i*(i+1)/2;
+        REQUIRE( syncWait(system, whenAllArray(system)) == expected );
+    }
+
+    SECTION( "Frame allocator" ) {
+        CountingAllocator counting( Core::getDefaultAllocator() );
+        setFrameAllocator( &counting );
+        {
+            // sum runs on this thread, so the tasks it awaits are from the frame allocator too
+            Core::Task<int> task = sum( 10 );
+            REQUIRE( syncWait(system, task) == 55 );
+        }
+        setFrameAllocator( nullptr );
+
+        REQUIRE( counting.allocations.load() > 10 );
+        REQUIRE( counting.allocations.load() == counting.frees.load() );
+    }
+
+    Core::destroyJobSystem( system );
+    Core::destroyAllocators();
+}
+
+#endif